@@ -39,13 +39,16 @@ VulkanAppBase::~VulkanAppBase() {
 
 	destroyMultisampleColorBuffer();
 	destroyDepthStencilImage();
+	devices.uploadManager.cleanup();
+	devices.timelineSync.cleanup();
+	commandRecorder.cleanup();
+	frameRingBuffer.cleanup();
 	devices.memoryAllocator.cleanup();
 
 	if (!presentCompleteSemaphores.empty()) {
 		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
 			vkDestroySemaphore(devices.device, presentCompleteSemaphores[i], nullptr);
 			vkDestroySemaphore(devices.device, renderCompleteSemaphores[i], nullptr);
-			vkDestroyFence(devices.device, frameLimitFences[i], nullptr);
 		}
 	}
 
@@ -87,6 +90,8 @@ void VulkanAppBase::run() {
 		currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
 	}
 	vkDeviceWaitIdle(devices.device);
+	//run pending deletions before the app destroys pools & memory they depend on
+	devices.timelineSync.collect();
 }
 
 /*
@@ -197,10 +202,14 @@ void VulkanAppBase::updateCamera() {
 */
 void VulkanAppBase::initApp() {
 	createCommandBuffers();
+	commandRecorder.init(&devices, MAX_FRAMES_IN_FLIGHT);
 	createSyncObjects();
 	createPipelineCache();
 	createDepthStencilImage(sampleCount);
 	createMultisampleColorBuffer(sampleCount);
+	frameRingBuffer.init(&devices, frameRingBufferSize, MAX_FRAMES_IN_FLIGHT,
+		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+		VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
 }
 
 /*
@@ -219,6 +228,11 @@ void VulkanAppBase::update() {
 	dt = time - oldTime;
 	oldTime = time;
 
+	//reclaim transient memory of this frame once its previous submission is finished
+	frameRingBuffer.beginFrame(currentFrame, frameTimelineValues[currentFrame]);
+	//destroy resources released by finished frames
+	devices.timelineSync.collect();
+
 	//mouse info update
 	glfwGetCursorPos(window, &xpos, &ypos);
 	leftPressed		= (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS);
@@ -245,6 +259,18 @@ void VulkanAppBase::update() {
 		oldPrintKeyState = GLFW_RELEASE;
 	}
 
+	//memory statistics
+	static int oldStatsKeyState = GLFW_RELEASE;
+	if (glfwGetKey(window, GLFW_KEY_F6) == GLFW_PRESS && oldStatsKeyState == GLFW_RELEASE) {
+		oldStatsKeyState = GLFW_PRESS;
+		std::ofstream file("memory_statistics.json");
+		file << devices.memoryAllocator.getStatisticsJson();
+		LOG("save memory statistics: memory_statistics.json");
+	}
+	if (glfwGetKey(window, GLFW_KEY_F6) == GLFW_RELEASE && oldStatsKeyState == GLFW_PRESS) {
+		oldStatsKeyState = GLFW_RELEASE;
+	}
+
 	if (captureMouse == true) {
 		updateCamera();
 	}
@@ -257,7 +283,7 @@ void VulkanAppBase::update() {
 
 	imguiBase->newFrame();
 	//imgui buffer updated || (mouse hovering imgui window && clicked)
-	if (imguiBase->updateBuffers() || (ImGui::IsMouseDown(ImGuiMouseButton(0)) && io.WantCaptureKeyboard)) {
+	if (imguiBase->updateBuffers(currentFrame) || (ImGui::IsMouseDown(ImGuiMouseButton(0)) && io.WantCaptureKeyboard)) {
 		if (imguiBase->deferCommandBufferRecord) {
 			//defer command buffer record
 			return;
@@ -271,7 +297,7 @@ void VulkanAppBase::update() {
 * image acquisition & check swapchain compatible
 */
 uint32_t VulkanAppBase::prepareFrame() {
-	vkWaitForFences(devices.device, 1, &frameLimitFences[currentFrame], VK_TRUE, UINT64_MAX);
+	devices.timelineSync.wait(TimelineSync::GRAPHICS, frameTimelineValues[currentFrame]);
 
 	//prepare image
 	uint32_t imageIndex;
@@ -284,16 +310,33 @@ uint32_t VulkanAppBase::prepareFrame() {
 	}
 
 	//check current image is already in-flight
-	if (inFlightImageFences[imageIndex] != VK_NULL_HANDLE) {
-		vkWaitForFences(devices.device, 1, &inFlightImageFences[imageIndex], VK_TRUE, UINT64_MAX);
-	}
-	//update image status
-	inFlightImageFences[imageIndex] = frameLimitFences[currentFrame];
-	vkResetFences(devices.device, 1, &frameLimitFences[currentFrame]);
+	devices.timelineSync.wait(TimelineSync::GRAPHICS, imageTimelineValues[imageIndex]);
 
 	return imageIndex;
 }
 
+/*
+* submit the frame's graphics work - waits for image acquisition, signals presentation & the graphics timeline
+*
+* @param imageIndex - acquired by prepareFrame()
+* @param cmdBufs - command buffers of the frame
+* @param extraWaits - timeline waits on other queues (compute ...)
+*
+* @return uint64_t - graphics timeline value of the frame
+*/
+uint64_t VulkanAppBase::submitGraphics(uint32_t imageIndex, const std::vector<VkCommandBuffer>& cmdBufs,
+	const std::vector<TimelineSync::Wait>& extraWaits) {
+	std::vector<TimelineSync::Wait> waits = {
+		{ presentCompleteSemaphores[currentFrame], 0, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT }
+	};
+	waits.insert(waits.end(), extraWaits.begin(), extraWaits.end());
+	uint64_t value = devices.timelineSync.submit(TimelineSync::GRAPHICS, cmdBufs,
+		waits, { renderCompleteSemaphores[currentFrame] });
+	frameTimelineValues[currentFrame] = value;
+	imageTimelineValues[imageIndex] = value;
+	return value;
+}
+
 /*
 * image presentation & check swapchain compatible
 */
@@ -321,11 +364,11 @@ void VulkanAppBase::resizeWindow(bool recordCmdBuf) {
 		glfwWaitEvents();
 	}
 
-	//finish all command before destroy vk resources
-	vkDeviceWaitIdle(devices.device);
+	//old resources are destroyed once frames in flight are finished - no device wait
 
 	//swapchain
 	swapchain.create();
+	imageTimelineValues.resize(swapchain.imageCount, 0);
 
 	//depth stencil image
 	destroyDepthStencilImage();
@@ -337,10 +380,9 @@ void VulkanAppBase::resizeWindow(bool recordCmdBuf) {
 	//framebuffer
 	createFramebuffers();
 
-	//imgui displat size update
+	//imgui displat size update - draw data & buffers are updated with the next frame
 	ImGuiIO& io = ImGui::GetIO();
 	io.DisplaySize = ImVec2(static_cast<float>(width), static_cast<float>(height));
-	imguiBase->updateBuffers();
 
 	//command buffers
 	destroyCommandBuffers();
@@ -370,6 +412,22 @@ void VulkanAppBase::resetCommandBuffer() {
 	createCommandBuffers();
 }
 
+/*
+* defer destruction of resources used by frames in flight - replaces waiting for the device
+*
+* @param destroy - destroys the resource once every frame submitted so far is finished
+*/
+void VulkanAppBase::destroyLater(std::function<void()> destroy) {
+	devices.timelineSync.destroyLater(TimelineSync::GRAPHICS, std::move(destroy));
+}
+
+/*
+* block until every frame submitted so far is finished - needed before rewriting per-frame descriptor sets
+*/
+void VulkanAppBase::waitFramesInFlight() {
+	devices.timelineSync.wait(TimelineSync::GRAPHICS, devices.timelineSync.getSubmittedValue(TimelineSync::GRAPHICS));
+}
+
 /*
 * helper function - creates vulkan instance
 */
@@ -493,35 +551,33 @@ void VulkanAppBase::createCommandBuffers() {
 }
 
 /*
-* helper function - free command buffers
+* helper function - free command buffers once frames in flight are finished
 */
 void VulkanAppBase::destroyCommandBuffers() {
 	if (!commandBuffers.empty()) {
-		vkFreeCommandBuffers(devices.device, devices.commandPool,
-			static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
+		destroyLater([device = devices.device, commandPool = devices.commandPool, oldCommandBuffers = commandBuffers]() {
+			vkFreeCommandBuffers(device, commandPool,
+				static_cast<uint32_t>(oldCommandBuffers.size()), oldCommandBuffers.data());
+		});
+		commandBuffers.clear();
 	}
 }
 
 /*
-* create semaphore & fence
+* create semaphores & per-frame / per-image timeline values
 */
 void VulkanAppBase::createSyncObjects() {
 	presentCompleteSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
 	renderCompleteSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-	frameLimitFences.resize(MAX_FRAMES_IN_FLIGHT);
-	inFlightImageFences.resize(swapchain.imageCount, VK_NULL_HANDLE);
+	frameTimelineValues.resize(MAX_FRAMES_IN_FLIGHT, 0);
+	imageTimelineValues.resize(swapchain.imageCount, 0);
 
 	VkSemaphoreCreateInfo semaphoreInfo{};
 	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-	VkFenceCreateInfo fenceInfo{};
-	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
 	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
 		VK_CHECK_RESULT(vkCreateSemaphore(devices.device, &semaphoreInfo, nullptr, &presentCompleteSemaphores[i]));
 		VK_CHECK_RESULT(vkCreateSemaphore(devices.device, &semaphoreInfo, nullptr, &renderCompleteSemaphores[i]));
-		VK_CHECK_RESULT(vkCreateFence(devices.device, &fenceInfo, nullptr, &frameLimitFences[i]));
 	}
 	LOG("created:\tsync objects");
 }
@@ -574,13 +630,16 @@ void VulkanAppBase::createDepthStencilImage(VkSampleCountFlagBits sampleCount) {
 }
 
 /*
-* destroy depth & stencil related resources
+* destroy depth & stencil related resources once frames in flight are finished
 */
 void VulkanAppBase::destroyDepthStencilImage() {
-	vkDestroyImageView(devices.device, depthImageView, nullptr);
-	devices.memoryAllocator.freeImageMemory(depthImage,
-		devices.lazilyAllocatedMemoryTypeExist ? VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT : VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-	vkDestroyImage(devices.device, depthImage, nullptr);
+	destroyLater([devices = &devices, image = depthImage, imageView = depthImageView]() {
+		vkDestroyImageView(devices->device, imageView, nullptr);
+		devices->memoryAllocator.freeImageMemory(image);
+		vkDestroyImage(devices->device, image, nullptr);
+	});
+	depthImageView = VK_NULL_HANDLE;
+	depthImage = VK_NULL_HANDLE;
 }
 
 /*
@@ -611,13 +670,14 @@ void VulkanAppBase::createMultisampleColorBuffer(VkSampleCountFlagBits sampleCou
 }
 
 /*
-* destroy multisample (color buffer) resources
+* destroy multisample (color buffer) resources once frames in flight are finished
 */
 void VulkanAppBase::destroyMultisampleColorBuffer() {
-	vkDestroyImageView(devices.device, multisampleColorImageView, nullptr);
-	devices.memoryAllocator.freeImageMemory(multisampleColorImage,
-		devices.lazilyAllocatedMemoryTypeExist ? VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT : VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-	vkDestroyImage(devices.device, multisampleColorImage, nullptr);
+	destroyLater([devices = &devices, image = multisampleColorImage, imageView = multisampleColorImageView]() {
+		vkDestroyImageView(devices->device, imageView, nullptr);
+		devices->memoryAllocator.freeImageMemory(image);
+		vkDestroyImage(devices->device, image, nullptr);
+	});
 
 	multisampleColorImageView = VK_NULL_HANDLE;
 	multisampleColorImage = VK_NULL_HANDLE;
@@ -808,7 +868,7 @@ void VulkanAppBase::saveScreenshot(const std::string& filename) {
 
 	//cleanup
 	imageMemory.unmap(devices.device);
-	devices.memoryAllocator.freeImageMemory(dstImage, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	devices.memoryAllocator.freeMemory(imageMemory);
 	vkDestroyImage(devices.device, dstImage, nullptr);
 	LOG("save image file: " + filename);
 }
\ No newline at end of file
@@ -1,6 +1,8 @@
 #pragma once
 #include "vulkan_device.h"
 #include "vulkan_swapchain.h"
+#include "vulkan_frame_ring_buffer.h"
+#include "vulkan_command_recorder.h"
 #include "GLFW/glfw3.h"
 #include "vulkan_imgui.h"
 
@@ -19,12 +21,16 @@ protected:
 	virtual void update();
 
 	uint32_t prepareFrame();
+	uint64_t submitGraphics(uint32_t imageIndex, const std::vector<VkCommandBuffer>& cmdBufs,
+		const std::vector<TimelineSync::Wait>& extraWaits = {});
 	void submitFrame(uint32_t imageIndex);
 	
 	virtual void resizeWindow(bool recordCommandBuffer = true);
 	static void windowResizeCallbck(GLFWwindow* window, int width, int height);
 	
 	void resetCommandBuffer();
+	void destroyLater(std::function<void()> destroy);
+	void waitFramesInFlight();
 	virtual void createFramebuffers() = 0;
 	virtual void recordCommandBuffer() = 0;
 
@@ -66,20 +72,26 @@ protected:
 	VulkanSwapchain swapchain;
 	/** command buffers - per swapchain */
 	std::vector<VkCommandBuffer> commandBuffers;
+	/** parallel recording of secondary command buffers - per-thread pools for every frame in flight */
+	CommandRecorder commandRecorder;
 	/** sync image acquisition */
 	std::vector<VkSemaphore> presentCompleteSemaphores;
 	/** sync image presentation */
 	std::vector<VkSemaphore> renderCompleteSemaphores;
-	/** limits maximum frames in flight */
-	std::vector<VkFence> frameLimitFences;
-	/** tracks all swapchain images if they are being used */
-	std::vector<VkFence> inFlightImageFences;
+	/** graphics timeline value of each frame's last submission - limits maximum frames in flight */
+	std::vector<uint64_t> frameTimelineValues;
+	/** graphics timeline value of the last submission rendering to each swapchain image */
+	std::vector<uint64_t> imageTimelineValues;
 	/** pipeline cache */
 	VkPipelineCache pipelineCache;
 	/** max number of frames processed in GPU */
 	int MAX_FRAMES_IN_FLIGHT = 2;
 	/** current frame - index for MAX_FRAMES_IN_FLIGHT */
 	size_t currentFrame = 0;
+	/** per-frame transient data (ubo ...) - region of currentFrame is reclaimed in update() */
+	FrameRingBuffer frameRingBuffer;
+	/** bytes of frameRingBuffer available to each frame */
+	VkDeviceSize frameRingBufferSize = 256 * 1024;
 	/** window resize check */
 	bool windowResized = false;
 	/** depth format */
@@ -0,0 +1,250 @@
+#include <algorithm>
+#include "vulkan_bvh.h"
+
+/*
+* surface area of the box
+*
+* @return float - 0 for an empty box
+*/
+float AABB::surfaceArea() const {
+	if (!isValid()) {
+		return 0.f;
+	}
+	glm::vec3 extent = max - min;
+	return 2.f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+}
+
+/*
+* bounds of the transformed box without transforming all 8 corners (Arvo)
+*
+* @param matrix - affine transformation
+*
+* @return AABB - empty if this box is empty
+*/
+AABB AABB::transform(const glm::mat4& matrix) const {
+	if (!isValid()) {
+		return AABB{};
+	}
+	AABB result;
+	result.min = result.max = glm::vec3(matrix[3]);
+	for (int col = 0; col < 3; ++col) {
+		for (int row = 0; row < 3; ++row) {
+			float a = matrix[col][row] * min[col];
+			float b = matrix[col][row] * max[col];
+			result.min[row] += std::min(a, b);
+			result.max[row] += std::max(a, b);
+		}
+	}
+	return result;
+}
+
+/*
+* extract planes from the rows of the matrix
+*
+* @param viewProjection - projection * view, or projection * view * model for object space planes
+*/
+Frustum::Frustum(const glm::mat4& viewProjection) {
+	glm::mat4 rows = glm::transpose(viewProjection);
+	planes[0] = rows[3] + rows[0]; //left
+	planes[1] = rows[3] - rows[0]; //right
+	planes[2] = rows[3] + rows[1]; //bottom
+	planes[3] = rows[3] - rows[1]; //top
+	planes[4] = rows[2]; //near
+	planes[5] = rows[3] - rows[2]; //far
+}
+
+/*
+* test the box against all planes - only the corners farthest along / against each normal are checked
+* boxes near the frustum edges may be reported intersecting while outside (conservative)
+*
+* @param box - box to test
+*
+* @return Containment - OUTSIDE if the box is completely behind a plane
+*/
+Frustum::Containment Frustum::test(const AABB& box) const {
+	Containment result = INSIDE;
+	for (const glm::vec4& plane : planes) {
+		glm::vec3 normal(plane);
+		glm::vec3 farthest = glm::mix(box.min, box.max, glm::greaterThanEqual(normal, glm::vec3(0.f)));
+		if (glm::dot(normal, farthest) + plane.w < 0.f) {
+			return OUTSIDE;
+		}
+		glm::vec3 nearest = glm::mix(box.max, box.min, glm::greaterThanEqual(normal, glm::vec3(0.f)));
+		if (glm::dot(normal, nearest) + plane.w < 0.f) {
+			result = INTERSECTING;
+		}
+	}
+	return result;
+}
+
+/*
+* build the hierarchy top down
+*
+* @param itemBounds - box of every item, query results are indices into this vector
+*/
+void BVH::build(const std::vector<AABB>& itemBounds) {
+	this->itemBounds = itemBounds;
+	nodes.clear();
+	itemIndices.clear();
+	for (uint32_t i = 0; i < itemBounds.size(); ++i) {
+		if (itemBounds[i].isValid()) {
+			itemIndices.push_back(i);
+		}
+	}
+	if (itemIndices.empty()) {
+		return;
+	}
+
+	//a binary tree with n leaves has 2n - 1 nodes
+	nodes.reserve(itemIndices.size() * 2);
+	Node root{};
+	root.itemCount = static_cast<uint32_t>(itemIndices.size());
+	for (uint32_t item : itemIndices) {
+		root.bounds.expand(itemBounds[item]);
+	}
+	nodes.push_back(root);
+	subdivide(0);
+	nodes.shrink_to_fit();
+}
+
+/*
+* split the node's items by the cheapest centroid bin boundary of all axes
+* cost = traversal (1) + area weighted item counts of the children relative to the node, leaf cost = item count
+*
+* @param nodeIndex - node to split, stays a leaf if no split is cheaper
+*/
+void BVH::subdivide(uint32_t nodeIndex) {
+	const uint32_t firstItem = nodes[nodeIndex].firstItem;
+	const uint32_t itemCount = nodes[nodeIndex].itemCount;
+	if (itemCount <= MAX_LEAF_SIZE) {
+		return;
+	}
+
+	AABB centroidBounds;
+	for (uint32_t i = firstItem; i < firstItem + itemCount; ++i) {
+		centroidBounds.expand(itemBounds[itemIndices[i]].center());
+	}
+
+	struct Bin {
+		AABB bounds;
+		uint32_t count = 0;
+	};
+	auto getBin = [&](uint32_t item, int axis) {
+		float extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+		float offset = (itemBounds[item].center()[axis] - centroidBounds.min[axis]) / extent;
+		return std::min(static_cast<uint32_t>(offset * BIN_COUNT), BIN_COUNT - 1);
+	};
+
+	int bestAxis = -1;
+	uint32_t bestSplit = 0;
+	float bestCost = FLT_MAX;
+	for (int axis = 0; axis < 3; ++axis) {
+		if (centroidBounds.max[axis] <= centroidBounds.min[axis]) {
+			continue;
+		}
+		Bin bins[BIN_COUNT];
+		for (uint32_t i = firstItem; i < firstItem + itemCount; ++i) {
+			Bin& bin = bins[getBin(itemIndices[i], axis)];
+			bin.bounds.expand(itemBounds[itemIndices[i]]);
+			bin.count++;
+		}
+
+		//left side sweep, then right side sweep evaluating the split after bin i
+		float leftArea[BIN_COUNT - 1];
+		uint32_t leftCount[BIN_COUNT - 1];
+		AABB left;
+		uint32_t count = 0;
+		for (uint32_t i = 0; i < BIN_COUNT - 1; ++i) {
+			left.expand(bins[i].bounds);
+			count += bins[i].count;
+			leftArea[i] = left.surfaceArea();
+			leftCount[i] = count;
+		}
+		AABB right;
+		count = 0;
+		for (uint32_t i = BIN_COUNT - 1; i > 0; --i) {
+			right.expand(bins[i].bounds);
+			count += bins[i].count;
+			if (leftCount[i - 1] == 0 || count == 0) {
+				continue;
+			}
+			float cost = leftArea[i - 1] * leftCount[i - 1] + right.surfaceArea() * count;
+			if (cost < bestCost) {
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = i;
+			}
+		}
+	}
+
+	float area = nodes[nodeIndex].bounds.surfaceArea();
+	if (bestAxis < 0 || (area > 0.f && 1.f + bestCost / area >= static_cast<float>(itemCount))) {
+		return;
+	}
+
+	//items of the bins before bestSplit go left
+	auto middle = std::partition(itemIndices.begin() + firstItem, itemIndices.begin() + firstItem + itemCount,
+		[&](uint32_t item) { return getBin(item, bestAxis) < bestSplit; });
+	uint32_t leftItemCount = static_cast<uint32_t>(middle - (itemIndices.begin() + firstItem));
+
+	Node left{}, right{};
+	left.firstItem = firstItem;
+	left.itemCount = leftItemCount;
+	right.firstItem = firstItem + leftItemCount;
+	right.itemCount = itemCount - leftItemCount;
+	for (uint32_t i = left.firstItem; i < left.firstItem + left.itemCount; ++i) {
+		left.bounds.expand(itemBounds[itemIndices[i]]);
+	}
+	for (uint32_t i = right.firstItem; i < right.firstItem + right.itemCount; ++i) {
+		right.bounds.expand(itemBounds[itemIndices[i]]);
+	}
+
+	uint32_t leftChild = static_cast<uint32_t>(nodes.size());
+	nodes[nodeIndex].leftChild = leftChild;
+	nodes.push_back(left);
+	nodes.push_back(right);
+	subdivide(leftChild);
+	subdivide(leftChild + 1);
+}
+
+/*
+* traverse the hierarchy, subtrees completely inside the frustum are appended without further tests
+*
+* @param frustum - view frustum in the space of the item boxes
+* @param visibleItems - out, indices of the items passed to build() - appended in leaf order
+*/
+void BVH::query(const Frustum& frustum, std::vector<uint32_t>& visibleItems) const {
+	if (nodes.empty()) {
+		return;
+	}
+
+	std::vector<uint32_t> stack;
+	stack.reserve(64);
+	stack.push_back(0);
+	while (!stack.empty()) {
+		const Node& node = nodes[stack.back()];
+		stack.pop_back();
+
+		Frustum::Containment containment = frustum.test(node.bounds);
+		if (containment == Frustum::OUTSIDE) {
+			continue;
+		}
+		if (containment == Frustum::INSIDE) {
+			visibleItems.insert(visibleItems.end(),
+				itemIndices.begin() + node.firstItem, itemIndices.begin() + node.firstItem + node.itemCount);
+			continue;
+		}
+
+		//intersecting
+		if (node.leftChild != 0) {
+			stack.push_back(node.leftChild + 1);
+			stack.push_back(node.leftChild);
+			continue;
+		}
+		for (uint32_t i = node.firstItem; i < node.firstItem + node.itemCount; ++i) {
+			if (frustum.test(itemBounds[itemIndices[i]]) != Frustum::OUTSIDE) {
+				visibleItems.push_back(itemIndices[i]);
+			}
+		}
+	}
+}
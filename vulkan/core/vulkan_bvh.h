@@ -0,0 +1,87 @@
+/*
+* reference:
+* Wald - On fast Construction of SAH-based Bounding Volume Hierarchies
+* Gribb, Hartmann - Fast Extraction of Viewing Frustum Planes from the World-View-Projection Matrix
+*/
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cfloat>
+#include "glm/glm.hpp"
+
+/*
+* axis aligned bounding box - empty (min > max) until a point is added
+*/
+struct AABB {
+	glm::vec3 min = glm::vec3(FLT_MAX);
+	glm::vec3 max = glm::vec3(-FLT_MAX);
+
+	/** @brief grow to contain the point */
+	void expand(const glm::vec3& point) { min = glm::min(min, point); max = glm::max(max, point); }
+	/** @brief grow to contain the box */
+	void expand(const AABB& box) { min = glm::min(min, box.min); max = glm::max(max, box.max); }
+	/** @brief false if nothing was added */
+	bool isValid() const { return min.x <= max.x && min.y <= max.y && min.z <= max.z; }
+	glm::vec3 center() const { return (min + max) * 0.5f; }
+	/** @brief surface area, 0 for an empty box */
+	float surfaceArea() const;
+	/** @brief bounds of the transformed box */
+	AABB transform(const glm::mat4& matrix) const;
+};
+
+/*
+* view frustum planes - normals point inside, depth range [0, 1]
+*/
+struct Frustum {
+	glm::vec4 planes[6];
+
+	Frustum() {}
+	/** @brief extract planes from a (view) projection matrix */
+	explicit Frustum(const glm::mat4& viewProjection);
+
+	enum Containment {
+		OUTSIDE,
+		INTERSECTING,
+		INSIDE
+	};
+	/** @brief test the box against all planes */
+	Containment test(const AABB& box) const;
+};
+
+/*
+* bounding volume hierarchy over item boxes, split by the surface area heuristic
+* items of a node are a contiguous range of itemIndices - build once, query every frame
+*/
+class BVH {
+public:
+	/** max items in a leaf - larger leaves only if no split is cheaper */
+	static constexpr uint32_t MAX_LEAF_SIZE = 4;
+	/** centroid bins per axis evaluated for a split */
+	static constexpr uint32_t BIN_COUNT = 16;
+
+	struct Node {
+		AABB bounds;
+		/** range in itemIndices covered by the node */
+		uint32_t firstItem = 0;
+		uint32_t itemCount = 0;
+		/** nodes[leftChild + 1] is the right child, 0 for a leaf (the root is never a child) */
+		uint32_t leftChild = 0;
+	};
+	std::vector<Node> nodes;
+	/** item indices ordered by the leaves */
+	std::vector<uint32_t> itemIndices;
+
+	/** @brief build the hierarchy, invalid boxes are never returned by queries */
+	void build(const std::vector<AABB>& itemBounds);
+	/** @brief append indices of items intersecting the frustum */
+	void query(const Frustum& frustum, std::vector<uint32_t>& visibleItems) const;
+	/** @brief bounds of all items */
+	AABB getBounds() const { return nodes.empty() ? AABB{} : nodes[0].bounds; }
+
+private:
+	/** item boxes in the original order */
+	std::vector<AABB> itemBounds;
+
+	/** @brief split the node recursively */
+	void subdivide(uint32_t nodeIndex);
+};
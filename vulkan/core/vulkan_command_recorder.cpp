@@ -0,0 +1,170 @@
+#include <algorithm>
+#include "vulkan_command_recorder.h"
+
+/*
+* create per-thread command pools for every frame
+*
+* @param devices - abstracted vulkan device handle
+* @param frameCount - number of frames recorded independently (usually MAX_FRAMES_IN_FLIGHT)
+*/
+void CommandRecorder::init(VulkanDevice* devices, uint32_t frameCount) {
+	this->devices = devices;
+	threadCount = JobSystem::get().getThreadCount();
+	frames.resize(frameCount);
+	for (PoolSet& poolSet : frames) {
+		poolSet = createPoolSet();
+	}
+	LOG("created:\tcommand recorder (" + std::to_string(threadCount) + " threads)");
+}
+
+/*
+* destroy all pools - command buffers recorded from them must not be executed anymore
+*/
+void CommandRecorder::cleanup() {
+	if (devices == nullptr) {
+		return;
+	}
+	for (PoolSet& poolSet : frames) {
+		destroyPoolSet(poolSet);
+	}
+	for (PoolSet& poolSet : retiredSets) {
+		destroyPoolSet(poolSet);
+	}
+	frames.clear();
+	retiredSets.clear();
+	devices = nullptr;
+}
+
+/*
+* retire the frame's pools & take fresh ones - the oldest retired pools are reset & reused if the gpu is done with them
+* primaries executing the old secondaries must be re-recorded as well
+*
+* @param frameIndex - frame whose command buffers are re-recorded
+*/
+void CommandRecorder::beginFrame(size_t frameIndex) {
+	PoolSet& poolSet = frames[frameIndex % frames.size()];
+	bool recorded = std::any_of(poolSet.usedCounts.begin(), poolSet.usedCounts.end(),
+		[](size_t usedCount) { return usedCount > 0; });
+	if (!recorded) {
+		return;
+	}
+
+	//every submission so far may execute the secondaries
+	poolSet.retireValue = devices->timelineSync.getSubmittedValue(TimelineSync::GRAPHICS);
+	retiredSets.push_back(std::move(poolSet));
+
+	if (devices->timelineSync.isComplete(TimelineSync::GRAPHICS, retiredSets.front().retireValue)) {
+		poolSet = std::move(retiredSets.front());
+		retiredSets.pop_front();
+		for (VkCommandPool pool : poolSet.pools) {
+			VK_CHECK_RESULT(vkResetCommandPool(devices->device, pool, 0));
+		}
+		std::fill(poolSet.usedCounts.begin(), poolSet.usedCounts.end(), 0);
+	}
+	else {
+		poolSet = createPoolSet();
+	}
+}
+
+/*
+* record every task into its own secondary command buffer - tasks run concurrently, each on the pool of its thread
+*
+* @param frameIndex - frame whose pools are recorded from
+* @param tasks - secondary contents
+*
+* @return std::vector<VkCommandBuffer> - executable secondaries in task order, valid until the frame's next beginFrame()
+*/
+std::vector<VkCommandBuffer> CommandRecorder::record(size_t frameIndex, const std::vector<Task>& tasks) {
+	PoolSet& poolSet = frames[frameIndex % frames.size()];
+	std::vector<VkCommandBuffer> commandBuffers(tasks.size());
+
+	JobSystem::get().parallelFor(tasks.size(), [&](size_t i) {
+		VkCommandBuffer cmdBuf = allocate(poolSet, JobSystem::getThreadIndex());
+
+		VkCommandBufferBeginInfo beginInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+		beginInfo.flags = tasks[i].usage;
+		if (tasks[i].inheritance.renderPass != VK_NULL_HANDLE) {
+			beginInfo.flags |= VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+		}
+		beginInfo.pInheritanceInfo = &tasks[i].inheritance;
+		VK_CHECK_RESULT(vkBeginCommandBuffer(cmdBuf, &beginInfo));
+		tasks[i].record(cmdBuf);
+		VK_CHECK_RESULT(vkEndCommandBuffer(cmdBuf));
+		commandBuffers[i] = cmdBuf;
+	});
+	return commandBuffers;
+}
+
+/*
+* task executed inside a render pass instance begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+*
+* @param renderPass - render pass of the instance
+* @param framebuffer - framebuffer of the instance, VK_NULL_HANDLE if unknown
+* @param record - records the contents
+* @param subpass - subpass the secondary is executed in
+*
+* @return Task - passed to record()
+*/
+CommandRecorder::Task CommandRecorder::makeTask(VkRenderPass renderPass, VkFramebuffer framebuffer,
+	std::function<void(VkCommandBuffer)> record, uint32_t subpass) {
+	Task task{};
+	task.inheritance.renderPass = renderPass;
+	task.inheritance.subpass = subpass;
+	task.inheritance.framebuffer = framebuffer;
+	task.record = std::move(record);
+	return task;
+}
+
+/*
+* create one command pool per thread
+*
+* @return PoolSet - pools without command buffers
+*/
+CommandRecorder::PoolSet CommandRecorder::createPoolSet() {
+	PoolSet poolSet{};
+	poolSet.pools.resize(threadCount);
+	poolSet.commandBuffers.resize(threadCount);
+	poolSet.usedCounts.resize(threadCount, 0);
+
+	VkCommandPoolCreateInfo poolInfo{ VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
+	poolInfo.queueFamilyIndex = devices->indices.graphicsFamily.value();
+	for (VkCommandPool& pool : poolSet.pools) {
+		VK_CHECK_RESULT(vkCreateCommandPool(devices->device, &poolInfo, nullptr, &pool));
+	}
+	return poolSet;
+}
+
+/*
+* destroy pools - frees their command buffers
+*
+* @param poolSet - pools to destroy
+*/
+void CommandRecorder::destroyPoolSet(PoolSet& poolSet) {
+	for (VkCommandPool pool : poolSet.pools) {
+		vkDestroyCommandPool(devices->device, pool, nullptr);
+	}
+	poolSet = {};
+}
+
+/*
+* hand out the next secondary of the thread's pool - allocates only when the pool has none left since its reset
+*
+* @param poolSet - pools of the recorded frame
+* @param threadIndex - JobSystem::getThreadIndex() of the calling thread
+*
+* @return VkCommandBuffer - in initial state
+*/
+VkCommandBuffer CommandRecorder::allocate(PoolSet& poolSet, uint32_t threadIndex) {
+	std::vector<VkCommandBuffer>& commandBuffers = poolSet.commandBuffers[threadIndex];
+	size_t& usedCount = poolSet.usedCounts[threadIndex];
+	if (usedCount == commandBuffers.size()) {
+		VkCommandBufferAllocateInfo allocInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+		allocInfo.commandPool = poolSet.pools[threadIndex];
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+		allocInfo.commandBufferCount = 1;
+		VkCommandBuffer cmdBuf = VK_NULL_HANDLE;
+		VK_CHECK_RESULT(vkAllocateCommandBuffers(devices->device, &allocInfo, &cmdBuf));
+		commandBuffers.push_back(cmdBuf);
+	}
+	return commandBuffers[usedCount++];
+}
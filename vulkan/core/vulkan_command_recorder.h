@@ -0,0 +1,65 @@
+#pragma once
+#include <deque>
+#include <functional>
+#include "vulkan_device.h"
+#include "vulkan_job_system.h"
+
+/*
+* records secondary command buffers concurrently on JobSystem threads
+* every thread owns one command pool per frame in flight - a pool is only touched by its thread, so recording takes no lock
+* re-recording a frame retires its pools, they are reset & reused once the gpu finished the command buffers recorded from them
+* record() must be called from one thread at a time (the main thread) - all non-worker threads share pool 0
+*/
+class CommandRecorder {
+public:
+	/** contents of one secondary command buffer */
+	struct Task {
+		/** render pass, subpass & framebuffer the secondary is executed in - renderPass VK_NULL_HANDLE outside render passes */
+		VkCommandBufferInheritanceInfo inheritance{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO };
+		/** records the contents - begin & end are done by the recorder, dynamic states aren't inherited */
+		std::function<void(VkCommandBuffer)> record;
+		/** extra begin flags - VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT if several primaries execute the secondary */
+		VkCommandBufferUsageFlags usage = 0;
+	};
+
+	/** @brief create per-thread command pools of the graphics family for every frame */
+	void init(VulkanDevice* devices, uint32_t frameCount);
+	/** @brief destroy all pools - the gpu must be idle */
+	void cleanup();
+	/** @brief retire the secondaries recorded for the frame before - call before re-recording its command buffers */
+	void beginFrame(size_t frameIndex);
+	/** @brief record tasks concurrently - one secondary per task, in task order */
+	std::vector<VkCommandBuffer> record(size_t frameIndex, const std::vector<Task>& tasks);
+
+	/** @brief task executed in a subpass of a render pass instance */
+	static Task makeTask(VkRenderPass renderPass, VkFramebuffer framebuffer,
+		std::function<void(VkCommandBuffer)> record, uint32_t subpass = 0);
+
+private:
+	/** command pools of one frame - one per thread */
+	struct PoolSet {
+		std::vector<VkCommandPool> pools;
+		/** secondaries allocated from each pool - reused after a pool reset */
+		std::vector<std::vector<VkCommandBuffer>> commandBuffers;
+		/** secondaries of each pool handed out since its last reset */
+		std::vector<size_t> usedCounts;
+		/** graphics timeline value of the last submission which may execute the secondaries */
+		uint64_t retireValue = 0;
+	};
+
+	/** abstracted vulkan device handle */
+	VulkanDevice* devices = nullptr;
+	/** JobSystem threads - one pool per thread */
+	uint32_t threadCount = 0;
+	/** pools recorded from - per frame */
+	std::vector<PoolSet> frames;
+	/** pools of re-recorded frames in retirement order - reused once their value is reached */
+	std::deque<PoolSet> retiredSets;
+
+	/** @brief create a pool per thread */
+	PoolSet createPoolSet();
+	/** @brief destroy pools & their command buffers */
+	void destroyPoolSet(PoolSet& poolSet);
+	/** @brief next free secondary of the thread's pool */
+	VkCommandBuffer allocate(PoolSet& poolSet, uint32_t threadIndex);
+};
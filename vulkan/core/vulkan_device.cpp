@@ -45,6 +45,9 @@ void VulkanDevice::pickPhysicalDevice(VkInstance instance, VkSurfaceKHR surface,
 	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
 	availableFeatures.pNext = &vk12Features;
 	vkGetPhysicalDeviceFeatures2(physicalDevice, &availableFeatures);
+	if (vk12Features.timelineSemaphore != VK_TRUE) {
+		throw std::runtime_error("timeline semaphores are not supported");
+	}
 
 	//for anti-aliasing
 	maxSampleCount = getMaxSampleCount();
@@ -58,6 +61,12 @@ void VulkanDevice::pickPhysicalDevice(VkInstance instance, VkSurfaceKHR surface,
 		}
 	}
 
+	//optional extensions
+	if (isDeviceExtensionSupported(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME)) {
+		this->requiredExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+		memoryBudgetEnabled = true;
+	}
+
 	LOG("initialized:\tphysical device");
 }
 
@@ -98,7 +107,8 @@ void VulkanDevice::createLogicalDevice() {
 	std::set<uint32_t> uniqueQueueFamilies = { 
 		indices.graphicsFamily.value(),
 		indices.presentFamily.value(),
-		indices.computeFamily.value()
+		indices.computeFamily.value(),
+		indices.transferFamily.value()
 	};
 
 	std::vector<VkDeviceQueueCreateInfo> queueInfos;
@@ -129,6 +139,7 @@ void VulkanDevice::createLogicalDevice() {
 	if (vk12Features.runtimeDescriptorArray == VK_TRUE) {
 		enabledVk12Features.runtimeDescriptorArray = VK_TRUE;
 	}
+	enabledVk12Features.timelineSemaphore = VK_TRUE;
 	deviceFeatures.pNext = &enabledVk12Features;
 
 	VkMemoryAllocateFlags memflags = 0;
@@ -145,11 +156,22 @@ void VulkanDevice::createLogicalDevice() {
 	vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
 	vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
 	vkGetDeviceQueue(device, indices.computeFamily.value(), 0, &computeQueue);
+	vkGetDeviceQueue(device, indices.transferFamily.value(), 0, &transferQueue);
 
 	LOG("created:\tlogical device");
 
 	//custom memory allocator
-	memoryAllocator.init(device, properties.limits.bufferImageGranularity, memProperties, memflags);
+	memoryAllocator.init(device, properties.limits.bufferImageGranularity,
+		properties.limits.nonCoherentAtomSize, memProperties, memflags);
+	if (memoryBudgetEnabled) {
+		memoryAllocator.enableMemoryBudget(physicalDevice);
+	}
+
+	//one timeline per queue - frames, uploads & compute signal it
+	timelineSync.init(device, graphicsQueue, computeQueue, transferQueue);
+
+	//staging uploads
+	uploadManager.init(this);
 }
 
 /*
@@ -206,7 +228,7 @@ bool VulkanDevice::checkPhysicalDevice(VkPhysicalDevice physicalDevice,
 * @param physicalDevice - current physical device to check
 * @param surface - abstracted handle to the native surface
 * 
-* @return QueueFamilyIndices - struct with valid queue family indices (graphics / present)
+* @return QueueFamilyIndices - struct with valid queue family indices (graphics / present / compute / transfer)
 */
 VulkanDevice::QueueFamilyIndices VulkanDevice::findQueueFamilyIndices(VkPhysicalDevice physicalDevice,
 	VkSurfaceKHR surface) {
@@ -244,6 +266,18 @@ VulkanDevice::QueueFamilyIndices VulkanDevice::findQueueFamilyIndices(VkPhysical
 		i++;
 	}
 
+	//transfer family - prefer a dedicated (dma) family, graphics otherwise
+	for (uint32_t j = 0; j < queueFamilyCount; ++j) {
+		VkQueueFlags flags = queueFamilies[j].queueFlags;
+		if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+			indices.transferFamily = j;
+			break;
+		}
+	}
+	if (!indices.transferFamily.has_value()) {
+		indices.transferFamily = indices.graphicsFamily;
+	}
+
 	return indices;
 }
 
@@ -336,7 +370,7 @@ MemoryAllocator::HostVisibleMemory VulkanDevice::createImage(VkImage& image,
 	VkImageCreateInfo imageInfo = 
 		vktools::initializers::imageCreateInfo(extent, format, tiling, usage, mipLevels, numSamples);
 	VK_CHECK_RESULT(vkCreateImage(device, &imageInfo, nullptr, &image));
-	return memoryAllocator.allocateImageMemory(image, properties);
+	return memoryAllocator.allocateImageMemory(image, properties, tiling);
 }
 
 void VulkanDevice::copyBufferToImage(VkBuffer buffer, VkImage image,
@@ -426,3 +460,22 @@ VkSampleCountFlagBits VulkanDevice::getMaxSampleCount() const {
 
 	return VK_SAMPLE_COUNT_1_BIT;
 }
+
+/*
+* check if the physical device supports the device extension
+*
+* @param extensionName - name of the device extension
+*
+* @return bool - true if supported
+*/
+bool VulkanDevice::isDeviceExtensionSupported(const char* extensionName) const {
+	uint32_t extensionCount = 0;
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+	std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+
+	return std::find_if(availableExtensions.begin(), availableExtensions.end(),
+		[extensionName](const auto& availableEXT) {
+			return strcmp(extensionName, availableEXT.extensionName) == 0;
+		}) != availableExtensions.end();
+}
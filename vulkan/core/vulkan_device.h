@@ -2,6 +2,8 @@
 #include <optional>
 #include "vulkan_utils.h"
 #include "vulkan_memory_allocator.h"
+#include "vulkan_upload_manager.h"
+#include "vulkan_timeline_sync.h"
 
 struct VulkanDevice {
 	VulkanDevice() {}
@@ -31,6 +33,8 @@ struct VulkanDevice {
 	void endCommandBuffer(VkCommandBuffer commandBuffer) const;
 	/** @brief get max sample count */
 	VkSampleCountFlagBits getMaxSampleCount() const;
+	/** @brief check if the physical device supports the device extension */
+	bool isDeviceExtensionSupported(const char* extensionName) const;
 
 	/** GPU handle */
 	VkPhysicalDevice physicalDevice;
@@ -43,6 +47,8 @@ struct VulkanDevice {
 		std::optional<uint32_t> graphicsFamily;
 		std::optional<uint32_t> presentFamily;
 		std::optional<uint32_t> computeFamily;
+		/** dedicated transfer family if available, graphics family otherwise - not part of isComplete() */
+		std::optional<uint32_t> transferFamily;
 
 		bool isComplete() const {
 			return graphicsFamily.has_value() && 
@@ -56,6 +62,8 @@ struct VulkanDevice {
 	VkQueue presentQueue;
 	/** handle to the compute queue */
 	VkQueue computeQueue;
+	/** handle to the transfer queue (graphics queue without a dedicated transfer family) */
+	VkQueue transferQueue;
 	/** memory properties of the current physical device */
 	VkPhysicalDeviceMemoryProperties memProperties;
 	/** current physical device properties */
@@ -68,10 +76,16 @@ struct VulkanDevice {
 	VkCommandPool commandPool = VK_NULL_HANDLE;
 	/** custom memory allocator */
 	MemoryAllocator memoryAllocator;
+	/** timeline semaphore per queue & deferred deletion - cleanup before memoryAllocator */
+	TimelineSync timelineSync;
+	/** batched staging uploads - cleanup before timelineSync */
+	UploadManager uploadManager;
 	/** max sample count */
 	uint32_t maxSampleCount;
 	/** VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT support */
 	bool lazilyAllocatedMemoryTypeExist = false;
+	/** VK_EXT_memory_budget is enabled - optional */
+	bool memoryBudgetEnabled = false;
 
 	/** swapchain support details - used for swapchain creation*/
 	struct SwapchainSupportDetails {
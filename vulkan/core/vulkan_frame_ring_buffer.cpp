@@ -0,0 +1,97 @@
+#include <algorithm>
+#include <cstring>
+#include "vulkan_frame_ring_buffer.h"
+
+/*
+* create ring buffer - frameRegionSize * frameCount bytes of host visible memory
+*
+* @param devices - abstracted vulkan device handle
+* @param frameRegionSize - bytes available to each frame
+* @param frameCount - number of frame regions (usually MAX_FRAMES_IN_FLIGHT)
+* @param usage - buffer usage flags
+*/
+void FrameRingBuffer::init(VulkanDevice* devices, VkDeviceSize frameRegionSize, uint32_t frameCount, VkBufferUsageFlags usage) {
+	this->devices = devices;
+	this->frameCount = frameCount;
+
+	//every allocation offset must be valid for any usage of the buffer
+	const VkPhysicalDeviceLimits& limits = devices->properties.limits;
+	defaultAlignment = 4;
+	if (usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT) {
+		defaultAlignment = std::max(defaultAlignment, limits.minUniformBufferOffsetAlignment);
+	}
+	if (usage & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT) {
+		defaultAlignment = std::max(defaultAlignment, limits.minStorageBufferOffsetAlignment);
+	}
+	this->frameRegionSize = (frameRegionSize + defaultAlignment - 1) / defaultAlignment * defaultAlignment;
+
+	memory = devices->createBuffer(buffer, this->frameRegionSize * frameCount, usage,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	currentFrame = 0;
+	head = 0;
+}
+
+/*
+* destroy ring buffer once frames in flight are finished - init() may be called right after
+*/
+void FrameRingBuffer::cleanup() {
+	if (buffer == VK_NULL_HANDLE) {
+		return;
+	}
+	devices->timelineSync.destroyLater(TimelineSync::GRAPHICS,
+		[devices = devices, buffer = buffer, memory = memory]() {
+			devices->memoryAllocator.freeMemory(memory);
+			vkDestroyBuffer(devices->device, buffer, nullptr);
+		});
+	buffer = VK_NULL_HANDLE;
+	memory = {};
+}
+
+/*
+* start allocating from the frame's region - previous allocations of the region are discarded
+*
+* @param frameIndex - index of the frame region
+* @param frameValue - graphics timeline value of the frame's last submission, 0 if already waited
+*/
+void FrameRingBuffer::beginFrame(size_t frameIndex, uint64_t frameValue) {
+	devices->timelineSync.wait(TimelineSync::GRAPHICS, frameValue);
+	currentFrame = frameIndex % frameCount;
+	head = 0;
+}
+
+/*
+* bump allocate from the current frame region
+*
+* @param size - required size
+* @param alignment - 0 to use default alignment (min uniform / storage buffer offset alignment)
+*
+* @return Allocation - buffer, offset & mapped pointer
+*/
+FrameRingBuffer::Allocation FrameRingBuffer::allocate(VkDeviceSize size, VkDeviceSize alignment) {
+	if (alignment == 0) {
+		alignment = defaultAlignment;
+	}
+	VkDeviceSize regionOffset = currentFrame * frameRegionSize;
+	VkDeviceSize offset = (regionOffset + head + alignment - 1) / alignment * alignment;
+	if (offset + size > regionOffset + frameRegionSize) {
+		throw std::runtime_error("FrameRingBuffer::allocate(): frame region is full");
+	}
+	head = offset + size - regionOffset;
+
+	return { buffer, offset, static_cast<uint8_t*>(memory.mappedData) + offset };
+}
+
+/*
+* allocate & memcpy data
+*
+* @param data - data to be copied
+* @param size - data size
+* @param alignment - 0 to use default alignment
+*
+* @return Allocation - buffer, offset & mapped pointer
+*/
+FrameRingBuffer::Allocation FrameRingBuffer::push(const void* data, VkDeviceSize size, VkDeviceSize alignment) {
+	Allocation allocation = allocate(size, alignment);
+	memcpy(allocation.data, data, static_cast<size_t>(size));
+	return allocation;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include "vulkan_device.h"
+
+/*
+* frame-scoped linear allocator for transient data (ubo, vertex, index ...)
+* one persistently mapped buffer is split into per-frame regions
+* allocations are bump-allocated and the whole region is reclaimed when the frame begins again
+*/
+class FrameRingBuffer {
+public:
+	/** suballocation - valid until the same frame index begins again */
+	struct Allocation {
+		/** ring buffer handle */
+		VkBuffer buffer = VK_NULL_HANDLE;
+		/** offset from the beginning of the buffer - used as (dynamic) offset */
+		VkDeviceSize offset = 0;
+		/** persistently mapped pointer of this allocation */
+		void* data = nullptr;
+	};
+
+	/** @brief create ring buffer - frameRegionSize * frameCount bytes */
+	void init(VulkanDevice* devices, VkDeviceSize frameRegionSize, uint32_t frameCount, VkBufferUsageFlags usage);
+	/** @brief destroy ring buffer once frames in flight are finished */
+	void cleanup();
+	/** @brief wait for the frame's graphics timeline value & reclaim its region */
+	void beginFrame(size_t frameIndex, uint64_t frameValue = 0);
+	/** @brief bump allocate from the current frame region */
+	Allocation allocate(VkDeviceSize size, VkDeviceSize alignment = 0);
+	/** @brief allocate & memcpy data */
+	Allocation push(const void* data, VkDeviceSize size, VkDeviceSize alignment = 0);
+
+	/** ring buffer handle - shared by all frames */
+	VkBuffer buffer = VK_NULL_HANDLE;
+	/** size of each frame region */
+	VkDeviceSize frameRegionSize = 0;
+
+private:
+	/** abstracted vulkan device handle */
+	VulkanDevice* devices = nullptr;
+	/** persistently mapped memory of the whole buffer */
+	MemoryAllocator::HostVisibleMemory memory;
+	/** number of frame regions */
+	uint32_t frameCount = 0;
+	/** region currently allocated from */
+	size_t currentFrame = 0;
+	/** next free byte in the current region - relative to the region */
+	VkDeviceSize head = 0;
+	/** default alignment - satisfies every usage the buffer is created with */
+	VkDeviceSize defaultAlignment = 4;
+};
@@ -1,5 +1,5 @@
 #include "vulkan_framebuffer.h"
-#include "vulkan_device.h"
+#include "vulkan_transient_attachment_pool.h"
 
 /*
 * free all resources
@@ -11,7 +11,9 @@ void Framebuffer::cleanup() {
 
 	//images
 	for (auto& attachment : attachments) {
-		devices->memoryAllocator.freeImageMemory(attachment.image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		if (!attachment.aliased) {
+			devices->memoryAllocator.freeImageMemory(attachment.image);
+		}
 		vkDestroyImage(devices->device, attachment.image, nullptr);
 		vkDestroyImageView(devices->device, attachment.imageView, nullptr);
 	}
@@ -26,8 +28,9 @@ void Framebuffer::cleanup() {
 * 
 * @param imageCreateInfo - info needed to create VkImage
 * @param memoryProperties - needed for allocateImageMemory()
+* @param movable - register the image to MemoryAllocator::defragment(), contents are not preserved by a move
 */
-void Framebuffer::addAttachment(VkImageCreateInfo imageCreateInfo, VkMemoryPropertyFlags memoryProperties) {
+void Framebuffer::addAttachment(VkImageCreateInfo imageCreateInfo, VkMemoryPropertyFlags memoryProperties, bool movable) {
 	Attachment attachment{};
 
 	//create image
@@ -40,8 +43,93 @@ void Framebuffer::addAttachment(VkImageCreateInfo imageCreateInfo, VkMemoryPrope
 		memoryProperties,
 		imageCreateInfo.samples);
 
+	fillAttachment(attachment, imageCreateInfo);
+
+	//create image view
+	attachment.imageView = vktools::createImageView(devices->device,
+		attachment.image,
+		VK_IMAGE_VIEW_TYPE_2D,
+		imageCreateInfo.format,
+		attachment.aspect, 1);
+
+	//attachments are cleared or fully overwritten every frame
+	if (movable) {
+		imageCreateInfo.mipLevels = 1;
+		devices->memoryAllocator.setMovable(attachment.image, imageCreateInfo, VK_IMAGE_LAYOUT_UNDEFINED, attachment.aspect);
+	}
+
+	attachments.push_back(attachment);
+}
+
+/*
+* replace attachment images moved by MemoryAllocator::defragment()
+* the command buffer passed to defragment() must have completed
+*
+* @param moves - moves returned by defragment(), moves of other resources are ignored
+*/
+void Framebuffer::applyDefragmentationMoves(const std::vector<MemoryAllocator::DefragmentationMove>& moves) {
+	for (auto& attachment : attachments) {
+		if (attachment.aliased) {
+			continue;
+		}
+		for (const auto& move : moves) {
+			if (move.srcImage != attachment.image) {
+				continue;
+			}
+			devices->memoryAllocator.freeImageMemory(attachment.image);
+			vkDestroyImage(devices->device, attachment.image, nullptr);
+			vkDestroyImageView(devices->device, attachment.imageView, nullptr);
+
+			attachment.image = move.dstImage;
+			attachment.imageView = vktools::createImageView(devices->device,
+				attachment.image,
+				VK_IMAGE_VIEW_TYPE_2D,
+				attachment.description.format,
+				attachment.aspect, 1);
+			break;
+		}
+	}
+}
+
+/*
+* add attachment used only in [firstPass, lastPass] of a frame
+* not sampled attachments use lazily allocated memory if available (tile memory, never resident)
+* otherwise the image memory is aliased by the pool - image view is created in createFramebuffer()
+*
+* @param imageCreateInfo - info needed to create VkImage
+* @param pool - transient pool of the frame, pool.allocate() must be called before createFramebuffer()
+* @param firstPass - index of the first pass using the image in a frame
+* @param lastPass - index of the last pass using the image in a frame
+*/
+void Framebuffer::addTransientAttachment(VkImageCreateInfo imageCreateInfo, TransientAttachmentPool& pool,
+	uint32_t firstPass, uint32_t lastPass) {
+	VkImageUsageFlags readUsage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT |
+		VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+	if (!(imageCreateInfo.usage & readUsage) && devices->lazilyAllocatedMemoryTypeExist) {
+		imageCreateInfo.usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+		addAttachment(imageCreateInfo, VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+		return;
+	}
+
+	Attachment attachment{};
+	attachment.aliased = true;
+	imageCreateInfo.mipLevels = 1;
+	VK_CHECK_RESULT(vkCreateImage(devices->device, &imageCreateInfo, nullptr, &attachment.image));
+	pool.addImage(attachment.image, firstPass, lastPass);
+	fillAttachment(attachment, imageCreateInfo);
+	attachments.push_back(attachment);
+}
+
+/*
+* fill aspect & attachment description based on the image info
+*
+* @param attachment - out, attachment to fill
+* @param imageCreateInfo - info used to create the attachment image
+*/
+void Framebuffer::fillAttachment(Attachment& attachment, const VkImageCreateInfo& imageCreateInfo) const {
 	//check image aspect
-	VkImageAspectFlags imageAspect = 0;
+	VkImageAspectFlags& imageAspect = attachment.aspect;
+	imageAspect = 0;
 	if (imageCreateInfo.usage & VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT) {
 		imageAspect = VK_IMAGE_ASPECT_COLOR_BIT;
 	}
@@ -54,13 +142,6 @@ void Framebuffer::addAttachment(VkImageCreateInfo imageCreateInfo, VkMemoryPrope
 		}
 	}
 	
-	//create image view
-	attachment.imageView = vktools::createImageView(devices->device,
-		attachment.image,
-		VK_IMAGE_VIEW_TYPE_2D,
-		imageCreateInfo.format,
-		imageAspect, 1);
-
 	//fill attachment description
 	attachment.description.format			= imageCreateInfo.format;
 	attachment.description.samples			= imageCreateInfo.samples;
@@ -78,7 +159,6 @@ void Framebuffer::addAttachment(VkImageCreateInfo imageCreateInfo, VkMemoryPrope
 		attachment.description.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 	}
 
-	attachments.push_back(attachment);
 }
 
 /*
@@ -140,6 +220,14 @@ VkRenderPass Framebuffer::createRenderPass(const std::vector<VkSubpassDependency
 void Framebuffer::createFramebuffer(VkExtent2D extent, VkRenderPass renderPass) {
 	std::vector<VkImageView> attachmentViews{};
 	for (auto& attachment : attachments) {
+		//aliased image is bound by TransientAttachmentPool::allocate()
+		if (attachment.imageView == VK_NULL_HANDLE) {
+			attachment.imageView = vktools::createImageView(devices->device,
+				attachment.image,
+				VK_IMAGE_VIEW_TYPE_2D,
+				attachment.description.format,
+				attachment.aspect, 1);
+		}
 		attachmentViews.push_back(attachment.imageView);
 	}
 	attachmentViews.shrink_to_fit();
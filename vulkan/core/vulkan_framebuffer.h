@@ -1,21 +1,32 @@
 #pragma once
 #include "vulkan_utils.h"
+#include "vulkan_memory_allocator.h"
 
 struct VulkanDevice;
+class TransientAttachmentPool;
 class Framebuffer {
 public:
 	struct Attachment {
 		VkImage image = VK_NULL_HANDLE;
 		VkImageView imageView = VK_NULL_HANDLE;
 		VkAttachmentDescription description{};
+		/** image view aspect */
+		VkImageAspectFlags aspect = 0;
+		/** memory is owned by TransientAttachmentPool */
+		bool aliased = false;
 	};
 
 	/** @brief get vulkan device handle */
 	void init(VulkanDevice* devices) { this->devices = devices; }
 	/** @brief clean up */
 	void cleanup();
-	/** @brief add attachment and create actual image */
-	void addAttachment(VkImageCreateInfo imageCreateInfo, VkMemoryPropertyFlags memoryProperties);
+	/** @brief add attachment and create actual image - movable images may be relocated by defragmentation */
+	void addAttachment(VkImageCreateInfo imageCreateInfo, VkMemoryPropertyFlags memoryProperties, bool movable = false);
+	/** @brief replace attachment images moved by MemoryAllocator::defragment() - call before createFramebuffer() */
+	void applyDefragmentationMoves(const std::vector<MemoryAllocator::DefragmentationMove>& moves);
+	/** @brief add attachment used only in [firstPass, lastPass] of a frame - lazily allocated or aliased memory */
+	void addTransientAttachment(VkImageCreateInfo imageCreateInfo, TransientAttachmentPool& pool,
+		uint32_t firstPass, uint32_t lastPass);
 	/** @brief create render pass based on the added attachments*/
 	VkRenderPass createRenderPass(const std::vector<VkSubpassDependency>& dependencies);
 	/** @brief create framebuffer */
@@ -29,4 +40,7 @@ public:
 private:
 	/** devices handle */
 	VulkanDevice* devices = nullptr;
+
+	/** @brief fill aspect & attachment description based on the image info */
+	void fillAttachment(Attachment& attachment, const VkImageCreateInfo& imageCreateInfo) const;
 };
@@ -3,39 +3,182 @@
 https://github.com/SaschaWillems/Vulkan/blob/master/examples/gltfscenerendering/gltfscenerendering.cpp
 https://github.com/nvpro-samples/nvpro_core/blob/master/nvh/gltfscene.cpp
 */
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <stb_image.h>
 #include "vulkan_gltf.h"
+#include "vulkan_job_system.h"
 #include "glm/gtc/type_ptr.hpp"
 
+namespace {
+	/** max staging memory of decoded images uploaded by one submission - half the ring, so the next batch decodes while this one copies */
+	const VkDeviceSize IMAGE_UPLOAD_BATCH_SIZE = UploadManager::STAGING_RING_SIZE / 2;
+}
+
 /*
-* upload vertex / index data to device memory
+* create device local buffer & stage its data - copied by the next UploadManager::submit()
 */
 void uploadBufferToDeviceMemory(VulkanDevice* devices, VkBuffer& buffer, const void* data,
 	VkDeviceSize bufferSize, VkBufferUsageFlags usage) {
-	//staging buffers
-	VkBuffer stagingBuffer;
-	MemoryAllocator::HostVisibleMemory stagingMemory = devices->createBuffer(stagingBuffer, bufferSize,
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-	);
-	stagingMemory.mapData(devices->device, data);
-
-	//create buffer
 	devices->createBuffer(buffer, bufferSize,
 		VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage
 	);
+	devices->uploadManager.uploadBuffer(buffer, data, bufferSize);
+}
+
+/*
+* validate the accessor range & get its first element
+*
+* @param model - the whole model
+* @param accessor - accessor to read
+* @param stride - out, bytes between elements (tightly packed if the view has no byteStride)
+*
+* @return const unsigned char* - nullptr if the accessor has no buffer view (all zeros)
+*/
+static const unsigned char* getAccessorData(const tinygltf::Model& model, const tinygltf::Accessor& accessor, size_t& stride) {
+	if (accessor.bufferView < 0) {
+		return nullptr;
+	}
+	if (accessor.sparse.isSparse) {
+		throw std::runtime_error("VulkanGLTF: sparse accessors not supported");
+	}
+	const tinygltf::BufferView& view = model.bufferViews[accessor.bufferView];
+	const tinygltf::Buffer& buffer = model.buffers[view.buffer];
+	int byteStride = accessor.ByteStride(view);
+	if (byteStride <= 0) {
+		throw std::runtime_error("VulkanGLTF: invalid accessor stride");
+	}
+	stride = static_cast<size_t>(byteStride);
+
+	size_t elementSize = tinygltf::GetComponentSizeInBytes(accessor.componentType) *
+		tinygltf::GetNumComponentsInType(accessor.type);
+	size_t offset = view.byteOffset + accessor.byteOffset;
+	if (accessor.count > 0 && offset + stride * (accessor.count - 1) + elementSize > buffer.data.size()) {
+		throw std::runtime_error("VulkanGLTF: accessor out of buffer range");
+	}
+	return buffer.data.data() + offset;
+}
+
+/*
+* read a vertex attribute accessor as floats - strided & interleaved views are supported
+* tightly packed float data (the vertex buffer layout) is copied with a single memcpy
+*
+* @param model - the whole model
+* @param accessor - attribute accessor, float or (normalized) integer components
+* @param componentCount - floats per destination element
+* @param dst - accessor.count * componentCount floats
+*/
+static void readFloatAccessor(const tinygltf::Model& model, const tinygltf::Accessor& accessor,
+	size_t componentCount, float* dst) {
+	size_t stride = 0;
+	const unsigned char* src = getAccessorData(model, accessor, stride);
+	if (src == nullptr) {
+		std::fill(dst, dst + accessor.count * componentCount, 0.f);
+		return;
+	}
+
+	size_t srcComponentCount = tinygltf::GetNumComponentsInType(accessor.type);
+	size_t copyCount = std::min(componentCount, srcComponentCount);
+	if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT) {
+		if (srcComponentCount == componentCount && stride == sizeof(float) * componentCount) {
+			memcpy(dst, src, accessor.count * stride);
+			return;
+		}
+		for (size_t i = 0; i < accessor.count; ++i, src += stride, dst += componentCount) {
+			memcpy(dst, src, sizeof(float) * copyCount);
+			std::fill(dst + copyCount, dst + componentCount, 0.f);
+		}
+		return;
+	}
+
+	//integer components - normalized to [0, 1] / [-1, 1] if requested
+	auto readComponent = [&](const unsigned char* component) -> float {
+		switch (accessor.componentType) {
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: {
+			uint8_t value = *component;
+			return accessor.normalized ? value / 255.f : value;
+		}
+		case TINYGLTF_COMPONENT_TYPE_BYTE: {
+			int8_t value = static_cast<int8_t>(*component);
+			return accessor.normalized ? std::max(value / 127.f, -1.f) : value;
+		}
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: {
+			uint16_t value;
+			memcpy(&value, component, sizeof(value));
+			return accessor.normalized ? value / 65535.f : value;
+		}
+		case TINYGLTF_COMPONENT_TYPE_SHORT: {
+			int16_t value;
+			memcpy(&value, component, sizeof(value));
+			return accessor.normalized ? std::max(value / 32767.f, -1.f) : value;
+		}
+		default:
+			throw std::runtime_error("VulkanGLTF: attribute component type " +
+				std::to_string(accessor.componentType) + " not supported");
+		}
+	};
+	size_t componentSize = tinygltf::GetComponentSizeInBytes(accessor.componentType);
+	for (size_t i = 0; i < accessor.count; ++i, src += stride, dst += componentCount) {
+		for (size_t c = 0; c < copyCount; ++c) {
+			dst[c] = readComponent(src + c * componentSize);
+		}
+		std::fill(dst + copyCount, dst + componentCount, 0.f);
+	}
+}
+
+/*
+* read an index accessor - uint32_t indices are copied with a single memcpy
+*
+* @param model - the whole model
+* @param accessor - index accessor
+* @param indices - out, accessor.count indices
+*/
+static void readIndexAccessor(const tinygltf::Model& model, const tinygltf::Accessor& accessor, std::vector<uint32_t>& indices) {
+	size_t stride = 0;
+	const unsigned char* src = getAccessorData(model, accessor, stride);
+	indices.resize(accessor.count);
+	if (src == nullptr) {
+		std::fill(indices.begin(), indices.end(), 0);
+		return;
+	}
 
-	//copy buffer
-	VkCommandBuffer cmdBuf = devices->beginCommandBuffer();
-	VkBufferCopy bufferCopyRegion{};
-	bufferCopyRegion.srcOffset = 0;
-	bufferCopyRegion.dstOffset = 0;
-	bufferCopyRegion.size = bufferSize;
-	vkCmdCopyBuffer(cmdBuf, stagingBuffer, buffer, 1, &bufferCopyRegion);
-	devices->endCommandBuffer(cmdBuf);
-
-	devices->memoryAllocator.freeBufferMemory(stagingBuffer,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-	vkDestroyBuffer(devices->device, stagingBuffer, nullptr);
+	switch (accessor.componentType) {
+	case TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT:
+		if (stride == sizeof(uint32_t)) {
+			memcpy(indices.data(), src, accessor.count * sizeof(uint32_t));
+			break;
+		}
+		for (size_t i = 0; i < accessor.count; ++i, src += stride) {
+			memcpy(&indices[i], src, sizeof(uint32_t));
+		}
+		break;
+	case TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT:
+		for (size_t i = 0; i < accessor.count; ++i, src += stride) {
+			uint16_t index;
+			memcpy(&index, src, sizeof(index));
+			indices[i] = index;
+		}
+		break;
+	case TINYGLTF_PARAMETER_TYPE_UNSIGNED_BYTE:
+		for (size_t i = 0; i < accessor.count; ++i, src += stride) {
+			indices[i] = *src;
+		}
+		break;
+	default:
+		throw std::runtime_error("VulkanGLTF::addPrimitive(): index component type" + 
+			std::to_string(accessor.componentType) + " not supported");
+	}
+}
+
+/*
+* tinygltf image callback - keeps the encoded file bytes, loadImages() decodes all images in parallel
+*/
+static bool storeEncodedImage(tinygltf::Image* image, const int /*imageIndex*/, std::string* /*err*/, std::string* /*warn*/,
+	int /*reqWidth*/, int /*reqHeight*/, const unsigned char* bytes, int size, void* /*userData*/) {
+	image->image.assign(bytes, bytes + size);
+	image->as_is = true;
+	return true;
 }
 
 /*
@@ -48,9 +191,14 @@ void VulkanGLTF::loadScene(VulkanDevice* devices, const std::string& path, VkBuf
 	tinygltf::Model model;
 	tinygltf::TinyGLTF loader;
 	std::string err, warn;
-
-	//load gltf file
-	bool result = loader.LoadASCIIFromFile(&model, &err, &warn, path);
+	loader.SetImageLoader(storeEncodedImage, nullptr);
+
+	//load gltf file - binary container (.glb) or json (.gltf)
+	std::string extension = path.substr(path.find_last_of('.') + 1);
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+	bool result = extension == "glb" ?
+		loader.LoadBinaryFromFile(&model, &err, &warn, path) :
+		loader.LoadASCIIFromFile(&model, &err, &warn, path);
 	std::string str = "Mesh::loadGltf(): ";
 	if (!warn.empty()) {
 		throw std::runtime_error(str + warn);
@@ -92,6 +240,14 @@ void VulkanGLTF::loadScene(VulkanDevice* devices, const std::string& path, VkBuf
 	for (int nodeIndex : scene.nodes) {
 		loadNode(model, nodeIndex, glm::mat4(1.f));
 	}
+
+	//hierarchy for cpu culling of the flattened nodes
+	std::vector<AABB> nodeBounds;
+	nodeBounds.reserve(nodes.size());
+	for (const Node& node : nodes) {
+		nodeBounds.push_back(node.bounds);
+	}
+	nodeBVH.build(nodeBounds);
 	
 	//create vertex & index buffer
 	size_t indexBufferSize			= bufferData.indices.size() * sizeof(uint32_t);
@@ -133,6 +289,9 @@ void VulkanGLTF::loadScene(VulkanDevice* devices, const std::string& path, VkBuf
 		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
 		VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
 
+	//all buffers in one batch - staged copies, so the cpu side data can go now
+	uploadTicket = devices->uploadManager.submit();
+
 	//free all temporary data
 	bufferData.colors.clear();
 	bufferData.indices.clear();
@@ -162,30 +321,30 @@ void VulkanGLTF::cleanup() {
 	}
 
 	//buffers
-	devices->memoryAllocator.freeBufferMemory(vertexBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	devices->memoryAllocator.freeBufferMemory(vertexBuffer);
 	vkDestroyBuffer(devices->device, vertexBuffer, nullptr);
-	devices->memoryAllocator.freeBufferMemory(indexBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	devices->memoryAllocator.freeBufferMemory(indexBuffer);
 	vkDestroyBuffer(devices->device, indexBuffer, nullptr);
-	devices->memoryAllocator.freeBufferMemory(normalBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	devices->memoryAllocator.freeBufferMemory(normalBuffer);
 	vkDestroyBuffer(devices->device, normalBuffer, nullptr);
-	devices->memoryAllocator.freeBufferMemory(uvBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	devices->memoryAllocator.freeBufferMemory(uvBuffer);
 	vkDestroyBuffer(devices->device, uvBuffer, nullptr);
-	devices->memoryAllocator.freeBufferMemory(colorBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	devices->memoryAllocator.freeBufferMemory(colorBuffer);
 	vkDestroyBuffer(devices->device, colorBuffer, nullptr);
-	devices->memoryAllocator.freeBufferMemory(tangentBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	devices->memoryAllocator.freeBufferMemory(tangentBuffer);
 	vkDestroyBuffer(devices->device, tangentBuffer, nullptr);
-	devices->memoryAllocator.freeBufferMemory(materialIndicesBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	devices->memoryAllocator.freeBufferMemory(materialIndicesBuffer);
 	vkDestroyBuffer(devices->device, materialIndicesBuffer, nullptr);
-	devices->memoryAllocator.freeBufferMemory(materialBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	devices->memoryAllocator.freeBufferMemory(materialBuffer);
 	vkDestroyBuffer(devices->device, materialBuffer, nullptr);
-	devices->memoryAllocator.freeBufferMemory(primitiveBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	devices->memoryAllocator.freeBufferMemory(primitiveBuffer);
 	vkDestroyBuffer(devices->device, primitiveBuffer, nullptr);
 }
 
 /*
-* load images from the model 
+* load images from the model - decoded on JobSystem workers, uploaded in as few submissions as possible
 * 
-* @param input - loaded gltf model
+* @param input - loaded gltf model, encoded image bytes are released once decoded
 */
 void VulkanGLTF::loadImages(tinygltf::Model& input) {
 	if (input.images.empty()) {
@@ -196,10 +355,62 @@ void VulkanGLTF::loadImages(tinygltf::Model& input) {
 		return;
 	}
 
+	//dimensions from the headers - images are created before decoding
+	struct ImageInfo {
+		int width = 0;
+		int height = 0;
+		VkDeviceSize size = 0;
+	};
+	std::vector<ImageInfo> infos(input.images.size());
+	for (size_t i = 0; i < input.images.size(); ++i) {
+		const tinygltf::Image& srcImage = input.images[i];
+		int channels = 0;
+		if (!srcImage.as_is || srcImage.image.empty() ||
+			!stbi_info_from_memory(srcImage.image.data(), static_cast<int>(srcImage.image.size()),
+				&infos[i].width, &infos[i].height, &channels)) {
+			throw std::runtime_error("failed to load texture: " + path + srcImage.uri);
+		}
+		infos[i].size = static_cast<VkDeviceSize>(infos[i].width) * infos[i].height * 4;
+	}
+
+	//batches of consecutive images decoded together & submitted at once
 	images.resize(input.images.size());
-	for (int i = 0; i < input.images.size(); ++i) {
-		tinygltf::Image& srcImage = input.images[i];
-		images[i].load(devices, path + srcImage.uri, VK_SAMPLER_ADDRESS_MODE_REPEAT);
+	size_t batchBegin = 0;
+	while (batchBegin < images.size()) {
+		size_t batchEnd = batchBegin;
+		VkDeviceSize stagingSize = 0;
+		while (batchEnd < images.size() && (batchEnd == batchBegin || stagingSize + infos[batchEnd].size <= IMAGE_UPLOAD_BATCH_SIZE)) {
+			stagingSize += infos[batchEnd].size;
+			batchEnd++;
+		}
+
+		std::vector<unsigned char*> stagingData(batchEnd - batchBegin);
+		for (size_t i = batchBegin; i < batchEnd; ++i) {
+			images[i].create(devices, infos[i].width, infos[i].height, VK_FORMAT_R8G8B8A8_SRGB,
+				VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_REPEAT);
+			stagingData[i - batchBegin] = static_cast<unsigned char*>(devices->uploadManager.stageImage(images[i].image,
+				{ static_cast<uint32_t>(infos[i].width), static_cast<uint32_t>(infos[i].height), 1 },
+				VK_FORMAT_R8G8B8A8_SRGB, infos[i].size, images[i].mipLevels));
+		}
+
+		//decode straight into the staging memory on all cores
+		JobSystem::get().parallelFor(batchEnd - batchBegin, [&](size_t job) {
+			size_t i = batchBegin + job;
+			tinygltf::Image& srcImage = input.images[i];
+			int width, height, channels;
+			stbi_uc* pixels = stbi_load_from_memory(srcImage.image.data(), static_cast<int>(srcImage.image.size()),
+				&width, &height, &channels, STBI_rgb_alpha);
+			if (!pixels) {
+				throw std::runtime_error("failed to load texture: " + path + srcImage.uri);
+			}
+			memcpy(stagingData[job], pixels, static_cast<size_t>(infos[i].size));
+			stbi_image_free(pixels);
+			std::vector<unsigned char>().swap(srcImage.image);
+		});
+
+		//staging memory of the batch is reclaimed once the gpu is done with it
+		devices->uploadManager.submit();
+		batchBegin = batchEnd;
 	}
 }
 
@@ -264,7 +475,7 @@ void VulkanGLTF::loadNode(const tinygltf::Model& model, int nodeIndex, const glm
 	if (srcNode.mesh > -1) {
 		const std::vector<unsigned int>& primitiveIndices = meshToPrimitives[srcNode.mesh];
 		for (unsigned int primitiveIndex : primitiveIndices) {
-			nodes.push_back({ matrix, primitiveIndex});
+			nodes.push_back({ matrix, primitiveIndex, primitiveBounds[primitiveIndex].transform(matrix) });
 		}
 	}
 
@@ -273,6 +484,16 @@ void VulkanGLTF::loadNode(const tinygltf::Model& model, int nodeIndex, const glm
 	}
 }
 
+/*
+* cull the flattened nodes against the view frustum through nodeBVH
+*
+* @param viewProjection - projection * view, depth range [0, 1]
+* @param visibleNodes - out, indices into nodes - appended in hierarchy order, not in nodes order
+*/
+void VulkanGLTF::cullNodes(const glm::mat4& viewProjection, std::vector<uint32_t>& visibleNodes) const {
+	nodeBVH.query(Frustum(viewProjection), visibleNodes);
+}
+
 /*
 * get local matrix from the node 
 * 
@@ -313,83 +534,101 @@ void VulkanGLTF::addPrimitive(const tinygltf::Primitive& inputPrimitive, const t
 	primitive.firstIndex = static_cast<uint32_t>(bufferData.indices.size());
 
 	/*
-	* vertices
+	* vertices - accessors are read straight into the vertex streams
 	*/
-	const float* positionBuffer = nullptr;
-	const float* normalsBuffer = nullptr;
-	const float* texCoordsBuffer = nullptr;
-	const float* tangentsBuffer = nullptr;
-	size_t vertexCount = 0;
-
-	//get positions
+	const tinygltf::Accessor* positionAccessor = nullptr;
 	if (auto posIt = inputPrimitive.attributes.find("POSITION"); posIt != inputPrimitive.attributes.end()) {
-		const tinygltf::Accessor& accessor = model.accessors[posIt->second];
-		const tinygltf::BufferView& view = model.bufferViews[accessor.bufferView];
-		positionBuffer = reinterpret_cast<const float*>(&(model.buffers[view.buffer].data[accessor.byteOffset + view.byteOffset]));
-		vertexCount = accessor.count;
+		positionAccessor = &model.accessors[posIt->second];
+	}
+	size_t vertexCount = positionAccessor ? positionAccessor->count : 0;
+	size_t vertexEnd = primitive.vertexOffset + vertexCount;
+	bufferData.positions.resize(vertexEnd);
+	bufferData.normals.resize(vertexEnd, glm::vec3(0.f));
+	bufferData.texCoord0s.resize(vertexEnd, glm::vec2(0.f));
+	bufferData.colors.resize(vertexEnd, glm::vec3(1.f));
+	bufferData.tangents.resize(vertexEnd, glm::vec4(0.f));
+
+	//attribute with the vertex count of the primitive, nullptr if not present
+	auto findAttribute = [&](const char* name) -> const tinygltf::Accessor* {
+		auto it = inputPrimitive.attributes.find(name);
+		if (it == inputPrimitive.attributes.end() || vertexCount == 0) {
+			return nullptr;
+		}
+		const tinygltf::Accessor& accessor = model.accessors[it->second];
+		if (accessor.count != vertexCount) {
+			throw std::runtime_error(std::string("VulkanGLTF::addPrimitive(): ") + name + " count mismatch");
+		}
+		return &accessor;
+	};
+	if (vertexCount > 0) {
+		readFloatAccessor(model, *positionAccessor, 3, &bufferData.positions[primitive.vertexOffset].x);
 	}
 	//get vertex normals
-	if (auto normalIt = inputPrimitive.attributes.find("NORMAL"); normalIt != inputPrimitive.attributes.end()) {
-		const tinygltf::Accessor& accessor = model.accessors[normalIt->second];
-		const tinygltf::BufferView& view = model.bufferViews[accessor.bufferView];
-		normalsBuffer = reinterpret_cast<const float*>(&(model.buffers[view.buffer].data[accessor.byteOffset + view.byteOffset]));
+	if (const tinygltf::Accessor* accessor = findAttribute("NORMAL")) {
+		readFloatAccessor(model, *accessor, 3, &bufferData.normals[primitive.vertexOffset].x);
+		for (size_t i = primitive.vertexOffset; i < vertexEnd; ++i) {
+			float length = glm::length(bufferData.normals[i]);
+			bufferData.normals[i] = length > 0.f ? bufferData.normals[i] / length : glm::vec3(0.f);
+		}
 	}
 	//get vertex texture coordinates
-	if (auto uvIt = inputPrimitive.attributes.find("TEXCOORD_0"); uvIt != inputPrimitive.attributes.end()) {
-		const tinygltf::Accessor& accessor = model.accessors[uvIt->second];
-		const tinygltf::BufferView& view = model.bufferViews[accessor.bufferView];
-		texCoordsBuffer = reinterpret_cast<const float*>(&(model.buffers[view.buffer].data[accessor.byteOffset + view.byteOffset]));
+	if (const tinygltf::Accessor* accessor = findAttribute("TEXCOORD_0")) {
+		readFloatAccessor(model, *accessor, 2, &bufferData.texCoord0s[primitive.vertexOffset].x);
 	}
-	//get tengents
-	if (auto tangentIt = inputPrimitive.attributes.find("TANGENT"); tangentIt != inputPrimitive.attributes.end()) {
-		const tinygltf::Accessor& accessor = model.accessors[tangentIt->second];
-		const tinygltf::BufferView& view = model.bufferViews[accessor.bufferView];
-		tangentsBuffer = reinterpret_cast<const float*>(&(model.buffers[view.buffer].data[accessor.byteOffset + view.byteOffset]));
+	//get tangents
+	if (const tinygltf::Accessor* accessor = findAttribute("TANGENT")) {
+		readFloatAccessor(model, *accessor, 4, &bufferData.tangents[primitive.vertexOffset].x);
 	}
 
-	//append data to model's vertex buffer
-	for (size_t i = 0; i < vertexCount; ++i) {
-		bufferData.positions.push_back(glm::make_vec3(&positionBuffer[i * 3]));
-		bufferData.normals.push_back(normalsBuffer ? glm::normalize(glm::make_vec3(&normalsBuffer[i * 3])) : glm::vec3(0.f));
-		bufferData.texCoord0s.push_back(texCoordsBuffer ? glm::make_vec2(&texCoordsBuffer[i * 2]) : glm::vec2(0.f));
-		bufferData.colors.push_back(glm::vec3(1.f));
-		bufferData.tangents.push_back(tangentsBuffer ? glm::make_vec4(&tangentsBuffer[i * 4]) : glm::vec4(0.f));
-	}
-	
 	/*
-	* indices
+	* indices - non indexed primitives get sequential indices
 	*/
-	const tinygltf::Accessor& accessor = model.accessors[inputPrimitive.indices];
-	const tinygltf::BufferView& bufferView = model.bufferViews[accessor.bufferView];
-	const tinygltf::Buffer& buffer = model.buffers[bufferView.buffer];
-
-	uint32_t indexCount = static_cast<uint32_t>(accessor.count);
-
-	switch (accessor.componentType) {
-	case TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT: {
-		const uint32_t* buf = reinterpret_cast<const uint32_t*>(&buffer.data[accessor.byteOffset + bufferView.byteOffset]);
-		for (size_t i = 0; i < accessor.count; ++i) {
-			bufferData.indices.push_back(buf[i] + primitive.vertexOffset);
-		}
-		break;
+	std::vector<uint32_t> indices;
+	if (inputPrimitive.indices > -1) {
+		readIndexAccessor(model, model.accessors[inputPrimitive.indices], indices);
 	}
-	case TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT: {
-		const uint16_t* buf = reinterpret_cast<const uint16_t*>(&buffer.data[accessor.byteOffset + bufferView.byteOffset]);
-		for (size_t i = 0; i < accessor.count; ++i) {
-			bufferData.indices.push_back(buf[i] + primitive.vertexOffset);
+	else {
+		indices.resize(vertexCount);
+		for (size_t i = 0; i < vertexCount; ++i) {
+			indices[i] = static_cast<uint32_t>(i);
 		}
-		break;
 	}
-	case TINYGLTF_PARAMETER_TYPE_UNSIGNED_BYTE: {
-		const uint8_t* buf = reinterpret_cast<const uint8_t*>(&buffer.data[accessor.byteOffset + bufferView.byteOffset]);
-		for (size_t i = 0; i < accessor.count; ++i) {
-			bufferData.indices.push_back(buf[i] + primitive.vertexOffset);
+	uint32_t indexCount = static_cast<uint32_t>(indices.size());
+
+	std::vector<meshopt::Lod> lods{ { 0, indexCount, 0.f } };
+	PrimitiveClusters clusterRange{ static_cast<uint32_t>(clusters.size()), 0 };
+	if (inputPrimitive.mode == TINYGLTF_MODE_TRIANGLES) {
+		optimizePrimitive(indices, primitive.vertexOffset, vertexCount);
+		//simplified levels follow the full detail indices & share the primitive's vertices
+		if (maxLodCount > 1) {
+			lods = meshopt::buildLodChain(indices, &bufferData.positions[primitive.vertexOffset].x, sizeof(glm::vec3),
+				vertexCount, maxLodCount);
 		}
-		break;
+		//meshlet ordered copy of the full detail triangles follows the levels
+		std::vector<meshopt::Cluster> primitiveClusterList = meshopt::buildClusters(indices, 0, indexCount,
+			&bufferData.positions[primitive.vertexOffset].x, sizeof(glm::vec3), vertexCount);
+		for (meshopt::Cluster& cluster : primitiveClusterList) {
+			cluster.firstIndex += primitive.firstIndex;
+			clusters.push_back(cluster);
+		}
+		clusterRange.clusterCount = static_cast<uint32_t>(primitiveClusterList.size());
 	}
-	default:
-		throw std::runtime_error("VulkanGLTF::addPrimitive(): index component type" + 
-			std::to_string(accessor.componentType) + " not supported");
+	for (meshopt::Lod& lod : lods) {
+		lod.firstIndex += primitive.firstIndex;
+	}
+	primitiveLods.push_back(std::move(lods));
+	primitiveClusters.push_back(clusterRange);
+
+	//vertices referenced after optimization
+	AABB bounds;
+	for (size_t i = 0; i < vertexCount; ++i) {
+		bounds.expand(bufferData.positions[primitive.vertexOffset + i]);
+	}
+	primitiveBounds.push_back(bounds);
+	size_t indexOffset = bufferData.indices.size();
+	bufferData.indices.resize(indexOffset + indices.size());
+	for (size_t i = 0; i < indices.size(); ++i) {
+		bufferData.indices[indexOffset + i] = indices[i] + primitive.vertexOffset;
 	}
 
 	primitive.indexCount = indexCount;
@@ -398,3 +637,43 @@ void VulkanGLTF::addPrimitive(const tinygltf::Primitive& inputPrimitive, const t
 	primitives.push_back(primitive);
 	bufferData.materialIndices.push_back(inputPrimitive.material);
 }
+
+/*
+* reorder triangles for post-transform cache & overdraw, then vertices in first use order
+* the primitive's vertices must be the last ones in bufferData
+*
+* @param indices - primitive local indices, reordered in place
+* @param vertexOffset - first vertex of the primitive in bufferData
+* @param vertexCount - in: primitive vertex count, out: referenced vertex count
+*/
+void VulkanGLTF::optimizePrimitive(std::vector<uint32_t>& indices, uint32_t vertexOffset, size_t& vertexCount) {
+	if (indices.empty()) {
+		return;
+	}
+	size_t indexCount = indices.size();
+	cacheStatisticsBefore += meshopt::analyzeVertexCache(indices.data(), indexCount, vertexCount);
+
+	std::vector<uint32_t> cacheOptimized(indexCount);
+	std::vector<uint32_t> clusters = meshopt::optimizeVertexCache(cacheOptimized.data(), indices.data(),
+		indexCount, vertexCount);
+	meshopt::optimizeOverdraw(indices.data(), cacheOptimized.data(), indexCount,
+		&bufferData.positions[vertexOffset].x, sizeof(glm::vec3), vertexCount, clusters);
+
+	std::vector<uint32_t> remap;
+	size_t newVertexCount = meshopt::optimizeVertexFetchRemap(remap, indices.data(), indexCount, vertexCount);
+	auto remapStream = [&](auto& stream) {
+		using T = typename std::decay_t<decltype(stream)>::value_type;
+		std::vector<T> segment(stream.begin() + vertexOffset, stream.end());
+		meshopt::remapVertexStream(segment, remap, newVertexCount);
+		stream.resize(vertexOffset);
+		stream.insert(stream.end(), segment.begin(), segment.end());
+	};
+	remapStream(bufferData.positions);
+	remapStream(bufferData.normals);
+	remapStream(bufferData.texCoord0s);
+	remapStream(bufferData.colors);
+	remapStream(bufferData.tangents);
+	vertexCount = newVertexCount;
+
+	cacheStatisticsAfter += meshopt::analyzeVertexCache(indices.data(), indexCount, vertexCount);
+}
@@ -7,6 +7,8 @@ https://github.com/nvpro-samples/nvpro_core/blob/master/nvh/gltfscene.h
 #include <unordered_map>
 #include "vulkan_utils.h"
 #include "vulkan_texture.h"
+#include "vulkan_mesh_optimizer.h"
+#include "vulkan_bvh.h"
 #include "../../include/tiny_gltf.h"
 
 /*
@@ -24,6 +26,8 @@ public:
 	void loadScene(VulkanDevice* devices, const std::string& path, VkBufferUsageFlags usage);
 	/** @brief release all resources */
 	void cleanup();
+	/** upload batch of the vertex / index / material buffers - poll with UploadManager::isComplete() */
+	UploadManager::Ticket uploadTicket = 0;
 
 	/*
 	* image
@@ -84,11 +88,18 @@ public:
 	struct Node {
 		glm::mat4 matrix;
 		uint32_t primitiveIndex = 0;
+		/** world space bounds of the primitive */
+		AABB bounds;
 	};
 	std::vector<Node> nodes;
 	/** @brief parse mesh data (vertex / index) */
 	void loadNode(const tinygltf::Model& model, int nodeIndex, const glm::mat4& parentMatrix);
 
+	/** hierarchy over the world space bounds of nodes - built by loadScene() */
+	BVH nodeBVH;
+	/** @brief append indices of nodes intersecting the view frustum */
+	void cullNodes(const glm::mat4& viewProjection, std::vector<uint32_t>& visibleNodes) const;
+
 	/*
 	* buffers
 	*/
@@ -128,10 +139,31 @@ public:
 	};
 	std::vector<Primitive> primitives;
 	VkBuffer primitiveBuffer = VK_NULL_HANDLE;
+	/** object space bounds of each primitive's vertices - kept out of Primitive, which mirrors the shader struct */
+	std::vector<AABB> primitiveBounds;
+
+	/** levels of detail built per triangle primitive including the full detail one - set before loadScene() */
+	uint32_t maxLodCount = 1;
+	/** index ranges of each primitive's levels in indexBuffer - [0] equals firstIndex / indexCount of the primitive */
+	std::vector<std::vector<meshopt::Lod>> primitiveLods;
+
+	/** cluster range of a primitive in clusters - empty for non triangle primitives */
+	struct PrimitiveClusters {
+		uint32_t firstCluster;
+		uint32_t clusterCount;
+	};
+	std::vector<PrimitiveClusters> primitiveClusters;
+	/** meshlets of the full detail level of every primitive - ranges of its meshlet ordered copy, absolute in indexBuffer */
+	std::vector<meshopt::Cluster> clusters;
+
+	/** vertex cache statistics of all triangle primitives before / after optimization */
+	meshopt::CacheStatistics cacheStatisticsBefore, cacheStatisticsAfter;
 
 private:
 	/** @brief get local matrix from the node */
 	glm::mat4 getLocalMatrix(const tinygltf::Node& inputNode) const;
 	/** @brief get vertex / index info from the input primitive */
 	void addPrimitive(const tinygltf::Primitive& inputPrimitive, const tinygltf::Model& model);
+	/** @brief reorder triangles & vertices of the last added primitive */
+	void optimizePrimitive(std::vector<uint32_t>& indices, uint32_t vertexOffset, size_t& vertexCount);
 };
@@ -55,9 +55,13 @@ void ImguiBase::init(VulkanDevice* devices, int width, int height,
 	//create render pass
 	createPipeline(renderPass, sampleCount);
 
+	//vertex & index ring buffer
+	vertexIndexRingBuffer.init(devices, 512 * 1024, MAX_FRAMES_IN_FLIGHT,
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+
 	//build first frame
 	newFrame();
-	updateBuffers();
+	updateBuffers(0);
 }
 
 /*
@@ -69,9 +73,7 @@ void ImguiBase::cleanup() {
 	}
 	ImGui::DestroyContext();
 	//vertex & index buffer
-	devices->memoryAllocator.freeBufferMemory(vertexIndexBuffer, 
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-	vkDestroyBuffer(devices->device, vertexIndexBuffer, nullptr);
+	vertexIndexRingBuffer.cleanup();
 	//image
 	fontImage.cleanup();
 	//pipeline
@@ -93,11 +95,14 @@ void ImguiBase::newFrame() {
 }
 
 /*
-* update vertex & index buffer
+* update vertex & index data of the current frame
+* frame fence must be signaled - VulkanAppBase::update waits for it
+* 
+* @param currentFrame - index of the frame region
 * 
-* @return bool - buffer recreated?
+* @return bool - draw command changed, command buffers must be re-recorded
 */
-bool ImguiBase::updateBuffers() {
+bool ImguiBase::updateBuffers(size_t currentFrame) {
 	bool bufferRecreated= false;
 	ImDrawData* imDrawData = ImGui::GetDrawData();
 
@@ -108,25 +113,31 @@ bool ImguiBase::updateBuffers() {
 		return bufferRecreated;
 	}
 
-	//finish all command before deleting the buffer
-	vkDeviceWaitIdle(devices->device);
-
-	//update buffers only if vertex or index count has been changed
-	if (vertexIndexBuffer == VK_NULL_HANDLE || vertexCount != imDrawData->TotalVtxCount 
-		|| indexCount != imDrawData->TotalIdxCount) {
-		devices->memoryAllocator.freeBufferMemory(vertexIndexBuffer,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-		vkDestroyBuffer(devices->device, vertexIndexBuffer, nullptr);
-		vertexIndexMem = devices->createBuffer(vertexIndexBuffer, vertexBufferSize + indexBufferSize,
-			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	//grow ring buffer - rare, old buffer may still be used by frames in flight
+	if (vertexBufferSize + indexBufferSize > vertexIndexRingBuffer.frameRegionSize) {
+		VkDeviceSize frameRegionSize = vertexIndexRingBuffer.frameRegionSize;
+		while (frameRegionSize < vertexBufferSize + indexBufferSize) {
+			frameRegionSize *= 2;
+		}
+		vertexIndexRingBuffer.cleanup();
+		vertexIndexRingBuffer.init(devices, frameRegionSize, static_cast<uint32_t>(descriptorSets.size()),
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+		bufferRecreated = true;
+	}
+
+	//draw commands change only if vertex or index count has been changed
+	if (vertexCount != imDrawData->TotalVtxCount || indexCount != imDrawData->TotalIdxCount) {
 		vertexCount = imDrawData->TotalVtxCount;
 		indexCount = imDrawData->TotalIdxCount;
 		bufferRecreated = true;
 	}
 
+	//vertex & index data is the only allocation of the frame region
+	vertexIndexRingBuffer.beginFrame(currentFrame);
+	FrameRingBuffer::Allocation allocation = vertexIndexRingBuffer.allocate(vertexBufferSize + indexBufferSize);
+
 	//memcpy vertex data
-	ImDrawVert* vtxDst = (ImDrawVert*)vertexIndexMem.getHandle(devices->device);
+	ImDrawVert* vtxDst = reinterpret_cast<ImDrawVert*>(allocation.data);
 	for (int n = 0; n < imDrawData->CmdListsCount; ++n) {
 		const ImDrawList* cmd_list = imDrawData->CmdLists[n];
 		memcpy(vtxDst, cmd_list->VtxBuffer.Data, cmd_list->VtxBuffer.Size * sizeof(ImDrawVert));
@@ -141,7 +152,6 @@ bool ImguiBase::updateBuffers() {
 		idxDst += cmd_list->IdxBuffer.Size;
 	}
 	
-	vertexIndexMem.unmap(devices->device);
 	return bufferRecreated;
 }
 
@@ -160,6 +170,7 @@ void ImguiBase::drawFrame(VkCommandBuffer cmdBuf, size_t currentFrame) {
 	VkViewport viewport = VkViewport{0, 0, io.DisplaySize.x, io.DisplaySize.y, 0.f, 1.f };
 	vkCmdSetViewport(cmdBuf, 0, 1, &viewport);
 
+	PushConstBlock pushConstBlock{};
 	pushConstBlock.scale = glm::vec2(2.f / io.DisplaySize.x, 2.f / io.DisplaySize.y);
 	pushConstBlock.translate = glm::vec2(-1.f);
 	vkCmdPushConstants(cmdBuf, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0,
@@ -170,10 +181,11 @@ void ImguiBase::drawFrame(VkCommandBuffer cmdBuf, size_t currentFrame) {
 	int32_t indexOffset = 0;
 
 	if (imDrawData->CmdListsCount > 0) {
-		VkDeviceSize offsets[1] = { 0 };
-		vkCmdBindVertexBuffers(cmdBuf, 0, 1, &vertexIndexBuffer, offsets);
+		//vertex & index data always starts at the frame region
+		VkDeviceSize offsets[1] = { vertexIndexRingBuffer.frameRegionSize * currentFrame };
+		vkCmdBindVertexBuffers(cmdBuf, 0, 1, &vertexIndexRingBuffer.buffer, offsets);
 		VkDeviceSize vertexBufferSize = imDrawData->TotalVtxCount * sizeof(ImDrawVert);
-		vkCmdBindIndexBuffer(cmdBuf, vertexIndexBuffer, vertexBufferSize, VK_INDEX_TYPE_UINT16);
+		vkCmdBindIndexBuffer(cmdBuf, vertexIndexRingBuffer.buffer, offsets[0] + vertexBufferSize, VK_INDEX_TYPE_UINT16);
 
 		for (int32_t i = 0; i < imDrawData->CmdListsCount; ++i) {
 			const ImDrawList* cmd_list = imDrawData->CmdLists[i];
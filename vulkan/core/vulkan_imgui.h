@@ -1,6 +1,7 @@
 #pragma once
 #include "vulkan_texture.h"
 #include "vulkan_descriptor_set_bindings.h"
+#include "vulkan_frame_ring_buffer.h"
 
 /* 
 * Imgui & vulkan integration
@@ -11,11 +12,10 @@ protected:
 	struct PushConstBlock {
 		glm::vec2 scale;
 		glm::vec2 translate;
-	} pushConstBlock;
+	};
 
-	/** vertex & index buffer */
-	VkBuffer vertexIndexBuffer							= VK_NULL_HANDLE;
-	MemoryAllocator::HostVisibleMemory vertexIndexMem;
+	/** vertex & index buffer - one frame region per frame in flight */
+	FrameRingBuffer vertexIndexRingBuffer;
 	int32_t vertexCount									= 0;
 	int32_t indexCount									= 0;
 	/** font image */
@@ -41,9 +41,9 @@ public:
 	void cleanup();
 	/** @brief start imgui frame */
 	virtual void newFrame();
-	/** @brief update vertex & index buffer */
-	bool updateBuffers();
-	/** @brief record imgui draw commands */
+	/** @brief update vertex & index data of the current frame */
+	bool updateBuffers(size_t currentFrame);
+	/** @brief record imgui draw commands - may be called concurrently for different command buffers */
 	void drawFrame(VkCommandBuffer cmdBuf, size_t currentFrame);
 	/** @brief create pipeline */
 	void createPipeline(VkRenderPass renderPass, VkSampleCountFlagBits sampleCount);
@@ -0,0 +1,197 @@
+#include <algorithm>
+#include <exception>
+#include "vulkan_job_system.h"
+
+namespace {
+	/** JobSystem::getThreadIndex() - set by the worker loop */
+	thread_local uint32_t currentThreadIndex = 0;
+}
+
+/*
+* start worker threads
+*
+* @param workerCount - 0 for hardware concurrency - 1
+*/
+JobSystem::JobSystem(uint32_t workerCount) {
+	if (workerCount == 0) {
+		workerCount = std::max(1u, std::thread::hardware_concurrency()) - 1;
+	}
+	//every deque exists before the first worker may steal
+	for (uint32_t i = 0; i <= workerCount; ++i) {
+		queues.push_back(std::make_unique<WorkQueue>());
+	}
+	workers.reserve(workerCount);
+	for (uint32_t i = 0; i < workerCount; ++i) {
+		workers.emplace_back(&JobSystem::run, this, i + 1);
+	}
+}
+
+/*
+* finish queued jobs & join workers
+*/
+JobSystem::~JobSystem() {
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		stopping = true;
+	}
+	sleepCondition.notify_all();
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+}
+
+/*
+* process wide instance
+*
+* @return JobSystem& - started on first use, joined at exit
+*/
+JobSystem& JobSystem::get() {
+	static JobSystem jobSystem;
+	return jobSystem;
+}
+
+/*
+* index of the calling thread - per-thread resources (command pools ...) are indexed with it
+*
+* @return uint32_t - 1.. for workers, 0 for the main thread & any other thread
+*/
+uint32_t JobSystem::getThreadIndex() {
+	return currentThreadIndex;
+}
+
+/*
+* run function(i) for every i in [0, count) on the workers & the calling thread
+* indices are handed out one by one, so uneven items (images of different sizes) balance themselves
+* runners are queued on the calling thread's deque - idle workers steal them
+*
+* @param count - number of items
+* @param function - called once per item, concurrently
+*/
+void JobSystem::parallelFor(size_t count, const std::function<void(size_t)>& function) {
+	if (count == 0) {
+		return;
+	}
+
+	//shared with queued runners which may start after this call returned
+	struct Batch {
+		std::atomic<size_t> nextIndex{ 0 };
+		std::atomic<size_t> doneCount{ 0 };
+		size_t count = 0;
+		const std::function<void(size_t)>* function = nullptr;
+		std::mutex mutex;
+		std::condition_variable done;
+		std::exception_ptr exception;
+	};
+	auto batch = std::make_shared<Batch>();
+	batch->count = count;
+	batch->function = &function;
+
+	auto runner = [batch]() {
+		for (size_t i = batch->nextIndex++; i < batch->count; i = batch->nextIndex++) {
+			try {
+				(*batch->function)(i);
+			}
+			catch (...) {
+				std::lock_guard<std::mutex> lock(batch->mutex);
+				if (!batch->exception) {
+					batch->exception = std::current_exception();
+				}
+			}
+			if (++batch->doneCount == batch->count) {
+				std::lock_guard<std::mutex> lock(batch->mutex);
+				batch->done.notify_all();
+			}
+		}
+	};
+
+	size_t runnerCount = std::min(count - 1, workers.size());
+	for (size_t i = 0; i < runnerCount; ++i) {
+		push(runner);
+	}
+
+	runner();
+
+	//help with other queued jobs (nested parallelFor) until the stolen indices are done
+	const uint32_t threadIndex = getThreadIndex();
+	std::function<void()> job;
+	while (batch->doneCount != batch->count && pop(threadIndex, job)) {
+		job();
+	}
+	{
+		std::unique_lock<std::mutex> lock(batch->mutex);
+		batch->done.wait(lock, [&]() { return batch->doneCount == batch->count; });
+	}
+	if (batch->exception) {
+		std::rethrow_exception(batch->exception);
+	}
+}
+
+/*
+* queue a job on the calling thread's deque
+*
+* @param job - runs on any thread
+*/
+void JobSystem::push(std::function<void()> job) {
+	WorkQueue& queue = *queues[getThreadIndex()];
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.jobs.push_back(std::move(job));
+	}
+	{
+		//under the sleep mutex - a worker checking pendingJobs can't miss the wake up
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		++pendingJobs;
+	}
+	sleepCondition.notify_one();
+}
+
+/*
+* take a job - newest of the own deque (cache warm), otherwise the oldest of another deque
+*
+* @param threadIndex - deque of the calling thread
+* @param job - out
+*
+* @return bool - false if every deque is empty
+*/
+bool JobSystem::pop(uint32_t threadIndex, std::function<void()>& job) {
+	const size_t queueCount = queues.size();
+	for (size_t i = 0; i < queueCount; ++i) {
+		WorkQueue& queue = *queues[(threadIndex + i) % queueCount];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.jobs.empty()) {
+			continue;
+		}
+		if (i == 0) {
+			job = std::move(queue.jobs.back());
+			queue.jobs.pop_back();
+		}
+		else {
+			job = std::move(queue.jobs.front());
+			queue.jobs.pop_front();
+		}
+		--pendingJobs;
+		return true;
+	}
+	return false;
+}
+
+/*
+* worker loop - run own & stolen jobs until the pool is destroyed
+*
+* @param threadIndex - index of the worker's deque
+*/
+void JobSystem::run(uint32_t threadIndex) {
+	currentThreadIndex = threadIndex;
+	while (true) {
+		std::function<void()> job;
+		if (pop(threadIndex, job)) {
+			job();
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		sleepCondition.wait(lock, [this]() { return stopping || pendingJobs > 0; });
+		if (stopping && pendingJobs == 0) {
+			return;
+		}
+	}
+}
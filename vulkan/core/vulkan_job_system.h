@@ -0,0 +1,58 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <cstdint>
+
+/*
+* fixed pool of worker threads with one job deque per thread (work stealing)
+* a thread pushes & pops jobs at the back of its own deque, idle workers steal from the front of the others
+* the thread waiting on a parallelFor() works on it too, so nested calls from jobs can't deadlock
+*/
+class JobSystem {
+public:
+	/** @brief start workers - 0 for hardware concurrency - 1 (the calling thread is the last one) */
+	explicit JobSystem(uint32_t workerCount = 0);
+	/** @brief finish queued jobs & join workers */
+	~JobSystem();
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	/** @brief process wide instance, started on first use */
+	static JobSystem& get();
+
+	/** @brief worker threads + the calling thread */
+	uint32_t getThreadCount() const { return static_cast<uint32_t>(workers.size()) + 1; }
+	/** @brief index of the calling thread in [0, getThreadCount()) - workers are 1.., every other thread is 0 */
+	static uint32_t getThreadIndex();
+	/** @brief run function(i) for every i in [0, count), returns when all are done - rethrows the first exception */
+	void parallelFor(size_t count, const std::function<void(size_t)>& function);
+
+private:
+	/** jobs of one thread - the owner works at the back, thieves at the front */
+	struct WorkQueue {
+		std::deque<std::function<void()>> jobs;
+		std::mutex mutex;
+	};
+
+	std::vector<std::thread> workers;
+	/** [0] is shared by all non-worker threads, [i] belongs to worker i */
+	std::vector<std::unique_ptr<WorkQueue>> queues;
+	/** queued jobs of all deques - workers sleep while it's 0 */
+	std::atomic<size_t> pendingJobs{ 0 };
+	std::mutex sleepMutex;
+	std::condition_variable sleepCondition;
+	bool stopping = false;
+
+	/** @brief queue a job on the calling thread's deque & wake a worker */
+	void push(std::function<void()> job);
+	/** @brief take a job from the back of the own deque or steal one from the front of another */
+	bool pop(uint32_t threadIndex, std::function<void()>& job);
+	/** @brief worker loop */
+	void run(uint32_t threadIndex);
+};
@@ -1,5 +1,10 @@
 #include <algorithm>
+#include <cstring>
+#include <sstream>
 #include <string>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 #include "vulkan_memory_allocator.h"
 
 /*
@@ -7,15 +12,19 @@
 *
 * @param device - logical device handle
 * @param bufferImageGranularity
+* @param nonCoherentAtomSize - flush / invalidate alignment of non-coherent memory
 */
-void MemoryAllocator::init(VkDevice device, VkDeviceSize bufferImageGranularity,
+void MemoryAllocator::init(VkDevice device, VkDeviceSize bufferImageGranularity, VkDeviceSize nonCoherentAtomSize,
 	const VkPhysicalDeviceMemoryProperties& memProperties, VkMemoryAllocateFlags allocateFlags,
 	uint32_t defaultChunkSize) {
 	this->memProperties = memProperties;
 	this->device = device;
 	this->bufferImageGranularity = bufferImageGranularity;
+	this->nonCoherentAtomSize = std::max<VkDeviceSize>(nonCoherentAtomSize, 1);
 	this->allocateFlags = allocateFlags;
 	memoryPools.resize(memProperties.memoryTypeCount);
+	heapUsedBytes.assign(memProperties.memoryHeapCount, 0);
+	heapPeakUsedBytes.assign(memProperties.memoryHeapCount, 0);
 
 	//assign memory type index & chunk size to individual memory pool
 	for (uint32_t i = 0; i < memProperties.memoryTypeCount; ++i) {
@@ -32,163 +41,275 @@ void MemoryAllocator::init(VkDevice device, VkDeviceSize bufferImageGranularity,
 
 		//memory type index
 		memoryPools[i].memoryTypeIndex = i;
+		memoryPools[i].propertyFlags = memProperties.memoryTypes[i].propertyFlags;
 	}
 }
 
 /*
 * (sub)allocate to pre-allocated memory
+* large buffers get a dedicated allocation, small ones a slab slot
 *
 * @param buffer - buffer handle to allocate (bind) memory
 * @param properties - memory properties needed for memory type search
 * 
-* @return HostVisibleMemory - contain device memory handle, size, offset
+* @return HostVisibleMemory - contain device memory handle, size, offset & allocation handle
 */
 MemoryAllocator::HostVisibleMemory MemoryAllocator::allocateBufferMemory(VkBuffer buffer, VkMemoryPropertyFlags properties) {
-	VkMemoryRequirements memRequirements;
-	vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
+	VkMemoryDedicatedRequirements dedicatedRequirements{ VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS };
+	VkMemoryRequirements2 memRequirements2{ VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2 };
+	memRequirements2.pNext = &dedicatedRequirements;
+	VkBufferMemoryRequirementsInfo2 requirementsInfo{ VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2 };
+	requirementsInfo.buffer = buffer;
+	vkGetBufferMemoryRequirements2(device, &requirementsInfo, &memRequirements2);
+	VkMemoryRequirements& memRequirements = memRequirements2.memoryRequirements;
 	uint32_t memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties, memProperties);
+	VkDeviceSize size = memRequirements.size;
+	adjustMemoryRequirements(memoryTypeIndex, memRequirements);
 
+	AllocationHandle allocation{ memoryTypeIndex };
+	VkDeviceSize offset = 0;
 	MemoryPool& pool = memoryPools[memoryTypeIndex];
-	//find suitable memory chunk
-	for (size_t i = 0; i < pool.memoryChunks.size(); ++i) {
-		if (pool.memoryChunks[i].currentSize > memRequirements.size) {
-			MemoryBlock memoryBlock{};
-			if (pool.memoryChunks[i].findSuitableMemoryLocation(memRequirements, bufferImageGranularity, memoryBlock)) {
-				pool.memoryChunks[i].addBufferMemoryBlock(device, buffer, memoryBlock);
-				if(properties & (VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT))
-					return { pool.memoryChunks[i].memoryHandle, memoryBlock.size, memoryBlock.offset };
-				else {
-					return{};
-				}
-			}
-		}
+	std::lock_guard<std::mutex> poolLock(*pool.mutex);
+	if (needsDedicatedAllocation(pool, memRequirements, dedicatedRequirements)) {
+		VkMemoryDedicatedAllocateInfo dedicatedInfo{ VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO };
+		dedicatedInfo.buffer = buffer;
+		allocation.chunkIndex = findSuitableMemoryChunk(pool, memRequirements, true, allocation.blockIndex, offset, &dedicatedInfo);
 	}
-
-	//failed to find suitable memory location - add new memory chunk
-	pool.allocateChunk(device, allocateFlags);
-	MemoryBlock memoryBlock{};
-	if (pool.memoryChunks.back().findSuitableMemoryLocation(memRequirements, bufferImageGranularity, memoryBlock)) {
-		pool.memoryChunks.back().addBufferMemoryBlock(device, buffer, memoryBlock);
-		if (properties & (VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT))
-			return { pool.memoryChunks.back().memoryHandle, memoryBlock.size, memoryBlock.offset };
-		else {
-			return{};
+	else if (memRequirements.size <= SLAB_MAX_SLOT_SIZE && memRequirements.alignment <= SLAB_MAX_SLOT_SIZE) {
+		if (!allocateSlot(pool, buffer, memRequirements, allocation, offset)) {
+			return {};
 		}
+		MemoryChunk& chunk = pool.memoryChunks[allocation.chunkIndex];
+		{
+			std::lock_guard<std::mutex> allocationLock(allocationMutex);
+			allocations[reinterpret_cast<uint64_t>(buffer)] = allocation;
+		}
+		return makeHostVisibleMemory(pool, chunk, size, offset, allocation);
+	}
+	else {
+		allocation.chunkIndex = findSuitableMemoryChunk(pool, memRequirements, true, allocation.blockIndex, offset);
+	}
+	if (allocation.blockIndex == INVALID_BLOCK_INDEX) {
+		return {};
 	}
 
-	return {};
+	MemoryChunk& chunk = pool.memoryChunks[allocation.chunkIndex];
+	chunk.addBufferMemoryBlock(device, buffer, allocation.blockIndex, offset, memRequirements.size);
+	trackUsage(memoryTypeIndex, memRequirements.size, true);
+	{
+		std::lock_guard<std::mutex> allocationLock(allocationMutex);
+		allocations[reinterpret_cast<uint64_t>(buffer)] = allocation;
+	}
+	return makeHostVisibleMemory(pool, chunk, size, offset, allocation);
 }
 
 /*
-* basically the same as allocateBufferMemory but for VkImage
+* basically the same as allocateBufferMemory but for VkImage - images never use slabs
 *
 * @param image - image handle to allocate (bind) memory
 * @param properties - memory properties needed for memory type search
+* @param tiling - linear images can share bufferImageGranularity page with buffers
 *
-* @return HostVisibleMemory - contain device memory handle, size, offset
+* @return HostVisibleMemory - contain device memory handle, size, offset & allocation handle
 */
-MemoryAllocator::HostVisibleMemory MemoryAllocator::allocateImageMemory(VkImage image, VkMemoryPropertyFlags properties) {
-	VkMemoryRequirements memRequirements;
-	vkGetImageMemoryRequirements(device, image, &memRequirements);
+MemoryAllocator::HostVisibleMemory MemoryAllocator::allocateImageMemory(VkImage image, VkMemoryPropertyFlags properties,
+	VkImageTiling tiling) {
+	VkMemoryDedicatedRequirements dedicatedRequirements{ VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS };
+	VkMemoryRequirements2 memRequirements2{ VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2 };
+	memRequirements2.pNext = &dedicatedRequirements;
+	VkImageMemoryRequirementsInfo2 requirementsInfo{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2 };
+	requirementsInfo.image = image;
+	vkGetImageMemoryRequirements2(device, &requirementsInfo, &memRequirements2);
+	VkMemoryRequirements& memRequirements = memRequirements2.memoryRequirements;
 	uint32_t memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties, memProperties);
+	VkDeviceSize size = memRequirements.size;
+	adjustMemoryRequirements(memoryTypeIndex, memRequirements);
 
+	bool linear = (tiling == VK_IMAGE_TILING_LINEAR);
+	AllocationHandle allocation{ memoryTypeIndex };
+	VkDeviceSize offset = 0;
 	MemoryPool& pool = memoryPools[memoryTypeIndex];
-	//find suitable memory chunk
-	for (size_t i = 0; i < pool.memoryChunks.size(); ++i) {
-		if (pool.memoryChunks[i].currentSize > memRequirements.size) {
-			MemoryBlock memoryBlock{};
-			if (pool.memoryChunks[i].findSuitableMemoryLocation(memRequirements, bufferImageGranularity, memoryBlock)) {
-				pool.memoryChunks[i].addImageMemoryBlock(device, image, memoryBlock);
-				if (properties & (VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
-					return { pool.memoryChunks[i].memoryHandle, memoryBlock.size, memoryBlock.offset };
-				else {
-					return{};
-				}
-			}
-		}
+	std::lock_guard<std::mutex> poolLock(*pool.mutex);
+	if (needsDedicatedAllocation(pool, memRequirements, dedicatedRequirements)) {
+		VkMemoryDedicatedAllocateInfo dedicatedInfo{ VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO };
+		dedicatedInfo.image = image;
+		allocation.chunkIndex = findSuitableMemoryChunk(pool, memRequirements, linear, allocation.blockIndex, offset, &dedicatedInfo);
+	}
+	else {
+		allocation.chunkIndex = findSuitableMemoryChunk(pool, memRequirements, linear, allocation.blockIndex, offset);
+	}
+	if (allocation.blockIndex == INVALID_BLOCK_INDEX) {
+		return {};
 	}
 
-	//failed to find suitable memory location - add new memory chunk
-	pool.allocateChunk(device, allocateFlags);
-	MemoryBlock memoryBlock{};
-	if (pool.memoryChunks.back().findSuitableMemoryLocation(memRequirements, bufferImageGranularity, memoryBlock)) {
-		pool.memoryChunks.back().addImageMemoryBlock(device, image, memoryBlock);
-		if (properties & (VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
-			return { pool.memoryChunks.back().memoryHandle, memoryBlock.size, memoryBlock.offset };
-		else {
-			return{};
+	MemoryChunk& chunk = pool.memoryChunks[allocation.chunkIndex];
+	chunk.addImageMemoryBlock(device, image, allocation.blockIndex, offset, memRequirements.size, linear);
+	trackUsage(memoryTypeIndex, memRequirements.size, true);
+	{
+		std::lock_guard<std::mutex> allocationLock(allocationMutex);
+		allocations[reinterpret_cast<uint64_t>(image)] = allocation;
+	}
+	return makeHostVisibleMemory(pool, chunk, size, offset, allocation);
+}
+
+/*
+* suballocate memory without binding - caller binds (aliased) resources & frees it with freeMemory
+*
+* @param memRequirements - combined requirements of the resources sharing the memory
+* @param properties - memory properties needed for memory type search
+* @param linear - memory holds buffers / linear images or optimal images
+*
+* @return HostVisibleMemory - contain device memory handle, size, offset & allocation handle
+*/
+MemoryAllocator::HostVisibleMemory MemoryAllocator::allocateMemory(const VkMemoryRequirements& memRequirements,
+	VkMemoryPropertyFlags properties, bool linear) {
+	VkMemoryRequirements requirements = memRequirements;
+	uint32_t memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, properties, memProperties);
+	VkDeviceSize size = requirements.size;
+	adjustMemoryRequirements(memoryTypeIndex, requirements);
+
+	AllocationHandle allocation{ memoryTypeIndex };
+	VkDeviceSize offset = 0;
+	MemoryPool& pool = memoryPools[memoryTypeIndex];
+	std::lock_guard<std::mutex> poolLock(*pool.mutex);
+	if (needsDedicatedAllocation(pool, requirements, {})) {
+		//no resource to dedicate to - own VkDeviceMemory only
+		VkMemoryDedicatedAllocateInfo dedicatedInfo{ VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO };
+		allocation.chunkIndex = findSuitableMemoryChunk(pool, requirements, linear, allocation.blockIndex, offset, &dedicatedInfo);
+	}
+	else {
+		allocation.chunkIndex = findSuitableMemoryChunk(pool, requirements, linear, allocation.blockIndex, offset);
+	}
+	if (allocation.blockIndex == INVALID_BLOCK_INDEX) {
+		return {};
+	}
+
+	MemoryChunk& chunk = pool.memoryChunks[allocation.chunkIndex];
+	chunk.addMemoryBlock(allocation.blockIndex, offset, requirements.size, linear);
+	trackUsage(memoryTypeIndex, requirements.size, true);
+	return makeHostVisibleMemory(pool, chunk, size, offset, allocation);
+}
+
+/*
+* align non-coherent suballocations to nonCoherentAtomSize
+* so flush / invalidate ranges never touch neighbouring blocks
+*
+* @param memoryTypeIndex - memory type of the suballocation
+* @param memRequirements - in/out, alignment & size are rounded up to nonCoherentAtomSize
+*/
+void MemoryAllocator::adjustMemoryRequirements(uint32_t memoryTypeIndex, VkMemoryRequirements& memRequirements) const {
+	VkMemoryPropertyFlags flags = memoryPools[memoryTypeIndex].propertyFlags;
+	if ((flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !(flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
+		memRequirements.alignment = std::max(memRequirements.alignment, nonCoherentAtomSize);
+		memRequirements.size = (memRequirements.size + nonCoherentAtomSize - 1) / nonCoherentAtomSize * nonCoherentAtomSize;
+	}
+}
+
+/*
+* build HostVisibleMemory of a new suballocation
+*
+* @param pool - memory pool of the suballocation
+* @param chunk - memory chunk of the suballocation
+* @param size - required memory size
+* @param offset - location of the suballocation in the chunk
+* @param allocation - allocation handle
+*
+* @return HostVisibleMemory
+*/
+MemoryAllocator::HostVisibleMemory MemoryAllocator::makeHostVisibleMemory(const MemoryPool& pool, const MemoryChunk& chunk,
+	VkDeviceSize size, VkDeviceSize offset, const AllocationHandle& allocation) const {
+	HostVisibleMemory memory{ chunk.memoryHandle, size, offset, allocation };
+	if (chunk.mappedData != nullptr) {
+		memory.mappedData = static_cast<uint8_t*>(chunk.mappedData) + offset;
+		if (!(pool.propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
+			memory.nonCoherentAtomSize = nonCoherentAtomSize;
 		}
 	}
+	return memory;
+}
 
-	return {};
+/*
+* free memory block of the allocation - no lookup, no driver query
+*
+* @param memory - returned by allocateBufferMemory / allocateImageMemory
+*/
+void MemoryAllocator::freeMemory(const HostVisibleMemory& memory) {
+	const AllocationHandle& allocation = memory.allocation;
+	if (allocation.memoryTypeIndex == UINT32_MAX) {
+		return;
+	}
+
+	MemoryPool& pool = memoryPools[allocation.memoryTypeIndex];
+	std::lock_guard<std::mutex> poolLock(*pool.mutex);
+	const MemoryBlock& block = pool.memoryChunks[allocation.chunkIndex].memoryBlocks[allocation.blockIndex];
+	if (block.free) {
+		throw std::runtime_error("MemoryAllocator::freeMemory(): allocation is already freed");
+	}
+	uint64_t handle = reinterpret_cast<uint64_t>(block.handle.bufferHandle);
+	if (allocation.slotIndex != UINT32_MAX) {
+		handle = pool.slabs[block.slabIndex].slotHandles[allocation.slotIndex];
+		if (handle == 0) {
+			throw std::runtime_error("MemoryAllocator::freeMemory(): allocation is already freed");
+		}
+	}
+	{
+		std::lock_guard<std::mutex> allocationLock(allocationMutex);
+		allocations.erase(handle);
+		movableResources.erase(handle);
+	}
+	freeAllocation(allocation);
 }
 
 /*
 * free buffer memory block
 * 
 * @param buffer - buffer to be deallocated
-* @param properties - used to identify memory type; 
-*	if it is not provided then memory allocator should search the whole memory pools
 */
-void MemoryAllocator::freeBufferMemory(VkBuffer buffer, VkMemoryPropertyFlags properties) {
+void MemoryAllocator::freeBufferMemory(VkBuffer buffer) {
 	if (buffer == VK_NULL_HANDLE) {
 		return;
 	}
 
-	if (properties == VK_MEMORY_PROPERTY_FLAG_BITS_MAX_ENUM) {
-		//memory properties are not provided; search the whole memory pools
-		for (uint32_t memoryTypeIndex = 0; memoryTypeIndex < memoryPools.size(); ++memoryTypeIndex) {
-			if (findAndEraseBufferMemoryBlock(buffer, memoryTypeIndex)) {
-				return;
-			}
+	AllocationHandle allocation;
+	{
+		std::lock_guard<std::mutex> allocationLock(allocationMutex);
+		auto it = allocations.find(reinterpret_cast<uint64_t>(buffer));
+		if (it == allocations.end()) {
+			throw std::runtime_error("MemoryAllocator::freeBufferMemory(): there is no matching buffer");
 		}
+		allocation = it->second;
+		allocations.erase(it);
+		movableResources.erase(reinterpret_cast<uint64_t>(buffer));
 	}
-	else {
-		//identify memory type
-		VkMemoryRequirements memRequirements;
-		vkGetBufferMemoryRequirements(device, buffer, &memRequirements); //make sure to free memory before you free VkBuffer
-		uint32_t memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties, memProperties);
 
-		if (findAndEraseBufferMemoryBlock(buffer, memoryTypeIndex)) {
-			return;
-		}
-	}
-
-	throw std::runtime_error("MemoryAllocator::freeBufferMemory(): there is no matching buffer");
+	std::lock_guard<std::mutex> poolLock(*memoryPools[allocation.memoryTypeIndex].mutex);
+	freeAllocation(allocation);
 }
 
 /*
 * basically the same as freeBufferMemory but for VkImage
 *
 * @param image - image to be deallocated
-* @param properties - used to identify memory type;
-*	if it is not provided then memory allocator should search the whole memory pools
 */
-void MemoryAllocator::freeImageMemory(VkImage image, VkMemoryPropertyFlags properties) {
+void MemoryAllocator::freeImageMemory(VkImage image) {
 	if (image == VK_NULL_HANDLE) {
 		return;
 	}
 
-	if (properties == VK_MEMORY_PROPERTY_FLAG_BITS_MAX_ENUM) {
-		//memory properties are not provided; search the whole memory pools
-		for (uint32_t memoryTypeIndex = 0; memoryTypeIndex < memoryPools.size(); ++memoryTypeIndex) {
-			if (findAndEraseImageMemoryBlock(image, memoryTypeIndex)) {
-				return;
-			}
-		}
-	}
-	else {
-		//identify memory type
-		VkMemoryRequirements memRequirements;
-		vkGetImageMemoryRequirements(device, image, &memRequirements); //make sure to free memory before you free VkImage
-		uint32_t memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties, memProperties);
-
-		if (findAndEraseImageMemoryBlock(image, memoryTypeIndex)) {
-			return;
+	AllocationHandle allocation;
+	{
+		std::lock_guard<std::mutex> allocationLock(allocationMutex);
+		auto it = allocations.find(reinterpret_cast<uint64_t>(image));
+		if (it == allocations.end()) {
+			throw std::runtime_error("MemoryAllocator::freeImageMemory(): there is no matching image");
 		}
+		allocation = it->second;
+		allocations.erase(it);
+		movableResources.erase(reinterpret_cast<uint64_t>(image));
 	}
 
-	throw std::runtime_error("MemoryAllocator::freeImageMemory(): there is no matching image");
+	std::lock_guard<std::mutex> poolLock(*memoryPools[allocation.memoryTypeIndex].mutex);
+	freeAllocation(allocation);
 }
 
 /*
@@ -241,71 +362,711 @@ uint32_t MemoryAllocator::findMemoryType(uint32_t memoryTypeBitsRequirements,
 }
 
 /*
-* helper function for freeBufferMemory
-* 
-* @param buffer - buffer handle bound to the memory to be deallocated
-* @param memoryTypeIndex - index of memoryType used by the buffer
-*/
-bool MemoryAllocator::findAndEraseBufferMemoryBlock(VkBuffer buffer, uint32_t memoryTypeIndex) {
-	//find & remove 
-	for (auto& memoryChunk : memoryPools[memoryTypeIndex].memoryChunks) {
-		auto it = std::find_if(memoryChunk.memoryBlocks.begin(), memoryChunk.memoryBlocks.end(),
-			[&buffer](const MemoryBlock& memoryBlock) {
-				return buffer == memoryBlock.handle.bufferHandle;
-			});
-
-		if (it != memoryChunk.memoryBlocks.end()) {
-			memoryChunk.currentSize += (it->blockEndLocation - it->offset);
-			memoryChunk.memoryBlocks.erase(it);
-			return true;
+* find free block in the pool, allocate new chunk if there is none
+*
+* @param pool - memory pool of the required memory type
+* @param memRequirements
+* @param linear - buffer / linear image or optimal image
+* @param blockIndex - out parameter, INVALID_BLOCK_INDEX if the resource doesn't fit in a chunk
+* @param offset - out parameter, aligned offset of the resource
+* @param dedicatedInfo - not nullptr to allocate a chunk only for this resource
+*
+* @return uint32_t - index of the chunk containing blockIndex
+*/
+uint32_t MemoryAllocator::findSuitableMemoryChunk(MemoryPool& pool,
+	const VkMemoryRequirements& memRequirements, bool linear, uint32_t& blockIndex, VkDeviceSize& offset,
+	const VkMemoryDedicatedAllocateInfo* dedicatedInfo) {
+	//find suitable memory chunk
+	for (uint32_t i = 0; dedicatedInfo == nullptr && i < pool.memoryChunks.size(); ++i) {
+		MemoryChunk& memoryChunk = pool.memoryChunks[i];
+		if (isChunkCompatible(memoryChunk, linear) && memoryChunk.currentSize >= memRequirements.size &&
+			memoryChunk.findSuitableMemoryLocation(memRequirements, bufferImageGranularity, linear, blockIndex, offset)) {
+			return i;
 		}
 	}
-	return false;
+
+	//failed to find suitable memory location - add new memory chunk
+	VkDeviceSize chunkSize = dedicatedInfo ? memRequirements.size : std::max(pool.defaultChunkSize, memRequirements.size);
+	uint32_t chunkIndex = pool.allocateChunk(device, allocateFlags, chunkSize, linear, dedicatedInfo);
+	if (!pool.memoryChunks[chunkIndex].findSuitableMemoryLocation(memRequirements, bufferImageGranularity, linear, blockIndex, offset)) {
+		blockIndex = INVALID_BLOCK_INDEX;
+	}
+	return chunkIndex;
 }
 
 /*
-* helper function for freeImageMemory
+* release block referenced by the allocation handle - pool mutex must be held
 *
-* @param image - image handle bound to the memory to be deallocated
-* @param memoryTypeIndex - index of memoryType used by the image
+* @param allocation - memory type / chunk / block index of the suballocation
 */
-bool MemoryAllocator::findAndEraseImageMemoryBlock(VkImage image, uint32_t memoryTypeIndex) {
-	//find & remove 
-	for (auto& memoryChunk : memoryPools[memoryTypeIndex].memoryChunks) {
-		auto it = std::find_if(memoryChunk.memoryBlocks.begin(), memoryChunk.memoryBlocks.end(),
-			[&image](const MemoryBlock& memoryBlock) {
-				return image == memoryBlock.handle.imageHandle;
-			});
+void MemoryAllocator::freeAllocation(const AllocationHandle& allocation) {
+	MemoryPool& pool = memoryPools[allocation.memoryTypeIndex];
+	if (allocation.slotIndex != UINT32_MAX) {
+		freeSlot(pool, allocation);
+		return;
+	}
 
-		if (it != memoryChunk.memoryBlocks.end()) {
-			memoryChunk.currentSize += (it->blockEndLocation - it->offset);
-			memoryChunk.memoryBlocks.erase(it);
-			return true;
+	MemoryChunk& chunk = pool.memoryChunks[allocation.chunkIndex];
+	trackUsage(allocation.memoryTypeIndex, chunk.memoryBlocks[allocation.blockIndex].size, false);
+	chunk.freeMemoryBlock(allocation.blockIndex);
+	if (chunk.dedicated) {
+		releaseChunk(chunk);
+	}
+}
+
+/*
+* check if the resource should get its own VkDeviceMemory
+* driver preference (VK_KHR_dedicated_allocation, core in 1.1) or more than a quarter of a chunk
+*
+* @param pool - memory pool of the resource
+* @param memRequirements
+* @param dedicatedRequirements - returned by vkGet*MemoryRequirements2
+*
+* @return bool - true for dedicated allocation
+*/
+bool MemoryAllocator::needsDedicatedAllocation(const MemoryPool& pool, const VkMemoryRequirements& memRequirements,
+	const VkMemoryDedicatedRequirements& dedicatedRequirements) const {
+	return dedicatedRequirements.requiresDedicatedAllocation || dedicatedRequirements.prefersDedicatedAllocation ||
+		memRequirements.size > pool.defaultChunkSize / 4;
+}
+
+/*
+* check if a resource can be suballocated from the chunk
+* linear & optimal resources never share a chunk, so bufferImageGranularity never pads
+*
+* @param chunk - memory chunk
+* @param linear - buffer / linear image or optimal image
+*
+* @return bool - true if the chunk may hold the resource
+*/
+bool MemoryAllocator::isChunkCompatible(const MemoryChunk& chunk, bool linear) const {
+	return chunk.memoryHandle != VK_NULL_HANDLE && !chunk.dedicated &&
+		(bufferImageGranularity <= 1 || chunk.linear == linear);
+}
+
+/*
+* bind small buffer to a free slab slot - new slab is suballocated if every slab of the size class is full
+* pool mutex must be held
+*
+* @param pool - memory pool of the buffer
+* @param buffer - buffer to bind
+* @param memRequirements - size & alignment must not exceed SLAB_MAX_SLOT_SIZE
+* @param allocation - out, chunk / slab block / slot of the buffer
+* @param offset - out, offset of the slot in the chunk
+*
+* @return bool - false if a new slab could not be allocated
+*/
+bool MemoryAllocator::allocateSlot(MemoryPool& pool, VkBuffer buffer, const VkMemoryRequirements& memRequirements,
+	AllocationHandle& allocation, VkDeviceSize& offset) {
+	//slots are aligned to their size since slabs are SLAB_MAX_SLOT_SIZE aligned
+	VkDeviceSize slotSize = SLAB_MIN_SLOT_SIZE;
+	while (slotSize < memRequirements.size || slotSize < memRequirements.alignment) {
+		slotSize <<= 1;
+	}
+
+	uint32_t slabIndex = INVALID_BLOCK_INDEX;
+	for (uint32_t i = 0; i < pool.slabs.size(); ++i) {
+		if (pool.slabs[i].slotSize == slotSize && !pool.slabs[i].freeSlots.empty()) {
+			slabIndex = i;
+			break;
+		}
+	}
+
+	if (slabIndex == INVALID_BLOCK_INDEX) {
+		VkMemoryRequirements slabRequirements{ SLAB_SIZE, SLAB_MAX_SLOT_SIZE, memRequirements.memoryTypeBits };
+		uint32_t blockIndex = INVALID_BLOCK_INDEX;
+		VkDeviceSize slabOffset = 0;
+		uint32_t chunkIndex = findSuitableMemoryChunk(pool, slabRequirements, true, blockIndex, slabOffset);
+		if (blockIndex == INVALID_BLOCK_INDEX) {
+			return false;
+		}
+
+		if (pool.unusedSlabIndices.empty()) {
+			slabIndex = static_cast<uint32_t>(pool.slabs.size());
+			pool.slabs.emplace_back();
+		}
+		else {
+			slabIndex = pool.unusedSlabIndices.back();
+			pool.unusedSlabIndices.pop_back();
 		}
+		pool.memoryChunks[chunkIndex].addSlabMemoryBlock(blockIndex, slabOffset, SLAB_SIZE, slabIndex);
+
+		MemoryPool::Slab& slab = pool.slabs[slabIndex];
+		slab.chunkIndex = chunkIndex;
+		slab.blockIndex = blockIndex;
+		slab.slotSize = slotSize;
+		uint32_t slotCount = static_cast<uint32_t>(SLAB_SIZE / slotSize);
+		slab.slotHandles.assign(slotCount, 0);
+		slab.freeSlots.clear();
+		for (uint32_t i = slotCount; i > 0; --i) {
+			slab.freeSlots.push_back(i - 1);
+		}
+	}
+
+	MemoryPool::Slab& slab = pool.slabs[slabIndex];
+	allocation.chunkIndex = slab.chunkIndex;
+	allocation.blockIndex = slab.blockIndex;
+	allocation.slotIndex = slab.freeSlots.back();
+	slab.freeSlots.pop_back();
+	slab.slotHandles[allocation.slotIndex] = reinterpret_cast<uint64_t>(buffer);
+
+	MemoryChunk& chunk = pool.memoryChunks[slab.chunkIndex];
+	offset = chunk.memoryBlocks[slab.blockIndex].offset + allocation.slotIndex * slotSize;
+	trackUsage(allocation.memoryTypeIndex, slotSize, true);
+	vkBindBufferMemory(device, buffer, chunk.memoryHandle, offset);
+	return true;
+}
+
+/*
+* return slab slot, release the slab when all of its slots are free - pool mutex must be held
+*
+* @param pool - memory pool of the slab
+* @param allocation - slot allocation
+*/
+void MemoryAllocator::freeSlot(MemoryPool& pool, const AllocationHandle& allocation) {
+	MemoryChunk& chunk = pool.memoryChunks[allocation.chunkIndex];
+	uint32_t slabIndex = chunk.memoryBlocks[allocation.blockIndex].slabIndex;
+	MemoryPool::Slab& slab = pool.slabs[slabIndex];
+	trackUsage(allocation.memoryTypeIndex, slab.slotSize, false);
+	slab.slotHandles[allocation.slotIndex] = 0;
+	slab.freeSlots.push_back(allocation.slotIndex);
+
+	if (slab.freeSlots.size() == slab.slotHandles.size()) {
+		chunk.freeMemoryBlock(slab.blockIndex);
+		slab = MemoryPool::Slab{};
+		pool.unusedSlabIndices.push_back(slabIndex);
+	}
+}
+
+/*
+* free device memory of the chunk - the chunk slot stays so allocation handles of other chunks stay valid
+*
+* @param chunk - chunk without active blocks
+*/
+void MemoryAllocator::releaseChunk(MemoryChunk& chunk) {
+	if (chunk.mappedData != nullptr) {
+		vkUnmapMemory(device, chunk.memoryHandle);
+	}
+	vkFreeMemory(device, chunk.memoryHandle, nullptr);
+	chunk = MemoryChunk{};
+}
+
+/*
+* update used & peak bytes & allocation count of the memory type & its heap - pool mutex must be held
+*
+* @param memoryTypeIndex - memory type of the suballocation
+* @param size - size of the suballocation
+* @param allocated - true on allocation, false on free
+*/
+void MemoryAllocator::trackUsage(uint32_t memoryTypeIndex, VkDeviceSize size, bool allocated) {
+	MemoryPool& pool = memoryPools[memoryTypeIndex];
+	uint32_t heapIndex = memProperties.memoryTypes[memoryTypeIndex].heapIndex;
+	if (allocated) {
+		pool.usedBytes += size;
+		pool.peakUsedBytes = std::max(pool.peakUsedBytes, pool.usedBytes);
+		++pool.totalAllocationCount;
+		std::lock_guard<std::mutex> allocationLock(allocationMutex);
+		heapUsedBytes[heapIndex] += size;
+		heapPeakUsedBytes[heapIndex] = std::max(heapPeakUsedBytes[heapIndex], heapUsedBytes[heapIndex]);
+	}
+	else {
+		pool.usedBytes -= size;
+		std::lock_guard<std::mutex> allocationLock(allocationMutex);
+		heapUsedBytes[heapIndex] -= size;
+	}
+}
+
+/*
+* register device local buffer which defragment() may move
+* pNext & queue family indices of createInfo are not kept
+*
+* @param buffer - buffer allocated by allocateBufferMemory
+* @param createInfo - used to create the replacement buffer, usage needs TRANSFER_SRC & TRANSFER_DST
+*/
+void MemoryAllocator::setMovable(VkBuffer buffer, const VkBufferCreateInfo& createInfo) {
+	VkBufferUsageFlags transferUsage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	if ((createInfo.usage & transferUsage) != transferUsage) {
+		throw std::runtime_error("MemoryAllocator::setMovable(): buffer usage needs transfer src & dst");
+	}
+	MovableResource resource{};
+	resource.bufferInfo = createInfo;
+	resource.bufferInfo.pNext = nullptr;
+	resource.bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	resource.bufferInfo.queueFamilyIndexCount = 0;
+	resource.bufferInfo.pQueueFamilyIndices = nullptr;
+	std::lock_guard<std::mutex> allocationLock(allocationMutex);
+	movableResources[reinterpret_cast<uint64_t>(buffer)] = resource;
+}
+
+/*
+* register device local image which defragment() may move
+* pNext & queue family indices of createInfo are not kept
+*
+* @param image - image allocated by allocateImageMemory
+* @param createInfo - used to create the replacement image, usage needs TRANSFER_SRC & TRANSFER_DST
+*	unless layout is VK_IMAGE_LAYOUT_UNDEFINED
+* @param layout - layout of the image when defragment() commands execute,
+*	VK_IMAGE_LAYOUT_UNDEFINED if contents need not be preserved (e.g. attachments)
+* @param aspect - image aspect to copy
+*/
+void MemoryAllocator::setMovable(VkImage image, const VkImageCreateInfo& createInfo, VkImageLayout layout,
+	VkImageAspectFlags aspect) {
+	VkImageUsageFlags transferUsage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	if (layout != VK_IMAGE_LAYOUT_UNDEFINED && (createInfo.usage & transferUsage) != transferUsage) {
+		throw std::runtime_error("MemoryAllocator::setMovable(): image usage needs transfer src & dst");
+	}
+	MovableResource resource{};
+	resource.imageInfo = createInfo;
+	resource.imageInfo.pNext = nullptr;
+	resource.imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	resource.imageInfo.queueFamilyIndexCount = 0;
+	resource.imageInfo.pQueueFamilyIndices = nullptr;
+	resource.imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	resource.layout = layout;
+	resource.aspect = aspect;
+	resource.image = true;
+	std::lock_guard<std::mutex> allocationLock(allocationMutex);
+	movableResources[reinterpret_cast<uint64_t>(image)] = resource;
+}
+
+/*
+* find new location for a movable resource
+* destination chunks are tried from the densest one, source chunk only below the current offset
+*
+* @param pool - memory pool of the resource
+* @param srcChunkIndex - chunk the resource is moved out of
+* @param srcOffset - current offset of the resource
+* @param memRequirements - requirements of the replacement resource
+* @param linear - buffer / linear image or optimal image
+* @param chunkIndex - out, destination chunk
+* @param blockIndex - out, free block containing the location
+* @param offset - out, new offset
+*
+* @return bool - false if there is no better location
+*/
+bool MemoryAllocator::findDefragmentationLocation(MemoryPool& pool, uint32_t srcChunkIndex, VkDeviceSize srcOffset,
+	const VkMemoryRequirements& memRequirements, bool linear, uint32_t& chunkIndex, uint32_t& blockIndex, VkDeviceSize& offset) {
+	std::vector<uint32_t> chunkIndices;
+	for (uint32_t i = 0; i < pool.memoryChunks.size(); ++i) {
+		if (isChunkCompatible(pool.memoryChunks[i], linear)) {
+			chunkIndices.push_back(i);
+		}
+	}
+	std::sort(chunkIndices.begin(), chunkIndices.end(), [&pool](uint32_t a, uint32_t b) {
+		return pool.memoryChunks[a].currentSize < pool.memoryChunks[b].currentSize;
+	});
+
+	for (uint32_t i : chunkIndices) {
+		MemoryChunk& memoryChunk = pool.memoryChunks[i];
+		if (memoryChunk.currentSize < memRequirements.size ||
+			!memoryChunk.findSuitableMemoryLocation(memRequirements, bufferImageGranularity, linear, blockIndex, offset)) {
+			continue;
+		}
+		//moving inside the source chunk only helps when the resource moves toward the chunk start
+		if (i == srcChunkIndex && offset >= srcOffset) {
+			continue;
+		}
+		chunkIndex = i;
+		return true;
 	}
 	return false;
 }
 
 /*
-* pre-allocate big chunk of memory
+* move movable resources out of the sparsest chunk of each device local memory type
+* replacement resources are created, bound & filled by copy commands recorded into cmdBuf
+*
+* movable resources must not be freed by other threads during the call
+*
+* @param cmdBuf - command buffer in recording state, must be submitted by the caller
+* @param maxBytesToMove - per-call budget
+* @param moves - out, resources moved by this call - see DefragmentationMove
+*
+* @return VkDeviceSize - bytes moved
+*/
+VkDeviceSize MemoryAllocator::defragment(VkCommandBuffer cmdBuf, VkDeviceSize maxBytesToMove,
+	std::vector<DefragmentationMove>& moves) {
+	//chunks emptied by previous moves
+	releaseEmptyChunks();
+
+	VkDeviceSize bytesMoved = 0;
+	size_t firstMove = moves.size();
+	//create info of each new move - used to record copies without map lookup
+	std::vector<MovableResource> moveResources;
+	std::vector<VkImageCopy> imageCopies;
+
+	for (uint32_t memoryTypeIndex = 0; memoryTypeIndex < memoryPools.size(); ++memoryTypeIndex) {
+		MemoryPool& pool = memoryPools[memoryTypeIndex];
+		if (!(pool.propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) ||
+			(pool.propertyFlags & (VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT))) {
+			continue;
+		}
+		std::lock_guard<std::mutex> poolLock(*pool.mutex);
+
+		//movable resources of the pool - slab slots & dedicated allocations stay
+		struct Candidate {
+			uint32_t chunkIndex;
+			VkDeviceSize offset;
+			VkDeviceSize size;
+			uint64_t handle;
+			MovableResource resource;
+		};
+		std::vector<Candidate> candidates;
+		{
+			std::lock_guard<std::mutex> allocationLock(allocationMutex);
+			for (const auto& movable : movableResources) {
+				const AllocationHandle& allocation = allocations.at(movable.first);
+				if (allocation.memoryTypeIndex != memoryTypeIndex || allocation.slotIndex != UINT32_MAX ||
+					pool.memoryChunks[allocation.chunkIndex].dedicated) {
+					continue;
+				}
+				const MemoryBlock& block = pool.memoryChunks[allocation.chunkIndex].memoryBlocks[allocation.blockIndex];
+				candidates.push_back({ allocation.chunkIndex, block.offset, block.size, movable.first, movable.second });
+			}
+		}
+
+		//source - chunk with the least used bytes among chunks holding movable resources
+		uint32_t srcChunkIndex = UINT32_MAX;
+		for (const auto& candidate : candidates) {
+			if (srcChunkIndex == UINT32_MAX ||
+				pool.memoryChunks[candidate.chunkIndex].currentSize > pool.memoryChunks[srcChunkIndex].currentSize) {
+				srcChunkIndex = candidate.chunkIndex;
+			}
+		}
+		if (srcChunkIndex == UINT32_MAX) {
+			continue;
+		}
+
+		//move from the chunk end
+		candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [srcChunkIndex](const Candidate& candidate) {
+			return candidate.chunkIndex != srcChunkIndex;
+		}), candidates.end());
+		std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+			return a.offset > b.offset;
+		});
+
+		for (const auto& candidate : candidates) {
+			const MovableResource& resource = candidate.resource;
+			VkDeviceSize srcSize = candidate.size;
+			if (bytesMoved + srcSize > maxBytesToMove) {
+				break;
+			}
+
+			//replacement resource
+			VkBuffer dstBuffer = VK_NULL_HANDLE;
+			VkImage dstImage = VK_NULL_HANDLE;
+			VkMemoryRequirements memRequirements;
+			bool linear = true;
+			if (resource.image) {
+				VK_CHECK_RESULT(vkCreateImage(device, &resource.imageInfo, nullptr, &dstImage));
+				vkGetImageMemoryRequirements(device, dstImage, &memRequirements);
+				linear = (resource.imageInfo.tiling == VK_IMAGE_TILING_LINEAR);
+			}
+			else {
+				VK_CHECK_RESULT(vkCreateBuffer(device, &resource.bufferInfo, nullptr, &dstBuffer));
+				vkGetBufferMemoryRequirements(device, dstBuffer, &memRequirements);
+			}
+			adjustMemoryRequirements(memoryTypeIndex, memRequirements);
+
+			uint32_t chunkIndex = 0, blockIndex = 0;
+			VkDeviceSize offset = 0;
+			if (!findDefragmentationLocation(pool, srcChunkIndex, candidate.offset, memRequirements, linear,
+				chunkIndex, blockIndex, offset)) {
+				vkDestroyImage(device, dstImage, nullptr);
+				vkDestroyBuffer(device, dstBuffer, nullptr);
+				continue;
+			}
+
+			MemoryChunk& dstChunk = pool.memoryChunks[chunkIndex];
+			DefragmentationMove move{};
+			uint64_t dstHandle = 0;
+			if (resource.image) {
+				dstChunk.addImageMemoryBlock(device, dstImage, blockIndex, offset, memRequirements.size, linear);
+				move.srcImage = reinterpret_cast<VkImage>(candidate.handle);
+				move.dstImage = dstImage;
+				dstHandle = reinterpret_cast<uint64_t>(dstImage);
+			}
+			else {
+				dstChunk.addBufferMemoryBlock(device, dstBuffer, blockIndex, offset, memRequirements.size);
+				move.srcBuffer = reinterpret_cast<VkBuffer>(candidate.handle);
+				move.dstBuffer = dstBuffer;
+				dstHandle = reinterpret_cast<uint64_t>(dstBuffer);
+			}
+			trackUsage(memoryTypeIndex, memRequirements.size, true);
+			{
+				//source stays allocated until the caller frees it, but must never be moved again
+				std::lock_guard<std::mutex> allocationLock(allocationMutex);
+				allocations[dstHandle] = { memoryTypeIndex, chunkIndex, blockIndex };
+				movableResources[dstHandle] = resource;
+				movableResources.erase(candidate.handle);
+			}
+			moves.push_back(move);
+			moveResources.push_back(resource);
+			bytesMoved += srcSize;
+		}
+	}
+
+	if (moves.size() == firstMove) {
+		return bytesMoved;
+	}
+
+	//wait for previous writes to the source resources
+	VkMemoryBarrier memoryBarrier{ VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+	memoryBarrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+	memoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	vkCmdPipelineBarrier(cmdBuf, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+		1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+	for (size_t i = firstMove; i < moves.size(); ++i) {
+		const DefragmentationMove& move = moves[i];
+		const MovableResource& resource = moveResources[i - firstMove];
+		if (move.dstBuffer != VK_NULL_HANDLE) {
+			VkBufferCopy copy{ 0, 0, resource.bufferInfo.size };
+			vkCmdCopyBuffer(cmdBuf, move.srcBuffer, move.dstBuffer, 1, &copy);
+			continue;
+		}
+
+		//image contents need not be preserved
+		if (resource.layout == VK_IMAGE_LAYOUT_UNDEFINED) {
+			continue;
+		}
+
+		VkImageSubresourceRange range{ resource.aspect, 0, resource.imageInfo.mipLevels, 0, resource.imageInfo.arrayLayers };
+		vktools::insertImageMemoryBarrier(cmdBuf, move.srcImage,
+			VK_ACCESS_MEMORY_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+			resource.layout, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, range);
+		vktools::insertImageMemoryBarrier(cmdBuf, move.dstImage,
+			0, VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, range);
+
+		imageCopies.clear();
+		for (uint32_t mipLevel = 0; mipLevel < resource.imageInfo.mipLevels; ++mipLevel) {
+			VkImageCopy copy{};
+			copy.srcSubresource = { resource.aspect, mipLevel, 0, resource.imageInfo.arrayLayers };
+			copy.dstSubresource = copy.srcSubresource;
+			copy.extent = {
+				std::max(resource.imageInfo.extent.width >> mipLevel, 1u),
+				std::max(resource.imageInfo.extent.height >> mipLevel, 1u),
+				std::max(resource.imageInfo.extent.depth >> mipLevel, 1u)
+			};
+			imageCopies.push_back(copy);
+		}
+		vkCmdCopyImage(cmdBuf, move.srcImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			move.dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			static_cast<uint32_t>(imageCopies.size()), imageCopies.data());
+
+		vktools::insertImageMemoryBarrier(cmdBuf, move.dstImage,
+			VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, resource.layout,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, range);
+	}
+
+	//make copied buffers visible to following commands
+	memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	memoryBarrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+	vkCmdPipelineBarrier(cmdBuf, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+		1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+	return bytesMoved;
+}
+
+/*
+* free chunks without any suballocation - keeps one spare chunk per memory type
+* released chunks keep their slot so allocation handles stay valid
+*/
+void MemoryAllocator::releaseEmptyChunks() {
+	for (auto& pool : memoryPools) {
+		std::lock_guard<std::mutex> poolLock(*pool.mutex);
+		bool spareKept = false;
+		for (auto& memoryChunk : pool.memoryChunks) {
+			if (memoryChunk.memoryHandle == VK_NULL_HANDLE || memoryChunk.activeBlockCount != 0) {
+				continue;
+			}
+			if (!spareKept) {
+				spareKept = true;
+				continue;
+			}
+			releaseChunk(memoryChunk);
+		}
+	}
+}
+
+/*
+* gather statistics per memory type & heap
+*
+* @param memoryTypeStats - out, indexed by memory type index
+* @param memoryHeapStats - out, indexed by memory heap index
+*/
+void MemoryAllocator::getStatistics(std::vector<Statistics>& memoryTypeStats,
+	std::vector<HeapStatistics>& memoryHeapStats) const {
+	memoryTypeStats.assign(memoryPools.size(), {});
+	memoryHeapStats.assign(memProperties.memoryHeapCount, {});
+
+	//free bytes are used to compute fragmentation
+	std::vector<VkDeviceSize> heapFreeBytes(memProperties.memoryHeapCount, 0);
+	for (uint32_t memoryTypeIndex = 0; memoryTypeIndex < memoryPools.size(); ++memoryTypeIndex) {
+		const MemoryPool& pool = memoryPools[memoryTypeIndex];
+		std::lock_guard<std::mutex> poolLock(*pool.mutex);
+		Statistics& stats = memoryTypeStats[memoryTypeIndex];
+		stats.usedBytes = pool.usedBytes;
+		stats.peakUsedBytes = pool.peakUsedBytes;
+		stats.totalAllocationCount = pool.totalAllocationCount;
+		stats.totalDeviceAllocationCount = pool.totalDeviceAllocationCount;
+
+		VkDeviceSize freeBytes = 0;
+		for (const auto& memoryChunk : pool.memoryChunks) {
+			if (memoryChunk.memoryHandle == VK_NULL_HANDLE) {
+				continue;
+			}
+			++stats.chunkCount;
+			stats.reservedBytes += memoryChunk.chunkSize;
+			stats.blockCount += memoryChunk.activeBlockCount;
+			stats.largestFreeRange = std::max(stats.largestFreeRange, memoryChunk.getLargestFreeRange());
+			freeBytes += memoryChunk.currentSize;
+		}
+		if (freeBytes != 0) {
+			stats.fragmentation = 1.f - static_cast<float>(stats.largestFreeRange) / freeBytes;
+		}
+
+		uint32_t heapIndex = memProperties.memoryTypes[memoryTypeIndex].heapIndex;
+		HeapStatistics& heapStats = memoryHeapStats[heapIndex];
+		heapStats.reservedBytes += stats.reservedBytes;
+		heapStats.blockCount += stats.blockCount;
+		heapStats.chunkCount += stats.chunkCount;
+		heapStats.totalAllocationCount += stats.totalAllocationCount;
+		heapStats.totalDeviceAllocationCount += stats.totalDeviceAllocationCount;
+		heapStats.largestFreeRange = std::max(heapStats.largestFreeRange, stats.largestFreeRange);
+		heapFreeBytes[heapIndex] += freeBytes;
+	}
+
+	{
+		std::lock_guard<std::mutex> allocationLock(allocationMutex);
+		for (uint32_t heapIndex = 0; heapIndex < memProperties.memoryHeapCount; ++heapIndex) {
+			HeapStatistics& heapStats = memoryHeapStats[heapIndex];
+			heapStats.heapSize = memProperties.memoryHeaps[heapIndex].size;
+			heapStats.usedBytes = heapUsedBytes[heapIndex];
+			heapStats.peakUsedBytes = heapPeakUsedBytes[heapIndex];
+			if (heapFreeBytes[heapIndex] != 0) {
+				heapStats.fragmentation = 1.f - static_cast<float>(heapStats.largestFreeRange) / heapFreeBytes[heapIndex];
+			}
+		}
+	}
+
+	//VK_EXT_memory_budget
+	if (budgetPhysicalDevice != VK_NULL_HANDLE) {
+		VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT };
+		VkPhysicalDeviceMemoryProperties2 memProperties2{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2 };
+		memProperties2.pNext = &budgetProperties;
+		vkGetPhysicalDeviceMemoryProperties2(budgetPhysicalDevice, &memProperties2);
+		for (uint32_t heapIndex = 0; heapIndex < memProperties.memoryHeapCount; ++heapIndex) {
+			memoryHeapStats[heapIndex].budget = budgetProperties.heapBudget[heapIndex];
+			memoryHeapStats[heapIndex].usage = budgetProperties.heapUsage[heapIndex];
+		}
+	}
+}
+
+/*
+* return statistics in json format
+*
+* @return std::string - json object with "memoryTypes" & "memoryHeaps" arrays
+*/
+std::string MemoryAllocator::getStatisticsJson() const {
+	std::vector<Statistics> memoryTypeStats;
+	std::vector<HeapStatistics> memoryHeapStats;
+	getStatistics(memoryTypeStats, memoryHeapStats);
+
+	auto writeStatistics = [](std::ostringstream& json, const Statistics& stats) {
+		json << "\"reservedBytes\": " << stats.reservedBytes
+			<< ", \"usedBytes\": " << stats.usedBytes
+			<< ", \"peakUsedBytes\": " << stats.peakUsedBytes
+			<< ", \"blockCount\": " << stats.blockCount
+			<< ", \"chunkCount\": " << stats.chunkCount
+			<< ", \"totalAllocationCount\": " << stats.totalAllocationCount
+			<< ", \"totalDeviceAllocationCount\": " << stats.totalDeviceAllocationCount
+			<< ", \"largestFreeRange\": " << stats.largestFreeRange
+			<< ", \"fragmentation\": " << stats.fragmentation;
+	};
+
+	std::ostringstream json;
+	json << "{\n\t\"memoryTypes\": [\n";
+	for (size_t i = 0; i < memoryTypeStats.size(); ++i) {
+		json << "\t\t{ \"index\": " << i
+			<< ", \"heapIndex\": " << memProperties.memoryTypes[i].heapIndex
+			<< ", \"propertyFlags\": " << memProperties.memoryTypes[i].propertyFlags << ", ";
+		writeStatistics(json, memoryTypeStats[i]);
+		json << " }" << (i + 1 < memoryTypeStats.size() ? "," : "") << "\n";
+	}
+	json << "\t],\n\t\"memoryHeaps\": [\n";
+	for (size_t i = 0; i < memoryHeapStats.size(); ++i) {
+		json << "\t\t{ \"index\": " << i
+			<< ", \"heapSize\": " << memoryHeapStats[i].heapSize
+			<< ", \"budget\": " << memoryHeapStats[i].budget
+			<< ", \"usage\": " << memoryHeapStats[i].usage << ", ";
+		writeStatistics(json, memoryHeapStats[i]);
+		json << " }" << (i + 1 < memoryHeapStats.size() ? "," : "") << "\n";
+	}
+	json << "\t]\n}\n";
+	return json.str();
+}
+
+/*
+* query heap budget in getStatistics
+*
+* @param physicalDevice - VK_EXT_memory_budget must be enabled on the logical device
+*/
+void MemoryAllocator::enableMemoryBudget(VkPhysicalDevice physicalDevice) {
+	budgetPhysicalDevice = physicalDevice;
+}
+
+/*
+* pre-allocate big chunk of memory - reuse released chunk slot if any
 *
 * @param device - logical device handle needed for vkAllocateMemory
+* @param allocateFlags - memory allocate flags
+* @param chunkSize - size of the chunk
+* @param linear - chunk for buffers & linear images or for optimal images
+* @param dedicatedInfo - not nullptr for dedicated allocation, must outlive the call
+*
+* @return uint32_t - index of the new chunk
 */
-void MemoryAllocator::MemoryPool::allocateChunk(VkDevice device, VkMemoryAllocateFlags allocateFlags) {
+uint32_t MemoryAllocator::MemoryPool::allocateChunk(VkDevice device, VkMemoryAllocateFlags allocateFlags,
+	VkDeviceSize chunkSize, bool linear, const VkMemoryDedicatedAllocateInfo* dedicatedInfo) {
 	VkMemoryAllocateInfo allocInfo{};
 	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize = defaultChunkSize;
+	allocInfo.allocationSize = chunkSize;
 	allocInfo.memoryTypeIndex = memoryTypeIndex;
+	allocInfo.pNext = dedicatedInfo;
 	VkMemoryAllocateFlagsInfo flagsInfo{};
 	if (allocateFlags & VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT) {
 		flagsInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
 		flagsInfo.flags = allocateFlags;
 		//flagsInfo.deviceMask = 1;
+		flagsInfo.pNext = dedicatedInfo;
 		allocInfo.pNext = &flagsInfo;
 	}
-	MemoryChunk newChunk{ VK_NULL_HANDLE, defaultChunkSize, defaultChunkSize };
+	MemoryChunk newChunk{};
+	newChunk.init(chunkSize);
+	newChunk.linear = linear;
+	newChunk.dedicated = (dedicatedInfo != nullptr);
 	VK_CHECK_RESULT(vkAllocateMemory(device, &allocInfo, nullptr, &newChunk.memoryHandle));
-	memoryChunks.push_back(newChunk);
+	++totalDeviceAllocationCount;
+
+	//host visible chunk is mapped once & stays mapped until cleanup
+	if (propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+		VK_CHECK_RESULT(vkMapMemory(device, newChunk.memoryHandle, 0, VK_WHOLE_SIZE, 0, &newChunk.mappedData));
+	}
+
+	//chunk indices are referenced by allocation handles - fill released slot first
+	for (uint32_t i = 0; i < memoryChunks.size(); ++i) {
+		if (memoryChunks[i].memoryHandle == VK_NULL_HANDLE) {
+			memoryChunks[i] = std::move(newChunk);
+			return i;
+		}
+	}
+	memoryChunks.push_back(std::move(newChunk));
+	return static_cast<uint32_t>(memoryChunks.size() - 1);
 }
 
 /*
@@ -318,100 +1079,217 @@ void MemoryAllocator::MemoryPool::allocateChunk(VkDevice device, VkMemoryAllocat
 size_t MemoryAllocator::MemoryPool::cleanup(VkDevice device) {
 	size_t activeMemoryNum = 0;
 	for (auto& memoryChunk : memoryChunks) {
-		activeMemoryNum += memoryChunk.memoryBlocks.size();
+		if (memoryChunk.memoryHandle == VK_NULL_HANDLE) {
+			continue;
+		}
+		activeMemoryNum += memoryChunk.activeBlockCount;
+		if (memoryChunk.mappedData != nullptr) {
+			vkUnmapMemory(device, memoryChunk.memoryHandle);
+		}
 		vkFreeMemory(device, memoryChunk.memoryHandle, nullptr);
 	}
 	return activeMemoryNum;
 }
 
+namespace {
+	/*
+	* index of the lowest set bit - mask must not be 0
+	*/
+	inline uint32_t findLSB(uint64_t mask) {
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward64(&index, mask);
+		return static_cast<uint32_t>(index);
+#else
+		return static_cast<uint32_t>(__builtin_ctzll(mask));
+#endif
+	}
+
+	/*
+	* index of the highest set bit - mask must not be 0
+	*/
+	inline uint32_t findMSB(uint64_t mask) {
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanReverse64(&index, mask);
+		return static_cast<uint32_t>(index);
+#else
+		return 63 - static_cast<uint32_t>(__builtin_clzll(mask));
+#endif
+	}
+
+	/*
+	* TLSF mapping - size -> (first level, second level) free list index
+	*
+	* @param size - block size
+	* @param fl - out, first level index
+	* @param sl - out, second level index
+	*/
+	inline void mapping(VkDeviceSize size, uint32_t& fl, uint32_t& sl, uint32_t slLog2) {
+		if (size < (VkDeviceSize(1) << slLog2)) {
+			//small blocks share the first list, linearly subdivided
+			fl = 0;
+			sl = static_cast<uint32_t>(size);
+		}
+		else {
+			uint32_t msb = findMSB(size);
+			fl = msb - slLog2 + 1;
+			sl = static_cast<uint32_t>((size >> (msb - slLog2)) ^ (VkDeviceSize(1) << slLog2));
+		}
+	}
+
+	/*
+	* true if byte locations a & b are in the same bufferImageGranularity page
+	*/
+	inline bool onSamePage(VkDeviceSize a, VkDeviceSize b, VkDeviceSize pageSize) {
+		return (a & ~(pageSize - 1)) == (b & ~(pageSize - 1));
+	}
+}
+
 /*
-* return suitable memory location (offset) in current memory chunk
+* make the whole chunk a single free block
+*
+* @param chunkSize - size of the memory chunk
+*/
+void MemoryAllocator::MemoryChunk::init(VkDeviceSize chunkSize) {
+	this->chunkSize = chunkSize;
+	currentSize = chunkSize;
+	flBitmap = 0;
+	slBitmaps.fill(0);
+	for (auto& list : freeLists) {
+		list.fill(INVALID_BLOCK_INDEX);
+	}
+
+	uint32_t blockIndex = createBlock();
+	memoryBlocks[blockIndex].offset = 0;
+	memoryBlocks[blockIndex].size = chunkSize;
+	insertFreeBlock(blockIndex);
+}
+
+/*
+* return suitable free block & memory location (offset) in current memory chunk
+* the list holding the requested size is searched first (first fit, so exactly fitting freed blocks are reused)
+* then the bitmaps pick the first bigger list whose blocks all fit (good fit) - blocks are never iterated chunk-wide
 *
 * @param memRequirements
 * @param bufferImageGranularity
-* @param memoryBlock - out parameter containing block layout if return value is true
+* @param linear - buffer / linear image or optimal image
+* @param blockIndex - out parameter, index of the free block containing the location
+* @param offset - out parameter, aligned location if return value is true
 *
 * @return bool - true when found, false when there is none
 */
-bool MemoryAllocator::MemoryChunk::findSuitableMemoryLocation(
-	const VkMemoryRequirements& memRequirements, VkDeviceSize bufferImageGranularity, MemoryBlock& memoryBlock) {
-	//TODO: consider bufferImageGranularity only when linear and non-linear resources are placed in adjacent memory
-	//memory chunk is empty
-	if (memoryBlocks.empty()) {
-		//bufferImageGranularity check
-		VkDeviceSize blockEndLocation = memRequirements.size;
-		if (bufferImageGranularity > memRequirements.alignment) {
-			if (VkDeviceSize remainder = memRequirements.size % bufferImageGranularity; remainder != 0) {
-				VkDeviceSize padding = bufferImageGranularity - remainder;
-				blockEndLocation += padding;
-			}
+bool MemoryAllocator::MemoryChunk::findSuitableMemoryLocation(const VkMemoryRequirements& memRequirements,
+	VkDeviceSize bufferImageGranularity, bool linear, uint32_t& blockIndex, VkDeviceSize& offset) const {
+	VkDeviceSize alignment = std::max<VkDeviceSize>(memRequirements.alignment, 1);
+	VkDeviceSize granularity = std::max<VkDeviceSize>(bufferImageGranularity, 1);
+
+	//empty chunk is a single free block at offset 0 - exact fit for dedicated chunks
+	if (activeBlockCount == 0 && flBitmap != 0) {
+		if (memRequirements.size > chunkSize) {
+			return false;
 		}
-		memoryBlock = { VK_NULL_HANDLE, 0, memRequirements.size, memRequirements.alignment, blockEndLocation };
+		uint32_t fl = findLSB(flBitmap);
+		blockIndex = freeLists[fl][findLSB(slBitmaps[fl])];
+		offset = 0;
 		return true;
 	}
+	if (memRequirements.size > currentSize) {
+		return false;
+	}
 
-	//iterate all memory blocks
-	for (size_t i = 0; i < memoryBlocks.size(); ++i) {
-		VkDeviceSize location = memoryBlocks[i].blockEndLocation;
-		VkDeviceSize blockSize = memRequirements.size;
+	//first block of the list that holds the resource after alignment & bufferImageGranularity padding
+	auto findInList = [&](uint32_t fl, uint32_t sl) {
+		for (uint32_t i = freeLists[fl][sl]; i != INVALID_BLOCK_INDEX; i = memoryBlocks[i].nextFree) {
+			const MemoryBlock& block = memoryBlocks[i];
+			VkDeviceSize location = (block.offset + alignment - 1) & ~(alignment - 1);
 
-		//alignment check
-		if (VkDeviceSize remainder = location % memRequirements.alignment; remainder != 0) {
-			//some padding is added to take account for alignment
-			VkDeviceSize padding = memRequirements.alignment - remainder;
-			location += padding;
-			blockSize += padding;
-		}
+			//bufferImageGranularity check - previous neighbour
+			if (granularity > 1 && block.prevPhysical != INVALID_BLOCK_INDEX) {
+				const MemoryBlock& prev = memoryBlocks[block.prevPhysical];
+				if (prev.linear != linear && onSamePage(prev.offset + prev.size - 1, location, granularity)) {
+					location = (location + granularity - 1) & ~(granularity - 1);
+				}
+			}
+			if (location + memRequirements.size > block.offset + block.size) {
+				continue;
+			}
 
-		//bufferImageGranularity check
-		if (bufferImageGranularity > memRequirements.alignment) {
-			if (VkDeviceSize remainder = (location + memRequirements.size) % bufferImageGranularity; remainder != 0) {
-				VkDeviceSize padding = bufferImageGranularity - remainder;
-				blockSize += padding;
+			//bufferImageGranularity check - next neighbour
+			if (granularity > 1 && block.nextPhysical != INVALID_BLOCK_INDEX) {
+				const MemoryBlock& next = memoryBlocks[block.nextPhysical];
+				if (next.linear != linear && onSamePage(location + memRequirements.size - 1, next.offset, granularity)) {
+					continue;
+				}
 			}
+
+			blockIndex = i;
+			offset = location;
+			return true;
 		}
+		return false;
+	};
+
+	//list of the requested size - its blocks may be smaller than the request, so each one is checked
+	uint32_t fl = 0, sl = 0;
+	mapping(memRequirements.size, fl, sl, SL_INDEX_COUNT_LOG2);
+	if ((slBitmaps[fl] & (1u << sl)) && findInList(fl, sl)) {
+		return true;
+	}
+	uint32_t requestFl = fl, requestSl = sl;
 
-		VkDeviceSize nextBlockEndLocation = (i + 1 == memoryBlocks.size()) ?
-			chunkSize : memoryBlocks[i + 1].offset;
+	//any block in the searched list can hold the resource even in the worst alignment case
+	VkDeviceSize searchSize = memRequirements.size + std::max(alignment, granularity) - 1;
+	if (searchSize > chunkSize) {
+		return false;
+	}
+
+	//round up to the next list so that every block in the list is big enough (good fit)
+	if (searchSize >= (VkDeviceSize(1) << SL_INDEX_COUNT_LOG2)) {
+		searchSize += (VkDeviceSize(1) << (findMSB(searchSize) - SL_INDEX_COUNT_LOG2)) - 1;
+	}
+	mapping(searchSize, fl, sl, SL_INDEX_COUNT_LOG2);
+
+	while (fl < FL_INDEX_COUNT) {
+		//find non-empty free list >= (fl, sl)
+		uint32_t slMap = (sl < SL_INDEX_COUNT) ? (slBitmaps[fl] & (~0u << sl)) : 0;
+		if (slMap == 0) {
+			uint64_t flMap = (fl + 1 < FL_INDEX_COUNT) ? (flBitmap & (~uint64_t(0) << (fl + 1))) : 0;
+			if (flMap == 0) {
+				return false;
+			}
+			fl = findLSB(flMap);
+			slMap = slBitmaps[fl];
+		}
+		sl = findLSB(slMap);
 
-		VkDeviceSize spaceInBetween = nextBlockEndLocation - memoryBlocks[i].blockEndLocation;
-		if (spaceInBetween > blockSize) {
-			memoryBlock = { VK_NULL_HANDLE,
-				location,
-				memRequirements.size,
-				memRequirements.alignment,
-				memoryBlocks[i].blockEndLocation + blockSize };
+		//first block fits unless it is blocked by granularity conflict with the next used block
+		if ((fl != requestFl || sl != requestSl) && findInList(fl, sl)) {
 			return true;
 		}
+
+		//every block in this list is blocked - try bigger lists
+		++sl;
 	}
 
 	return false;
 }
 
-/*
-* sort memory block vector in real memory location order
-*/
-void MemoryAllocator::MemoryChunk::sort() {
-	std::sort(memoryBlocks.begin(), memoryBlocks.end(),
-		[](const MemoryBlock& l, const MemoryBlock& r) {
-			return l.offset < r.offset;
-		});
-}
-
 /*
 * add new memory block to this memory chunk
 *
 * @param device - logical device handle
 * @param buffer - buffer handle owning memoryBlock
-* @param memoryBlock - memory block to add
+* @param blockIndex - free block found by findSuitableMemoryLocation
+* @param offset - location found by findSuitableMemoryLocation
+* @param size - required memory size
 */
 void MemoryAllocator::MemoryChunk::addBufferMemoryBlock(VkDevice device, VkBuffer buffer,
-	MemoryBlock& memoryBlock) {
-	memoryBlock.handle.bufferHandle = buffer;
-	memoryBlocks.push_back(memoryBlock);
-	sort();
-	currentSize -= (memoryBlock.blockEndLocation - memoryBlock.offset);
-	vkBindBufferMemory(device, buffer, memoryHandle, memoryBlock.offset);
+	uint32_t blockIndex, VkDeviceSize offset, VkDeviceSize size) {
+	splitFreeBlock(blockIndex, offset, size);
+	memoryBlocks[blockIndex].handle.bufferHandle = buffer;
+	memoryBlocks[blockIndex].linear = true;
+	vkBindBufferMemory(device, buffer, memoryHandle, offset);
 }
 
 /*
@@ -419,44 +1297,311 @@ void MemoryAllocator::MemoryChunk::addBufferMemoryBlock(VkDevice device, VkBuffe
 *
 * @param device - logical device handle
 * @param image - image handle owning memoryBlock
-* @param memoryBlock - memory block to add
+* @param blockIndex - free block found by findSuitableMemoryLocation
+* @param offset - location found by findSuitableMemoryLocation
+* @param size - required memory size
+* @param linear - linear tiling image
 */
 void MemoryAllocator::MemoryChunk::addImageMemoryBlock(VkDevice device, VkImage image,
-	MemoryBlock& memoryBlock) {
-	memoryBlock.handle.imageHandle = image;
-	memoryBlocks.push_back(memoryBlock);
-	sort();
-	currentSize -= (memoryBlock.blockEndLocation - memoryBlock.offset);
-	vkBindImageMemory(device, image, memoryHandle, memoryBlock.offset);
+	uint32_t blockIndex, VkDeviceSize offset, VkDeviceSize size, bool linear) {
+	splitFreeBlock(blockIndex, offset, size);
+	memoryBlocks[blockIndex].handle.imageHandle = image;
+	memoryBlocks[blockIndex].linear = linear;
+	vkBindImageMemory(device, image, memoryHandle, offset);
+}
+
+/*
+* add new memory block without binding - used by MemoryAllocator::allocateMemory
+*
+* @param blockIndex - free block found by findSuitableMemoryLocation
+* @param offset - location found by findSuitableMemoryLocation
+* @param size - required memory size
+* @param linear - block holds buffers / linear images or optimal images
+*/
+void MemoryAllocator::MemoryChunk::addMemoryBlock(uint32_t blockIndex, VkDeviceSize offset, VkDeviceSize size,
+	bool linear) {
+	splitFreeBlock(blockIndex, offset, size);
+	memoryBlocks[blockIndex].linear = linear;
+}
+
+/*
+* add new slab block to this memory chunk - slots are bound by the pool
+*
+* @param blockIndex - free block found by findSuitableMemoryLocation
+* @param offset - location found by findSuitableMemoryLocation
+* @param size - slab size
+* @param slabIndex - index of MemoryPool::slabs
+*/
+void MemoryAllocator::MemoryChunk::addSlabMemoryBlock(uint32_t blockIndex, VkDeviceSize offset, VkDeviceSize size,
+	uint32_t slabIndex) {
+	splitFreeBlock(blockIndex, offset, size);
+	memoryBlocks[blockIndex].linear = true;
+	memoryBlocks[blockIndex].slabIndex = slabIndex;
+}
+
+/*
+* release memory block & merge it with free neighbours
+*
+* @param blockIndex - index of the used block
+*/
+void MemoryAllocator::MemoryChunk::freeMemoryBlock(uint32_t blockIndex) {
+	MemoryBlock& block = memoryBlocks[blockIndex];
+	block.free = true;
+	block.linear = true;
+	block.slabIndex = INVALID_BLOCK_INDEX;
+	block.handle.bufferHandle = VK_NULL_HANDLE;
+	currentSize += block.size;
+	--activeBlockCount;
+
+	//coalesce with next free block
+	uint32_t nextIndex = block.nextPhysical;
+	if (nextIndex != INVALID_BLOCK_INDEX && memoryBlocks[nextIndex].free) {
+		removeFreeBlock(nextIndex);
+		absorbNextBlock(blockIndex);
+	}
+
+	//coalesce with previous free block
+	uint32_t prevIndex = memoryBlocks[blockIndex].prevPhysical;
+	if (prevIndex != INVALID_BLOCK_INDEX && memoryBlocks[prevIndex].free) {
+		removeFreeBlock(prevIndex);
+		absorbNextBlock(prevIndex);
+		blockIndex = prevIndex;
+	}
+
+	insertFreeBlock(blockIndex);
+}
+
+/*
+* split used part [offset, offset + size) out of a free block
+* leading alignment padding & remaining tail go back to the free lists
+*
+* @param blockIndex - free block to split, becomes the used block
+* @param offset - start of the used part
+* @param size - size of the used part
+*/
+void MemoryAllocator::MemoryChunk::splitFreeBlock(uint32_t blockIndex, VkDeviceSize offset, VkDeviceSize size) {
+	removeFreeBlock(blockIndex);
+
+	//leading padding
+	if (offset > memoryBlocks[blockIndex].offset) {
+		uint32_t paddingIndex = createBlock();
+		MemoryBlock& block = memoryBlocks[blockIndex];
+		MemoryBlock& padding = memoryBlocks[paddingIndex];
+		padding.offset = block.offset;
+		padding.size = offset - block.offset;
+		padding.prevPhysical = block.prevPhysical;
+		padding.nextPhysical = blockIndex;
+		if (block.prevPhysical != INVALID_BLOCK_INDEX) {
+			memoryBlocks[block.prevPhysical].nextPhysical = paddingIndex;
+		}
+		block.prevPhysical = paddingIndex;
+		block.offset = offset;
+		block.size -= padding.size;
+		insertFreeBlock(paddingIndex);
+	}
+
+	//remaining tail
+	if (memoryBlocks[blockIndex].size > size) {
+		uint32_t tailIndex = createBlock();
+		MemoryBlock& block = memoryBlocks[blockIndex];
+		MemoryBlock& tail = memoryBlocks[tailIndex];
+		tail.offset = offset + size;
+		tail.size = block.size - size;
+		tail.prevPhysical = blockIndex;
+		tail.nextPhysical = block.nextPhysical;
+		if (block.nextPhysical != INVALID_BLOCK_INDEX) {
+			memoryBlocks[block.nextPhysical].prevPhysical = tailIndex;
+		}
+		block.nextPhysical = tailIndex;
+		block.size = size;
+		insertFreeBlock(tailIndex);
+	}
+
+	memoryBlocks[blockIndex].free = false;
+	currentSize -= size;
+	++activeBlockCount;
 }
 
 /*
-* memcpy bufferData to device memory
+* return size of the largest free block - only the highest non-empty free list is searched
+*
+* @return VkDeviceSize - 0 if there is no free block
+*/
+VkDeviceSize MemoryAllocator::MemoryChunk::getLargestFreeRange() const {
+	if (flBitmap == 0) {
+		return 0;
+	}
+	uint32_t fl = findMSB(flBitmap);
+	uint32_t sl = findMSB(slBitmaps[fl]);
+
+	VkDeviceSize largestFreeRange = 0;
+	for (uint32_t i = freeLists[fl][sl]; i != INVALID_BLOCK_INDEX; i = memoryBlocks[i].nextFree) {
+		largestFreeRange = std::max(largestFreeRange, memoryBlocks[i].size);
+	}
+	return largestFreeRange;
+}
+
+/*
+* get a new block slot - reuse released slot if possible
+*
+* @return uint32_t - index of the new block
+*/
+uint32_t MemoryAllocator::MemoryChunk::createBlock() {
+	if (!unusedBlockIndices.empty()) {
+		uint32_t blockIndex = unusedBlockIndices.back();
+		unusedBlockIndices.pop_back();
+		memoryBlocks[blockIndex] = MemoryBlock{};
+		return blockIndex;
+	}
+	memoryBlocks.emplace_back();
+	return static_cast<uint32_t>(memoryBlocks.size() - 1);
+}
+
+/*
+* insert free block to the head of the matching free list
+*
+* @param blockIndex - index of the free block
+*/
+void MemoryAllocator::MemoryChunk::insertFreeBlock(uint32_t blockIndex) {
+	uint32_t fl = 0, sl = 0;
+	mapping(memoryBlocks[blockIndex].size, fl, sl, SL_INDEX_COUNT_LOG2);
+
+	MemoryBlock& block = memoryBlocks[blockIndex];
+	block.free = true;
+	block.prevFree = INVALID_BLOCK_INDEX;
+	block.nextFree = freeLists[fl][sl];
+	if (block.nextFree != INVALID_BLOCK_INDEX) {
+		memoryBlocks[block.nextFree].prevFree = blockIndex;
+	}
+	freeLists[fl][sl] = blockIndex;
+	flBitmap |= (uint64_t(1) << fl);
+	slBitmaps[fl] |= (1u << sl);
+}
+
+/*
+* remove free block from its free list
+*
+* @param blockIndex - index of the free block
+*/
+void MemoryAllocator::MemoryChunk::removeFreeBlock(uint32_t blockIndex) {
+	uint32_t fl = 0, sl = 0;
+	mapping(memoryBlocks[blockIndex].size, fl, sl, SL_INDEX_COUNT_LOG2);
+
+	MemoryBlock& block = memoryBlocks[blockIndex];
+	if (block.prevFree != INVALID_BLOCK_INDEX) {
+		memoryBlocks[block.prevFree].nextFree = block.nextFree;
+	}
+	if (block.nextFree != INVALID_BLOCK_INDEX) {
+		memoryBlocks[block.nextFree].prevFree = block.prevFree;
+	}
+	if (freeLists[fl][sl] == blockIndex) {
+		freeLists[fl][sl] = block.nextFree;
+		if (block.nextFree == INVALID_BLOCK_INDEX) {
+			slBitmaps[fl] &= ~(1u << sl);
+			if (slBitmaps[fl] == 0) {
+				flBitmap &= ~(uint64_t(1) << fl);
+			}
+		}
+	}
+	block.prevFree = INVALID_BLOCK_INDEX;
+	block.nextFree = INVALID_BLOCK_INDEX;
+}
+
+/*
+* merge blockIndex's next physical block into blockIndex & release the slot
+* both blocks must be out of free lists
+*
+* @param blockIndex - index of the block absorbing its next neighbour
+*/
+void MemoryAllocator::MemoryChunk::absorbNextBlock(uint32_t blockIndex) {
+	uint32_t nextIndex = memoryBlocks[blockIndex].nextPhysical;
+	MemoryBlock& block = memoryBlocks[blockIndex];
+	MemoryBlock& next = memoryBlocks[nextIndex];
+
+	block.size += next.size;
+	block.nextPhysical = next.nextPhysical;
+	if (next.nextPhysical != INVALID_BLOCK_INDEX) {
+		memoryBlocks[next.nextPhysical].prevPhysical = blockIndex;
+	}
+	unusedBlockIndices.push_back(nextIndex);
+}
+
+/*
+* memcpy bufferData to persistently mapped memory
 * 
-* @param device - logical device  handle needed for vkMapMemory
+* @param device - logical device handle needed for flush
 * @param bufferData - data to be copied
 */
 void MemoryAllocator::HostVisibleMemory::mapData(VkDevice device, const void* bufferData) {
-	void* data;
-	vkMapMemory(device, memory, offset, size, 0, &data);
-	memcpy(data, bufferData, (size_t)size);
-	vkUnmapMemory(device, memory);
+	memcpy(mappedData, bufferData, (size_t)size);
+	flush(device);
 }
 
 /*
-* return data pointer
+* return persistently mapped data pointer
 * 
+* @param device - logical device handle needed for invalidate
+*
 * @return void* - data pointer
 */
 void* MemoryAllocator::HostVisibleMemory::getHandle(VkDevice device) {
-	void* data;
-	vkMapMemory(device, memory, offset, size, 0, &data);
-	return data;
+	invalidate(device);
+	return mappedData;
 }
 
 /*
-* unmap memory - vkUnmapMemory
+* memory stays mapped until the chunk is freed - only flush host writes
+*
+* @param device - logical device handle needed for flush
 */
 void MemoryAllocator::HostVisibleMemory::unmap(VkDevice device) {
-	vkUnmapMemory(device, memory);
+	flush(device);
+}
+
+namespace {
+	/*
+	* nonCoherentAtomSize aligned range in [memory.offset, memory.offset + alignUp(memory.size, atom))
+	*/
+	VkMappedMemoryRange nonCoherentRange(VkDeviceMemory memory, VkDeviceSize memoryOffset, VkDeviceSize memorySize,
+		VkDeviceSize atomSize, VkDeviceSize offset, VkDeviceSize size) {
+		VkDeviceSize blockSize = (memorySize + atomSize - 1) / atomSize * atomSize;
+		VkDeviceSize end = (size == VK_WHOLE_SIZE) ? blockSize : std::min(blockSize, (offset + size + atomSize - 1) / atomSize * atomSize);
+		VkDeviceSize begin = offset / atomSize * atomSize;
+
+		VkMappedMemoryRange range{ VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE };
+		range.memory = memory;
+		range.offset = memoryOffset + begin;
+		range.size = end - begin;
+		return range;
+	}
+}
+
+/*
+* make host writes visible to the device - no-op on host coherent memory
+*
+* @param device - logical device handle
+* @param offset - relative to the start of this memory block
+* @param size - range size, VK_WHOLE_SIZE for the whole block
+*/
+void MemoryAllocator::HostVisibleMemory::flush(VkDevice device, VkDeviceSize offset, VkDeviceSize size) {
+	if (nonCoherentAtomSize == 0) {
+		return;
+	}
+	VkMappedMemoryRange range = nonCoherentRange(memory, this->offset, this->size, nonCoherentAtomSize, offset, size);
+	VK_CHECK_RESULT(vkFlushMappedMemoryRanges(device, 1, &range));
+}
+
+/*
+* make device writes visible to the host - no-op on host coherent memory
+*
+* @param device - logical device handle
+* @param offset - relative to the start of this memory block
+* @param size - range size, VK_WHOLE_SIZE for the whole block
+*/
+void MemoryAllocator::HostVisibleMemory::invalidate(VkDevice device, VkDeviceSize offset, VkDeviceSize size) {
+	if (nonCoherentAtomSize == 0) {
+		return;
+	}
+	VkMappedMemoryRange range = nonCoherentRange(memory, this->offset, this->size, nonCoherentAtomSize, offset, size);
+	VK_CHECK_RESULT(vkInvalidateMappedMemoryRanges(device, 1, &range));
 }
@@ -1,21 +1,46 @@
 #pragma once
+#include <array>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
 #include "vulkan_utils.h"
 
 /*
-	* Custom memory allocator is implemented to deal with device memory allocation limit in a very NAIVE way
-	* There is no defragmentation feature or fancy algorithm for memory block searching
+	* Custom memory allocator is implemented to deal with device memory allocation limit
+	* Each memory chunk is managed by a two-level segregated fit (TLSF) allocator
+	* - constant time allocation & free, neighbouring free ranges are coalesced
+	* Resources are routed by size - large (or driver preferred) ones get a dedicated allocation,
+	* small buffers share size-class slabs, the rest is suballocated from chunks
+	* Optimal tiling images & linear resources use separate chunks so bufferImageGranularity needs no padding
+	* Device local resources registered with setMovable can be moved by incremental defragmentation
+	* Allocation & free are thread safe - each memory type is locked separately
+	* so loader threads allocating from different memory types don't contend
 */
 class MemoryAllocator {
 public:
-	/** contain all info needed for data mapping */
+	/** opaque allocation handle - memory pool / chunk / block which own the suballocation */
+	struct AllocationHandle {
+		uint32_t memoryTypeIndex = UINT32_MAX;
+		uint32_t chunkIndex = UINT32_MAX;
+		uint32_t blockIndex = UINT32_MAX;
+		/** slot in a slab - UINT32_MAX if not slab allocated */
+		uint32_t slotIndex = UINT32_MAX;
+	};
+
+	/** contain all info needed for data mapping & freeing */
 	struct HostVisibleMemory {
 	public:
-		/** @brief memcpy bufferData to device memory */
+		/** @brief memcpy bufferData to persistently mapped memory */
 		void mapData(VkDevice device, const void* bufferData);
-		/** @brief return data pointer */
+		/** @brief return persistently mapped data pointer */
 		void* getHandle(VkDevice device);
-		/** @brief vkUnmapMemory */
+		/** @brief flush host writes - memory stays mapped */
 		void unmap(VkDevice device);
+		/** @brief make host writes visible to the device (non-coherent memory only) */
+		void flush(VkDevice device, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+		/** @brief make device writes visible to the host (non-coherent memory only) */
+		void invalidate(VkDevice device, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
 
 		/** device memory handle */
 		VkDeviceMemory memory = VK_NULL_HANDLE;
@@ -23,9 +48,58 @@ public:
 		VkDeviceSize size = 0;
 		/** offset where this memory block begins */
 		VkDeviceSize offset = 0;
+		/** used by MemoryAllocator::freeMemory */
+		AllocationHandle allocation;
+		/** pointer to the first byte of this memory block - nullptr if not host visible */
+		void* mappedData = nullptr;
+		/** 0 if memory is host coherent, otherwise flush / invalidate range alignment */
+		VkDeviceSize nonCoherentAtomSize = 0;
+	};
+
+	/** usage statistics of a memory type or heap */
+	struct Statistics {
+		/** bytes allocated from the driver (chunks) */
+		VkDeviceSize reservedBytes = 0;
+		/** bytes of suballocations */
+		VkDeviceSize usedBytes = 0;
+		/** highest usedBytes so far */
+		VkDeviceSize peakUsedBytes = 0;
+		/** number of suballocations */
+		uint32_t blockCount = 0;
+		/** number of chunks */
+		uint32_t chunkCount = 0;
+		/** suballocations made since init - counts churn, not live blocks */
+		uint64_t totalAllocationCount = 0;
+		/** vkAllocateMemory calls since init */
+		uint64_t totalDeviceAllocationCount = 0;
+		/** largest contiguous free range in a single chunk */
+		VkDeviceSize largestFreeRange = 0;
+		/** 1 - largestFreeRange / free bytes - 0 if free memory is a single range */
+		float fragmentation = 0.f;
+	};
+
+	/** heap statistics - budget & usage are 0 if VK_EXT_memory_budget is not enabled */
+	struct HeapStatistics : Statistics {
+		VkDeviceSize heapSize = 0;
+		/** VkPhysicalDeviceMemoryBudgetPropertiesEXT::heapBudget */
+		VkDeviceSize budget = 0;
+		/** VkPhysicalDeviceMemoryBudgetPropertiesEXT::heapUsage - all processes */
+		VkDeviceSize usage = 0;
+	};
+
+	/** 
+	* resource moved by defragment() - caller must replace src handle with dst (views, descriptors ...)
+	* and free src (freeBufferMemory / freeImageMemory & destroy) once the command buffer has completed
+	* dst stays movable, src is not movable anymore
+	*/
+	struct DefragmentationMove {
+		VkBuffer srcBuffer = VK_NULL_HANDLE;
+		VkBuffer dstBuffer = VK_NULL_HANDLE;
+		VkImage srcImage = VK_NULL_HANDLE;
+		VkImage dstImage = VK_NULL_HANDLE;
 	};
 
-	void init(VkDevice device, VkDeviceSize bufferImageGranularity,
+	void init(VkDevice device, VkDeviceSize bufferImageGranularity, VkDeviceSize nonCoherentAtomSize,
 		const VkPhysicalDeviceMemoryProperties& memProperties, VkMemoryAllocateFlags allocateFlags = 0,
 		uint32_t defaultChunkSize = 268435000); //256 MiB
 	/** @brief free all allocated memory */
@@ -33,54 +107,135 @@ public:
 	/** @brief suballocation - add new (buffer) memory block */
 	HostVisibleMemory allocateBufferMemory(VkBuffer buffer, VkMemoryPropertyFlags properties);
 	/** @brief suballocation - add new (image) memory block */
-	HostVisibleMemory allocateImageMemory(VkImage image, VkMemoryPropertyFlags properties);
+	HostVisibleMemory allocateImageMemory(VkImage image, VkMemoryPropertyFlags properties,
+		VkImageTiling tiling = VK_IMAGE_TILING_OPTIMAL);
+	/** @brief suballocation without binding - caller binds (aliased) resources, free with freeMemory */
+	HostVisibleMemory allocateMemory(const VkMemoryRequirements& memRequirements, VkMemoryPropertyFlags properties,
+		bool linear);
 
-	/** @brief free (buffer) memory block */
-	void freeBufferMemory(VkBuffer buffer, VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_FLAG_BITS_MAX_ENUM);
-	/** @brief free (image) memory block */
-	void freeImageMemory(VkImage image, VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_FLAG_BITS_MAX_ENUM);
+	/** @brief free memory block of the allocation - O(1) */
+	void freeMemory(const HostVisibleMemory& memory);
+	/** @brief free (buffer) memory block - allocation is found by buffer handle */
+	void freeBufferMemory(VkBuffer buffer);
+	/** @brief free (image) memory block - allocation is found by image handle */
+	void freeImageMemory(VkImage image);
+	/** @brief register device local buffer which defragment() may move */
+	void setMovable(VkBuffer buffer, const VkBufferCreateInfo& createInfo);
+	/** @brief register device local image which defragment() may move */
+	void setMovable(VkImage image, const VkImageCreateInfo& createInfo, VkImageLayout layout, VkImageAspectFlags aspect);
+	/** @brief move movable resources out of sparse device local chunks - up to maxBytesToMove */
+	VkDeviceSize defragment(VkCommandBuffer cmdBuf, VkDeviceSize maxBytesToMove, std::vector<DefragmentationMove>& moves);
+	/** @brief free chunks without any suballocation - keeps one spare chunk per memory type */
+	void releaseEmptyChunks();
+	/** @brief gather statistics per memory type & heap */
+	void getStatistics(std::vector<Statistics>& memoryTypeStats, std::vector<HeapStatistics>& memoryHeapStats) const;
+	/** @brief return statistics in json format */
+	std::string getStatisticsJson() const;
+	/** @brief query heap budget in getStatistics - VK_EXT_memory_budget must be enabled */
+	void enableMemoryBudget(VkPhysicalDevice physicalDevice);
 	/** @brief return suitable memory type */
 	static uint32_t findMemoryType(uint32_t memoryTypeBitsRequirements,
 		VkMemoryPropertyFlags requiredProperties, const VkPhysicalDeviceMemoryProperties& memProperties);
 
 private:
-	/** small memory chunk reside in MemoryChunk */
+	/** TLSF parameters - second level splits each power of two range into 32 lists */
+	static constexpr uint32_t SL_INDEX_COUNT_LOG2 = 5;
+	static constexpr uint32_t SL_INDEX_COUNT = 1 << SL_INDEX_COUNT_LOG2;
+	static constexpr uint32_t FL_INDEX_COUNT = 64;
+	/** null block index */
+	static constexpr uint32_t INVALID_BLOCK_INDEX = UINT32_MAX;
+	/** buffers up to SLAB_MAX_SLOT_SIZE share slabs of power of two sized slots */
+	static constexpr VkDeviceSize SLAB_MIN_SLOT_SIZE = 64;
+	static constexpr VkDeviceSize SLAB_MAX_SLOT_SIZE = 4096;
+	static constexpr VkDeviceSize SLAB_SIZE = 64 * 1024;
+
+	/** small memory chunk reside in MemoryChunk - either a free range or a suballocation */
 	struct MemoryBlock {
 		union Handle{
 			VkBuffer bufferHandle = VK_NULL_HANDLE;
 			VkImage imageHandle;
 		}handle;
-		
+
 		/** aka block start byte location */
 		VkDeviceSize offset = 0;
 		VkDeviceSize size = 0;
-		VkDeviceSize alignment = 0;
-		/** byte location divisible by alignment, also divisible by bufferImageGranularity */
-		VkDeviceSize blockEndLocation = 0;
+		/** physically adjacent blocks in the chunk */
+		uint32_t prevPhysical = INVALID_BLOCK_INDEX;
+		uint32_t nextPhysical = INVALID_BLOCK_INDEX;
+		/** links of the segregated free list - valid only if the block is free */
+		uint32_t prevFree = INVALID_BLOCK_INDEX;
+		uint32_t nextFree = INVALID_BLOCK_INDEX;
+		bool free = true;
+		/** buffer or linear image - used for bufferImageGranularity check */
+		bool linear = true;
+		/** index of MemoryPool::slabs if the block is split into slots */
+		uint32_t slabIndex = INVALID_BLOCK_INDEX;
 	};
 
 	/** allocated memory block by vkAllocateMemory call */
 	struct MemoryChunk {
-		/** @brief return suitable memory location (offset) in current memory chunk */
+		/** @brief make the whole chunk a single free block */
+		void init(VkDeviceSize chunkSize);
+		/** @brief return suitable free block & memory location (offset) in current memory chunk */
 		bool findSuitableMemoryLocation(const VkMemoryRequirements& memRequirements,
-			VkDeviceSize bufferImageGranularity, MemoryBlock& memoryBlock);
-		/** @brief sort memory block vector in real memory location order (offset) */
-		void sort();
+			VkDeviceSize bufferImageGranularity, bool linear, uint32_t& blockIndex, VkDeviceSize& offset) const;
 		/** @brief add new buffer memory block to this memory chunk */
-		void addBufferMemoryBlock(VkDevice device, VkBuffer buffer, MemoryBlock& memoryBlock);
+		void addBufferMemoryBlock(VkDevice device, VkBuffer buffer, uint32_t blockIndex,
+			VkDeviceSize offset, VkDeviceSize size);
 		/** @brief add new image memory block to this memory chunk */
-		void addImageMemoryBlock(VkDevice device, VkImage image, MemoryBlock& memoryBlock);
+		void addImageMemoryBlock(VkDevice device, VkImage image, uint32_t blockIndex,
+			VkDeviceSize offset, VkDeviceSize size, bool linear);
+		/** @brief add new memory block without binding */
+		void addMemoryBlock(uint32_t blockIndex, VkDeviceSize offset, VkDeviceSize size, bool linear);
+		/** @brief add new slab block to this memory chunk - slots are bound by the pool */
+		void addSlabMemoryBlock(uint32_t blockIndex, VkDeviceSize offset, VkDeviceSize size, uint32_t slabIndex);
+		/** @brief release memory block & merge it with free neighbours */
+		void freeMemoryBlock(uint32_t blockIndex);
+		/** @brief return size of the largest free block */
+		VkDeviceSize getLargestFreeRange() const;
 
 		VkDeviceMemory memoryHandle = VK_NULL_HANDLE;
+		/** persistently mapped pointer of the whole chunk - nullptr if not host visible */
+		void* mappedData = nullptr;
 		VkDeviceSize chunkSize = 0;
+		/** total bytes of free blocks */
 		VkDeviceSize currentSize = 0;
+		/** every block (free & used) - indices are stable */
 		std::vector<MemoryBlock> memoryBlocks;
+		/** recycled slots of memoryBlocks */
+		std::vector<uint32_t> unusedBlockIndices;
+		/** number of used blocks */
+		uint32_t activeBlockCount = 0;
+		/** holds buffers & linear images only - ignored if bufferImageGranularity is 1 */
+		bool linear = true;
+		/** memory of a single resource - released when the resource is freed */
+		bool dedicated = false;
+
+	private:
+		/** bit i is set if flBitmap's i-th first level has any free block */
+		uint64_t flBitmap = 0;
+		/** bit j of slBitmaps[i] is set if freeLists[i][j] is not empty */
+		std::array<uint32_t, FL_INDEX_COUNT> slBitmaps{};
+		/** heads of the segregated free lists */
+		std::array<std::array<uint32_t, SL_INDEX_COUNT>, FL_INDEX_COUNT> freeLists{};
+
+		/** @brief split used part [offset, offset + size) out of a free block */
+		void splitFreeBlock(uint32_t blockIndex, VkDeviceSize offset, VkDeviceSize size);
+		/** @brief get a new block slot */
+		uint32_t createBlock();
+		/** @brief insert free block to the matching free list */
+		void insertFreeBlock(uint32_t blockIndex);
+		/** @brief remove free block from its free list */
+		void removeFreeBlock(uint32_t blockIndex);
+		/** @brief merge blockIndex's next physical block into blockIndex */
+		void absorbNextBlock(uint32_t blockIndex);
 	};
 
 	/** allocated memory block by vkAllocateMemory */
 	struct MemoryPool {
-		/** @brief pre-allocate big chunk of memory */
-		void allocateChunk(VkDevice device, VkMemoryAllocateFlags allocateFlags);
+		/** @brief pre-allocate big chunk of memory - reuse released chunk slot if any */
+		uint32_t allocateChunk(VkDevice device, VkMemoryAllocateFlags allocateFlags, VkDeviceSize chunkSize,
+			bool linear, const VkMemoryDedicatedAllocateInfo* dedicatedInfo = nullptr);
 		/** @brief clean up all pre-allocated chunk of memory */
 		size_t cleanup(VkDevice device);
 
@@ -88,8 +243,30 @@ private:
 		VkDeviceSize defaultChunkSize = 0;
 		/** index of memory type defined in device memory properties */
 		uint32_t memoryTypeIndex = -1;
-		/** vector of pre-allocated memories */
+		/** property flags of the memory type */
+		VkMemoryPropertyFlags propertyFlags = 0;
+		/** bytes of suballocations & its peak */
+		VkDeviceSize usedBytes = 0;
+		VkDeviceSize peakUsedBytes = 0;
+		/** suballocations & vkAllocateMemory calls since init */
+		uint64_t totalAllocationCount = 0;
+		uint64_t totalDeviceAllocationCount = 0;
+		/** vector of pre-allocated memories - released chunks keep their slot (memoryHandle is VK_NULL_HANDLE) */
 		std::vector<MemoryChunk> memoryChunks;
+		/** chunk block split into equal slots for small buffers */
+		struct Slab {
+			uint32_t chunkIndex = 0;
+			uint32_t blockIndex = INVALID_BLOCK_INDEX;
+			VkDeviceSize slotSize = 0;
+			/** buffer bound to each slot - 0 if the slot is free */
+			std::vector<uint64_t> slotHandles;
+			std::vector<uint32_t> freeSlots;
+		};
+		std::vector<Slab> slabs;
+		/** recycled indices of slabs */
+		std::vector<uint32_t> unusedSlabIndices;
+		/** guards chunks & usage of this pool - heap allocated to keep the pool movable */
+		std::unique_ptr<std::mutex> mutex = std::make_unique<std::mutex>();
 	};
 
 	/** device memory properties */
@@ -98,13 +275,59 @@ private:
 	VkDevice device = VK_NULL_HANDLE;
 	/** used for chunk size */
 	VkDeviceSize bufferImageGranularity = 0;
+	/** flush / invalidate alignment of host visible, non-coherent memory */
+	VkDeviceSize nonCoherentAtomSize = 1;
 	/** memory pools for each memory types */
 	std::vector<MemoryPool> memoryPools;
 	/** memory allocate flags - used for vkAllocateMemory */
 	VkMemoryAllocateFlags allocateFlags = 0;
+	/** bytes of suballocations per heap & its peak */
+	std::vector<VkDeviceSize> heapUsedBytes;
+	std::vector<VkDeviceSize> heapPeakUsedBytes;
+	/** physical device handle - VK_NULL_HANDLE unless VK_EXT_memory_budget is enabled */
+	VkPhysicalDevice budgetPhysicalDevice = VK_NULL_HANDLE;
+	/** buffer / image handle -> allocation - used by freeBufferMemory & freeImageMemory */
+	std::unordered_map<uint64_t, AllocationHandle> allocations;
+	/** guards allocations, movableResources & heap usage - locked after a pool mutex, never before */
+	mutable std::mutex allocationMutex;
+
+	/** info needed to recreate a resource moved by defragment() */
+	struct MovableResource {
+		VkBufferCreateInfo bufferInfo{};
+		VkImageCreateInfo imageInfo{};
+		/** image layout between frames - VK_IMAGE_LAYOUT_UNDEFINED if contents need not be copied */
+		VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkImageAspectFlags aspect = 0;
+		bool image = false;
+	};
+	/** buffer / image handle -> movable resource info */
+	std::unordered_map<uint64_t, MovableResource> movableResources;
 
-	/** @brief helper function for freeBufferMemory */
-	bool findAndEraseBufferMemoryBlock(VkBuffer buffer, uint32_t memoryTypeIndex);
-	/** @brief helper function for freeImageMemory */
-	bool findAndEraseImageMemoryBlock(VkImage image, uint32_t memoryTypeIndex);
-};
\ No newline at end of file
+	/** @brief find free block in the pool, allocate new (or dedicated) chunk if there is none */
+	uint32_t findSuitableMemoryChunk(MemoryPool& pool, const VkMemoryRequirements& memRequirements,
+		bool linear, uint32_t& blockIndex, VkDeviceSize& offset, const VkMemoryDedicatedAllocateInfo* dedicatedInfo = nullptr);
+	/** @brief check if the resource should get its own VkDeviceMemory */
+	bool needsDedicatedAllocation(const MemoryPool& pool, const VkMemoryRequirements& memRequirements,
+		const VkMemoryDedicatedRequirements& dedicatedRequirements) const;
+	/** @brief check if a resource can be suballocated from the chunk */
+	bool isChunkCompatible(const MemoryChunk& chunk, bool linear) const;
+	/** @brief bind small buffer to a free slab slot */
+	bool allocateSlot(MemoryPool& pool, VkBuffer buffer, const VkMemoryRequirements& memRequirements,
+		AllocationHandle& allocation, VkDeviceSize& offset);
+	/** @brief return slab slot, release the slab when all of its slots are free */
+	void freeSlot(MemoryPool& pool, const AllocationHandle& allocation);
+	/** @brief free device memory of the chunk - the chunk slot stays for reuse */
+	void releaseChunk(MemoryChunk& chunk);
+	/** @brief align non-coherent suballocations to nonCoherentAtomSize */
+	void adjustMemoryRequirements(uint32_t memoryTypeIndex, VkMemoryRequirements& memRequirements) const;
+	/** @brief build HostVisibleMemory of a new suballocation */
+	HostVisibleMemory makeHostVisibleMemory(const MemoryPool& pool, const MemoryChunk& chunk,
+		VkDeviceSize size, VkDeviceSize offset, const AllocationHandle& allocation) const;
+	/** @brief update used & peak bytes of the memory type & its heap */
+	void trackUsage(uint32_t memoryTypeIndex, VkDeviceSize size, bool allocated);
+	/** @brief find new location for a movable resource, prefer dense chunks */
+	bool findDefragmentationLocation(MemoryPool& pool, uint32_t srcChunkIndex, VkDeviceSize srcOffset,
+		const VkMemoryRequirements& memRequirements, bool linear, uint32_t& chunkIndex, uint32_t& blockIndex, VkDeviceSize& offset);
+	/** @brief release block referenced by the allocation handle */
+	void freeAllocation(const AllocationHandle& allocation);
+};
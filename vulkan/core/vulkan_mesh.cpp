@@ -1,5 +1,12 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
 #include <tiny_obj_loader.h>
+#include "glm/gtc/packing.hpp"
 #include "vulkan_mesh.h"
+#include "vulkan_obj_parser.h"
 #include "vulkan_device.h"
 
 /*
@@ -11,23 +18,86 @@ Mesh::Mesh(const std::string& path) {
 	load(path);
 }
 
+namespace {
+	/** interleaved obj vertex - position, normal, uv */
+	struct ObjVertex {
+		float data[8];
+		uint32_t size; //number of used floats
+
+		bool operator==(const ObjVertex& other) const {
+			return memcmp(data, other.data, sizeof(float) * size) == 0;
+		}
+	};
+
+	/** FNV-1a over the raw vertex bytes */
+	struct ObjVertexHash {
+		size_t operator()(const ObjVertex& vertex) const {
+			const unsigned char* bytes = reinterpret_cast<const unsigned char*>(vertex.data);
+			uint64_t hash = 14695981039346656037ull;
+			for (size_t i = 0; i < sizeof(float) * vertex.size; ++i) {
+				hash = (hash ^ bytes[i]) * 1099511628211ull;
+			}
+			return static_cast<size_t>(hash);
+		}
+	};
+
+	/*
+	* print load time & vertex count before / after deduplication
+	*
+	* @param path - path to the mesh file
+	* @param statistics - statistics of the finished load
+	*/
+	void logLoadStatistics(const std::string& path, const Mesh::LoadStatistics& statistics) {
+		LOG("loaded:\t\t" + path + (statistics.cacheHit ? " (mesh cache) " : " ") +
+			std::to_string(statistics.loadTime) + " ms, vertices " +
+			std::to_string(statistics.inputVertexCount) + " -> " + std::to_string(statistics.vertexCount));
+	}
+}
+
 /*
 * parse vertex data
+* face corners with the same (position, normal, uv) share one vertex
 *
 * @param path - path to the mesh file
 */
 void Mesh::load(const std::string& path) {
+	auto startTime = std::chrono::high_resolution_clock::now();
 	vertices.cleanup();
+	indexData.cleanup();
+	cacheFile.close();
 	indices.clear();
+	quantized = false;
+
+	//binary mesh cache - vertex & index data stay in the mapping
+	std::string cachePath = meshcache::getCachePath(path);
+	uint64_t sourceSize = 0;
+	int64_t sourceTime = 0;
+	bool sourceStamped = meshcache::getSourceStamp(path, sourceSize, sourceTime);
+	if (sourceStamped && loadCache(cachePath, sourceSize, sourceTime)) {
+		loadStatistics = {};
+		loadStatistics.loadTime = std::chrono::duration<float, std::chrono::milliseconds::period>(
+			std::chrono::high_resolution_clock::now() - startTime).count();
+		loadStatistics.cacheHit = true;
+		loadStatistics.inputVertexCount = indexCount;
+		loadStatistics.vertexCount = vertexCount;
+		logLoadStatistics(path, loadStatistics);
+		return;
+	}
 
-	//model load
+	//model load - parallel parser, tinyobj for files with materials
 	tinyobj::attrib_t attrib;
-	std::vector<tinyobj::shape_t> shapes;
-	std::vector<tinyobj::material_t> materials;
-	std::string error;
-
-	if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &error, path.c_str())) {
-		throw std::runtime_error(error);
+	std::vector<tinyobj::index_t> objIndices;
+	if (!objparser::load(path, attrib, objIndices)) {
+		std::vector<tinyobj::shape_t> shapes;
+		std::vector<tinyobj::material_t> materials;
+		std::string error;
+		if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &error, path.c_str())) {
+			throw std::runtime_error(error);
+		}
+		objIndices.clear();
+		for (const auto& shape : shapes) {
+			objIndices.insert(objIndices.end(), shape.mesh.indices.begin(), shape.mesh.indices.end());
+		}
 	}
 
 	//vertex size
@@ -41,44 +111,162 @@ void Mesh::load(const std::string& path) {
 		vertexSize += sizeof(glm::vec2);
 	}
 
-	//vertex count
-	vertexCount = 0;
-	for (const auto& shape : shapes) {
-		vertexCount += shape.mesh.indices.size();
-	}
+	//face corner count
+	size_t cornerCount = objIndices.size();
+	indices.reserve(cornerCount);
+
+	//deduplicate
+	std::vector<ObjVertex> uniqueVertices;
+	std::unordered_map<ObjVertex, uint32_t, ObjVertexHash> vertexIndices;
+	vertexIndices.reserve(cornerCount);
+	for (const auto& index : objIndices) {
+		ObjVertex vertex{};
+		vertex.data[vertex.size++] = attrib.vertices[3 * index.vertex_index + 0];
+		vertex.data[vertex.size++] = attrib.vertices[3 * index.vertex_index + 1];
+		vertex.data[vertex.size++] = attrib.vertices[3 * index.vertex_index + 2];
+
+		if (hasNormalAttribute) {
+			vertex.data[vertex.size++] = attrib.normals[3 * index.normal_index + 0];
+			vertex.data[vertex.size++] = attrib.normals[3 * index.normal_index + 1];
+			vertex.data[vertex.size++] = attrib.normals[3 * index.normal_index + 2];
+		}
 
-	vertices.allocate(vertexSize * vertexCount);
+		if (hasTexcoordAttribute) {
+			vertex.data[vertex.size++] = attrib.texcoords[2 * index.texcoord_index + 0];
+			vertex.data[vertex.size++] = attrib.texcoords[2 * index.texcoord_index + 1];
+		}
+
+		auto inserted = vertexIndices.emplace(vertex, static_cast<uint32_t>(uniqueVertices.size()));
+		if (inserted.second) {
+			uniqueVertices.push_back(vertex);
+		}
+		indices.push_back(inserted.first->second);
+	}
 
 	//copy data to the (cpu) buffer
-	for (const auto& shape : shapes) {
-		for (const auto& index : shape.mesh.indices) {
-			glm::vec3 pos = {
-				attrib.vertices[3 * index.vertex_index + 0],
-				attrib.vertices[3 * index.vertex_index + 1],
-				attrib.vertices[3 * index.vertex_index + 2]
-			};
-			vertices.push(&pos, sizeof(pos));
-
-			if (hasNormalAttribute) {
-				glm::vec3 normal = {
-				attrib.normals[3 * index.normal_index + 0],
-				attrib.normals[3 * index.normal_index + 1],
-				attrib.normals[3 * index.normal_index + 2]
-				};
-				vertices.push(&normal, sizeof(normal));
-			}
+	vertexCount = uniqueVertices.size();
+	vertices.allocate(vertexSize * vertexCount);
+	for (const auto& vertex : uniqueVertices) {
+		vertices.push(vertex.data, vertexSize);
+	}
+	indexCount = static_cast<uint32_t>(indices.size());
+	updateIndexType();
+	optimize();
+	computeBounds();
+	lods = meshopt::buildLodChain(indices, reinterpret_cast<const float*>(vertices.data()), vertexSize,
+		vertexCount, MAX_LOD_COUNT);
+	//meshlet ordered copy of the full detail triangles follows the levels
+	clusters = meshopt::buildClusters(indices, 0, indexCount, reinterpret_cast<const float*>(vertices.data()),
+		vertexSize, vertexCount);
+
+	loadStatistics.loadTime = std::chrono::duration<float, std::chrono::milliseconds::period>(
+		std::chrono::high_resolution_clock::now() - startTime).count();
+	loadStatistics.cacheHit = false;
+	loadStatistics.inputVertexCount = cornerCount;
+	loadStatistics.vertexCount = vertexCount;
+
+	if (sourceStamped) {
+		writeCache(cachePath, sourceSize, sourceTime);
+	}
+	logLoadStatistics(path, loadStatistics);
+}
 
-			if (hasTexcoordAttribute) {
-				glm::vec2 texcoord = {
-				attrib.texcoords[2 * index.texcoord_index + 0],
-				attrib.texcoords[2 * index.texcoord_index + 1]
-				};
-				vertices.push(&texcoord, sizeof(texcoord));
-			}
+/*
+* map the mesh cache & point vertex / index data into the mapping
+*
+* @param cachePath - path to the cache file
+* @param sourceSize - current size of the source file
+* @param sourceTime - current modification time of the source file
+*
+* @return bool - false if the cache doesn't exist or is stale
+*/
+bool Mesh::loadCache(const std::string& cachePath, uint64_t sourceSize, int64_t sourceTime) {
+	if (!cacheFile.open(cachePath)) {
+		return false;
+	}
+	MeshCacheHeader header{};
+	if (cacheFile.size() < sizeof(header)) {
+		cacheFile.close();
+		return false;
+	}
+	memcpy(&header, cacheFile.data(), sizeof(header));
+	if (!header.isValid(cacheFile.size(), sourceSize, sourceTime)) {
+		cacheFile.close();
+		return false;
+	}
 
-			indices.push_back(static_cast<uint32_t>(indices.size()));
+	hasNormalAttribute = (header.attributes & MeshCacheHeader::ATTRIBUTE_NORMAL) != 0;
+	hasTexcoordAttribute = (header.attributes & MeshCacheHeader::ATTRIBUTE_TEXCOORD) != 0;
+	vertexSize = header.vertexSize;
+	vertexCount = header.vertexCount;
+	indexType = static_cast<VkIndexType>(header.indexType);
+	indexCount = header.lodIndexCount[0];
+	lods.resize(header.lodCount);
+	for (uint32_t i = 0; i < header.lodCount; ++i) {
+		lods[i] = { header.lodFirstIndex[i], header.lodIndexCount[i], header.lodError[i] };
+	}
+	boundsMin = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+	boundsMax = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+	if (header.clusterDataSize != uint64_t(sizeof(meshopt::Cluster)) * header.clusterCount) {
+		cacheFile.close();
+		return false;
+	}
+	clusters.resize(header.clusterCount);
+	if (header.clusterCount > 0) {
+		memcpy(clusters.data(), cacheFile.data() + header.clusterOffset, static_cast<size_t>(header.clusterDataSize));
+	}
+	for (const meshopt::Cluster& cluster : clusters) {
+		if (uint64_t(cluster.firstIndex) + cluster.indexCount > header.indexCount) {
+			clusters.clear();
+			cacheFile.close();
+			return false;
 		}
 	}
+	vertices.reference(cacheFile.data() + header.vertexOffset, static_cast<size_t>(header.vertexDataSize));
+	indexData.reference(cacheFile.data() + header.indexOffset, static_cast<size_t>(header.indexDataSize));
+	return true;
+}
+
+/*
+* write current vertex & index data to the mesh cache - failure only costs the next start time
+*
+* @param cachePath - path to the cache file
+* @param sourceSize - current size of the source file
+* @param sourceTime - current modification time of the source file
+*/
+void Mesh::writeCache(const std::string& cachePath, uint64_t sourceSize, int64_t sourceTime) const {
+	MeshCacheHeader header{};
+	header.sourceSize = sourceSize;
+	header.sourceTime = sourceTime;
+	header.attributes = (hasNormalAttribute ? MeshCacheHeader::ATTRIBUTE_NORMAL : 0) |
+		(hasTexcoordAttribute ? MeshCacheHeader::ATTRIBUTE_TEXCOORD : 0);
+	header.vertexSize = static_cast<uint32_t>(vertexSize);
+	header.vertexCount = static_cast<uint32_t>(vertexCount);
+	header.indexType = static_cast<uint32_t>(indexType);
+	header.indexCount = static_cast<uint32_t>(indices.size());
+	header.lodCount = static_cast<uint32_t>(std::min<size_t>(lods.size(), MeshCacheHeader::MAX_LOD_COUNT));
+	for (uint32_t i = 0; i < header.lodCount; ++i) {
+		header.lodFirstIndex[i] = lods[i].firstIndex;
+		header.lodIndexCount[i] = lods[i].indexCount;
+		header.lodError[i] = lods[i].error;
+	}
+	for (int i = 0; i < 3; ++i) {
+		header.boundsMin[i] = boundsMin[i];
+		header.boundsMax[i] = boundsMax[i];
+	}
+	header.vertexDataSize = vertexSize * vertexCount;
+	header.clusterCount = static_cast<uint32_t>(clusters.size());
+	header.clusterDataSize = sizeof(meshopt::Cluster) * clusters.size();
+
+	if (indexType == VK_INDEX_TYPE_UINT16) {
+		std::vector<uint16_t> indices16(indices.begin(), indices.end());
+		header.indexDataSize = sizeof(uint16_t) * indices16.size();
+		meshcache::write(cachePath, header, vertices.data(), indices16.data(), clusters.data());
+	}
+	else {
+		header.indexDataSize = sizeof(uint32_t) * indices.size();
+		meshcache::write(cachePath, header, vertices.data(), indices.data(), clusters.data());
+	}
 }
 
 /*
@@ -98,7 +286,10 @@ void Mesh::load(const std::vector<glm::vec3>& position,
 	bool hasNormal,
 	bool hasUV) {
 	this->vertices.cleanup();
+	this->indexData.cleanup();
+	this->cacheFile.close();
 	this->indices.clear();
+	this->quantized = false;
 	this->indices = indices;
 	this->vertexCount = vertexCount;
 	this->hasNormalAttribute = hasNormal;
@@ -118,6 +309,162 @@ void Mesh::load(const std::vector<glm::vec3>& position,
 		vertices.push(&uv[i], sizeof(glm::vec2));
 	}
 	this->indices.shrink_to_fit();
+	this->indexCount = static_cast<uint32_t>(this->indices.size());
+	this->lods = { { 0, this->indexCount, 0.f } };
+	updateIndexType();
+	computeBounds();
+	this->clusters = meshopt::buildClusters(this->indices, 0, this->indexCount,
+		reinterpret_cast<const float*>(vertices.data()), vertexSize, vertexCount);
+}
+
+/*
+* reorder triangles for post-transform cache & overdraw, then vertices in first use order
+* position must be the first attribute of the vertex
+*/
+void Mesh::optimize() {
+	if (indices.empty()) {
+		return;
+	}
+	if (quantized) {
+		throw std::runtime_error("Mesh::optimize(): quantized vertices can't be optimized");
+	}
+	//levels of detail & clusters index the old triangle order - keep the full detail mesh only
+	indices.resize(this->indexCount);
+	lods = { { 0, this->indexCount, 0.f } };
+	clusters.clear();
+
+	size_t indexCount = indices.size();
+	loadStatistics.cacheBefore = meshopt::analyzeVertexCache(indices.data(), indexCount, vertexCount);
+
+	std::vector<uint32_t> cacheOptimized(indexCount);
+	std::vector<uint32_t> clusters = meshopt::optimizeVertexCache(cacheOptimized.data(), indices.data(),
+		indexCount, vertexCount);
+	meshopt::optimizeOverdraw(indices.data(), cacheOptimized.data(), indexCount,
+		reinterpret_cast<const float*>(vertices.data()), vertexSize, vertexCount, clusters);
+	vertexCount = meshopt::optimizeVertexFetch(vertices.data(), indices.data(), indexCount, vertexCount, vertexSize);
+	vertices.bufferSize = vertexCount * vertexSize;
+	vertices.currentOffset = vertices.bufferSize;
+	updateIndexType();
+
+	loadStatistics.cacheAfter = meshopt::analyzeVertexCache(indices.data(), indexCount, vertexCount);
+}
+
+namespace {
+	/*
+	* octahedral normal encoding - project onto the octahedron, fold the lower hemisphere over the diagonals
+	*
+	* @param n - unit vector
+	*
+	* @return glm::vec2 - [-1, 1]^2
+	*/
+	glm::vec2 encodeOctahedral(glm::vec3 n) {
+		float length = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+		if (length == 0.f) {
+			return glm::vec2(0.f);
+		}
+		n /= length;
+		glm::vec2 p(n.x, n.y);
+		if (n.z < 0.f) {
+			p.x = (1.f - std::abs(n.y)) * (n.x >= 0.f ? 1.f : -1.f);
+			p.y = (1.f - std::abs(n.x)) * (n.y >= 0.f ? 1.f : -1.f);
+		}
+		return p;
+	}
+}
+
+/*
+* convert vertices to the compact layout - 16 (position, normal, uv) instead of 32 bytes per vertex
+* position - R16G16B16A16_UNORM relative to the bounding box, see getDequantization()
+* normal - octahedral R16G16_SNORM
+* texcoord - R16G16_SFLOAT
+* call after load() and before createModelBuffer()
+*/
+void Mesh::quantize() {
+	if (quantized || vertices.buffer == nullptr) {
+		return;
+	}
+
+	size_t compactSize = 4 * sizeof(uint16_t);
+	if (hasNormalAttribute) {
+		compactSize += 2 * sizeof(uint16_t);
+	}
+	if (hasTexcoordAttribute) {
+		compactSize += 2 * sizeof(uint16_t);
+	}
+
+	glm::vec3 extent = boundsMax - boundsMin;
+	std::vector<uint16_t> compact;
+	compact.reserve(compactSize / sizeof(uint16_t) * vertexCount);
+	for (size_t i = 0; i < vertexCount; ++i) {
+		const char* vertex = vertices.buffer + i * vertexSize;
+		glm::vec3 position;
+		memcpy(&position, vertex, sizeof(position));
+		vertex += sizeof(glm::vec3);
+		for (int k = 0; k < 3; ++k) {
+			float normalized = extent[k] > 0.f ? (position[k] - boundsMin[k]) / extent[k] : 0.f;
+			compact.push_back(glm::packUnorm1x16(normalized));
+		}
+		compact.push_back(0); //padding - 3 component 16 bit formats are rarely supported
+
+		if (hasNormalAttribute) {
+			glm::vec3 normal;
+			memcpy(&normal, vertex, sizeof(normal));
+			vertex += sizeof(glm::vec3);
+			glm::vec2 octahedral = encodeOctahedral(normal);
+			compact.push_back(glm::packSnorm1x16(octahedral.x));
+			compact.push_back(glm::packSnorm1x16(octahedral.y));
+		}
+
+		if (hasTexcoordAttribute) {
+			glm::vec2 uv;
+			memcpy(&uv, vertex, sizeof(uv));
+			compact.push_back(glm::packHalf1x16(uv.x));
+			compact.push_back(glm::packHalf1x16(uv.y));
+		}
+	}
+
+	//replaces the parsed data or the reference into the mapped cache file
+	vertexSize = compactSize;
+	vertices.cleanup();
+	vertices.allocate(vertexSize * vertexCount);
+	vertices.push(compact.data(), vertexSize * vertexCount);
+	quantized = true;
+}
+
+/*
+* dequantization constants of the compact layout - push to the vertex shader
+*
+* @return Dequantization - offset = boundsMin, scale = bounds extent (identity if not quantized)
+*/
+Mesh::Dequantization Mesh::getDequantization() const {
+	if (!quantized) {
+		return { glm::vec4(0.f), glm::vec4(1.f) };
+	}
+	return { glm::vec4(boundsMin, 0.f), glm::vec4(boundsMax - boundsMin, 0.f) };
+}
+
+/*
+* compute object space bounding box from vertex positions (first attribute)
+*/
+void Mesh::computeBounds() {
+	boundsMin = glm::vec3(std::numeric_limits<float>::max());
+	boundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+	for (size_t i = 0; i < vertexCount; ++i) {
+		glm::vec3 position;
+		memcpy(&position, vertices.buffer + i * vertexSize, sizeof(position));
+		boundsMin = glm::min(boundsMin, position);
+		boundsMax = glm::max(boundsMax, position);
+	}
+	if (vertexCount == 0) {
+		boundsMin = boundsMax = glm::vec3(0.f);
+	}
+}
+
+/*
+* pick 16 bit indices when the vertex count allows - halves index buffer size & bandwidth
+*/
+void Mesh::updateIndexType() {
+	indexType = vertexCount <= UINT16_MAX ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
 }
 
 /*
@@ -127,25 +474,10 @@ void Mesh::load(const std::vector<glm::vec3>& position,
 */
 VkBuffer Mesh::createModelBuffer(VulkanDevice* devices) {
 	VkDeviceSize vertexBufferSize = vertices.bufferSize;
-	VkDeviceSize indexBufferSize = sizeof(indices[0]) * indices.size();
+	size_t indexSize = indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+	//all levels & the cluster copy - the whole index blob on a cache hit
+	VkDeviceSize indexBufferSize = indexData.buffer != nullptr ? indexData.bufferSize : indexSize * indices.size();
 	VkDeviceSize totalSize = vertexBufferSize + indexBufferSize;
-	Mesh::Buffer buffer;
-	buffer.allocate(totalSize);
-	buffer.push(vertices.data(), vertexBufferSize);
-	buffer.push(indices.data(), indexBufferSize);
-
-	//create staging buffer
-	VkBuffer stagingBuffer;
-	VkBufferCreateInfo stagingBufferCreateInfo = vktools::initializers::bufferCreateInfo(
-		totalSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
-	VK_CHECK_RESULT(vkCreateBuffer(devices->device, &stagingBufferCreateInfo, nullptr, &stagingBuffer));
-
-	//suballocate
-	VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-	MemoryAllocator::HostVisibleMemory hostVisibleMemory = devices->memoryAllocator.allocateBufferMemory(
-		stagingBuffer, properties);
-
-	hostVisibleMemory.mapData(devices->device, buffer.data());
 
 	//create vertex & index buffer
 	VkBuffer vertexIndexBuffer;
@@ -158,12 +490,24 @@ VkBuffer Mesh::createModelBuffer(VulkanDevice* devices) {
 	//suballocation
 	devices->memoryAllocator.allocateBufferMemory(vertexIndexBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-	//host visible -> device local
-	devices->copyBuffer(devices->commandPool, stagingBuffer, vertexIndexBuffer, totalSize);
+	//write straight to the staging memory - from the mapped cache file or the parsed data
+	char* stagingData = static_cast<char*>(devices->uploadManager.stageBuffer(vertexIndexBuffer, 0, totalSize));
+	memcpy(stagingData, vertices.data(), vertexBufferSize);
+	if (indexData.buffer != nullptr) {
+		memcpy(stagingData + vertexBufferSize, indexData.data(), indexBufferSize);
+	}
+	else if (indexType == VK_INDEX_TYPE_UINT16) {
+		uint16_t* stagingIndices = reinterpret_cast<uint16_t*>(stagingData + vertexBufferSize);
+		for (size_t i = 0; i < indices.size(); ++i) {
+			stagingIndices[i] = static_cast<uint16_t>(indices[i]);
+		}
+	}
+	else {
+		memcpy(stagingData + vertexBufferSize, indices.data(), indexBufferSize);
+	}
 
-	devices->memoryAllocator.freeBufferMemory(stagingBuffer, properties);
-	vkDestroyBuffer(devices->device, stagingBuffer, nullptr);
-	buffer.cleanup();
+	//host visible -> device local, ordered before later graphics submissions
+	devices->uploadManager.submit();
 
 	return vertexIndexBuffer;
 }
@@ -172,16 +516,8 @@ VkVertexInputBindingDescription Mesh::getBindingDescription() const{
 	if (vertices.buffer == nullptr) {
 		throw std::runtime_error("Mesh::getBindingDescription(): current mesh is empty");
 	}
-	
-	uint32_t stride = sizeof(glm::vec3); //position
-	if (hasNormalAttribute) {
-		stride += sizeof(glm::vec3); //normal
-	}
-	if (hasTexcoordAttribute) {
-		stride += sizeof(glm::vec2); //texcoord
-	}
 
-	return vktools::initializers::vertexInputBindingDescription(0, stride);
+	return vktools::initializers::vertexInputBindingDescription(0, static_cast<uint32_t>(vertexSize));
 }
 
 std::vector<VkVertexInputAttributeDescription> Mesh::getAttributeDescriptions() const{
@@ -193,25 +529,28 @@ std::vector<VkVertexInputAttributeDescription> Mesh::getAttributeDescriptions()
 	std::vector<VkVertexInputAttributeDescription> attributeDescriptions(attributeCount);
 
 	//position
+	VkFormat positionFormat = quantized ? VK_FORMAT_R16G16B16A16_UNORM : VK_FORMAT_R32G32B32_SFLOAT;
 	attributeDescriptions[0] = 
-		vktools::initializers::vertexInputAttributeDescription(0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0);
+		vktools::initializers::vertexInputAttributeDescription(0, 0, positionFormat, 0);
 	uint32_t currentAttributeIndex = 1;
-	uint32_t offset = sizeof(glm::vec3);
+	uint32_t offset = quantized ? 4 * sizeof(uint16_t) : sizeof(glm::vec3);
 
 	//normal
 	if (hasNormalAttribute) {
+		VkFormat normalFormat = quantized ? VK_FORMAT_R16G16_SNORM : VK_FORMAT_R32G32B32_SFLOAT;
 		attributeDescriptions[currentAttributeIndex] =
-			vktools::initializers::vertexInputAttributeDescription(0, currentAttributeIndex, VK_FORMAT_R32G32B32_SFLOAT, offset);
+			vktools::initializers::vertexInputAttributeDescription(0, currentAttributeIndex, normalFormat, offset);
 		currentAttributeIndex++;
-		offset += sizeof(glm::vec3);
+		offset += quantized ? 2 * sizeof(uint16_t) : sizeof(glm::vec3);
 	}
 
 	//texcoord
 	if (hasTexcoordAttribute) {
+		VkFormat texcoordFormat = quantized ? VK_FORMAT_R16G16_SFLOAT : VK_FORMAT_R32G32_SFLOAT;
 		attributeDescriptions[currentAttributeIndex] =
-			vktools::initializers::vertexInputAttributeDescription(0, currentAttributeIndex, VK_FORMAT_R32G32_SFLOAT, offset);
+			vktools::initializers::vertexInputAttributeDescription(0, currentAttributeIndex, texcoordFormat, offset);
 		currentAttributeIndex++;
-		offset += sizeof(glm::vec2);
+		offset += quantized ? 2 * sizeof(uint16_t) : sizeof(glm::vec2);
 	}
 	
 	return attributeDescriptions;
@@ -225,6 +564,21 @@ std::vector<VkVertexInputAttributeDescription> Mesh::getAttributeDescriptions()
 void Mesh::Buffer::allocate(size_t bufferSize) {
 	this->bufferSize = bufferSize;
 	buffer = (char*)malloc(bufferSize);
+	owned = true;
+}
+
+/*
+* point the buffer to memory owned by someone else - not freed by cleanup()
+*
+* @param data
+* @param dataSize
+*/
+void Mesh::Buffer::reference(const void* data, size_t dataSize) {
+	cleanup();
+	buffer = const_cast<char*>(static_cast<const char*>(data));
+	bufferSize = dataSize;
+	currentOffset = dataSize;
+	owned = false;
 }
 
 /*
@@ -245,8 +599,11 @@ void Mesh::Buffer::push(const void* data, size_t dataSize) {
 * deallocate buffer
 */
 void Mesh::Buffer::cleanup() {
-	free(buffer);
+	if (owned) {
+		free(buffer);
+	}
 	buffer = nullptr;
+	bufferSize = 0;
 	currentOffset = 0;
 }
 
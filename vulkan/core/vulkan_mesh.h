@@ -2,6 +2,8 @@
 #include <array>
 #include "vulkan_utils.h"
 #include "glm/glm.hpp"
+#include "vulkan_mesh_optimizer.h"
+#include "vulkan_mesh_cache.h"
 
 struct VulkanDevice;
 struct Mesh {
@@ -11,6 +13,7 @@ struct Mesh {
 			cleanup();
 		}
 		void allocate(size_t bufferSize);
+		void reference(const void* data, size_t dataSize);
 		void push(const void* data, size_t dataSize);
 		void cleanup();
 		void* data() const;
@@ -18,11 +21,13 @@ struct Mesh {
 		char* buffer = nullptr;
 		size_t bufferSize = 0;
 		size_t currentOffset = 0;
+		/** false if buffer points to memory owned by someone else (mapped cache file) */
+		bool owned = true;
 	} vertices;
 
 	Mesh(){}
 	Mesh(const std::string& path);
-	/** @brief load obj model from a file */
+	/** @brief load obj model from a file - through the binary mesh cache if it is up to date */
 	void load(const std::string& path);
 	/** @brief build model from vertex data */
 	void load(const std::vector<glm::vec3>& position,
@@ -30,6 +35,10 @@ struct Mesh {
 		const std::vector<glm::vec2>& uv,
 		const std::vector<uint32_t>& indices,
 		uint32_t vertexCount, bool hasNormal, bool hasUV);
+	/** @brief reorder triangles & vertices for vertex cache, overdraw and vertex fetch */
+	void optimize();
+	/** @brief convert to the compact layout - 16 bit unorm position in bounds, octahedral normal, half float uv */
+	void quantize();
 	/** @brief create vertex+index buffer */
 	VkBuffer createModelBuffer(VulkanDevice* devices);
 
@@ -38,14 +47,66 @@ struct Mesh {
 	/** @brief return vertex attribute description for current model */
 	std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions() const;
 
-	/** vector of index - uint32_t by default */
+	/** position dequantization (push constant layout) - object space position = offset + scale * unorm position */
+	struct Dequantization {
+		glm::vec4 offset;
+		glm::vec4 scale;
+	};
+	/** @brief dequantization constants of the compact layout - identity if not quantized */
+	Dequantization getDequantization() const;
+	/** @brief true if quantize() converted the vertices to the compact layout */
+	bool isQuantized() const { return quantized; }
+
+	/** vector of index (all levels of detail, then the cluster copy) - uint32_t by default, empty if loaded from the mesh cache */
 	std::vector<uint32_t> indices;
+	/** index count of the full detail mesh (lods[0]) */
+	uint32_t indexCount = 0;
+	/** levels of detail - index ranges of the gpu index buffer, [0] is the full detail mesh */
+	std::vector<meshopt::Lod> lods;
+	/** max number of levels built by load() including the full detail one */
+	static constexpr uint32_t MAX_LOD_COUNT = 4;
+	/** meshlets of the full detail mesh with culling bounds - ranges of its meshlet ordered copy, empty after optimize() */
+	std::vector<meshopt::Cluster> clusters;
+	/** index type of the gpu index buffer - 16 bit if every index fits */
+	VkIndexType indexType = VK_INDEX_TYPE_UINT32;
 	/** vertex size (or stride) */
 	size_t vertexSize = 0;
 	/** vertex count */
 	size_t vertexCount = 0;
+	/** object space bounding box */
+	glm::vec3 boundsMin = glm::vec3(0.f), boundsMax = glm::vec3(0.f);
+
+	/** statistics of the last obj load */
+	struct LoadStatistics {
+		/** parse + deduplication time (or cache mapping time) in milliseconds */
+		float loadTime = 0.f;
+		/** loaded from the binary mesh cache */
+		bool cacheHit = false;
+		/** vertex count without deduplication (face corners) */
+		size_t inputVertexCount = 0;
+		/** vertex count after deduplication */
+		size_t vertexCount = 0;
+		/** vertex cache statistics before / after optimize() */
+		meshopt::CacheStatistics cacheBefore, cacheAfter;
+	} loadStatistics;
 
 private:
+	/** @brief pick 16 bit indices when the vertex count allows */
+	void updateIndexType();
+	/** @brief compute boundsMin / boundsMax from vertex positions */
+	void computeBounds();
+	/** @brief map vertex & index blobs of the mesh cache */
+	bool loadCache(const std::string& cachePath, uint64_t sourceSize, int64_t sourceTime);
+	/** @brief write current vertex & index data to the mesh cache */
+	void writeCache(const std::string& cachePath, uint64_t sourceSize, int64_t sourceTime) const;
+
+	/** index blob of the mapped mesh cache */
+	Buffer indexData;
+	/** mapped mesh cache - vertices & indexData point into it */
+	MappedFile cacheFile;
+
 	bool hasNormalAttribute = false;
 	bool hasTexcoordAttribute = false;
+	/** vertices are in the compact layout */
+	bool quantized = false;
 };
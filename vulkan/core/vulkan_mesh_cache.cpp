@@ -0,0 +1,209 @@
+#include <filesystem>
+#include <fstream>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "vulkan_mesh_cache.h"
+
+/*
+* map the whole file read-only
+*
+* @param path - file to map
+*
+* @return bool - false if the file doesn't exist, is empty or can't be mapped
+*/
+bool MappedFile::open(const std::string& path) {
+	close();
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	LARGE_INTEGER size{};
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+		CloseHandle(file);
+		return false;
+	}
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping == nullptr) {
+		CloseHandle(file);
+		return false;
+	}
+	void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (data == nullptr) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+	fileHandle = file;
+	mappingHandle = mapping;
+	fileSize = static_cast<size_t>(size.QuadPart);
+#else
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat fileStat{};
+	if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0) {
+		::close(fd);
+		return false;
+	}
+	void* data = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	if (data == MAP_FAILED) {
+		::close(fd);
+		return false;
+	}
+	fileDescriptor = fd;
+	fileSize = static_cast<size_t>(fileStat.st_size);
+#endif
+	mappedData = static_cast<const char*>(data);
+	return true;
+}
+
+/*
+* unmap & close the file
+*/
+void MappedFile::close() {
+	if (mappedData == nullptr) {
+		return;
+	}
+#ifdef _WIN32
+	UnmapViewOfFile(mappedData);
+	CloseHandle(mappingHandle);
+	CloseHandle(fileHandle);
+	mappingHandle = nullptr;
+	fileHandle = nullptr;
+#else
+	munmap(const_cast<char*>(mappedData), fileSize);
+	::close(fileDescriptor);
+	fileDescriptor = -1;
+#endif
+	mappedData = nullptr;
+	fileSize = 0;
+}
+
+/*
+* check magic, version, source stamp & that every blob / level of detail lies inside the file
+*
+* @param fileSize - size of the mapped cache file
+* @param sourceSize - current size of the source file
+* @param sourceTime - current modification time of the source file
+*
+* @return bool - true if the cache can be used as is
+*/
+bool MeshCacheHeader::isValid(size_t fileSize, uint64_t sourceSize, int64_t sourceTime) const {
+	if (magic != MAGIC || version != VERSION) {
+		return false;
+	}
+	if (this->sourceSize != sourceSize || this->sourceTime != sourceTime) {
+		return false;
+	}
+	if (vertexOffset % BLOB_ALIGNMENT != 0 || indexOffset % BLOB_ALIGNMENT != 0 || clusterOffset % BLOB_ALIGNMENT != 0) {
+		return false;
+	}
+	if (lodCount == 0 || lodCount > MAX_LOD_COUNT) {
+		return false;
+	}
+	for (uint32_t i = 0; i < lodCount; ++i) {
+		if (uint64_t(lodFirstIndex[i]) + lodIndexCount[i] > indexCount) {
+			return false;
+		}
+	}
+	uint64_t indexSize = indexType == 0 ? sizeof(uint16_t) : sizeof(uint32_t); //VK_INDEX_TYPE_UINT16 == 0
+	return vertexDataSize == uint64_t(vertexSize) * vertexCount &&
+		indexDataSize == indexSize * indexCount &&
+		vertexOffset + vertexDataSize <= fileSize &&
+		indexOffset + indexDataSize <= fileSize &&
+		clusterOffset + clusterDataSize <= fileSize;
+}
+
+namespace meshcache {
+	/*
+	* cache file path of a source mesh
+	*
+	* @param sourcePath - path to the source mesh file
+	*
+	* @return std::string - sourcePath + ".meshcache"
+	*/
+	std::string getCachePath(const std::string& sourcePath) {
+		return sourcePath + ".meshcache";
+	}
+
+	/*
+	* size & modification time of the source file
+	*
+	* @param sourcePath - path to the source mesh file
+	* @param size - out, file size in bytes
+	* @param time - out, last write time in file clock ticks
+	*
+	* @return bool - false if the file doesn't exist
+	*/
+	bool getSourceStamp(const std::string& sourcePath, uint64_t& size, int64_t& time) {
+		std::error_code error;
+		size = std::filesystem::file_size(sourcePath, error);
+		if (error) {
+			return false;
+		}
+		time = static_cast<int64_t>(std::filesystem::last_write_time(sourcePath, error).time_since_epoch().count());
+		return !error;
+	}
+
+	/*
+	* write header & aligned blobs
+	*
+	* @param cachePath - output file
+	* @param header - filled header, blob offsets are computed here
+	* @param vertexData - header.vertexDataSize bytes
+	* @param indexData - header.indexDataSize bytes
+	* @param clusterData - header.clusterDataSize bytes
+	*
+	* @return bool - false if the cache couldn't be written (read-only directory etc.)
+	*/
+	bool write(const std::string& cachePath, MeshCacheHeader header,
+		const void* vertexData, const void* indexData, const void* clusterData) {
+		auto alignUp = [](uint64_t offset) {
+			return (offset + MeshCacheHeader::BLOB_ALIGNMENT - 1) / MeshCacheHeader::BLOB_ALIGNMENT * MeshCacheHeader::BLOB_ALIGNMENT;
+		};
+		header.vertexOffset = alignUp(sizeof(MeshCacheHeader));
+		header.indexOffset = alignUp(header.vertexOffset + header.vertexDataSize);
+		header.clusterOffset = alignUp(header.indexOffset + header.indexDataSize);
+
+		//write to a temporary file first - a crash never leaves a half written cache
+		std::string tempPath = cachePath + ".tmp";
+		{
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+			if (!file.is_open()) {
+				return false;
+			}
+			const char zeros[MeshCacheHeader::BLOB_ALIGNMENT] = {};
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(zeros, header.vertexOffset - sizeof(header));
+			file.write(static_cast<const char*>(vertexData), header.vertexDataSize);
+			file.write(zeros, header.indexOffset - header.vertexOffset - header.vertexDataSize);
+			file.write(static_cast<const char*>(indexData), header.indexDataSize);
+			file.write(zeros, header.clusterOffset - header.indexOffset - header.indexDataSize);
+			file.write(static_cast<const char*>(clusterData), header.clusterDataSize);
+			if (!file.good()) {
+				file.close();
+				std::error_code error;
+				std::filesystem::remove(tempPath, error);
+				return false;
+			}
+		}
+		std::error_code error;
+		std::filesystem::rename(tempPath, cachePath, error);
+		if (error) {
+			std::filesystem::remove(tempPath, error);
+			return false;
+		}
+		return true;
+	}
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <string>
+#include <cstdint>
+
+/*
+* read-only memory mapped file - mapping lives until close() or destruction
+*/
+class MappedFile {
+public:
+	MappedFile() {}
+	~MappedFile() { close(); }
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	/** @brief map the whole file, false if it doesn't exist or is empty */
+	bool open(const std::string& path);
+	/** @brief unmap & close */
+	void close();
+
+	/** first byte of the mapping - nullptr if not opened */
+	const char* data() const { return mappedData; }
+	/** file size in bytes */
+	size_t size() const { return fileSize; }
+
+private:
+	const char* mappedData = nullptr;
+	size_t fileSize = 0;
+#ifdef _WIN32
+	void* fileHandle = nullptr;
+	void* mappingHandle = nullptr;
+#else
+	int fileDescriptor = -1;
+#endif
+};
+
+/*
+* binary mesh cache (*.meshcache next to the source file)
+* [MeshCacheHeader][vertex blob][index blob][cluster blob] - blobs aligned to BLOB_ALIGNMENT
+* vertex blob is interleaved position (+ normal) (+ uv), index blob is uint16_t or uint32_t
+* index blob holds all levels of detail back to back, the header has their ranges
+* cluster blob is meshopt::Cluster[clusterCount] of the full detail level - ranges of the index blob after the levels
+*/
+struct MeshCacheHeader {
+	static constexpr uint32_t MAGIC = 0x434d4b56; //"VKMC"
+	/** bump whenever the layout or the mesh processing changes */
+	static constexpr uint32_t VERSION = 4;
+	static constexpr uint64_t BLOB_ALIGNMENT = 16;
+	static constexpr uint32_t ATTRIBUTE_NORMAL = 0x1;
+	static constexpr uint32_t ATTRIBUTE_TEXCOORD = 0x2;
+	static constexpr uint32_t MAX_LOD_COUNT = 8;
+
+	uint32_t magic = MAGIC;
+	uint32_t version = VERSION;
+	/** source file size & modification time - stale cache is rebuilt */
+	uint64_t sourceSize = 0;
+	int64_t sourceTime = 0;
+	/** ATTRIBUTE_* flags, position is always present */
+	uint32_t attributes = 0;
+	uint32_t vertexSize = 0;
+	uint32_t vertexCount = 0;
+	/** VkIndexType */
+	uint32_t indexType = 0;
+	/** index count of all levels */
+	uint32_t indexCount = 0;
+	uint32_t lodCount = 0;
+	/** level of detail ranges in the index blob & their relative error */
+	uint32_t lodFirstIndex[MAX_LOD_COUNT] = {};
+	uint32_t lodIndexCount[MAX_LOD_COUNT] = {};
+	float lodError[MAX_LOD_COUNT] = {};
+	float boundsMin[3] = { 0.f, 0.f, 0.f };
+	float boundsMax[3] = { 0.f, 0.f, 0.f };
+	/** blob offsets from the beginning of the file */
+	uint64_t vertexOffset = 0;
+	uint64_t vertexDataSize = 0;
+	uint64_t indexOffset = 0;
+	uint64_t indexDataSize = 0;
+	uint64_t clusterOffset = 0;
+	uint64_t clusterDataSize = 0;
+	uint32_t clusterCount = 0;
+	uint32_t clusterPadding = 0;
+
+	/** @brief check magic, version, source stamp & blob ranges */
+	bool isValid(size_t fileSize, uint64_t sourceSize, int64_t sourceTime) const;
+};
+
+namespace meshcache {
+	/** @brief cache file path of a source mesh */
+	std::string getCachePath(const std::string& sourcePath);
+	/** @brief size & modification time of the source file, false if it doesn't exist */
+	bool getSourceStamp(const std::string& sourcePath, uint64_t& size, int64_t& time);
+	/** @brief write header & blobs, fills blob offsets of the header - false on failure */
+	bool write(const std::string& cachePath, MeshCacheHeader header,
+		const void* vertexData, const void* indexData, const void* clusterData);
+}
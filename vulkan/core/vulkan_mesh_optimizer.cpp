@@ -0,0 +1,869 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+#include "vulkan_mesh_optimizer.h"
+
+namespace meshopt {
+	/*
+	* accumulate counters of another mesh
+	*/
+	CacheStatistics& CacheStatistics::operator+=(const CacheStatistics& other) {
+		transformCount += other.transformCount;
+		triangleCount += other.triangleCount;
+		vertexCount += other.vertexCount;
+		return *this;
+	}
+
+	/*
+	* simulate a FIFO post-transform cache
+	*
+	* @param indices - triangle list
+	* @param indexCount - multiple of 3
+	* @param vertexCount - max index + 1
+	* @param cacheSize - FIFO entry count
+	*
+	* @return CacheStatistics - transform / triangle / referenced vertex counts
+	*/
+	CacheStatistics analyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount,
+		uint32_t cacheSize) {
+		CacheStatistics statistics{};
+		statistics.triangleCount = indexCount / 3;
+
+		//time stamp of the vertex entering the cache - FIFO doesn't refresh on hit
+		std::vector<size_t> cacheTimeStamps(vertexCount, 0);
+		std::vector<bool> referenced(vertexCount, false);
+		size_t time = cacheSize + 1;
+		for (size_t i = 0; i < indexCount; ++i) {
+			uint32_t index = indices[i];
+			if (time - cacheTimeStamps[index] > cacheSize) {
+				cacheTimeStamps[index] = time++;
+				statistics.transformCount++;
+			}
+			if (!referenced[index]) {
+				referenced[index] = true;
+				statistics.vertexCount++;
+			}
+		}
+		return statistics;
+	}
+
+	namespace {
+		/** vertex -> triangle adjacency in CSR layout */
+		struct TriangleAdjacency {
+			std::vector<uint32_t> offsets;
+			std::vector<uint32_t> counts;
+			std::vector<uint32_t> triangles;
+
+			TriangleAdjacency(const uint32_t* indices, size_t indexCount, size_t vertexCount)
+				: offsets(vertexCount, 0), counts(vertexCount, 0), triangles(indexCount) {
+				for (size_t i = 0; i < indexCount; ++i) {
+					if (indices[i] >= vertexCount) {
+						throw std::out_of_range("meshopt::TriangleAdjacency(): index out of range");
+					}
+					counts[indices[i]]++;
+				}
+				uint32_t offset = 0;
+				for (size_t v = 0; v < vertexCount; ++v) {
+					offsets[v] = offset;
+					offset += counts[v];
+				}
+				std::vector<uint32_t> filled(offsets);
+				for (size_t i = 0; i < indexCount; ++i) {
+					triangles[filled[indices[i]]++] = static_cast<uint32_t>(i / 3);
+				}
+			}
+		};
+	}
+
+	/*
+	* Tipsify - fan around the current vertex, then move to the candidate vertex
+	* which stays longest in the cache; a dead end restarts from the dead end stack or the input order
+	*
+	* @param dst - output indices, must not alias indices
+	* @param indices - triangle list
+	* @param indexCount - multiple of 3
+	* @param vertexCount - max index + 1
+	* @param cacheSize - FIFO entry count to optimize for
+	*
+	* @return std::vector<uint32_t> - first index of each cluster, a new cluster starts where the cache is flushed
+	*/
+	std::vector<uint32_t> optimizeVertexCache(uint32_t* dst, const uint32_t* indices, size_t indexCount,
+		size_t vertexCount, uint32_t cacheSize) {
+		std::vector<uint32_t> clusters;
+		if (indexCount == 0) {
+			return clusters;
+		}
+		if (indexCount % 3 != 0) {
+			throw std::invalid_argument("meshopt::optimizeVertexCache(): index count must be a multiple of 3");
+		}
+
+		TriangleAdjacency adjacency(indices, indexCount, vertexCount);
+		std::vector<uint32_t> liveTriangles(adjacency.counts);
+		std::vector<size_t> cacheTimeStamps(vertexCount, 0);
+		std::vector<bool> emitted(indexCount / 3, false);
+		std::vector<uint32_t> deadEndStack;
+		deadEndStack.reserve(indexCount);
+		std::vector<uint32_t> candidates;
+		candidates.reserve(64);
+
+		size_t time = cacheSize + 1;
+		size_t outputCount = 0;
+		uint32_t inputCursor = 0;
+
+		//next vertex with live triangles - dead end stack first, then input order (cache flush)
+		auto skipDeadEnd = [&]() -> int64_t {
+			while (!deadEndStack.empty()) {
+				uint32_t vertex = deadEndStack.back();
+				deadEndStack.pop_back();
+				if (liveTriangles[vertex] > 0) {
+					return vertex;
+				}
+			}
+			while (inputCursor < vertexCount) {
+				if (liveTriangles[inputCursor] > 0) {
+					clusters.push_back(static_cast<uint32_t>(outputCount));
+					return inputCursor;
+				}
+				++inputCursor;
+			}
+			return -1;
+		};
+
+		int64_t fanningVertex = skipDeadEnd();
+		while (fanningVertex >= 0) {
+			candidates.clear();
+			uint32_t offset = adjacency.offsets[fanningVertex];
+			for (uint32_t t = 0; t < adjacency.counts[fanningVertex]; ++t) {
+				uint32_t triangle = adjacency.triangles[offset + t];
+				if (emitted[triangle]) {
+					continue;
+				}
+				for (uint32_t k = 0; k < 3; ++k) {
+					uint32_t vertex = indices[triangle * 3 + k];
+					dst[outputCount++] = vertex;
+					deadEndStack.push_back(vertex);
+					candidates.push_back(vertex);
+					liveTriangles[vertex]--;
+					if (time - cacheTimeStamps[vertex] > cacheSize) {
+						cacheTimeStamps[vertex] = time++;
+					}
+				}
+				emitted[triangle] = true;
+			}
+
+			//pick the candidate that is still in the cache after fanning its live triangles
+			int64_t nextVertex = -1;
+			int64_t bestPriority = -1;
+			for (uint32_t vertex : candidates) {
+				if (liveTriangles[vertex] == 0) {
+					continue;
+				}
+				int64_t priority = 0;
+				int64_t age = static_cast<int64_t>(time - cacheTimeStamps[vertex]);
+				if (age + 2 * static_cast<int64_t>(liveTriangles[vertex]) <= static_cast<int64_t>(cacheSize)) {
+					priority = age;
+				}
+				if (priority > bestPriority) {
+					bestPriority = priority;
+					nextVertex = vertex;
+				}
+			}
+			fanningVertex = nextVertex >= 0 ? nextVertex : skipDeadEnd();
+		}
+		return clusters;
+	}
+
+	/*
+	* split cache clusters further while the cluster ACMR stays within threshold of the whole mesh,
+	* then sort clusters by dot(cluster centroid - mesh centroid, cluster normal) - outer, outward facing
+	* clusters first so they occlude the rest (early-z rejects more fragments)
+	*
+	* @param dst - output indices, must not alias indices
+	* @param indices - output of optimizeVertexCache()
+	* @param indexCount - multiple of 3
+	* @param positions - first float of the position of the first vertex
+	* @param positionStride - byte stride between positions
+	* @param vertexCount - max index + 1
+	* @param clusters - cluster offsets returned by optimizeVertexCache()
+	* @param threshold - allowed ACMR increase (1.05 = 5%)
+	* @param cacheSize - FIFO entry count
+	*/
+	void optimizeOverdraw(uint32_t* dst, const uint32_t* indices, size_t indexCount,
+		const float* positions, size_t positionStride, size_t vertexCount,
+		const std::vector<uint32_t>& clusters, float threshold, uint32_t cacheSize) {
+		if (indexCount == 0) {
+			return;
+		}
+		auto getPosition = [&](uint32_t index) {
+			const float* p = reinterpret_cast<const float*>(
+				reinterpret_cast<const char*>(positions) + positionStride * index);
+			return std::array<float, 3>{ p[0], p[1], p[2] };
+		};
+
+		//soft boundaries
+		float meshACMR = analyzeVertexCache(indices, indexCount, vertexCount, cacheSize).acmr();
+		std::vector<uint32_t> softClusters;
+		std::vector<size_t> cacheTimeStamps(vertexCount, 0);
+		size_t time = cacheSize + 1;
+		for (size_t c = 0; c < clusters.size(); ++c) {
+			size_t begin = clusters[c];
+			size_t end = c + 1 < clusters.size() ? clusters[c + 1] : indexCount;
+			size_t clusterBegin = begin;
+			size_t transformCount = 0;
+			time += cacheSize + 1; //flush
+			softClusters.push_back(static_cast<uint32_t>(begin));
+			for (size_t i = begin; i < end; i += 3) {
+				for (size_t k = 0; k < 3; ++k) {
+					uint32_t index = indices[i + k];
+					if (time - cacheTimeStamps[index] > cacheSize) {
+						cacheTimeStamps[index] = time++;
+						transformCount++;
+					}
+				}
+				size_t triangleCount = (i + 3 - clusterBegin) / 3;
+				if (i + 3 < end && float(transformCount) / triangleCount <= threshold * meshACMR) {
+					clusterBegin = i + 3;
+					transformCount = 0;
+					time += cacheSize + 1;
+					softClusters.push_back(static_cast<uint32_t>(clusterBegin));
+				}
+			}
+		}
+
+		//mesh centroid
+		float meshCentroid[3] = { 0.f, 0.f, 0.f };
+		for (size_t i = 0; i < indexCount; ++i) {
+			std::array<float, 3> p = getPosition(indices[i]);
+			for (int k = 0; k < 3; ++k) {
+				meshCentroid[k] += p[k] / indexCount;
+			}
+		}
+
+		//sort key - area weighted centroid & normal of each cluster
+		std::vector<std::pair<float, uint32_t>> sortKeys(softClusters.size());
+		for (size_t c = 0; c < softClusters.size(); ++c) {
+			size_t begin = softClusters[c];
+			size_t end = c + 1 < softClusters.size() ? softClusters[c + 1] : indexCount;
+			float centroid[3] = { 0.f, 0.f, 0.f }, normal[3] = { 0.f, 0.f, 0.f };
+			float areaSum = 0.f;
+			for (size_t i = begin; i < end; i += 3) {
+				std::array<float, 3> p0 = getPosition(indices[i]);
+				std::array<float, 3> p1 = getPosition(indices[i + 1]);
+				std::array<float, 3> p2 = getPosition(indices[i + 2]);
+				float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+				float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+				float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+				float area = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+				for (int k = 0; k < 3; ++k) {
+					centroid[k] += (p0[k] + p1[k] + p2[k]) / 3.f * area;
+					normal[k] += n[k];
+				}
+				areaSum += area;
+			}
+			float normalLength = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+			float key = 0.f;
+			if (areaSum > 0.f && normalLength > 0.f) {
+				for (int k = 0; k < 3; ++k) {
+					key += (centroid[k] / areaSum - meshCentroid[k]) * normal[k] / normalLength;
+				}
+			}
+			sortKeys[c] = { key, static_cast<uint32_t>(c) };
+		}
+		std::stable_sort(sortKeys.begin(), sortKeys.end(), [](const auto& a, const auto& b) {
+			return a.first > b.first;
+		});
+
+		size_t outputCount = 0;
+		for (const auto& sortKey : sortKeys) {
+			size_t c = sortKey.second;
+			size_t begin = softClusters[c];
+			size_t end = c + 1 < softClusters.size() ? softClusters[c + 1] : indexCount;
+			memcpy(dst + outputCount, indices + begin, (end - begin) * sizeof(uint32_t));
+			outputCount += end - begin;
+		}
+	}
+
+	/*
+	* assign new vertex indices in first use order & rewrite the index buffer
+	*
+	* @param remap - out, old index -> new index (~0u for unreferenced vertices)
+	* @param indices - triangle list, rewritten in place
+	* @param indexCount
+	* @param vertexCount - max index + 1
+	*
+	* @return size_t - referenced vertex count
+	*/
+	size_t optimizeVertexFetchRemap(std::vector<uint32_t>& remap, uint32_t* indices, size_t indexCount,
+		size_t vertexCount) {
+		remap.assign(vertexCount, ~0u);
+		uint32_t nextVertex = 0;
+		for (size_t i = 0; i < indexCount; ++i) {
+			uint32_t& newIndex = remap[indices[i]];
+			if (newIndex == ~0u) {
+				newIndex = nextVertex++;
+			}
+			indices[i] = newIndex;
+		}
+		return nextVertex;
+	}
+
+	/*
+	* reorder an interleaved vertex buffer in first use order, unreferenced vertices are dropped
+	*
+	* @param vertices - interleaved vertex data, reordered in place
+	* @param indices - triangle list, rewritten in place
+	* @param indexCount
+	* @param vertexCount - vertex count of the input buffer
+	* @param vertexSize - stride
+	*
+	* @return size_t - referenced vertex count (new vertex count)
+	*/
+	size_t optimizeVertexFetch(void* vertices, uint32_t* indices, size_t indexCount, size_t vertexCount,
+		size_t vertexSize) {
+		std::vector<uint32_t> remap;
+		size_t newVertexCount = optimizeVertexFetchRemap(remap, indices, indexCount, vertexCount);
+
+		char* data = reinterpret_cast<char*>(vertices);
+		std::vector<char> copy(data, data + vertexCount * vertexSize);
+		for (size_t i = 0; i < vertexCount; ++i) {
+			if (remap[i] != ~0u) {
+				memcpy(data + remap[i] * vertexSize, copy.data() + i * vertexSize, vertexSize);
+			}
+		}
+		return newVertexCount;
+	}
+
+	namespace {
+		/** symmetric 4x4 error quadric - sum of squared distances to the planes of the surrounding triangles */
+		struct Quadric {
+			double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+			double b0 = 0, b1 = 0, b2 = 0;
+			double c = 0;
+
+			void addPlane(const std::array<double, 3>& n, double d, double weight) {
+				a00 += weight * n[0] * n[0]; a01 += weight * n[0] * n[1]; a02 += weight * n[0] * n[2];
+				a11 += weight * n[1] * n[1]; a12 += weight * n[1] * n[2]; a22 += weight * n[2] * n[2];
+				b0 += weight * n[0] * d; b1 += weight * n[1] * d; b2 += weight * n[2] * d;
+				c += weight * d * d;
+			}
+			Quadric& operator+=(const Quadric& other) {
+				a00 += other.a00; a01 += other.a01; a02 += other.a02;
+				a11 += other.a11; a12 += other.a12; a22 += other.a22;
+				b0 += other.b0; b1 += other.b1; b2 += other.b2;
+				c += other.c;
+				return *this;
+			}
+			/** p^T A p + 2 b.p + c */
+			double error(const std::array<float, 3>& p) const {
+				double x = p[0], y = p[1], z = p[2];
+				double result = a00 * x * x + a11 * y * y + a22 * z * z +
+					2 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+					2 * (b0 * x + b1 * y + b2 * z) + c;
+				return std::max(result, 0.0);
+			}
+		};
+
+		std::array<double, 3> triangleNormal(const std::array<float, 3>& p0, const std::array<float, 3>& p1,
+			const std::array<float, 3>& p2) {
+			double e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			double e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			return { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+		}
+	}
+
+	/*
+	* quadric error metric simplification - edge collapses onto existing vertices, so the
+	* simplified index buffer keeps using the original vertex buffer (all attributes stay valid)
+	* attribute seams (several vertices at one position) and open borders are locked
+	* collapses are applied in passes - cheapest first, one collapse per neighbourhood & pass
+	*
+	* @param dst - output indices, at least indexCount, may alias indices
+	* @param indices - triangle list
+	* @param indexCount - multiple of 3
+	* @param positions - first float of the position of the first vertex
+	* @param positionStride - byte stride between positions
+	* @param vertexCount - max index + 1
+	* @param targetIndexCount - stop once the index count is at or below this
+	* @param targetError - max error relative to the bounding sphere radius
+	* @param resultError - out (optional), error of the simplified mesh relative to the bounding sphere radius
+	*
+	* @return size_t - simplified index count
+	*/
+	size_t simplify(uint32_t* dst, const uint32_t* indices, size_t indexCount,
+		const float* positions, size_t positionStride, size_t vertexCount,
+		size_t targetIndexCount, float targetError, float* resultError) {
+		if (indexCount % 3 != 0) {
+			throw std::invalid_argument("meshopt::simplify(): index count must be a multiple of 3");
+		}
+		auto getPosition = [&](uint32_t index) {
+			const float* p = reinterpret_cast<const float*>(
+				reinterpret_cast<const char*>(positions) + positionStride * index);
+			return std::array<float, 3>{ p[0], p[1], p[2] };
+		};
+
+		//bounding sphere radius - errors are relative to it
+		std::array<float, 3> boundsMin = getPosition(indexCount ? indices[0] : 0), boundsMax = boundsMin;
+		for (size_t i = 0; i < indexCount; ++i) {
+			std::array<float, 3> p = getPosition(indices[i]);
+			for (int k = 0; k < 3; ++k) {
+				boundsMin[k] = std::min(boundsMin[k], p[k]);
+				boundsMax[k] = std::max(boundsMax[k], p[k]);
+			}
+		}
+		double radius = 0.5 * std::sqrt(double(boundsMax[0] - boundsMin[0]) * (boundsMax[0] - boundsMin[0]) +
+			double(boundsMax[1] - boundsMin[1]) * (boundsMax[1] - boundsMin[1]) +
+			double(boundsMax[2] - boundsMin[2]) * (boundsMax[2] - boundsMin[2]));
+		double maxCost = radius > 0.0 ? (targetError * radius) * (targetError * radius) : 0.0;
+
+		//weld by position - seams show up as several vertices at one position
+		struct PositionHash {
+			size_t operator()(const std::array<float, 3>& p) const {
+				uint32_t bits[3];
+				memcpy(bits, p.data(), sizeof(bits));
+				return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+			}
+		};
+		std::vector<uint32_t> weld(vertexCount);
+		std::vector<uint32_t> weldSize(vertexCount, 0);
+		std::unordered_map<std::array<float, 3>, uint32_t, PositionHash> positionToVertex;
+		positionToVertex.reserve(vertexCount);
+		for (uint32_t v = 0; v < vertexCount; ++v) {
+			weld[v] = positionToVertex.emplace(getPosition(v), v).first->second;
+			weldSize[weld[v]]++;
+		}
+
+		//lock seams & open borders (half edge without its twin on the welded mesh)
+		std::vector<bool> locked(vertexCount, false);
+		for (uint32_t v = 0; v < vertexCount; ++v) {
+			locked[v] = weldSize[weld[v]] > 1;
+		}
+		std::vector<uint32_t> weldedIndices(indexCount);
+		for (size_t i = 0; i < indexCount; ++i) {
+			weldedIndices[i] = weld[indices[i]];
+		}
+		TriangleAdjacency weldedAdjacency(weldedIndices.data(), indexCount, vertexCount);
+		auto hasHalfEdge = [&](uint32_t a, uint32_t b) {
+			uint32_t offset = weldedAdjacency.offsets[a];
+			for (uint32_t t = 0; t < weldedAdjacency.counts[a]; ++t) {
+				const uint32_t* triangle = &weldedIndices[weldedAdjacency.triangles[offset + t] * 3];
+				for (size_t k = 0; k < 3; ++k) {
+					if (triangle[k] == a && triangle[(k + 1) % 3] == b) {
+						return true;
+					}
+				}
+			}
+			return false;
+		};
+		std::vector<bool> border(vertexCount, false);
+		for (size_t i = 0; i < indexCount; i += 3) {
+			for (size_t k = 0; k < 3; ++k) {
+				uint32_t a = weldedIndices[i + k], b = weldedIndices[i + (k + 1) % 3];
+				if (!hasHalfEdge(b, a)) {
+					border[a] = border[b] = true;
+				}
+			}
+		}
+		for (uint32_t v = 0; v < vertexCount; ++v) {
+			locked[v] = locked[v] || border[weld[v]];
+		}
+
+		//area weighted plane quadrics
+		std::vector<Quadric> quadrics(vertexCount);
+		for (size_t i = 0; i < indexCount; i += 3) {
+			std::array<float, 3> p0 = getPosition(indices[i]);
+			std::array<double, 3> n = triangleNormal(p0, getPosition(indices[i + 1]), getPosition(indices[i + 2]));
+			double area = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			if (area == 0.0) {
+				continue;
+			}
+			n = { n[0] / area, n[1] / area, n[2] / area };
+			double d = -(n[0] * p0[0] + n[1] * p0[1] + n[2] * p0[2]);
+			for (size_t k = 0; k < 3; ++k) {
+				quadrics[indices[i + k]].addPlane(n, d, area);
+			}
+		}
+
+		std::vector<uint32_t> result(indices, indices + indexCount);
+		std::vector<uint32_t> remap(vertexCount);
+		std::vector<bool> touched(vertexCount);
+		struct Collapse {
+			uint32_t from, to;
+			double cost;
+		};
+		std::vector<Collapse> collapses;
+		double resultCost = 0.0;
+
+		while (result.size() > targetIndexCount) {
+			TriangleAdjacency adjacency(result.data(), result.size(), vertexCount);
+
+			//candidates - both directions of every edge, the collapsed vertex must be free
+			//interior edges show up as two opposite half edges, only a < b is used
+			collapses.clear();
+			for (size_t i = 0; i < result.size(); i += 3) {
+				for (size_t k = 0; k < 3; ++k) {
+					uint32_t a = result[i + k], b = result[i + (k + 1) % 3];
+					if (a > b || (locked[a] && locked[b])) {
+						continue;
+					}
+					Quadric quadric = quadrics[a];
+					quadric += quadrics[b];
+					if (!locked[a]) {
+						collapses.push_back({ a, b, quadric.error(getPosition(b)) });
+					}
+					if (!locked[b]) {
+						collapses.push_back({ b, a, quadric.error(getPosition(a)) });
+					}
+				}
+			}
+			if (collapses.empty()) {
+				break;
+			}
+
+			//most collapses of a pass are rejected by overlapping neighbourhoods - sort the cheapest part only
+			size_t trianglesToRemove = (result.size() - targetIndexCount + 2) / 3;
+			auto cheaper = [](const Collapse& x, const Collapse& y) { return x.cost < y.cost; };
+			size_t sortCount = std::min(collapses.size(), trianglesToRemove * 4);
+			std::nth_element(collapses.begin(), collapses.begin() + (sortCount - 1), collapses.end(), cheaper);
+			std::sort(collapses.begin(), collapses.begin() + sortCount, cheaper);
+			collapses.resize(sortCount);
+
+			//apply the cheapest collapses whose neighbourhoods don't overlap
+			for (uint32_t v = 0; v < vertexCount; ++v) {
+				remap[v] = v;
+			}
+			std::fill(touched.begin(), touched.end(), false);
+			size_t removedTriangles = 0;
+			for (const Collapse& collapse : collapses) {
+				if (collapse.cost > maxCost || removedTriangles >= trianglesToRemove) {
+					break;
+				}
+				if (touched[collapse.from] || touched[collapse.to]) {
+					continue;
+				}
+
+				//reject collapses that flip a remaining triangle
+				std::array<float, 3> target = getPosition(collapse.to);
+				bool flipped = false;
+				size_t collapsedTriangles = 0;
+				uint32_t offset = adjacency.offsets[collapse.from];
+				for (uint32_t t = 0; t < adjacency.counts[collapse.from] && !flipped; ++t) {
+					const uint32_t* triangle = &result[adjacency.triangles[offset + t] * 3];
+					if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to) {
+						collapsedTriangles++;
+						continue;
+					}
+					std::array<float, 3> p[3], q[3];
+					for (int k = 0; k < 3; ++k) {
+						p[k] = getPosition(triangle[k]);
+						q[k] = triangle[k] == collapse.from ? target : p[k];
+					}
+					std::array<double, 3> before = triangleNormal(p[0], p[1], p[2]);
+					std::array<double, 3> after = triangleNormal(q[0], q[1], q[2]);
+					flipped = before[0] * after[0] + before[1] * after[1] + before[2] * after[2] <= 0.0;
+				}
+				if (flipped) {
+					continue;
+				}
+
+				remap[collapse.from] = collapse.to;
+				quadrics[collapse.to] += quadrics[collapse.from];
+				resultCost = std::max(resultCost, collapse.cost);
+				removedTriangles += collapsedTriangles;
+				for (uint32_t t = 0; t < adjacency.counts[collapse.from]; ++t) {
+					const uint32_t* triangle = &result[adjacency.triangles[offset + t] * 3];
+					touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = true;
+				}
+			}
+			if (removedTriangles == 0) {
+				break;
+			}
+
+			//rewrite & drop collapsed triangles
+			size_t writeCount = 0;
+			for (size_t i = 0; i < result.size(); i += 3) {
+				uint32_t a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+				if (a != b && b != c && a != c) {
+					result[writeCount++] = a;
+					result[writeCount++] = b;
+					result[writeCount++] = c;
+				}
+			}
+			result.resize(writeCount);
+		}
+
+		memcpy(dst, result.data(), result.size() * sizeof(uint32_t));
+		if (resultError) {
+			*resultError = radius > 0.0 ? static_cast<float>(std::sqrt(resultCost) / radius) : 0.f;
+		}
+		return result.size();
+	}
+
+	/*
+	* level of detail chain - every level halves the triangle count of the previous one
+	* levels are appended to indices & vertex cache optimized, the vertex buffer is shared
+	* stops early once simplification stalls (locked borders / seams) or exceeds maxError
+	*
+	* @param indices - full detail triangle list, levels are appended
+	* @param positions - first float of the position of the first vertex
+	* @param positionStride - byte stride between positions
+	* @param vertexCount - max index + 1
+	* @param maxLodCount - max number of levels including the full detail one
+	* @param maxError - max error of a single simplification step relative to the bounding sphere radius
+	*
+	* @return std::vector<Lod> - index ranges of all levels, [0] is the input
+	*/
+	std::vector<Lod> buildLodChain(std::vector<uint32_t>& indices, const float* positions, size_t positionStride,
+		size_t vertexCount, uint32_t maxLodCount, float maxError) {
+		std::vector<Lod> lods;
+		lods.push_back({ 0, static_cast<uint32_t>(indices.size()), 0.f });
+
+		std::vector<uint32_t> previous(indices);
+		std::vector<uint32_t> simplified(indices.size());
+		while (lods.size() < maxLodCount && !previous.empty()) {
+			size_t targetIndexCount = previous.size() / 6 * 3;
+			float error = 0.f;
+			size_t simplifiedCount = simplify(simplified.data(), previous.data(), previous.size(),
+				positions, positionStride, vertexCount, targetIndexCount, maxError, &error);
+			//less than 10% removed - not worth another level
+			if (simplifiedCount == 0 || simplifiedCount * 10 > previous.size() * 9) {
+				break;
+			}
+
+			previous.resize(simplifiedCount);
+			optimizeVertexCache(previous.data(), simplified.data(), simplifiedCount, vertexCount);
+			lods.push_back({ static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(simplifiedCount),
+				lods.back().error + error });
+			indices.insert(indices.end(), previous.begin(), previous.end());
+		}
+		return lods;
+	}
+
+	/*
+	* greedy meshlet partitioning - the next triangle is the live neighbour of the current meshlet
+	* that adds the fewest new vertices, a new meshlet starts at the first unused triangle in input order
+	* (run after optimizeVertexCache() - input order is already local)
+	*
+	* @param meshlets - out, vertex / triangle ranges of each meshlet
+	* @param meshletVertices - out, global vertex index of each meshlet local vertex
+	* @param meshletTriangles - out, 3 meshlet local vertex indices per triangle
+	* @param indices - triangle list
+	* @param indexCount - multiple of 3
+	* @param vertexCount - max index + 1
+	* @param maxVertices - max vertices per meshlet (3 ~ 256)
+	* @param maxTriangles - max triangles per meshlet
+	*/
+	void buildMeshlets(std::vector<Meshlet>& meshlets, std::vector<uint32_t>& meshletVertices,
+		std::vector<uint8_t>& meshletTriangles, const uint32_t* indices, size_t indexCount, size_t vertexCount,
+		size_t maxVertices, size_t maxTriangles) {
+		if (indexCount % 3 != 0) {
+			throw std::invalid_argument("meshopt::buildMeshlets(): index count must be a multiple of 3");
+		}
+		if (maxVertices < 3 || maxVertices > 256 || maxTriangles < 1) {
+			throw std::invalid_argument("meshopt::buildMeshlets(): invalid meshlet limits");
+		}
+		meshlets.clear();
+		meshletVertices.clear();
+		meshletTriangles.clear();
+		if (indexCount == 0) {
+			return;
+		}
+
+		TriangleAdjacency adjacency(indices, indexCount, vertexCount);
+		std::vector<uint32_t> liveTriangles(adjacency.counts);
+		std::vector<bool> emitted(indexCount / 3, false);
+		std::vector<uint32_t> localIndex(vertexCount, ~0u);
+		size_t scanCursor = 0;
+
+		Meshlet meshlet{};
+		auto newVertexCount = [&](size_t triangle) {
+			uint32_t count = 0;
+			for (size_t k = 0; k < 3; ++k) {
+				count += localIndex[indices[triangle * 3 + k]] == ~0u ? 1 : 0;
+			}
+			return count;
+		};
+		auto flush = [&]() {
+			for (uint32_t v = 0; v < meshlet.vertexCount; ++v) {
+				localIndex[meshletVertices[meshlet.vertexOffset + v]] = ~0u;
+			}
+			meshlets.push_back(meshlet);
+			meshlet = {};
+			meshlet.vertexOffset = static_cast<uint32_t>(meshletVertices.size());
+			meshlet.triangleOffset = static_cast<uint32_t>(meshletTriangles.size() / 3);
+		};
+
+		for (size_t emittedCount = 0; emittedCount < indexCount / 3; ++emittedCount) {
+			//best neighbour of the meshlet - vertices without live triangles are skipped
+			int64_t best = -1;
+			uint32_t bestNewVertices = 4;
+			for (uint32_t v = 0; v < meshlet.vertexCount && bestNewVertices > 0; ++v) {
+				uint32_t vertex = meshletVertices[meshlet.vertexOffset + v];
+				if (liveTriangles[vertex] == 0) {
+					continue;
+				}
+				uint32_t offset = adjacency.offsets[vertex];
+				for (uint32_t t = 0; t < adjacency.counts[vertex]; ++t) {
+					uint32_t triangle = adjacency.triangles[offset + t];
+					if (emitted[triangle]) {
+						continue;
+					}
+					uint32_t newVertices = newVertexCount(triangle);
+					if (newVertices < bestNewVertices) {
+						best = triangle;
+						bestNewVertices = newVertices;
+					}
+				}
+			}
+
+			//no neighbour or meshlet full - start a new one
+			if (best >= 0 && (meshlet.vertexCount + bestNewVertices > maxVertices || meshlet.triangleCount + 1 > maxTriangles)) {
+				flush();
+				best = -1;
+			}
+			if (best < 0) {
+				while (emitted[scanCursor]) {
+					scanCursor++;
+				}
+				best = static_cast<int64_t>(scanCursor);
+				if (meshlet.vertexCount + newVertexCount(scanCursor) > maxVertices || meshlet.triangleCount + 1 > maxTriangles) {
+					flush();
+				}
+			}
+
+			for (size_t k = 0; k < 3; ++k) {
+				uint32_t vertex = indices[best * 3 + k];
+				if (localIndex[vertex] == ~0u) {
+					localIndex[vertex] = meshlet.vertexCount++;
+					meshletVertices.push_back(vertex);
+				}
+				meshletTriangles.push_back(static_cast<uint8_t>(localIndex[vertex]));
+				liveTriangles[vertex]--;
+			}
+			meshlet.triangleCount++;
+			emitted[best] = true;
+		}
+		flush();
+	}
+
+	/*
+	* bounding sphere (bounding box center) & normal cone (averaged triangle normals) of one meshlet
+	*
+	* @param meshletVertices - first global vertex index of the meshlet
+	* @param meshletTriangles - first local index of the meshlet's triangles
+	* @param triangleCount
+	* @param positions - first float of the position of the first vertex
+	* @param positionStride - byte stride between positions
+	*
+	* @return MeshletBounds - coneCutoff is 1 (no cone culling) if normals spread over ~84 degrees or more
+	*/
+	MeshletBounds computeMeshletBounds(const uint32_t* meshletVertices, const uint8_t* meshletTriangles,
+		size_t triangleCount, const float* positions, size_t positionStride) {
+		MeshletBounds bounds{};
+		if (triangleCount == 0) {
+			return bounds;
+		}
+		auto getPosition = [&](uint8_t local) {
+			const float* p = reinterpret_cast<const float*>(
+				reinterpret_cast<const char*>(positions) + positionStride * meshletVertices[local]);
+			return std::array<float, 3>{ p[0], p[1], p[2] };
+		};
+
+		//sphere around the bounding box center
+		std::array<float, 3> boundsMin = getPosition(meshletTriangles[0]), boundsMax = boundsMin;
+		for (size_t i = 0; i < triangleCount * 3; ++i) {
+			std::array<float, 3> p = getPosition(meshletTriangles[i]);
+			for (int k = 0; k < 3; ++k) {
+				boundsMin[k] = std::min(boundsMin[k], p[k]);
+				boundsMax[k] = std::max(boundsMax[k], p[k]);
+			}
+		}
+		float radiusSquared = 0.f;
+		for (int k = 0; k < 3; ++k) {
+			bounds.center[k] = (boundsMin[k] + boundsMax[k]) * 0.5f;
+		}
+		for (size_t i = 0; i < triangleCount * 3; ++i) {
+			std::array<float, 3> p = getPosition(meshletTriangles[i]);
+			float dx = p[0] - bounds.center[0], dy = p[1] - bounds.center[1], dz = p[2] - bounds.center[2];
+			radiusSquared = std::max(radiusSquared, dx * dx + dy * dy + dz * dz);
+		}
+		bounds.radius = std::sqrt(radiusSquared);
+
+		//normal cone
+		std::vector<std::array<float, 3>> normals;
+		normals.reserve(triangleCount);
+		float axis[3] = { 0.f, 0.f, 0.f };
+		for (size_t i = 0; i < triangleCount; ++i) {
+			std::array<double, 3> n = triangleNormal(getPosition(meshletTriangles[i * 3]),
+				getPosition(meshletTriangles[i * 3 + 1]), getPosition(meshletTriangles[i * 3 + 2]));
+			double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			if (length == 0.0) {
+				continue;
+			}
+			normals.push_back({ float(n[0] / length), float(n[1] / length), float(n[2] / length) });
+			for (int k = 0; k < 3; ++k) {
+				axis[k] += normals.back()[k];
+			}
+		}
+		float axisLength = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+		if (normals.empty() || axisLength == 0.f) {
+			return bounds;
+		}
+		float minDot = 1.f;
+		for (int k = 0; k < 3; ++k) {
+			bounds.coneAxis[k] = axis[k] / axisLength;
+		}
+		for (const auto& n : normals) {
+			minDot = std::min(minDot, n[0] * bounds.coneAxis[0] + n[1] * bounds.coneAxis[1] + n[2] * bounds.coneAxis[2]);
+		}
+		//backfacing from every point of the sphere only if all normals are within 90 degrees minus the view spread
+		bounds.coneCutoff = minDot <= 0.1f ? 1.f : std::sqrt(1.f - minDot * minDot);
+		return bounds;
+	}
+
+	/*
+	* meshlets as contiguous index ranges - a meshlet ordered copy of the source range is appended to indices,
+	* so a cluster can be drawn (or compacted by a culling pass) with firstIndex / indexCount
+	* while the source range keeps its vertex cache / overdraw order
+	*
+	* @param indices - triangle lists, the copy is appended
+	* @param firstIndex - first index of the source range
+	* @param indexCount - multiple of 3
+	* @param positions - first float of the position of the first vertex
+	* @param positionStride - byte stride between positions
+	* @param vertexCount - max index + 1
+	* @param maxVertices - max vertices per meshlet
+	* @param maxTriangles - max triangles per meshlet
+	*
+	* @return std::vector<Cluster> - firstIndex relative to indices
+	*/
+	std::vector<Cluster> buildClusters(std::vector<uint32_t>& indices, size_t firstIndex, size_t indexCount,
+		const float* positions, size_t positionStride, size_t vertexCount,
+		size_t maxVertices, size_t maxTriangles) {
+		if (firstIndex + indexCount > indices.size()) {
+			throw std::invalid_argument("meshopt::buildClusters(): index range out of bounds");
+		}
+		std::vector<Meshlet> meshlets;
+		std::vector<uint32_t> meshletVertices;
+		std::vector<uint8_t> meshletTriangles;
+		buildMeshlets(meshlets, meshletVertices, meshletTriangles, indices.data() + firstIndex, indexCount, vertexCount,
+			maxVertices, maxTriangles);
+
+		std::vector<Cluster> clusters(meshlets.size());
+		indices.reserve(indices.size() + indexCount);
+		for (size_t m = 0; m < meshlets.size(); ++m) {
+			const Meshlet& meshlet = meshlets[m];
+			const uint32_t* vertices = &meshletVertices[meshlet.vertexOffset];
+			const uint8_t* triangles = &meshletTriangles[meshlet.triangleOffset * 3];
+			clusters[m].bounds = computeMeshletBounds(vertices, triangles, meshlet.triangleCount, positions, positionStride);
+			clusters[m].firstIndex = static_cast<uint32_t>(indices.size());
+			clusters[m].indexCount = meshlet.triangleCount * 3;
+			for (uint32_t i = 0; i < meshlet.triangleCount * 3; ++i) {
+				indices.push_back(vertices[triangles[i]]);
+			}
+		}
+		return clusters;
+	}
+}
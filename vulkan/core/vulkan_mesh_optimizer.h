@@ -0,0 +1,135 @@
+/*
+* reference:
+* Sander, Nehab, Barczak - Fast Triangle Reordering for Vertex Locality and Reduced Overdraw (Tipsify)
+* Garland, Heckbert - Surface Simplification Using Quadric Error Metrics
+* https://github.com/zeux/meshoptimizer
+*/
+#pragma once
+#include <cstddef>
+#include <vector>
+#include <cstdint>
+
+/*
+* index / vertex reordering for triangle lists - run once at load time
+* 1. optimizeVertexCache() - post-transform vertex cache locality
+* 2. optimizeOverdraw() - reorder cache friendly clusters so likely occluders are drawn first
+* 3. optimizeVertexFetch() - vertices in first use order (pre-transform cache / memory locality)
+* 4. buildLodChain() - simplified index buffers sharing the vertex buffer of the full detail mesh
+* 5. buildClusters() - meshlets with bounding sphere & normal cone for cluster culling, appended after the levels
+* cpu only - no vulkan dependency
+*/
+namespace meshopt {
+	/** simulated FIFO cache size - close to the vertex reuse window of current desktop GPUs */
+	constexpr uint32_t DEFAULT_CACHE_SIZE = 16;
+
+	/** vertex cache simulation result - counters are additive over several meshes */
+	struct CacheStatistics {
+		/** vertex shader invocations */
+		size_t transformCount = 0;
+		size_t triangleCount = 0;
+		/** referenced vertices */
+		size_t vertexCount = 0;
+
+		/** @brief average cache miss ratio - transformed vertices per triangle (0.5 ~ 3.0) */
+		float acmr() const { return triangleCount ? float(transformCount) / triangleCount : 0.f; }
+		/** @brief average transform to vertex ratio - 1.0 is optimal */
+		float atvr() const { return vertexCount ? float(transformCount) / vertexCount : 0.f; }
+		CacheStatistics& operator+=(const CacheStatistics& other);
+	};
+
+	/** level of detail - index range inside an index buffer shared by all levels */
+	struct Lod {
+		uint32_t firstIndex = 0;
+		uint32_t indexCount = 0;
+		/** geometric error relative to the bounding sphere radius (half diagonal of the bounding box) */
+		float error = 0.f;
+	};
+
+	/** meshlet limits - 64 vertices / 124 triangles fit the mesh shader output limits of current GPUs */
+	constexpr size_t MESHLET_MAX_VERTICES = 64;
+	constexpr size_t MESHLET_MAX_TRIANGLES = 124;
+
+	/** meshlet - ranges in the meshlet vertex / triangle arrays */
+	struct Meshlet {
+		uint32_t vertexOffset = 0;
+		uint32_t triangleOffset = 0;
+		uint32_t vertexCount = 0;
+		uint32_t triangleCount = 0;
+	};
+
+	/*
+	* culling bounds of a meshlet
+	* cluster is invisible if the bounding sphere is outside the frustum or, for the normal cone,
+	* dot(center - cameraPos, coneAxis) >= coneCutoff * length(center - cameraPos) + radius
+	*/
+	struct MeshletBounds {
+		float center[3] = { 0.f, 0.f, 0.f };
+		float radius = 0.f;
+		float coneAxis[3] = { 0.f, 0.f, 0.f };
+		/** sin of the cone half angle - 1 disables cone culling */
+		float coneCutoff = 1.f;
+	};
+
+	/** meshlet as a contiguous index range + bounds - std430 layout, 48 bytes */
+	struct Cluster {
+		MeshletBounds bounds;
+		uint32_t firstIndex = 0;
+		uint32_t indexCount = 0;
+		uint32_t padding[2] = { 0, 0 };
+	};
+
+	/** @brief simulate a FIFO post-transform cache */
+	CacheStatistics analyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount,
+		uint32_t cacheSize = DEFAULT_CACHE_SIZE);
+	/** @brief Tipsify triangle reordering, returns first index of each cache-flushing cluster */
+	std::vector<uint32_t> optimizeVertexCache(uint32_t* dst, const uint32_t* indices, size_t indexCount,
+		size_t vertexCount, uint32_t cacheSize = DEFAULT_CACHE_SIZE);
+	/** @brief split clusters while ACMR stays below threshold and sort them front to back from the outside */
+	void optimizeOverdraw(uint32_t* dst, const uint32_t* indices, size_t indexCount,
+		const float* positions, size_t positionStride, size_t vertexCount,
+		const std::vector<uint32_t>& clusters, float threshold = 1.05f, uint32_t cacheSize = DEFAULT_CACHE_SIZE);
+	/** @brief build remap table in first use order & rewrite indices, returns referenced vertex count */
+	size_t optimizeVertexFetchRemap(std::vector<uint32_t>& remap, uint32_t* indices, size_t indexCount,
+		size_t vertexCount);
+	/** @brief reorder an interleaved vertex buffer in first use order, returns referenced vertex count */
+	size_t optimizeVertexFetch(void* vertices, uint32_t* indices, size_t indexCount, size_t vertexCount,
+		size_t vertexSize);
+
+	/** @brief quadric error edge collapse towards targetIndexCount, returns the simplified index count */
+	size_t simplify(uint32_t* dst, const uint32_t* indices, size_t indexCount,
+		const float* positions, size_t positionStride, size_t vertexCount,
+		size_t targetIndexCount, float targetError, float* resultError = nullptr);
+	/** @brief append simplified levels (each half of the previous) to indices, returns all levels incl. the input */
+	std::vector<Lod> buildLodChain(std::vector<uint32_t>& indices, const float* positions, size_t positionStride,
+		size_t vertexCount, uint32_t maxLodCount, float maxError = 0.25f);
+
+	/** @brief partition a triangle list into meshlets, triangles grow from shared vertices */
+	void buildMeshlets(std::vector<Meshlet>& meshlets, std::vector<uint32_t>& meshletVertices,
+		std::vector<uint8_t>& meshletTriangles, const uint32_t* indices, size_t indexCount, size_t vertexCount,
+		size_t maxVertices = MESHLET_MAX_VERTICES, size_t maxTriangles = MESHLET_MAX_TRIANGLES);
+	/** @brief bounding sphere & normal cone of one meshlet */
+	MeshletBounds computeMeshletBounds(const uint32_t* meshletVertices, const uint8_t* meshletTriangles,
+		size_t triangleCount, const float* positions, size_t positionStride);
+	/** @brief append a meshlet ordered copy of an index range & return each meshlet as a range of the copy with bounds */
+	std::vector<Cluster> buildClusters(std::vector<uint32_t>& indices, size_t firstIndex, size_t indexCount,
+		const float* positions, size_t positionStride, size_t vertexCount,
+		size_t maxVertices = MESHLET_MAX_VERTICES, size_t maxTriangles = MESHLET_MAX_TRIANGLES);
+
+	/*
+	* reorder one vertex stream with a remap table from optimizeVertexFetchRemap()
+	*
+	* @param stream - vertex attribute stream, resized to newVertexCount
+	* @param remap - old index -> new index (~0u for unused vertices)
+	* @param newVertexCount - referenced vertex count
+	*/
+	template<typename T>
+	void remapVertexStream(std::vector<T>& stream, const std::vector<uint32_t>& remap, size_t newVertexCount) {
+		std::vector<T> remapped(newVertexCount);
+		for (size_t i = 0; i < remap.size(); ++i) {
+			if (remap[i] != ~0u) {
+				remapped[remap[i]] = stream[i];
+			}
+		}
+		stream.swap(remapped);
+	}
+}
@@ -0,0 +1,402 @@
+/*
+* reference:
+* https://github.com/tinyobjloader/tinyobjloader (float parsing & face handling are kept identical)
+*/
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include "vulkan_obj_parser.h"
+#include "vulkan_mesh_cache.h"
+
+namespace {
+	/** smallest chunk worth a worker thread */
+	constexpr size_t MIN_CHUNK_SIZE = 1 << 20;
+
+	/** relative (negative) face index - resolved once the element counts of previous chunks are known */
+	struct RelativeIndex {
+		size_t corner;
+		uint32_t fieldMask; //1 - vertex, 2 - normal, 4 - texcoord
+	};
+
+	/** result of one line aligned chunk */
+	struct Chunk {
+		const char* begin = nullptr;
+		const char* end = nullptr;
+		std::vector<float> positions, normals, texcoords;
+		std::vector<tinyobj::index_t> indices;
+		std::vector<RelativeIndex> relativeIndices;
+		bool hasMaterial = false;
+	};
+
+	inline bool isSpace(char c) { return c == ' ' || c == '\t'; }
+	inline bool isDigit(char c) { return static_cast<unsigned int>(c - '0') < 10u; }
+
+	/*
+	* tinyobj tryParseDouble() - bounded by s_end instead of a terminating character
+	*/
+	bool tryParseDouble(const char* s, const char* s_end, double* result) {
+		if (s >= s_end) {
+			return false;
+		}
+		double mantissa = 0.0;
+		int exponent = 0;
+		char sign = '+';
+		char exp_sign = '+';
+		const char* curr = s;
+		int read = 0;
+		bool end_not_reached = false;
+
+		if (*curr == '+' || *curr == '-') {
+			sign = *curr;
+			curr++;
+		}
+		else if (!isDigit(*curr)) {
+			return false;
+		}
+
+		//integer part
+		end_not_reached = (curr != s_end);
+		while (end_not_reached && isDigit(*curr)) {
+			mantissa *= 10;
+			mantissa += static_cast<int>(*curr - 0x30);
+			curr++;
+			read++;
+			end_not_reached = (curr != s_end);
+		}
+		if (read == 0) {
+			return false;
+		}
+
+		if (end_not_reached) {
+			bool hasExponent = false;
+			//decimal part
+			if (*curr == '.') {
+				curr++;
+				read = 1;
+				end_not_reached = (curr != s_end);
+				while (end_not_reached && isDigit(*curr)) {
+					static const double pow_lut[] = {
+						1.0, 0.1, 0.01, 0.001, 0.0001, 0.00001, 0.000001, 0.0000001,
+					};
+					const int lut_entries = sizeof pow_lut / sizeof pow_lut[0];
+					mantissa += static_cast<int>(*curr - 0x30) *
+						(read < lut_entries ? pow_lut[read] : std::pow(10.0, -read));
+					read++;
+					curr++;
+					end_not_reached = (curr != s_end);
+				}
+				hasExponent = end_not_reached;
+			}
+			else if (*curr == 'e' || *curr == 'E') {
+				hasExponent = true;
+			}
+
+			//exponent part
+			if (hasExponent && (*curr == 'e' || *curr == 'E')) {
+				curr++;
+				end_not_reached = (curr != s_end);
+				if (end_not_reached && (*curr == '+' || *curr == '-')) {
+					exp_sign = *curr;
+					curr++;
+				}
+				else if (!end_not_reached || !isDigit(*curr)) {
+					return false;
+				}
+				read = 0;
+				end_not_reached = (curr != s_end);
+				while (end_not_reached && isDigit(*curr)) {
+					exponent *= 10;
+					exponent += static_cast<int>(*curr - 0x30);
+					curr++;
+					read++;
+					end_not_reached = (curr != s_end);
+				}
+				exponent *= (exp_sign == '+' ? 1 : -1);
+				if (read == 0) {
+					return false;
+				}
+			}
+		}
+
+		*result = (sign == '+' ? 1 : -1) *
+			(exponent ? std::ldexp(mantissa * std::pow(5.0, exponent), exponent) : mantissa);
+		return true;
+	}
+
+	/*
+	* tinyobj parseReal()
+	*/
+	float parseReal(const char*& token, const char* lineEnd, double defaultValue) {
+		while (token < lineEnd && isSpace(*token)) {
+			++token;
+		}
+		const char* end = token;
+		while (end < lineEnd && *end != ' ' && *end != '\t' && *end != '\r') {
+			++end;
+		}
+		double value = defaultValue;
+		tryParseDouble(token, end, &value);
+		token = end;
+		return static_cast<float>(value);
+	}
+
+	/*
+	* atoi() bounded by the line end
+	*/
+	int parseInt(const char* token, const char* lineEnd) {
+		while (token < lineEnd && (*token == ' ' || (*token >= '\t' && *token <= '\r'))) {
+			++token;
+		}
+		bool negative = false;
+		if (token < lineEnd && (*token == '+' || *token == '-')) {
+			negative = *token == '-';
+			++token;
+		}
+		long long value = 0;
+		while (token < lineEnd && isDigit(*token)) {
+			value = value * 10 + (*token - '0');
+			++token;
+		}
+		return static_cast<int>(negative ? -value : value);
+	}
+
+	/*
+	* strcspn(token, "/ \t\r") bounded by the line end
+	*/
+	const char* skipIndex(const char* token, const char* lineEnd) {
+		while (token < lineEnd && *token != '/' && *token != ' ' && *token != '\t' && *token != '\r') {
+			++token;
+		}
+		return token;
+	}
+
+	/*
+	* tinyobj fixIndex() - relative indices only know the chunk local element count
+	*/
+	int fixIndex(int index, int localCount, bool& relative) {
+		relative = index < 0;
+		if (index > 0) {
+			return index - 1;
+		}
+		if (index == 0) {
+			return 0;
+		}
+		return localCount + index;
+	}
+
+	/*
+	* parse a line aligned range of the file
+	*/
+	void parseChunk(Chunk& chunk) {
+		std::vector<tinyobj::index_t> face;
+		std::vector<uint32_t> faceMasks;
+		const char* current = chunk.begin;
+		while (current < chunk.end) {
+			//line - tinyobj safeGetline() ends lines with \n, \r or \r\n, an embedded \0 ends the content
+			const char* lineBegin = current;
+			const char* lineEnd = current;
+			while (lineEnd < chunk.end && *lineEnd != '\n' && *lineEnd != '\r') {
+				++lineEnd;
+			}
+			current = lineEnd + 1;
+			for (const char* c = lineBegin; c < lineEnd; ++c) {
+				if (*c == '\0') {
+					lineEnd = c;
+					break;
+				}
+			}
+
+			const char* token = lineBegin;
+			while (token < lineEnd && isSpace(*token)) {
+				++token;
+			}
+			if (lineEnd - token < 2) {
+				continue;
+			}
+
+			//vertex
+			if (token[0] == 'v' && isSpace(token[1])) {
+				token += 2;
+				chunk.positions.push_back(parseReal(token, lineEnd, 0.0));
+				chunk.positions.push_back(parseReal(token, lineEnd, 0.0));
+				chunk.positions.push_back(parseReal(token, lineEnd, 0.0));
+				continue;
+			}
+			if (lineEnd - token < 3) {
+				continue;
+			}
+			//normal
+			if (token[0] == 'v' && token[1] == 'n' && isSpace(token[2])) {
+				token += 3;
+				chunk.normals.push_back(parseReal(token, lineEnd, 0.0));
+				chunk.normals.push_back(parseReal(token, lineEnd, 0.0));
+				chunk.normals.push_back(parseReal(token, lineEnd, 0.0));
+				continue;
+			}
+			//texcoord
+			if (token[0] == 'v' && token[1] == 't' && isSpace(token[2])) {
+				token += 3;
+				chunk.texcoords.push_back(parseReal(token, lineEnd, 0.0));
+				chunk.texcoords.push_back(parseReal(token, lineEnd, 0.0));
+				continue;
+			}
+			//material change - tinyobj regroups faces, leave the file to it
+			if (lineEnd - token >= 7 && strncmp(token, "usemtl", 6) == 0 && isSpace(token[6])) {
+				chunk.hasMaterial = true;
+				return;
+			}
+			//face - tinyobj parseTriple()
+			if (token[0] == 'f' && isSpace(token[1])) {
+				token += 2;
+				while (token < lineEnd && isSpace(*token)) {
+					++token;
+				}
+				int positionCount = static_cast<int>(chunk.positions.size() / 3);
+				int normalCount = static_cast<int>(chunk.normals.size() / 3);
+				int texcoordCount = static_cast<int>(chunk.texcoords.size() / 2);
+				face.clear();
+				faceMasks.clear();
+				while (token < lineEnd && *token != '\r') {
+					tinyobj::index_t index{ -1, -1, -1 };
+					uint32_t mask = 0;
+					bool relative = false;
+					index.vertex_index = fixIndex(parseInt(token, lineEnd), positionCount, relative);
+					mask |= relative ? 1 : 0;
+					token = skipIndex(token, lineEnd);
+					if (token < lineEnd && *token == '/') {
+						token++;
+						if (token < lineEnd && *token == '/') {
+							//i//k
+							token++;
+							index.normal_index = fixIndex(parseInt(token, lineEnd), normalCount, relative);
+							mask |= relative ? 2 : 0;
+							token = skipIndex(token, lineEnd);
+						}
+						else {
+							//i/j/k or i/j
+							index.texcoord_index = fixIndex(parseInt(token, lineEnd), texcoordCount, relative);
+							mask |= relative ? 4 : 0;
+							token = skipIndex(token, lineEnd);
+							if (token < lineEnd && *token == '/') {
+								token++;
+								index.normal_index = fixIndex(parseInt(token, lineEnd), normalCount, relative);
+								mask |= relative ? 2 : 0;
+								token = skipIndex(token, lineEnd);
+							}
+						}
+					}
+					face.push_back(index);
+					faceMasks.push_back(mask);
+					while (token < lineEnd && (isSpace(*token) || *token == '\r')) {
+						++token;
+					}
+				}
+
+				//polygon -> triangle fan
+				for (size_t k = 2; k < face.size(); ++k) {
+					size_t corners[3] = { 0, k - 1, k };
+					for (size_t corner : corners) {
+						if (faceMasks[corner] != 0) {
+							chunk.relativeIndices.push_back({ chunk.indices.size(), faceMasks[corner] });
+						}
+						chunk.indices.push_back(face[corner]);
+					}
+				}
+			}
+		}
+	}
+}
+
+namespace objparser {
+	/*
+	* parse v / vn / vt / f records on worker threads
+	*
+	* @param path - path to the obj file
+	* @param attrib - out, positions / normals / texcoords
+	* @param indices - out, triangulated face corners of all shapes in file order
+	* @param threadCount - worker count, 0 for hardware concurrency
+	*
+	* @return bool - false if the file can't be mapped or uses materials (tinyobj::LoadObj() has to be used)
+	*/
+	bool load(const std::string& path, tinyobj::attrib_t& attrib, std::vector<tinyobj::index_t>& indices,
+		uint32_t threadCount) {
+		MappedFile file;
+		if (!file.open(path)) {
+			return false;
+		}
+
+		if (threadCount == 0) {
+			threadCount = std::max(1u, std::thread::hardware_concurrency());
+		}
+		size_t chunkCount = std::min<size_t>(threadCount, file.size() / MIN_CHUNK_SIZE + 1);
+
+		//line aligned chunks
+		std::vector<Chunk> chunks(chunkCount);
+		const char* fileEnd = file.data() + file.size();
+		const char* begin = file.data();
+		for (size_t i = 0; i < chunkCount; ++i) {
+			const char* end = (i + 1 == chunkCount) ? fileEnd : file.data() + file.size() / chunkCount * (i + 1);
+			end = std::max(end, begin);
+			while (end < fileEnd && *end != '\n' && *end != '\r') {
+				++end;
+			}
+			chunks[i].begin = begin;
+			chunks[i].end = end;
+			begin = end;
+		}
+
+		auto runParallel = [&](auto&& function) {
+			std::vector<std::thread> workers;
+			for (size_t i = 1; i < chunkCount; ++i) {
+				workers.emplace_back(function, i);
+			}
+			function(0);
+			for (auto& worker : workers) {
+				worker.join();
+			}
+		};
+		runParallel([&](size_t i) { parseChunk(chunks[i]); });
+		for (const Chunk& chunk : chunks) {
+			if (chunk.hasMaterial) {
+				return false;
+			}
+		}
+
+		//prefix sums
+		std::vector<size_t> positionOffsets(chunkCount + 1, 0), normalOffsets(chunkCount + 1, 0);
+		std::vector<size_t> texcoordOffsets(chunkCount + 1, 0), indexOffsets(chunkCount + 1, 0);
+		for (size_t i = 0; i < chunkCount; ++i) {
+			positionOffsets[i + 1] = positionOffsets[i] + chunks[i].positions.size();
+			normalOffsets[i + 1] = normalOffsets[i] + chunks[i].normals.size();
+			texcoordOffsets[i + 1] = texcoordOffsets[i] + chunks[i].texcoords.size();
+			indexOffsets[i + 1] = indexOffsets[i] + chunks[i].indices.size();
+		}
+		attrib.vertices.resize(positionOffsets[chunkCount]);
+		attrib.normals.resize(normalOffsets[chunkCount]);
+		attrib.texcoords.resize(texcoordOffsets[chunkCount]);
+		indices.resize(indexOffsets[chunkCount]);
+
+		//merge
+		runParallel([&](size_t i) {
+			Chunk& chunk = chunks[i];
+			std::copy(chunk.positions.begin(), chunk.positions.end(), attrib.vertices.begin() + positionOffsets[i]);
+			std::copy(chunk.normals.begin(), chunk.normals.end(), attrib.normals.begin() + normalOffsets[i]);
+			std::copy(chunk.texcoords.begin(), chunk.texcoords.end(), attrib.texcoords.begin() + texcoordOffsets[i]);
+			for (const RelativeIndex& relative : chunk.relativeIndices) {
+				tinyobj::index_t& index = chunk.indices[relative.corner];
+				if (relative.fieldMask & 1) {
+					index.vertex_index += static_cast<int>(positionOffsets[i] / 3);
+				}
+				if (relative.fieldMask & 2) {
+					index.normal_index += static_cast<int>(normalOffsets[i] / 3);
+				}
+				if (relative.fieldMask & 4) {
+					index.texcoord_index += static_cast<int>(texcoordOffsets[i] / 2);
+				}
+			}
+			std::copy(chunk.indices.begin(), chunk.indices.end(), indices.begin() + indexOffsets[i]);
+		});
+		return true;
+	}
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <tiny_obj_loader.h>
+
+/*
+* parallel obj front end - v / vn / vt / f records only
+* the file is split into line aligned chunks parsed on worker threads, then merged with prefix sums
+* output matches tinyobj::LoadObj() bit for bit (same float parsing, fan triangulation & index fixing)
+*/
+namespace objparser {
+	/** @brief parse positions / normals / texcoords & triangulated face corners in file order */
+	bool load(const std::string& path, tinyobj::attrib_t& attrib, std::vector<tinyobj::index_t>& indices,
+		uint32_t threadCount = 0);
+}
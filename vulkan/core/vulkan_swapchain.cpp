@@ -15,7 +15,7 @@ void VulkanSwapchain::cleanup() {
 /*
 * get device handle from app
 */
-void VulkanSwapchain::init(const VulkanDevice* devices, GLFWwindow* window) {
+void VulkanSwapchain::init(VulkanDevice* devices, GLFWwindow* window) {
 	this->devices = devices;
 	this->window = window;
 }
@@ -132,12 +132,15 @@ void VulkanSwapchain::create() {
 	VK_CHECK_RESULT(vkCreateSwapchainKHR(devices->device, &swapchainInfo, nullptr, &swapchain));
 	LOG("created:\tswapchain");
 
-	//delete old swapchain & image views
+	//delete old swapchain & image views once frames rendering to them are finished
 	if (oldSwapchain != VK_NULL_HANDLE) {
-		for (auto& imageView : imageViews) {
-			vkDestroyImageView(devices->device, imageView, nullptr);
-		}
-		vkDestroySwapchainKHR(devices->device, oldSwapchain, nullptr);
+		devices->timelineSync.destroyLater(TimelineSync::GRAPHICS,
+			[device = devices->device, oldSwapchain, oldImageViews = imageViews]() {
+				for (VkImageView imageView : oldImageViews) {
+					vkDestroyImageView(device, imageView, nullptr);
+				}
+				vkDestroySwapchainKHR(device, oldSwapchain, nullptr);
+			});
 	}
 
 	//get swapchain images
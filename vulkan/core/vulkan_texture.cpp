@@ -12,7 +12,7 @@ void TextureBase::cleanup() {
 	}
 	vkDestroySampler(devices->device, descriptor.sampler, nullptr);
 	vkDestroyImageView(devices->device, descriptor.imageView, nullptr);
-	devices->memoryAllocator.freeImageMemory(image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	devices->memoryAllocator.freeImageMemory(image);
 	vkDestroyImage(devices->device, image, nullptr);
 }
 
@@ -72,6 +72,23 @@ void Texture2D::loadHDR(VulkanDevice* devices, const std::string& path, VkSample
 */
 void Texture2D::load(VulkanDevice* devices, void* data,
 	uint32_t texWidth, uint32_t texHeight, VkDeviceSize imageSize, VkFormat format,
+	VkFilter filter, VkSamplerAddressMode mode) {
+	create(devices, texWidth, texHeight, format, filter, mode);
+	devices->uploadManager.uploadImage(image, data, { texWidth, texHeight, 1 }, format, imageSize, mipLevels, 1, filter);
+	devices->uploadManager.submit();
+}
+
+/*
+* create empty image with a full mip chain & imageView & sampler - contents are staged with UploadManager::stageImage()
+*
+* @param devices - abstracted vulkan device handle
+* @param texWidth
+* @param texHeight
+* @param format - image format
+* @param filter - sampler & mipmap generation filter
+* @param mode - sampler address mode
+*/
+void Texture2D::create(VulkanDevice* devices, uint32_t texWidth, uint32_t texHeight, VkFormat format,
 	VkFilter filter, VkSamplerAddressMode mode) {
 	//image creation
 	this->devices = devices;
@@ -96,53 +113,6 @@ void Texture2D::load(VulkanDevice* devices, void* data,
 	descriptor.imageView = vktools::createImageView(devices->device, image,
 		VK_IMAGE_VIEW_TYPE_2D, format, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels);
 
-	/*
-	* staging - create staging buffer
-	*/
-	VkBuffer stagingBuffer;
-	VkBufferCreateInfo stagingBufferCreateInfo = vktools::initializers::bufferCreateInfo(
-		imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
-	VK_CHECK_RESULT(vkCreateBuffer(devices->device, &stagingBufferCreateInfo, nullptr, &stagingBuffer));
-
-	VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-	MemoryAllocator::HostVisibleMemory hostVisibleMemory = devices->memoryAllocator.allocateBufferMemory(
-		stagingBuffer, properties);
-	hostVisibleMemory.mapData(devices->device, data);
-
-	/*
-	* undefined -> transfer dst optimal
-	*/
-	VkCommandBuffer cmdBuf = devices->beginCommandBuffer();
-	vktools::setImageLayout(cmdBuf,
-		image,
-		VK_IMAGE_LAYOUT_UNDEFINED,
-		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-		{ VK_IMAGE_ASPECT_COLOR_BIT, 0, mipLevels, 0, 1 });
-
-	/*
-	* image copy from staging buffer
-	*/
-	VkBufferImageCopy copy = vktools::initializers::bufferCopyRegion({ texWidth, texHeight, 1 });
-	vkCmdCopyBufferToImage(cmdBuf,
-		stagingBuffer,
-		image,
-		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-		1,
-		&copy
-	);
-	
-	/*
-	* generate mipmaps
-	*/
-	vktools::generateMipmaps(cmdBuf, devices->physicalDevice, image, format, texWidth, texHeight, mipLevels, filter);
-	devices->endCommandBuffer(cmdBuf);
-
-	/*
-	* cleanup 
-	*/
-	devices->memoryAllocator.freeBufferMemory(stagingBuffer, properties);
-	vkDestroyBuffer(devices->device, stagingBuffer, nullptr);
-
 	/*
 	* create sampler
 	*/
@@ -203,61 +173,23 @@ void TextureCube::load(VulkanDevice* devices, const std::string& path, VkSampler
 	VK_CHECK_RESULT(vkCreateImage(devices->device, &imageInfo, nullptr, &image));
 	devices->memoryAllocator.allocateImageMemory(image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-	//staging
-	VkBuffer stagingBuffer;
-	VkBufferCreateInfo stagingBufferCreateInfo = vktools::initializers::bufferCreateInfo(
-		imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
-	VK_CHECK_RESULT(vkCreateBuffer(devices->device, &stagingBufferCreateInfo, nullptr, &stagingBuffer));
-
-	VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-	MemoryAllocator::HostVisibleMemory hostVisibleMemory = devices->memoryAllocator.allocateBufferMemory(
-		stagingBuffer, properties);
-
-	//map memory
-	unsigned char* data = reinterpret_cast<unsigned char*>(hostVisibleMemory.getHandle(devices->device));
+	//faces are packed layer after layer & copied through the staging ring in pieces - faces may exceed the ring together
+	std::vector<unsigned char> data(static_cast<size_t>(imageSize));
 	for (int i = 0; i < 6; ++i) {
-		memcpy(data, pixelData[i], layerSize);
+		memcpy(data.data() + i * layerSize, pixelData[i], layerSize);
 		stbi_image_free(pixelData[i]);
-		data += layerSize;
 	}
-	hostVisibleMemory.unmap(devices->device);
-
+	devices->uploadManager.uploadImage(image, data.data(),
+		{ static_cast<uint32_t>(width), static_cast<uint32_t>(height), 1 }, VK_FORMAT_R8G8B8A8_UNORM, imageSize, mipLevels, 6);
+	devices->uploadManager.submit();
+	descriptor.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
-	//set image layout & data copy
-	VkCommandBuffer cmdBuf = devices->beginCommandBuffer();
 	VkImageSubresourceRange subresourceRange{};
 	subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 	subresourceRange.baseMipLevel = 0;
 	subresourceRange.levelCount = mipLevels;
 	subresourceRange.baseArrayLayer = 0;
 	subresourceRange.layerCount = 6;
-	
-	vktools::setImageLayout(cmdBuf,
-		image,
-		VK_IMAGE_LAYOUT_UNDEFINED,
-		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-		subresourceRange);
-
-	VkBufferImageCopy copy = vktools::initializers::bufferCopyRegion(
-		{ static_cast<VkDeviceSize>(width), static_cast<VkDeviceSize>(height), 1 });
-	copy.imageSubresource.layerCount = 6;
-
-	vkCmdCopyBufferToImage(cmdBuf,
-		stagingBuffer,
-		image,
-		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-		1,
-		&copy);
-
-	descriptor.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-
-	vktools::setImageLayout(cmdBuf,
-		image,
-		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-		descriptor.imageLayout,
-		subresourceRange);
-
-	devices->endCommandBuffer(cmdBuf);
 
 	//create image view
 	VkImageViewCreateInfo imageViewInfo = vktools::initializers::imageViewCreateInfo(
@@ -269,7 +201,4 @@ void TextureCube::load(VulkanDevice* devices, const std::string& path, VkSampler
 		vktools::initializers::samplerCreateInfo(devices->availableFeatures, devices->properties, VK_FILTER_LINEAR, mode);
 	samplerInfo.compareOp = VK_COMPARE_OP_NEVER;
 	VK_CHECK_RESULT(vkCreateSampler(devices->device, &samplerInfo, nullptr, &descriptor.sampler));
-
-	devices->memoryAllocator.freeBufferMemory(stagingBuffer, properties);
-	vkDestroyBuffer(devices->device, stagingBuffer, nullptr);
 }
@@ -37,6 +37,9 @@ public:
 	void load(VulkanDevice* devices, void* data,
 		uint32_t texWidth, uint32_t texHeight, VkDeviceSize imageSize, VkFormat format,
 		VkFilter filter = VK_FILTER_LINEAR, VkSamplerAddressMode mode = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
+	/** @brief create image (full mip chain) & imageView & sampler without contents */
+	void create(VulkanDevice* devices, uint32_t texWidth, uint32_t texHeight, VkFormat format,
+		VkFilter filter = VK_FILTER_LINEAR, VkSamplerAddressMode mode = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
 
 };
 
@@ -0,0 +1,235 @@
+#include <algorithm>
+#include "vulkan_timeline_sync.h"
+
+/*
+* create one timeline semaphore per unique queue
+*
+* @param device - logical device created with timelineSemaphore enabled
+* @param graphicsQueue
+* @param computeQueue - may be the graphics queue
+* @param transferQueue - may be the graphics queue
+*/
+void TimelineSync::init(VkDevice device, VkQueue graphicsQueue, VkQueue computeQueue, VkQueue transferQueue) {
+	this->device = device;
+	VkSemaphoreTypeCreateInfo typeInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO };
+	typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	typeInfo.initialValue = 0;
+	VkSemaphoreCreateInfo semaphoreInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
+	semaphoreInfo.pNext = &typeInfo;
+
+	VkQueue queues[QUEUE_COUNT] = { graphicsQueue, computeQueue, transferQueue };
+	for (uint32_t i = 0; i < QUEUE_COUNT; ++i) {
+		auto it = std::find_if(timelines.begin(), timelines.end(),
+			[&](const Timeline& timeline) { return timeline.queue == queues[i]; });
+		if (it != timelines.end()) {
+			timelineIndices[i] = static_cast<uint32_t>(it - timelines.begin());
+			continue;
+		}
+		Timeline timeline{};
+		timeline.queue = queues[i];
+		VK_CHECK_RESULT(vkCreateSemaphore(device, &semaphoreInfo, nullptr, &timeline.semaphore));
+		timelineIndices[i] = static_cast<uint32_t>(timelines.size());
+		timelines.push_back(timeline);
+	}
+	LOG("created:\ttimeline semaphores (" + std::to_string(timelines.size()) + " queues)");
+}
+
+/*
+* wait for everything submitted, run pending deletions & destroy semaphores
+*/
+void TimelineSync::cleanup() {
+	if (device == VK_NULL_HANDLE) {
+		return;
+	}
+	for (const Timeline& timeline : timelines) {
+		VkSemaphoreWaitInfo waitInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO };
+		waitInfo.semaphoreCount = 1;
+		waitInfo.pSemaphores = &timeline.semaphore;
+		waitInfo.pValues = &timeline.submittedValue;
+		VK_CHECK_RESULT(vkWaitSemaphores(device, &waitInfo, UINT64_MAX));
+	}
+	for (Timeline& timeline : timelines) {
+		vkDestroySemaphore(device, timeline.semaphore, nullptr);
+	}
+	timelines.clear();
+	device = VK_NULL_HANDLE;
+
+	//after the reset - destroy functions deferring more deletions run them immediately
+	std::vector<Deletion> pending = std::move(deletions);
+	deletions.clear();
+	for (Deletion& deletion : pending) {
+		deletion.destroy();
+	}
+}
+
+/*
+* submit to the queue - the queue's timeline is signaled with the next value after the command buffers
+*
+* @param queue - queue to submit to
+* @param commandBuffers - may be empty (wait / signal only)
+* @param waits - binary semaphores (swapchain) or timeline values of any queue
+* @param binarySignals - binary semaphores signaled with the timeline (presentation)
+*
+* @return uint64_t - signaled value, wait for it with wait() or makeWait()
+*/
+uint64_t TimelineSync::submit(Queue queue, const std::vector<VkCommandBuffer>& commandBuffers,
+	const std::vector<Wait>& waits, const std::vector<VkSemaphore>& binarySignals) {
+	std::vector<VkSemaphore> waitSemaphores;
+	std::vector<uint64_t> waitValues;
+	std::vector<VkPipelineStageFlags> waitStages;
+	for (const Wait& wait : waits) {
+		waitSemaphores.push_back(wait.semaphore);
+		waitValues.push_back(wait.value);
+		waitStages.push_back(wait.stageMask);
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	Timeline& timeline = timelines[timelineIndices[queue]];
+	uint64_t value = timeline.submittedValue + 1;
+
+	//timeline last, binary signal values are ignored
+	std::vector<VkSemaphore> signalSemaphores(binarySignals);
+	signalSemaphores.push_back(timeline.semaphore);
+	std::vector<uint64_t> signalValues(signalSemaphores.size(), 0);
+	signalValues.back() = value;
+
+	VkTimelineSemaphoreSubmitInfo timelineInfo{ VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO };
+	timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+	timelineInfo.pWaitSemaphoreValues = waitValues.data();
+	timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+	timelineInfo.pSignalSemaphoreValues = signalValues.data();
+
+	VkSubmitInfo submitInfo{ VK_STRUCTURE_TYPE_SUBMIT_INFO };
+	submitInfo.pNext = &timelineInfo;
+	submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+	submitInfo.pWaitSemaphores = waitSemaphores.data();
+	submitInfo.pWaitDstStageMask = waitStages.data();
+	submitInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+	submitInfo.pCommandBuffers = commandBuffers.data();
+	submitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+	submitInfo.pSignalSemaphores = signalSemaphores.data();
+	VK_CHECK_RESULT(vkQueueSubmit(timeline.queue, 1, &submitInfo, VK_NULL_HANDLE));
+
+	timeline.submittedValue = value;
+	return value;
+}
+
+/*
+* make a wait on the queue's timeline for another submission
+*
+* @param queue - queue whose work is waited for
+* @param value - returned by submit() / getSubmittedValue()
+* @param stageMask - stages of the waiting submission which wait
+*
+* @return Wait - passed to submit()
+*/
+TimelineSync::Wait TimelineSync::makeWait(Queue queue, uint64_t value, VkPipelineStageFlags stageMask) const {
+	return { timelines[timelineIndices[queue]].semaphore, value, stageMask };
+}
+
+/*
+* last signaled value of the queue
+*
+* @param queue - queue to check
+*
+* @return uint64_t - 0 if nothing was submitted
+*/
+uint64_t TimelineSync::getSubmittedValue(Queue queue) const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return timelines[timelineIndices[queue]].submittedValue;
+}
+
+/*
+* counter value of the queue's timeline
+*
+* @param queue - queue to check
+*
+* @return uint64_t - every submission with a value up to this is finished
+*/
+uint64_t TimelineSync::getCompletedValue(Queue queue) const {
+	uint64_t value = 0;
+	VK_CHECK_RESULT(vkGetSemaphoreCounterValue(device, timelines[timelineIndices[queue]].semaphore, &value));
+	return value;
+}
+
+/*
+* block until the queue reached the value
+*
+* @param queue - queue to wait for
+* @param value - returned by submit(), 0 returns immediately
+*/
+void TimelineSync::wait(Queue queue, uint64_t value) const {
+	if (value == 0) {
+		return;
+	}
+	VkSemaphoreWaitInfo waitInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO };
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &timelines[timelineIndices[queue]].semaphore;
+	waitInfo.pValues = &value;
+	VK_CHECK_RESULT(vkWaitSemaphores(device, &waitInfo, UINT64_MAX));
+}
+
+/*
+* defer destruction until everything submitted to the queue so far is finished
+* runs immediately before init() / after cleanup() - nothing can be in flight
+*
+* @param queue - queue which may still use the resource
+* @param destroy - destroys the resource, runs on the thread calling collect()
+*/
+void TimelineSync::destroyLater(Queue queue, std::function<void()> destroy) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (device != VK_NULL_HANDLE) {
+			uint32_t timelineIndex = timelineIndices[queue];
+			deletions.push_back({ timelineIndex, timelines[timelineIndex].submittedValue, std::move(destroy) });
+			return;
+		}
+	}
+	destroy();
+}
+
+/*
+* defer destruction until the queue reached the value
+*
+* @param queue - queue which may still use the resource
+* @param value - last value the resource is used with
+* @param destroy - destroys the resource, runs on the thread calling collect()
+*/
+void TimelineSync::destroyLater(Queue queue, uint64_t value, std::function<void()> destroy) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (device != VK_NULL_HANDLE) {
+			deletions.push_back({ timelineIndices[queue], value, std::move(destroy) });
+			return;
+		}
+	}
+	destroy();
+}
+
+/*
+* run deletions whose values are reached - one counter query per timeline
+*/
+void TimelineSync::collect() {
+	std::vector<std::function<void()>> finished;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (deletions.empty()) {
+			return;
+		}
+		std::vector<uint64_t> completedValues(timelines.size());
+		for (size_t i = 0; i < timelines.size(); ++i) {
+			VK_CHECK_RESULT(vkGetSemaphoreCounterValue(device, timelines[i].semaphore, &completedValues[i]));
+		}
+		auto pending = std::stable_partition(deletions.begin(), deletions.end(),
+			[&](const Deletion& deletion) { return deletion.value > completedValues[deletion.timelineIndex]; });
+		for (auto it = pending; it != deletions.end(); ++it) {
+			finished.push_back(std::move(it->destroy));
+		}
+		deletions.erase(pending, deletions.end());
+	}
+
+	//outside the lock - destroy functions may defer more deletions
+	for (std::function<void()>& destroy : finished) {
+		destroy();
+	}
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <array>
+#include <functional>
+#include <mutex>
+#include <vector>
+#include "vulkan_utils.h"
+
+/*
+* one timeline semaphore per queue (vulkan 1.2) - every submission through submit() signals the next value
+* frames, uploads & compute work are tracked by the value they signaled, so waiting for old work is a single
+* vkWaitSemaphores & polling is vkGetSemaphoreCounterValue - no fences to reset or recycle
+* queues sharing a VkQueue (graphics == compute ...) share the timeline
+* resources are destroyed once the values they were used with are reached (destroyLater / collect)
+*/
+class TimelineSync {
+public:
+	enum Queue {
+		GRAPHICS = 0,
+		COMPUTE,
+		TRANSFER,
+		QUEUE_COUNT
+	};
+
+	/** semaphore wait of a submission */
+	struct Wait {
+		VkSemaphore semaphore = VK_NULL_HANDLE;
+		/** timeline value - ignored for binary semaphores */
+		uint64_t value = 0;
+		VkPipelineStageFlags stageMask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+	};
+
+	/** @brief create timeline semaphores - queues with the same handle share one */
+	void init(VkDevice device, VkQueue graphicsQueue, VkQueue computeQueue, VkQueue transferQueue);
+	/** @brief wait for all queues, run pending deletions & destroy semaphores */
+	void cleanup();
+
+	/** @brief submit command buffers & signal the queue's next value - returns the value */
+	uint64_t submit(Queue queue, const std::vector<VkCommandBuffer>& commandBuffers,
+		const std::vector<Wait>& waits = {}, const std::vector<VkSemaphore>& binarySignals = {});
+	/** @brief wait of another submission on a value of the queue's timeline */
+	Wait makeWait(Queue queue, uint64_t value, VkPipelineStageFlags stageMask) const;
+
+	/** @brief value of the last submit() to the queue - 0 if nothing was submitted */
+	uint64_t getSubmittedValue(Queue queue) const;
+	/** @brief value the gpu has reached on the queue */
+	uint64_t getCompletedValue(Queue queue) const;
+	/** @brief check if the queue reached the value without blocking */
+	bool isComplete(Queue queue, uint64_t value) const { return value <= getCompletedValue(queue); }
+	/** @brief block until the queue reached the value - returns immediately for 0 */
+	void wait(Queue queue, uint64_t value) const;
+
+	/** @brief run destroy once everything submitted to the queue so far is finished - immediately without timelines */
+	void destroyLater(Queue queue, std::function<void()> destroy);
+	/** @brief run destroy once the queue reached the value */
+	void destroyLater(Queue queue, uint64_t value, std::function<void()> destroy);
+	/** @brief run deletions whose values are reached - called once per frame by VulkanAppBase::update() */
+	void collect();
+
+private:
+	struct Timeline {
+		VkQueue queue = VK_NULL_HANDLE;
+		VkSemaphore semaphore = VK_NULL_HANDLE;
+		/** last signaled value - guarded by mutex */
+		uint64_t submittedValue = 0;
+	};
+	struct Deletion {
+		uint32_t timelineIndex;
+		uint64_t value;
+		std::function<void()> destroy;
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+	/** unique queues */
+	std::vector<Timeline> timelines;
+	/** Queue -> index of timelines */
+	std::array<uint32_t, QUEUE_COUNT> timelineIndices{};
+	/** pending deletions in submission order per timeline */
+	std::vector<Deletion> deletions;
+	/** guards submitted values, queue submission (external sync of shared queues) & deletions */
+	mutable std::mutex mutex;
+};
@@ -0,0 +1,97 @@
+#include <algorithm>
+#include "vulkan_transient_attachment_pool.h"
+
+/*
+* free aliased memory - images bound to it must be destroyed (or not used anymore)
+*/
+void TransientAttachmentPool::cleanup() {
+	if (devices == nullptr) {
+		return;
+	}
+	devices->memoryAllocator.freeMemory(memory);
+	memory = {};
+	images.clear();
+	requiredSize = 0;
+	allocatedSize = 0;
+}
+
+/*
+* register image without memory - bound by allocate()
+*
+* @param image - image created without memory
+* @param firstPass - index of the first pass writing / reading the image in a frame
+* @param lastPass - index of the last pass reading the image in a frame
+*/
+void TransientAttachmentPool::addImage(VkImage image, uint32_t firstPass, uint32_t lastPass) {
+	if (memory.memory != VK_NULL_HANDLE) {
+		throw std::runtime_error("TransientAttachmentPool::addImage(): pool is already allocated");
+	}
+
+	TransientImage transientImage{ image, firstPass, lastPass };
+	vkGetImageMemoryRequirements(devices->device, image, &transientImage.memRequirements);
+	images.push_back(transientImage);
+}
+
+/*
+* assign aliased offsets, allocate one memory block & bind every registered image
+* greedy - biggest image first, placed at the lowest offset not used by an image alive in the same passes
+*/
+void TransientAttachmentPool::allocate() {
+	if (images.empty()) {
+		return;
+	}
+
+	std::vector<size_t> order(images.size());
+	for (size_t i = 0; i < order.size(); ++i) {
+		order[i] = i;
+	}
+	std::sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+		return images[a].memRequirements.size > images[b].memRequirements.size;
+	});
+
+	VkMemoryRequirements memRequirements{ 0, 1, ~0u };
+	std::vector<size_t> placed;
+	for (size_t index : order) {
+		TransientImage& image = images[index];
+		VkDeviceSize alignment = image.memRequirements.alignment;
+
+		//ranges of placed images alive at the same time, sorted by offset
+		std::vector<std::pair<VkDeviceSize, VkDeviceSize>> occupied;
+		for (size_t other : placed) {
+			const TransientImage& placedImage = images[other];
+			if (placedImage.firstPass <= image.lastPass && image.firstPass <= placedImage.lastPass) {
+				occupied.push_back({ placedImage.offset, placedImage.offset + placedImage.memRequirements.size });
+			}
+		}
+		std::sort(occupied.begin(), occupied.end());
+
+		//first gap big enough
+		VkDeviceSize offset = 0;
+		for (const auto& range : occupied) {
+			if (offset + image.memRequirements.size <= range.first) {
+				break;
+			}
+			offset = std::max(offset, (range.second + alignment - 1) / alignment * alignment);
+		}
+		image.offset = offset;
+		placed.push_back(index);
+
+		requiredSize += image.memRequirements.size;
+		memRequirements.size = std::max(memRequirements.size, offset + image.memRequirements.size);
+		memRequirements.alignment = std::max(memRequirements.alignment, alignment);
+		memRequirements.memoryTypeBits &= image.memRequirements.memoryTypeBits;
+	}
+	if (memRequirements.memoryTypeBits == 0) {
+		throw std::runtime_error("TransientAttachmentPool::allocate(): images have no common memory type");
+	}
+
+	memory = devices->memoryAllocator.allocateMemory(memRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, false);
+	if (memory.memory == VK_NULL_HANDLE) {
+		throw std::runtime_error("TransientAttachmentPool::allocate(): failed to allocate memory");
+	}
+	allocatedSize = memRequirements.size;
+
+	for (const auto& image : images) {
+		VK_CHECK_RESULT(vkBindImageMemory(devices->device, image.image, memory.memory, memory.offset + image.offset));
+	}
+}
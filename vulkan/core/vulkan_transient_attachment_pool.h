@@ -0,0 +1,40 @@
+#pragma once
+#include "vulkan_device.h"
+
+/*
+* memory aliasing for render targets used only within a frame
+* images whose pass ranges [firstPass, lastPass] don't overlap share the same memory range
+* one pool per frame in flight - frames in flight run concurrently and must never alias
+*/
+class TransientAttachmentPool {
+public:
+	/** @brief get vulkan device handle */
+	void init(VulkanDevice* devices) { this->devices = devices; }
+	/** @brief free aliased memory - images are destroyed by their owners */
+	void cleanup();
+	/** @brief register image without memory, used from firstPass to lastPass of a frame */
+	void addImage(VkImage image, uint32_t firstPass, uint32_t lastPass);
+	/** @brief assign aliased offsets, allocate memory & bind every registered image */
+	void allocate();
+
+	/** sum of image sizes - memory needed without aliasing */
+	VkDeviceSize requiredSize = 0;
+	/** size of the aliased memory */
+	VkDeviceSize allocatedSize = 0;
+
+private:
+	struct TransientImage {
+		VkImage image = VK_NULL_HANDLE;
+		uint32_t firstPass = 0;
+		uint32_t lastPass = 0;
+		VkMemoryRequirements memRequirements{};
+		VkDeviceSize offset = 0;
+	};
+
+	/** devices handle */
+	VulkanDevice* devices = nullptr;
+	/** registered images */
+	std::vector<TransientImage> images;
+	/** memory shared by all images */
+	MemoryAllocator::HostVisibleMemory memory;
+};
@@ -0,0 +1,508 @@
+#include <algorithm>
+#include <cstring>
+#include "vulkan_device.h"
+#include "vulkan_upload_manager.h"
+
+/*
+* create the staging ring & command pools - command buffers are allocated per batch & freed once it finishes
+*
+* @param devices - abstracted vulkan device handle, queues must be created
+*/
+void UploadManager::init(VulkanDevice* devices) {
+	this->devices = devices;
+	transferFamily = devices->indices.transferFamily.value();
+	graphicsFamily = devices->indices.graphicsFamily.value();
+
+	ringMemory = devices->createBuffer(ringBuffer, STAGING_RING_SIZE, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	ringData = static_cast<uint8_t*>(ringMemory.getHandle(devices->device));
+	ringHead = ringTail = 0;
+
+	VkCommandPoolCreateInfo poolInfo{ VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	poolInfo.queueFamilyIndex = graphicsFamily;
+	VK_CHECK_RESULT(vkCreateCommandPool(devices->device, &poolInfo, nullptr, &graphicsCommandPool));
+	if (hasDedicatedTransferQueue()) {
+		poolInfo.queueFamilyIndex = transferFamily;
+		VK_CHECK_RESULT(vkCreateCommandPool(devices->device, &poolInfo, nullptr, &transferCommandPool));
+	}
+	LOG(std::string("initialized:\tupload manager") + (hasDedicatedTransferQueue() ? " (transfer queue)" : ""));
+}
+
+/*
+* wait for all submitted batches, drop staged uploads & destroy the ring & command pools
+*/
+void UploadManager::cleanup() {
+	if (devices == nullptr) {
+		return;
+	}
+	collect(lastSubmittedTicket);
+	freeStagingBuffers(stagingBuffers);
+	bufferCopies.clear();
+	imageBegins.clear();
+	imageCopies.clear();
+	imageEnds.clear();
+	devices->memoryAllocator.freeMemory(ringMemory);
+	vkDestroyBuffer(devices->device, ringBuffer, nullptr);
+	ringBuffer = VK_NULL_HANDLE;
+	ringData = nullptr;
+	vkDestroyCommandPool(devices->device, graphicsCommandPool, nullptr);
+	vkDestroyCommandPool(devices->device, transferCommandPool, nullptr);
+	graphicsCommandPool = transferCommandPool = VK_NULL_HANDLE;
+	devices = nullptr;
+}
+
+/*
+* reserve staging memory for a buffer region
+*
+* @param dstBuffer - device local buffer created with VK_BUFFER_USAGE_TRANSFER_DST_BIT
+* @param dstOffset - offset in dstBuffer
+* @param size - bytes to copy
+*
+* @return void* - persistently mapped staging memory, valid until submit() or the next upload* call
+*/
+void* UploadManager::stageBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, VkDeviceSize size) {
+	std::lock_guard<std::mutex> lock(mutex);
+	BufferCopy copy{};
+	copy.dstBuffer = dstBuffer;
+	copy.region.dstOffset = dstOffset;
+	copy.region.size = size;
+	void* data = allocateStaging(size, copy.stagingBuffer, copy.region.srcOffset);
+	bufferCopies.push_back(copy);
+	return data;
+}
+
+/*
+* copy data to a buffer region through the ring in STAGING_PIECE_SIZE pieces
+*
+* @param dstBuffer - device local buffer created with VK_BUFFER_USAGE_TRANSFER_DST_BIT
+* @param data - size bytes
+* @param size - bytes to copy, nothing is staged for 0
+* @param dstOffset - offset in dstBuffer
+*/
+void UploadManager::uploadBuffer(VkBuffer dstBuffer, const void* data, VkDeviceSize size, VkDeviceSize dstOffset) {
+	std::lock_guard<std::mutex> lock(mutex);
+	const uint8_t* src = static_cast<const uint8_t*>(data);
+	for (VkDeviceSize copied = 0; copied < size;) {
+		VkDeviceSize pieceSize = std::min(size - copied, STAGING_PIECE_SIZE);
+		BufferCopy copy{ dstBuffer, ringBuffer };
+		copy.region.srcOffset = reserveRingPiece(pieceSize);
+		copy.region.dstOffset = dstOffset + copied;
+		copy.region.size = pieceSize;
+		memcpy(ringData + copy.region.srcOffset, src + copied, static_cast<size_t>(pieceSize));
+		bufferCopies.push_back(copy);
+		copied += pieceSize;
+	}
+}
+
+/*
+* reserve staging memory for level 0 of all layers
+* the rest of the mip chain is blitted on the graphics queue (single layer only)
+*
+* @param image - image in undefined layout, created with transfer dst (& src for mipmaps) usage
+* @param extent - size of level 0
+* @param format - image format, must support linear blit if mipLevels > 1
+* @param size - bytes of all layers
+* @param mipLevels - mip levels of the image
+* @param layerCount - array layers of the image
+* @param filter - mipmap generation filter
+*
+* @return void* - persistently mapped staging memory, valid until submit() or the next upload* call
+*/
+void* UploadManager::stageImage(VkImage image, VkExtent3D extent, VkFormat format, VkDeviceSize size,
+	uint32_t mipLevels, uint32_t layerCount, VkFilter filter) {
+	if (mipLevels > 1 && layerCount > 1) {
+		throw std::runtime_error("UploadManager::stageImage(): mipmaps of layered images not supported");
+	}
+	std::lock_guard<std::mutex> lock(mutex);
+	ImageUpload upload{ image, extent, format, mipLevels, layerCount, filter };
+	ImageCopy copy{ image };
+	copy.region = vktools::initializers::bufferCopyRegion(extent);
+	copy.region.imageSubresource.layerCount = layerCount;
+	void* data = allocateStaging(size, copy.stagingBuffer, copy.region.bufferOffset);
+	imageBegins.push_back(upload);
+	imageCopies.push_back(copy);
+	imageEnds.push_back(upload);
+	return data;
+}
+
+/*
+* copy data to an image through the ring - images larger than STAGING_PIECE_SIZE are copied
+* in row ranges of one layer, staged work may be submitted in between to free ring space
+*
+* @param data - size bytes, tightly packed texels of level 0, layer after layer
+*/
+void UploadManager::uploadImage(VkImage image, const void* data, VkExtent3D extent, VkFormat format, VkDeviceSize size,
+	uint32_t mipLevels, uint32_t layerCount, VkFilter filter) {
+	if (mipLevels > 1 && layerCount > 1) {
+		throw std::runtime_error("UploadManager::uploadImage(): mipmaps of layered images not supported");
+	}
+	std::lock_guard<std::mutex> lock(mutex);
+	ImageUpload upload{ image, extent, format, mipLevels, layerCount, filter };
+	imageBegins.push_back(upload);
+
+	const uint8_t* src = static_cast<const uint8_t*>(data);
+	ImageCopy copy{ image, ringBuffer };
+	copy.region = vktools::initializers::bufferCopyRegion(extent);
+	if (size <= STAGING_PIECE_SIZE) {
+		copy.region.imageSubresource.layerCount = layerCount;
+		copy.region.bufferOffset = reserveRingPiece(size);
+		memcpy(ringData + copy.region.bufferOffset, src, static_cast<size_t>(size));
+		imageCopies.push_back(copy);
+	}
+	else {
+		const VkDeviceSize layerSize = size / layerCount;
+		const VkDeviceSize rowPitch = layerSize / extent.height;
+		const uint32_t pieceRows = static_cast<uint32_t>(std::max<VkDeviceSize>(1, STAGING_PIECE_SIZE / rowPitch));
+		for (uint32_t layer = 0; layer < layerCount; ++layer) {
+			for (uint32_t row = 0; row < extent.height; row += pieceRows) {
+				uint32_t rowCount = std::min(pieceRows, extent.height - row);
+				VkDeviceSize pieceSize = rowPitch * rowCount;
+				copy.region.bufferOffset = reserveRingPiece(pieceSize);
+				copy.region.imageSubresource.baseArrayLayer = layer;
+				copy.region.imageOffset = { 0, static_cast<int32_t>(row), 0 };
+				copy.region.imageExtent = { extent.width, rowCount, 1 };
+				memcpy(ringData + copy.region.bufferOffset, src + layer * layerSize + row * rowPitch, static_cast<size_t>(pieceSize));
+				imageCopies.push_back(copy);
+			}
+		}
+	}
+	imageEnds.push_back(upload);
+}
+
+/*
+* record & submit everything staged so far
+* with a transfer queue: transfer submit (copies + release) -> transfer timeline -> graphics submit (acquire + mipmaps)
+* otherwise one graphics submit
+*
+* @return Ticket - batch of this submission, the last submitted one if nothing was staged
+*/
+UploadManager::Ticket UploadManager::submit() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return submitLocked();
+}
+
+/*
+* poll the batch
+*
+* @param ticket - returned by submit()
+*
+* @return bool - true if the batch (and all before it) finished on the gpu
+*/
+bool UploadManager::isComplete(Ticket ticket) {
+	std::lock_guard<std::mutex> lock(mutex);
+	collect(0);
+	return devices->timelineSync.isComplete(TimelineSync::GRAPHICS, ticket);
+}
+
+/*
+* block until the batch finished on the gpu
+*
+* @param ticket - returned by submit()
+*/
+void UploadManager::wait(Ticket ticket) {
+	std::lock_guard<std::mutex> lock(mutex);
+	collect(ticket);
+}
+
+/*
+* reserve contiguous ring space - wraps to the ring start instead of splitting
+* waits for the oldest submitted batches until the space is free
+*
+* @param size - bytes to reserve
+* @param ringOffset - out, offset in ringBuffer - 16 byte aligned (buffer to image copies need multiples of the texel size)
+*
+* @return bool - false if the space is held by staged, not yet submitted work (or size exceeds the ring)
+*/
+bool UploadManager::reserveRing(VkDeviceSize size, VkDeviceSize& ringOffset) {
+	const VkDeviceSize alignment = 16;
+	if (size > STAGING_RING_SIZE) {
+		return false;
+	}
+	VkDeviceSize begin = 0;
+	while (true) {
+		//empty ring - restart at the ring start so the whole ring is usable
+		if (ringTail == ringHead) {
+			ringHead = ringTail = (ringHead + STAGING_RING_SIZE - 1) / STAGING_RING_SIZE * STAGING_RING_SIZE;
+		}
+		begin = (ringHead + alignment - 1) / alignment * alignment;
+		if (begin % STAGING_RING_SIZE + size > STAGING_RING_SIZE) {
+			begin = (begin / STAGING_RING_SIZE + 1) * STAGING_RING_SIZE;
+		}
+		if (begin + size - ringTail <= STAGING_RING_SIZE) {
+			break;
+		}
+		if (batches.empty()) {
+			return false;
+		}
+		collect(batches.front().ticket);
+	}
+	ringHead = begin + size;
+	ringOffset = begin % STAGING_RING_SIZE;
+	return true;
+}
+
+/*
+* reserve ring space for a piece of an upload* call - staged work is submitted if it holds the space
+*
+* @param size - bytes to reserve, at most STAGING_RING_SIZE
+*
+* @return VkDeviceSize - offset in ringBuffer
+*/
+VkDeviceSize UploadManager::reserveRingPiece(VkDeviceSize size) {
+	VkDeviceSize ringOffset = 0;
+	if (!reserveRing(size, ringOffset)) {
+		submitLocked();
+		if (!reserveRing(size, ringOffset)) {
+			throw std::runtime_error("UploadManager::reserveRingPiece(): upload piece larger than the staging ring");
+		}
+	}
+	return ringOffset;
+}
+
+/*
+* ring space for a stage* request - a temporary buffer (freed with the batch) if the ring can't hold it
+* the returned pointer must stay valid until submit(), so staged work is never submitted here
+*
+* @param size - bytes to allocate
+* @param stagingBuffer - out, ring or temporary buffer
+* @param stagingOffset - out, offset in stagingBuffer
+*
+* @return void* - mapped pointer of the allocation
+*/
+void* UploadManager::allocateStaging(VkDeviceSize size, VkBuffer& stagingBuffer, VkDeviceSize& stagingOffset) {
+	if (reserveRing(size, stagingOffset)) {
+		stagingBuffer = ringBuffer;
+		return ringData + stagingOffset;
+	}
+	StagingBuffer temporary{};
+	temporary.memory = devices->createBuffer(temporary.buffer, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	stagingBuffers.push_back(temporary);
+	stagingBuffer = temporary.buffer;
+	stagingOffset = 0;
+	return temporary.memory.getHandle(devices->device);
+}
+
+/*
+* record & submit - the batch holds the ring up to the current head until the graphics timeline reaches it
+*
+* @return Ticket - batch of this submission, the last submitted one if nothing was staged
+*/
+UploadManager::Ticket UploadManager::submitLocked() {
+	collect(0);
+	if (bufferCopies.empty() && imageCopies.empty()) {
+		return lastSubmittedTicket;
+	}
+
+	Batch batch{};
+	batch.ringEnd = ringHead;
+	batch.stagingBuffers = std::move(stagingBuffers);
+	stagingBuffers.clear();
+
+	VkCommandBufferAllocateInfo allocInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandBufferCount = 1;
+	VkCommandBufferBeginInfo beginInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	allocInfo.commandPool = graphicsCommandPool;
+	VK_CHECK_RESULT(vkAllocateCommandBuffers(devices->device, &allocInfo, &batch.graphicsCommandBuffer));
+	VkCommandBuffer transferCommandBuffer = batch.graphicsCommandBuffer;
+	if (hasDedicatedTransferQueue()) {
+		allocInfo.commandPool = transferCommandPool;
+		VK_CHECK_RESULT(vkAllocateCommandBuffers(devices->device, &allocInfo, &batch.transferCommandBuffer));
+		transferCommandBuffer = batch.transferCommandBuffer;
+	}
+
+	//transfer - same command buffer as graphics without a transfer queue
+	VK_CHECK_RESULT(vkBeginCommandBuffer(transferCommandBuffer, &beginInfo));
+	recordTransfer(transferCommandBuffer);
+	if (hasDedicatedTransferQueue()) {
+		VK_CHECK_RESULT(vkEndCommandBuffer(transferCommandBuffer));
+		VK_CHECK_RESULT(vkBeginCommandBuffer(batch.graphicsCommandBuffer, &beginInfo));
+	}
+	recordGraphics(batch.graphicsCommandBuffer);
+	VK_CHECK_RESULT(vkEndCommandBuffer(batch.graphicsCommandBuffer));
+
+	//graphics part waits for the copies on the transfer timeline
+	TimelineSync& timelineSync = devices->timelineSync;
+	if (hasDedicatedTransferQueue()) {
+		uint64_t transferValue = timelineSync.submit(TimelineSync::TRANSFER, { batch.transferCommandBuffer });
+		batch.ticket = timelineSync.submit(TimelineSync::GRAPHICS, { batch.graphicsCommandBuffer },
+			{ timelineSync.makeWait(TimelineSync::TRANSFER, transferValue, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT) });
+	}
+	else {
+		batch.ticket = timelineSync.submit(TimelineSync::GRAPHICS, { batch.graphicsCommandBuffer });
+	}
+	lastSubmittedTicket = batch.ticket;
+
+	bufferCopies.clear();
+	imageBegins.clear();
+	imageCopies.clear();
+	imageEnds.clear();
+	batches.push_back(std::move(batch));
+	return lastSubmittedTicket;
+}
+
+/*
+* record copies - level 0 of images is left in transfer dst layout
+* with a transfer queue, ownership of every written buffer range & every completed image is released to the graphics family
+* images copied across several batches stay with the transfer family until their last piece
+*
+* @param cmdBuf - command buffer of the transfer family
+*/
+void UploadManager::recordTransfer(VkCommandBuffer cmdBuf) {
+	for (const BufferCopy& copy : bufferCopies) {
+		vkCmdCopyBuffer(cmdBuf, copy.stagingBuffer, copy.dstBuffer, 1, &copy.region);
+	}
+
+	std::vector<VkImageMemoryBarrier> imageBarriers;
+	VkImageMemoryBarrier imageBarrier{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+	imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	imageBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	imageBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	imageBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	for (const ImageUpload& upload : imageBegins) {
+		imageBarrier.image = upload.image;
+		imageBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, upload.layerCount };
+		imageBarriers.push_back(imageBarrier);
+	}
+	if (!imageBarriers.empty()) {
+		vkCmdPipelineBarrier(cmdBuf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+			0, nullptr, 0, nullptr, static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+	}
+	for (const ImageCopy& copy : imageCopies) {
+		vkCmdCopyBufferToImage(cmdBuf, copy.stagingBuffer, copy.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy.region);
+	}
+
+	if (!hasDedicatedTransferQueue()) {
+		return;
+	}
+
+	//release - must match the acquire in recordGraphics()
+	std::vector<VkBufferMemoryBarrier> bufferBarriers;
+	VkBufferMemoryBarrier bufferBarrier{ VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER };
+	bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	bufferBarrier.srcQueueFamilyIndex = transferFamily;
+	bufferBarrier.dstQueueFamilyIndex = graphicsFamily;
+	for (const BufferCopy& copy : bufferCopies) {
+		bufferBarrier.buffer = copy.dstBuffer;
+		bufferBarrier.offset = copy.region.dstOffset;
+		bufferBarrier.size = copy.region.size;
+		bufferBarriers.push_back(bufferBarrier);
+	}
+	imageBarriers.clear();
+	imageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	imageBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	imageBarrier.dstAccessMask = 0;
+	imageBarrier.srcQueueFamilyIndex = transferFamily;
+	imageBarrier.dstQueueFamilyIndex = graphicsFamily;
+	for (const ImageUpload& upload : imageEnds) {
+		imageBarrier.image = upload.image;
+		imageBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, upload.layerCount };
+		imageBarriers.push_back(imageBarrier);
+	}
+	vkCmdPipelineBarrier(cmdBuf, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+		0, nullptr,
+		static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
+		static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+}
+
+/*
+* record acquire barriers (transfer queue only), mipmaps & shader read only layouts of completed images
+* buffer writes are made visible to every later command on the graphics queue
+*
+* @param cmdBuf - command buffer of the graphics family
+*/
+void UploadManager::recordGraphics(VkCommandBuffer cmdBuf) {
+	if (hasDedicatedTransferQueue()) {
+		std::vector<VkBufferMemoryBarrier> bufferBarriers;
+		VkBufferMemoryBarrier bufferBarrier{ VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER };
+		bufferBarrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+		bufferBarrier.srcQueueFamilyIndex = transferFamily;
+		bufferBarrier.dstQueueFamilyIndex = graphicsFamily;
+		for (const BufferCopy& copy : bufferCopies) {
+			bufferBarrier.buffer = copy.dstBuffer;
+			bufferBarrier.offset = copy.region.dstOffset;
+			bufferBarrier.size = copy.region.size;
+			bufferBarriers.push_back(bufferBarrier);
+		}
+		std::vector<VkImageMemoryBarrier> imageBarriers;
+		VkImageMemoryBarrier imageBarrier{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+		imageBarrier.oldLayout = imageBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		imageBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+		imageBarrier.srcQueueFamilyIndex = transferFamily;
+		imageBarrier.dstQueueFamilyIndex = graphicsFamily;
+		for (const ImageUpload& upload : imageEnds) {
+			imageBarrier.image = upload.image;
+			imageBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, upload.layerCount };
+			imageBarriers.push_back(imageBarrier);
+		}
+		vkCmdPipelineBarrier(cmdBuf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+			0, nullptr,
+			static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
+			static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+	}
+	else if (!bufferCopies.empty()) {
+		VkMemoryBarrier barrier{ VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+		vkCmdPipelineBarrier(cmdBuf, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+			1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	for (const ImageUpload& upload : imageEnds) {
+		if (upload.mipLevels > 1) {
+			//levels blitted from level 0
+			vktools::setImageLayout(cmdBuf, upload.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				{ VK_IMAGE_ASPECT_COLOR_BIT, 1, upload.mipLevels - 1, 0, 1 });
+			vktools::generateMipmaps(cmdBuf, devices->physicalDevice, upload.image, upload.format,
+				upload.extent.width, upload.extent.height, upload.mipLevels, upload.filter);
+			continue;
+		}
+		vktools::setImageLayout(cmdBuf, upload.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, upload.layerCount });
+	}
+}
+
+/*
+* free command buffers & temporary staging buffers of finished batches & move the ring tail
+*
+* @param waitTicket - block until this batch is finished, 0 to only poll
+*/
+void UploadManager::collect(Ticket waitTicket) {
+	while (!batches.empty()) {
+		Batch& batch = batches.front();
+		if (batch.ticket <= waitTicket) {
+			devices->timelineSync.wait(TimelineSync::GRAPHICS, batch.ticket);
+		}
+		else if (!devices->timelineSync.isComplete(TimelineSync::GRAPHICS, batch.ticket)) {
+			break;
+		}
+
+		vkFreeCommandBuffers(devices->device, graphicsCommandPool, 1, &batch.graphicsCommandBuffer);
+		if (batch.transferCommandBuffer != VK_NULL_HANDLE) {
+			vkFreeCommandBuffers(devices->device, transferCommandPool, 1, &batch.transferCommandBuffer);
+		}
+		freeStagingBuffers(batch.stagingBuffers);
+		//the ring may have been restarted past this batch while it was empty
+		ringTail = std::max(ringTail, batch.ringEnd);
+		batches.pop_front();
+	}
+}
+
+/*
+* free temporary staging buffers
+*
+* @param buffers - buffers to free, cleared
+*/
+void UploadManager::freeStagingBuffers(std::vector<StagingBuffer>& buffers) {
+	for (StagingBuffer& staging : buffers) {
+		devices->memoryAllocator.freeMemory(staging.memory);
+		vkDestroyBuffer(devices->device, staging.buffer, nullptr);
+	}
+	buffers.clear();
+}
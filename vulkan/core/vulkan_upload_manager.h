@@ -0,0 +1,126 @@
+#pragma once
+#include <deque>
+#include <mutex>
+#include "vulkan_utils.h"
+#include "vulkan_memory_allocator.h"
+
+/*
+* batches staging copies (buffers & images) into as few submissions as possible
+* copies run on the dedicated transfer queue if the device has one, then ownership moves to the graphics family
+* mipmaps & final image layouts are done on the graphics queue, which waits for the copies on the transfer timeline
+* nothing blocks on the gpu unless wait() is called - later graphics submissions are ordered after the batch
+* staging memory is one persistently mapped ring, space of a batch is reclaimed once the graphics timeline reaches it
+*/
+struct VulkanDevice;
+class UploadManager {
+public:
+	/** graphics timeline value of a submitted batch, poll with isComplete() - 0 is always complete */
+	using Ticket = uint64_t;
+	/** size of the staging ring - stage* requests larger than the free space get a temporary buffer */
+	static constexpr VkDeviceSize STAGING_RING_SIZE = 64 * 1024 * 1024;
+	/** upload* copies larger data through the ring in pieces of this size */
+	static constexpr VkDeviceSize STAGING_PIECE_SIZE = STAGING_RING_SIZE / 4;
+
+	/** @brief create the staging ring & command pools of the transfer & graphics family */
+	void init(VulkanDevice* devices);
+	/** @brief wait for all batches & destroy everything - before MemoryAllocator::cleanup() */
+	void cleanup();
+
+	/** @brief reserve staging memory for a buffer region - fill the returned pointer before submit() or the next upload* call */
+	void* stageBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, VkDeviceSize size);
+	/** @brief copy data to a buffer region through the ring - may submit staged work early if the ring is full */
+	void uploadBuffer(VkBuffer dstBuffer, const void* data, VkDeviceSize size, VkDeviceSize dstOffset = 0);
+	/** @brief reserve staging memory for level 0 of all layers, layer after layer - the image ends in shader read only layout */
+	void* stageImage(VkImage image, VkExtent3D extent, VkFormat format, VkDeviceSize size,
+		uint32_t mipLevels = 1, uint32_t layerCount = 1, VkFilter filter = VK_FILTER_LINEAR);
+	/** @brief copy data to an image through the ring, row ranges at a time - may submit staged work early */
+	void uploadImage(VkImage image, const void* data, VkExtent3D extent, VkFormat format, VkDeviceSize size,
+		uint32_t mipLevels = 1, uint32_t layerCount = 1, VkFilter filter = VK_FILTER_LINEAR);
+
+	/** @brief record & submit everything staged so far - returns the last ticket if nothing is staged */
+	Ticket submit();
+	/** @brief poll the batch, reclaims staging memory of finished batches */
+	bool isComplete(Ticket ticket);
+	/** @brief block until the batch is finished */
+	void wait(Ticket ticket);
+
+	/** copies go through a queue family other than graphics */
+	bool hasDedicatedTransferQueue() const { return transferFamily != graphicsFamily; }
+
+private:
+	VulkanDevice* devices = nullptr;
+	uint32_t transferFamily = 0;
+	uint32_t graphicsFamily = 0;
+	VkCommandPool transferCommandPool = VK_NULL_HANDLE;
+	VkCommandPool graphicsCommandPool = VK_NULL_HANDLE;
+	std::mutex mutex;
+
+	/** persistently mapped staging ring */
+	VkBuffer ringBuffer = VK_NULL_HANDLE;
+	MemoryAllocator::HostVisibleMemory ringMemory;
+	uint8_t* ringData = nullptr;
+	/** monotonic byte positions - position in the ring is value % STAGING_RING_SIZE */
+	VkDeviceSize ringHead = 0;
+	VkDeviceSize ringTail = 0;
+
+	/** temporary staging buffer of a stage* request not fitting in the ring */
+	struct StagingBuffer {
+		VkBuffer buffer = VK_NULL_HANDLE;
+		MemoryAllocator::HostVisibleMemory memory;
+	};
+	struct BufferCopy {
+		VkBuffer dstBuffer;
+		VkBuffer stagingBuffer;
+		VkBufferCopy region;
+	};
+	struct ImageCopy {
+		VkImage image;
+		VkBuffer stagingBuffer;
+		VkBufferImageCopy region;
+	};
+	/** image whose copies are all recorded - mipmaps / final layout */
+	struct ImageUpload {
+		VkImage image;
+		VkExtent3D extent;
+		VkFormat format;
+		uint32_t mipLevels;
+		uint32_t layerCount;
+		VkFilter filter;
+	};
+	/** staged, not yet submitted */
+	std::vector<StagingBuffer> stagingBuffers;
+	std::vector<BufferCopy> bufferCopies;
+	/** images to move undefined -> transfer dst before the copies (level 0) */
+	std::vector<ImageUpload> imageBegins;
+	std::vector<ImageCopy> imageCopies;
+	std::vector<ImageUpload> imageEnds;
+
+	struct Batch {
+		Ticket ticket = 0;
+		VkCommandBuffer transferCommandBuffer = VK_NULL_HANDLE;
+		VkCommandBuffer graphicsCommandBuffer = VK_NULL_HANDLE;
+		/** ringTail once the batch finished */
+		VkDeviceSize ringEnd = 0;
+		std::vector<StagingBuffer> stagingBuffers;
+	};
+	/** submitted batches in ticket order */
+	std::deque<Batch> batches;
+	Ticket lastSubmittedTicket = 0;
+
+	/** @brief reserve ring space, waiting for submitted batches - false if unsubmitted staging is in the way */
+	bool reserveRing(VkDeviceSize size, VkDeviceSize& ringOffset);
+	/** @brief reserve ring space, submitting staged work if needed - size <= STAGING_RING_SIZE */
+	VkDeviceSize reserveRingPiece(VkDeviceSize size);
+	/** @brief ring space or a temporary buffer */
+	void* allocateStaging(VkDeviceSize size, VkBuffer& stagingBuffer, VkDeviceSize& stagingOffset);
+	/** @brief submit() with the mutex held */
+	Ticket submitLocked();
+	/** @brief record copies & release barriers */
+	void recordTransfer(VkCommandBuffer cmdBuf);
+	/** @brief record acquire barriers, mipmaps & final layouts */
+	void recordGraphics(VkCommandBuffer cmdBuf);
+	/** @brief free resources of finished batches, optionally waiting up to the ticket */
+	void collect(Ticket waitTicket);
+	/** @brief free temporary staging buffers */
+	void freeStagingBuffers(std::vector<StagingBuffer>& buffers);
+};
@@ -77,8 +77,7 @@ public:
 
 		//uniform buffers
 		for (size_t i = 0; i < cameraUBO.size(); ++i) {
-			devices.memoryAllocator.freeBufferMemory(cameraUBO[i],
-				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+			devices.memoryAllocator.freeBufferMemory(cameraUBO[i]);
 			vkDestroyBuffer(devices.device, cameraUBO[i], nullptr);
 		}
 
@@ -86,9 +85,9 @@ public:
 		skyboxTexture.cleanup();
 		
 		//model & skybox buffers
-		devices.memoryAllocator.freeBufferMemory(modelBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		devices.memoryAllocator.freeBufferMemory(modelBuffer);
 		vkDestroyBuffer(devices.device, modelBuffer, nullptr);
-		devices.memoryAllocator.freeBufferMemory(skyboxBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		devices.memoryAllocator.freeBufferMemory(skyboxBuffer);
 		vkDestroyBuffer(devices.device, skyboxBuffer, nullptr);
 
 		//framebuffers
@@ -184,18 +183,8 @@ private:
 		uint32_t imageIndex = prepareFrame();
 
 		//render
-		VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-		VkSubmitInfo submitInfo{};
-		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		submitInfo.waitSemaphoreCount = 1;
-		submitInfo.pWaitSemaphores = &presentCompleteSemaphores[currentFrame];
-		submitInfo.pWaitDstStageMask = waitStages;
-		submitInfo.commandBufferCount = 1;
 		size_t commandBufferIndex = currentFrame * framebuffers.size() + imageIndex;
-		submitInfo.pCommandBuffers = &commandBuffers[commandBufferIndex];
-		submitInfo.signalSemaphoreCount = 1;
-		submitInfo.pSignalSemaphores = &renderCompleteSemaphores[currentFrame];
-		VK_CHECK_RESULT(vkQueueSubmit(devices.graphicsQueue, 1, &submitInfo, frameLimitFences[currentFrame]));
+		submitGraphics(imageIndex, { commandBuffers[commandBufferIndex] });
 
 		submitFrame(imageIndex);
 	}
@@ -374,9 +363,12 @@ private:
 	* create framebuffer - use swapchain images
 	*/
 	virtual void createFramebuffers() override {
-		for (auto& framebuffer : framebuffers) {
-			vkDestroyFramebuffer(devices.device, framebuffer, nullptr);
-		}
+		//old framebuffers may still be used by frames in flight
+		destroyLater([device = devices.device, oldFramebuffers = framebuffers]() {
+			for (VkFramebuffer framebuffer : oldFramebuffers) {
+				vkDestroyFramebuffer(device, framebuffer, nullptr);
+			}
+		});
 		framebuffers.resize(swapchain.imageCount);
 
 		for (size_t i = 0; i < swapchain.imageCount; ++i) {
@@ -454,8 +446,8 @@ private:
 			VkDeviceSize offsets[] = { 0 };
 			vkCmdBindVertexBuffers(commandBuffers[i], 0, 1, &modelBuffer, offsets);
 			VkDeviceSize indexBufferOffset = model.vertices.bufferSize; // sizeof vertex buffer
-			vkCmdBindIndexBuffer(commandBuffers[i], modelBuffer, indexBufferOffset, VK_INDEX_TYPE_UINT32);
-			vkCmdDrawIndexed(commandBuffers[i], static_cast<uint32_t>(model.indices.size()), 1, 0, 0, 0);
+			vkCmdBindIndexBuffer(commandBuffers[i], modelBuffer, indexBufferOffset, model.indexType);
+			vkCmdDrawIndexed(commandBuffers[i], model.indexCount, 1, 0, 0, 0);
 
 			/*
 			* draw skybox
@@ -466,8 +458,8 @@ private:
 
 			vkCmdBindVertexBuffers(commandBuffers[i], 0, 1, &skyboxBuffer, offsets);
 			indexBufferOffset = skybox.vertices.bufferSize; // sizeof vertex buffer
-			vkCmdBindIndexBuffer(commandBuffers[i], skyboxBuffer, indexBufferOffset, VK_INDEX_TYPE_UINT32);
-			vkCmdDrawIndexed(commandBuffers[i], static_cast<uint32_t>(skybox.indices.size()), 1, 0, 0, 0);
+			vkCmdBindIndexBuffer(commandBuffers[i], skyboxBuffer, indexBufferOffset, skybox.indexType);
+			vkCmdDrawIndexed(commandBuffers[i], skybox.indexCount, 1, 0, 0, 0);
 			
 			/*
 			* imgui
@@ -546,8 +538,8 @@ private:
 	* change all resource related to multusampling
 	*/
 	void changeMultisampleResources() {
-		//finish all command before destroy vk resources
-		vkDeviceWaitIdle(devices.device);
+		//render pass & pipelines are destroyed in place - attachments are destroyed later
+		waitFramesInFlight();
 
 		//depth stencil image
 		destroyDepthStencilImage();
@@ -1,4 +1,5 @@
 #include <array>
+#include <fstream>
 #include <random>
 #include <include/imgui/imgui.h>
 #include "core/vulkan_app_base.h"
@@ -10,13 +11,43 @@
 #include "core/vulkan_texture.h"
 #include "core/vulkan_pipeline.h"
 #include "core/vulkan_framebuffer.h"
+#include "core/vulkan_transient_attachment_pool.h"
 
 namespace {
 	std::random_device device;
 	std::mt19937_64 RNGen(device());
 	std::uniform_real_distribution<> rdFloat(0.0, 1.0);
 	const int LIGHT_NUM = 20;
+	/** model instances per grid side - culled on the gpu, or bucketed by level of detail in frameRingBuffer without gpu culling */
 	const int INSTANCE_NUM_SQRT = 32;
+	/** local_size_x of shaders/cull.comp */
+	const uint32_t CULL_GROUP_SIZE = 64;
+	/** local_size_x & y of shaders/hiz_build.comp */
+	const uint32_t HIZ_GROUP_SIZE = 8;
+	/** max depth pyramid levels - level 0 up to 32768 pixels wide */
+	const uint32_t MAX_HIZ_LEVEL_COUNT = 16;
+	/** compact vertex layout for the g-buffer pass - off at runtime if shaders/gbuffer_quantized_vert.spv is missing (compile.bat) */
+	const bool QUANTIZE_VERTICES = true;
+	/** instance culling & lod selection on the gpu - off at runtime if shaders/cull_comp.spv & hiz_build*_comp.spv are missing (compile.bat) */
+	const bool GPU_CULLING = true;
+	/** bytes of gbuffer attachments moved per resize */
+	const VkDeviceSize DEFRAGMENTATION_BUDGET = 64 * 1024 * 1024;
+
+	/*
+	* check if every file can be opened - optional features test their compiled shaders with it
+	*
+	* @param paths - files to check
+	*
+	* @return bool - false if any file is missing
+	*/
+	bool filesExist(std::initializer_list<const char*> paths) {
+		for (const char* path : paths) {
+			if (!std::ifstream(path, std::ios::binary).is_open()) {
+				return false;
+			}
+		}
+		return true;
+	}
 }
 
 class Imgui : public ImguiBase {
@@ -37,6 +68,23 @@ public:
 			ImGui::Checkbox("Enable SSAO", &userInput.enableSSAO);
 		}
 
+		//gpu culling
+		ImGui::NewLine();
+		if (gpuCulling) {
+			ImGui::Checkbox("Frustum culling", &userInput.enableFrustumCulling);
+			ImGui::Checkbox("Occlusion culling", &userInput.enableOcclusionCulling);
+		}
+		ImGui::Text("Visible instances: %u / %u", visibleInstanceCount, instanceCount);
+
+		//level of detail - selected by the culling shader or per instance on the cpu
+		ImGui::NewLine();
+		ImGui::Checkbox("Enable LOD", &userInput.enableLod);
+		ImGui::SliderFloat("LOD pixel error", &userInput.lodPixelError, 0.25f, 8.0f);
+		ImGui::Text("Model triangles: %u", triangleCount);
+		for (size_t i = 0; i < lodInstanceCounts.size(); ++i) {
+			ImGui::Text("LOD %zu instances: %u", i, lodInstanceCounts[i]);
+		}
+
 		//edge detection threshold
 		if (userInput.renderMode == 0 || userInput.renderMode == 4) {
 			ImGui::Text("Edge detection threshold");
@@ -52,7 +100,22 @@ public:
 		int renderMode = 0;
 		float threshold = 0.5f;
 		bool enableSSAO = false;
+		bool enableLod = true;
+		float lodPixelError = 1.f;
+		bool enableFrustumCulling = true;
+		bool enableOcclusionCulling = true;
 	} userInput;
+
+	/** culling controls are shown only if the gpu culling runs */
+	bool gpuCulling = false;
+	/** model instances before culling */
+	uint32_t instanceCount = 0;
+	/** model instances which passed culling - read back from the gpu, MAX_FRAMES_IN_FLIGHT frames late (all without gpu culling) */
+	uint32_t visibleInstanceCount = 0;
+	/** model triangles drawn */
+	uint32_t triangleCount = 0;
+	/** model instances drawn with each level of detail */
+	std::array<uint32_t, Mesh::MAX_LOD_COUNT> lodInstanceCounts{};
 };
 
 class VulkanApp : public VulkanAppBase {
@@ -86,20 +149,13 @@ public:
 		vkDestroyDescriptorSetLayout(devices.device, ssaoDescriptorSetLayout, nullptr);
 		vkDestroyDescriptorPool(devices.device, ssaoBlurDescriptorPool, nullptr);
 		vkDestroyDescriptorSetLayout(devices.device, ssaoBlurDescriptorSetLayout, nullptr);
-
-		//uniform buffers
-		for (size_t i = 0; i < cameraUBO.size(); ++i) {
-			devices.memoryAllocator.freeBufferMemory(cameraUBO[i],
-				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-			vkDestroyBuffer(devices.device, cameraUBO[i], nullptr);
-			devices.memoryAllocator.freeBufferMemory(deferredUBO[i],
-				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-			vkDestroyBuffer(devices.device, deferredUBO[i], nullptr);
-		}
+		vkDestroyDescriptorPool(devices.device, cullDescriptorPool, nullptr);
+		vkDestroyDescriptorSetLayout(devices.device, cullDescriptorSetLayout, nullptr);
+		vkDestroyDescriptorPool(devices.device, hizDescriptorPool, nullptr);
+		vkDestroyDescriptorSetLayout(devices.device, hizDescriptorSetLayout, nullptr);
 
 		//ssao resources
-		devices.memoryAllocator.freeBufferMemory(ssaoKernelUBO,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		devices.memoryAllocator.freeBufferMemory(ssaoKernelUBO);
 		vkDestroyBuffer(devices.device, ssaoKernelUBO, nullptr);
 		ssaoNoiseTex.cleanup();
 
@@ -107,17 +163,28 @@ public:
 		skyboxTexture.cleanup();
 
 		//model & floor buffer & skybox buffers
-		devices.memoryAllocator.freeBufferMemory(modelBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		devices.memoryAllocator.freeBufferMemory(modelBuffer);
 		vkDestroyBuffer(devices.device, modelBuffer, nullptr);
-		devices.memoryAllocator.freeBufferMemory(floorBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		devices.memoryAllocator.freeBufferMemory(floorBuffer);
 		vkDestroyBuffer(devices.device, floorBuffer, nullptr);
-		devices.memoryAllocator.freeBufferMemory(skyboxBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		devices.memoryAllocator.freeBufferMemory(skyboxBuffer);
 		vkDestroyBuffer(devices.device, skyboxBuffer, nullptr);
 
 		//instanced position buffer
-		devices.memoryAllocator.freeBufferMemory(instancedTransformationBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		devices.memoryAllocator.freeBufferMemory(instancedTransformationBuffer);
 		vkDestroyBuffer(devices.device, instancedTransformationBuffer, nullptr);
 
+		//gpu culling resources
+		for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+			devices.memoryAllocator.freeBufferMemory(culledInstanceBuffers[i]);
+			vkDestroyBuffer(devices.device, culledInstanceBuffers[i], nullptr);
+			devices.memoryAllocator.freeBufferMemory(cullDrawBuffers[i]);
+			vkDestroyBuffer(devices.device, cullDrawBuffers[i], nullptr);
+		}
+		devices.memoryAllocator.freeBufferMemory(cullStatisticsBuffer);
+		vkDestroyBuffer(devices.device, cullStatisticsBuffer, nullptr);
+		destroyHiZPyramid();
+
 		//framebuffers
 		for (auto& framebuffer : framebuffers) {
 			vkDestroyFramebuffer(devices.device, framebuffer, nullptr);
@@ -132,6 +199,11 @@ public:
 		vkDestroyPipelineLayout(devices.device, ssaoPipelineLayout, nullptr);
 		vkDestroyPipeline(devices.device, ssaoBlurPipeline, nullptr);
 		vkDestroyPipelineLayout(devices.device, ssaoBlurPipelineLayout, nullptr);
+		vkDestroyPipeline(devices.device, cullPipeline, nullptr);
+		vkDestroyPipelineLayout(devices.device, cullPipelineLayout, nullptr);
+		vkDestroyPipeline(devices.device, hizPipeline, nullptr);
+		vkDestroyPipeline(devices.device, hizDepthPipeline, nullptr);
+		vkDestroyPipelineLayout(devices.device, hizPipelineLayout, nullptr);
 		vkDestroyPipeline(devices.device, skyboxPipeline, nullptr);
 		vkDestroyPipeline(devices.device, msaaPipeline, nullptr);
 		vkDestroyRenderPass(devices.device, renderPass, nullptr);
@@ -144,6 +216,7 @@ public:
 			offscreenFramebuffers[i].cleanup();
 			ssaoFramebuffers[i].cleanup();
 			ssaoBlurFramebuffers[i].cleanup();
+			transientAttachmentPools[i].cleanup();
 		}
 	}
 
@@ -155,6 +228,14 @@ public:
 		VulkanAppBase::initApp();
 		sampleCount = static_cast<VkSampleCountFlagBits>(devices.maxSampleCount);
 
+		//gpu culling needs its compute shaders
+		gpuCulling = GPU_CULLING &&
+			filesExist({ "shaders/cull_comp.spv", "shaders/hiz_build_comp.spv", "shaders/hiz_build_ms_comp.spv" });
+		if (GPU_CULLING && !gpuCulling) {
+			LOG("shaders/cull_comp.spv or hiz_build*_comp.spv is missing - continue without gpu culling");
+		}
+		static_cast<Imgui*>(imguiBase)->gpuCulling = gpuCulling;
+
 		//init cap setting
 		camera.camPos = glm::vec3(5.f, 5.f, 20.f);
 		camera.camFront = -camera.camPos;
@@ -162,8 +243,16 @@ public:
 
 		//mesh loading & buffer creation
 		model.load("../../meshes/bunny.obj");
-		modelBuffer = model.createModelBuffer(&devices);
 		floor.load("../../meshes/cube.obj");
+		//model & floor share the gbuffer pipeline - both or neither are quantized
+		if (QUANTIZE_VERTICES && filesExist({ "shaders/gbuffer_quantized_vert.spv" })) {
+			model.quantize();
+			floor.quantize();
+		}
+		else if (QUANTIZE_VERTICES) {
+			LOG("shaders/gbuffer_quantized_vert.spv is missing - continue without vertex quantization");
+		}
+		modelBuffer = model.createModelBuffer(&devices);
 		floorBuffer = floor.createModelBuffer(&devices);
 
 		//skybox model loading & buffer creation
@@ -175,11 +264,17 @@ public:
 
 		//ssao sample kernel uniform & noise images
 		createSSAOResources();
+		//gbuffer & ssao attachments
+		createAttachments();
+		//depth pyramid for occlusion culling
+		createHiZPyramid();
 		//ssao render pass & framebuffer
 		createSSAORenderPassFramebuffer();
 
 		//instance possition buffer
 		createInstancePositionBuffer();
+		//culling output buffers
+		createCullingResources();
 
 		//offscreen resources
 		createOffscreenRenderPassFramebuffer();
@@ -259,14 +354,16 @@ private:
 	/** clear color */
 	VkClearColorValue clearColor{ 0.f, 0.2f, 0.f, 1.f };
 
-	/** uniform buffer handle */
-	std::vector<VkBuffer> cameraUBO;
-	/**  uniform buffer memory handle */
-	std::vector<MemoryAllocator::HostVisibleMemory> cameraUBOMemories;
-	/** uniform buffer handle */
-	std::vector<VkBuffer> deferredUBO;
-	/** uniform buffer memory handle */
-	std::vector<MemoryAllocator::HostVisibleMemory> deferredUBOMemories;
+	/** camera ubo dynamic offsets in frameRingBuffer - per frame */
+	std::vector<uint32_t> cameraUBOOffsets;
+	/** deferred ubo dynamic offsets in frameRingBuffer - per frame */
+	std::vector<uint32_t> deferredUBOOffsets;
+	/** culling ubo dynamic offsets in frameRingBuffer - per frame */
+	std::vector<uint32_t> cullUBOOffsets;
+	/** model instances of each level of detail in frameRingBuffer, without gpu culling - per frame */
+	std::vector<std::array<VkDeviceSize, Mesh::MAX_LOD_COUNT>> lodInstanceOffsets;
+	/** indirect draw command of each level of detail in frameRingBuffer, without gpu culling - per frame */
+	std::vector<VkDeviceSize> lodDrawOffsets;
 	/** ssao sample kernel */
 	VkBuffer ssaoKernelUBO;
 	/** ssao sample kernel memory handle */
@@ -306,6 +403,12 @@ private:
 	/*
 	* ssao resources
 	*/
+	/*
+	* transient attachments
+	*/
+	/** aliased memory of attachments used only within a frame - one pool per frame in flight */
+	std::vector<TransientAttachmentPool> transientAttachmentPools;
+
 	/** ssao framebuffer - one channel attachment */
 	std::vector<Framebuffer> ssaoFramebuffers, ssaoBlurFramebuffers;
 	/** ssao render pass */
@@ -332,24 +435,94 @@ private:
 	/** buffer for instancePos */
 	VkBuffer instancedTransformationBuffer = VK_NULL_HANDLE;
 
+	/*
+	* gpu culling resources
+	*/
+	/** culling ubo (std140) - matches shaders/cull.comp */
+	struct CullData {
+		glm::mat4 previousView;
+		glm::vec4 frustumPlanes[6];
+		glm::vec4 modelSphere;
+		glm::vec4 lodErrors;
+		glm::vec4 cameraPos;
+		glm::vec4 previousProjection;
+		glm::vec2 pyramidSize;
+		float zNear;
+		float projectionScale;
+		uint32_t firstInstance;
+		uint32_t instanceCount;
+		uint32_t lodCount;
+		uint32_t flags;
+		float lodPixelError;
+		float padding[3];
+	} uboCull{};
+	static_assert(Mesh::MAX_LOD_COUNT <= 4, "CullData::lodErrors holds up to 4 levels of detail");
+	/** CullData::flags */
+	enum CullFlags : uint32_t {
+		CULL_FRUSTUM = 0x1,
+		CULL_OCCLUSION = 0x2,
+		SELECT_LOD = 0x4
+	};
+	/** model instances - instancedTransformation without the floor */
+	uint32_t modelInstanceCount = 0;
+	/** visible model instances bucketed by level of detail (modelInstanceCount slots each) - per frame */
+	std::vector<VkBuffer> culledInstanceBuffers;
+	/** indirect draw command of each level of detail - per frame */
+	std::vector<VkBuffer> cullDrawBuffers;
+	/** draw commands copied back for the statistics - one region per frame */
+	VkBuffer cullStatisticsBuffer = VK_NULL_HANDLE;
+	MemoryAllocator::HostVisibleMemory cullStatisticsMemory;
+	/** culling compute pipeline */
+	/** GPU_CULLING & its shaders are available - every instance is drawn with a level of detail picked on the cpu otherwise */
+	bool gpuCulling = false;
+	VkPipeline cullPipeline = VK_NULL_HANDLE;
+	VkPipelineLayout cullPipelineLayout = VK_NULL_HANDLE;
+	/** culling descriptors - per frame */
+	DescriptorSetBindings cullBindings;
+	VkDescriptorSetLayout cullDescriptorSetLayout = VK_NULL_HANDLE;
+	VkDescriptorPool cullDescriptorPool = VK_NULL_HANDLE;
+	std::vector<VkDescriptorSet> cullDescriptorSets;
+	/** view & projection of the previous frame - the pyramid is built from its depth */
+	glm::mat4 previousView = glm::mat4(1.f), previousProjection = glm::mat4(1.f);
+
+	/*
+	* depth pyramid (hi-z) - max depth of the gbuffer depth, level 0 is half the swapchain extent
+	*/
+	/** push constants of shaders/hiz_build.comp */
+	struct HiZLevel {
+		glm::ivec2 sourceSize;
+		glm::ivec2 destinationSize;
+	};
+	VkImage hizImage = VK_NULL_HANDLE;
+	/** view of all levels - sampled by the culling */
+	VkImageView hizView = VK_NULL_HANDLE;
+	/** view of each level - written by the pyramid build, read when building the next level */
+	std::vector<VkImageView> hizLevelViews;
+	VkExtent2D hizExtent{};
+	uint32_t hizLevelCount = 0;
+	/** depth aspect view of each frame's gbuffer depth */
+	std::vector<VkImageView> depthSampleViews;
+	/** false until a frame has built the pyramid - contents are undefined after creation */
+	bool hizValid = false;
+	/** level 0 reads the gbuffer depth (multisampled variant), the others read the previous level */
+	VkPipeline hizPipeline = VK_NULL_HANDLE, hizDepthPipeline = VK_NULL_HANDLE;
+	VkPipelineLayout hizPipelineLayout = VK_NULL_HANDLE;
+	DescriptorSetBindings hizBindings;
+	VkDescriptorSetLayout hizDescriptorSetLayout = VK_NULL_HANDLE;
+	VkDescriptorPool hizDescriptorPool = VK_NULL_HANDLE;
+	/** gbuffer depth -> level 0 - per frame */
+	std::vector<VkDescriptorSet> hizDepthDescriptorSets;
+	/** level i -> level i + 1 */
+	std::vector<VkDescriptorSet> hizLevelDescriptorSets;
+
 	/*
 	* called every frame - submit queues
 	*/
 	virtual void draw() override {
 		uint32_t imageIndex = prepareFrame();
 
-		VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-		VkSubmitInfo submitInfo{};
-		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		submitInfo.waitSemaphoreCount = 1;
-		submitInfo.pWaitSemaphores = &presentCompleteSemaphores[currentFrame];
-		submitInfo.pWaitDstStageMask = waitStages;
-		submitInfo.commandBufferCount = 1;
 		size_t commandBufferIndex = currentFrame * framebuffers.size() + imageIndex;
-		submitInfo.pCommandBuffers = &commandBuffers[commandBufferIndex];
-		submitInfo.signalSemaphoreCount = 1;
-		submitInfo.pSignalSemaphores = &renderCompleteSemaphores[currentFrame];
-		VK_CHECK_RESULT(vkQueueSubmit(devices.graphicsQueue, 1, &submitInfo, frameLimitFences[currentFrame]));
+		submitGraphics(imageIndex, { commandBuffers[commandBufferIndex] });
 
 		submitFrame(imageIndex);
 	}
@@ -366,10 +539,15 @@ private:
 	* override resize function - update offscreen resources
 	*/
 	void resizeWindow(bool /*recordCommandBuffer*/) override {
+		//offscreen attachments & per-frame descriptor sets are rewritten in place
+		waitFramesInFlight();
 		sampleCount = VK_SAMPLE_COUNT_1_BIT;
 		VulkanAppBase::resizeWindow(false);
 		sampleCount = static_cast<VkSampleCountFlagBits>(devices.maxSampleCount);
 
+		createAttachments();
+		defragmentAttachments();
+		createHiZPyramid();
 		createSSAORenderPassFramebuffer(true);
 		createOffscreenRenderPassFramebuffer(true); //no need to recreate renderpass
 		updateDescriptorSets();
@@ -415,18 +593,48 @@ private:
 	}
 
 	/*
-	* create ssao framebuffer & renderpass
+	* create gbuffer & ssao attachments
+	* pass order in a frame - gbuffer(0), depth pyramid(1), ssao(2), ssao blur(3), lighting(4)
+	* attachments used only by a few passes share memory through the transient pool of the frame
 	*/
-	void createSSAORenderPassFramebuffer(bool createFramebufferOnly = false) {
+	void createAttachments() {
+		offscreenFramebuffers.resize(MAX_FRAMES_IN_FLIGHT);
 		ssaoFramebuffers.resize(MAX_FRAMES_IN_FLIGHT);
 		ssaoBlurFramebuffers.resize(MAX_FRAMES_IN_FLIGHT);
+		transientAttachmentPools.resize(MAX_FRAMES_IN_FLIGHT);
 		for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+			offscreenFramebuffers[i].init(&devices);
+			offscreenFramebuffers[i].cleanup();
 			ssaoFramebuffers[i].init(&devices);
 			ssaoFramebuffers[i].cleanup();
 			ssaoBlurFramebuffers[i].init(&devices);
 			ssaoBlurFramebuffers[i].cleanup();
+			transientAttachmentPools[i].init(&devices);
+			transientAttachmentPools[i].cleanup();
+
+			VkMemoryPropertyFlagBits memProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+			//position
+			VkImageCreateInfo attachmentInfo = vktools::initializers::imageCreateInfo(
+				{ swapchain.extent.width, swapchain.extent.height, 1 },
+				VK_FORMAT_R16G16B16A16_SFLOAT,
+				VK_IMAGE_TILING_OPTIMAL,
+				VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, 
+				1,
+				sampleCount
+			);
+			//TODO: reconstruct position data from depth value
+			offscreenFramebuffers[i].addAttachment(attachmentInfo, memProperties, true);
+
+			//normal - use same info
+			offscreenFramebuffers[i].addAttachment(attachmentInfo, memProperties, true);
 
-			//create ssao framebuffer
+			//depth - written by gbuffer pass, read by depth pyramid build
+			attachmentInfo.format = depthFormat;
+			attachmentInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+			offscreenFramebuffers[i].addTransientAttachment(attachmentInfo, transientAttachmentPools[i], 0, 1);
+
+			//ssao - written by ssao pass, read by blur pass
 			VkImageCreateInfo ssaoBufferInfo =
 				vktools::initializers::imageCreateInfo(
 					{ swapchain.extent.width, swapchain.extent.height, 1 },
@@ -435,19 +643,43 @@ private:
 					VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
 					1,
 					sampleCount);
+			ssaoFramebuffers[i].addTransientAttachment(ssaoBufferInfo, transientAttachmentPools[i], 2, 3);
 
-			ssaoFramebuffers[i].addAttachment(ssaoBufferInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-			ssaoBlurFramebuffers[i].addAttachment(ssaoBufferInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+			//ssao blur - written by blur pass, read by lighting pass
+			ssaoBlurFramebuffers[i].addTransientAttachment(ssaoBufferInfo, transientAttachmentPools[i], 3, 4);
+
+			transientAttachmentPools[i].allocate();
+		}
+	}
+
+	/*
+	* compact gbuffer attachments after resize - attachments of the old size leave holes in device local chunks
+	* moved images are replaced before framebuffers & descriptor sets are recreated
+	*/
+	void defragmentAttachments() {
+		std::vector<MemoryAllocator::DefragmentationMove> moves;
+		VkCommandBuffer cmdBuf = devices.beginCommandBuffer();
+		devices.memoryAllocator.defragment(cmdBuf, DEFRAGMENTATION_BUDGET, moves);
+		devices.endCommandBuffer(cmdBuf);
+
+		for (auto& framebuffer : offscreenFramebuffers) {
+			framebuffer.applyDefragmentationMoves(moves);
 		}
-		
+		devices.memoryAllocator.releaseEmptyChunks();
+	}
+
+	/*
+	* create ssao framebuffer & renderpass
+	*/
+	void createSSAORenderPassFramebuffer(bool createFramebufferOnly = false) {
+		//ssao & blur target may alias gbuffer depth - wait for depth writes, not by region
 		VkSubpassDependency ssaoStart{};
 		ssaoStart.srcSubpass = VK_SUBPASS_EXTERNAL;
 		ssaoStart.dstSubpass = 0;
-		ssaoStart.srcStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-		ssaoStart.srcAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+		ssaoStart.srcStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		ssaoStart.srcAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 		ssaoStart.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
 		ssaoStart.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-		ssaoStart.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
 
 		VkSubpassDependency ssaoEnd{};
 		ssaoEnd.srcSubpass = 0;
@@ -461,8 +693,8 @@ private:
 		VkSubpassDependency ssaoBlurStart{};
 		ssaoBlurStart.srcSubpass = VK_SUBPASS_EXTERNAL;
 		ssaoBlurStart.dstSubpass = 0;
-		ssaoBlurStart.srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-		ssaoBlurStart.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		ssaoBlurStart.srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		ssaoBlurStart.srcAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 		ssaoBlurStart.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
 		ssaoBlurStart.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
 
@@ -513,7 +745,7 @@ private:
 		//create vertex & index buffer
 		VkBufferCreateInfo bufferCreateInfo = vktools::initializers::bufferCreateInfo(
 			bufferSize,
-			VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+			VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
 		VK_CHECK_RESULT(vkCreateBuffer(devices.device, &bufferCreateInfo, nullptr, &instancedTransformationBuffer));
 
 		//suballocation
@@ -522,42 +754,101 @@ private:
 		//host visible -> device local
 		devices.copyBuffer(devices.commandPool, stagingBuffer, instancedTransformationBuffer, bufferSize);
 
-		devices.memoryAllocator.freeBufferMemory(stagingBuffer, properties);
+		devices.memoryAllocator.freeMemory(hostVisibleMemory);
 		vkDestroyBuffer(devices.device, stagingBuffer, nullptr);
 	}
 
 	/*
-	* offscreen images & render pass & framebuffer
+	* create per frame culling output - visible instances bucketed by level of detail & indirect draw commands
+	* both stay in device local memory, so the instance count isn't bound by frameRingBuffer
 	*/
-	void createOffscreenRenderPassFramebuffer(bool createFramebufferOnly = false) {
-		offscreenFramebuffers.resize(MAX_FRAMES_IN_FLIGHT);
+	void createCullingResources() {
+		modelInstanceCount = static_cast<uint32_t>(instancedTransformation.size() - 1); //[0] is the floor
+		culledInstanceBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+		cullDrawBuffers.resize(MAX_FRAMES_IN_FLIGHT);
 		for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
-			offscreenFramebuffers[i].init(&devices);
-			offscreenFramebuffers[i].cleanup();
+			devices.createBuffer(culledInstanceBuffers[i],
+				sizeof(Transformation) * modelInstanceCount * Mesh::MAX_LOD_COUNT,
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+			devices.createBuffer(cullDrawBuffers[i], sizeof(VkDrawIndexedIndirectCommand) * Mesh::MAX_LOD_COUNT,
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+				VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+		}
 
-			VkMemoryPropertyFlagBits memProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+		//statistics region of a frame is read once its fence is waited again
+		VkDeviceSize statisticsSize = sizeof(VkDrawIndexedIndirectCommand) * Mesh::MAX_LOD_COUNT * MAX_FRAMES_IN_FLIGHT;
+		cullStatisticsMemory = devices.createBuffer(cullStatisticsBuffer, statisticsSize,
+			VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		memset(cullStatisticsMemory.mappedData, 0, static_cast<size_t>(statisticsSize));
+	}
 
-			//position
-			VkImageCreateInfo attachmentInfo = vktools::initializers::imageCreateInfo(
-				{ swapchain.extent.width, swapchain.extent.height, 1 },
-				VK_FORMAT_R16G16B16A16_SFLOAT,
-				VK_IMAGE_TILING_OPTIMAL,
-				VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, 
-				1,
-				sampleCount
-			);
-			//TODO: reconstruct position data from depth value
-			offscreenFramebuffers[i].addAttachment(attachmentInfo, memProperties);
+	/*
+	* create max depth pyramid & depth views of the gbuffer depth - recreated with the attachments
+	* one pyramid is shared by all frames, built after the gbuffer pass & read by the next frame's culling
+	*/
+	void createHiZPyramid() {
+		destroyHiZPyramid();
+
+		hizExtent = { std::max(swapchain.extent.width / 2, 1u), std::max(swapchain.extent.height / 2, 1u) };
+		hizLevelCount = 1;
+		while (hizLevelCount < MAX_HIZ_LEVEL_COUNT &&
+			((hizExtent.width >> hizLevelCount) > 0 || (hizExtent.height >> hizLevelCount) > 0)) {
+			hizLevelCount++;
+		}
 
-			//normal - use same info
-			offscreenFramebuffers[i].addAttachment(attachmentInfo, memProperties);
+		devices.createImage(hizImage, { hizExtent.width, hizExtent.height, 1 }, VK_FORMAT_R32_SFLOAT,
+			VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, hizLevelCount);
+		hizView = vktools::createImageView(devices.device, hizImage, VK_IMAGE_VIEW_TYPE_2D,
+			VK_FORMAT_R32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, hizLevelCount);
+		hizLevelViews.resize(hizLevelCount);
+		for (uint32_t level = 0; level < hizLevelCount; ++level) {
+			VkImageViewCreateInfo viewInfo = vktools::initializers::imageViewCreateInfo(hizImage,
+				VK_IMAGE_VIEW_TYPE_2D, VK_FORMAT_R32_SFLOAT, { VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1 });
+			VK_CHECK_RESULT(vkCreateImageView(devices.device, &viewInfo, nullptr, &hizLevelViews[level]));
+		}
 
-			//depth
-			attachmentInfo.format = depthFormat;
-			attachmentInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
-			offscreenFramebuffers[i].addAttachment(attachmentInfo, memProperties);
+		//storage writes & sampling share the general layout
+		VkCommandBuffer cmdBuf = devices.beginCommandBuffer();
+		vktools::setImageLayout(cmdBuf, hizImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
+			{ VK_IMAGE_ASPECT_COLOR_BIT, 0, hizLevelCount, 0, 1 });
+		devices.endCommandBuffer(cmdBuf);
+		hizValid = false;
+
+		//depth aspect only - depthFormat may have stencil
+		depthSampleViews.resize(MAX_FRAMES_IN_FLIGHT);
+		for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+			depthSampleViews[i] = vktools::createImageView(devices.device, offscreenFramebuffers[i].attachments[2].image,
+				VK_IMAGE_VIEW_TYPE_2D, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, 1);
+		}
+	}
+
+	/*
+	* destroy depth pyramid & depth views
+	*/
+	void destroyHiZPyramid() {
+		if (hizImage == VK_NULL_HANDLE) {
+			return;
+		}
+		for (VkImageView view : depthSampleViews) {
+			vkDestroyImageView(devices.device, view, nullptr);
+		}
+		for (VkImageView view : hizLevelViews) {
+			vkDestroyImageView(devices.device, view, nullptr);
 		}
+		vkDestroyImageView(devices.device, hizView, nullptr);
+		devices.memoryAllocator.freeImageMemory(hizImage);
+		vkDestroyImage(devices.device, hizImage, nullptr);
+		depthSampleViews.clear();
+		hizLevelViews.clear();
+		hizView = VK_NULL_HANDLE;
+		hizImage = VK_NULL_HANDLE;
+	}
 
+	/*
+	* offscreen images & render pass & framebuffer
+	*/
+	void createOffscreenRenderPassFramebuffer(bool createFramebufferOnly = false) {
 		std::vector<VkSubpassDependency> dependencies{};
 		dependencies.resize(2);
 		dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
@@ -619,8 +910,10 @@ private:
 		gen.addVertexInputBindingDescription({ bindingDescription, instancedPosBindingDesc });
 		gen.addVertexInputAttributeDescription(attributeDescription);
 		gen.addDescriptorSetLayout({ offscreenDescriptorSetLayout });
+		gen.addPushConstantRange({ { VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(Mesh::Dequantization) } });
 		gen.addShader(
-			vktools::createShaderModule(devices.device, vktools::readFile("shaders/gbuffer_vert.spv")),
+			vktools::createShaderModule(devices.device, vktools::readFile(
+				model.isQuantized() ? "shaders/gbuffer_quantized_vert.spv" : "shaders/gbuffer_vert.spv")),
 			VK_SHADER_STAGE_VERTEX_BIT);
 		gen.addShader(
 			vktools::createShaderModule(devices.device, vktools::readFile("shaders/gbuffer_frag.spv")),
@@ -713,15 +1006,63 @@ private:
 		gen.generate(renderPass, &msaaPipeline, &pipelineLayout);
 
 		LOG("created:\tgraphics pipelines");
+		if (gpuCulling) {
+			createCullingPipelines();
+		}
+	}
+
+	/*
+	* create gpu culling & depth pyramid compute pipelines
+	*/
+	void createCullingPipelines() {
+		VkPipelineLayoutCreateInfo cullPipelineLayoutCreateInfo =
+			vktools::initializers::pipelineLayoutCreateInfo(&cullDescriptorSetLayout, 1);
+		VK_CHECK_RESULT(vkCreatePipelineLayout(devices.device, &cullPipelineLayoutCreateInfo, nullptr, &cullPipelineLayout));
+
+		std::vector<VkDescriptorSetLayout> hizSetLayouts{ hizDescriptorSetLayout };
+		std::vector<VkPushConstantRange> hizPushConstantRanges{ { VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(HiZLevel) } };
+		VkPipelineLayoutCreateInfo hizPipelineLayoutCreateInfo =
+			vktools::initializers::pipelineLayoutCreateInfo(hizSetLayouts, hizPushConstantRanges);
+		VK_CHECK_RESULT(vkCreatePipelineLayout(devices.device, &hizPipelineLayoutCreateInfo, nullptr, &hizPipelineLayout));
+
+		VkComputePipelineCreateInfo computePipelineCreateInfo{};
+		computePipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		computePipelineCreateInfo.layout = cullPipelineLayout;
+		VkShaderModule csCull = vktools::createShaderModule(devices.device, vktools::readFile("shaders/cull_comp.spv"));
+		computePipelineCreateInfo.stage = vktools::initializers::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_COMPUTE_BIT, csCull);
+		VK_CHECK_RESULT(vkCreateComputePipelines(devices.device, VK_NULL_HANDLE, 1, &computePipelineCreateInfo, nullptr, &cullPipeline));
+
+		//gbuffer depth is multisampled unless sampleCount is 1
+		computePipelineCreateInfo.layout = hizPipelineLayout;
+		VkShaderModule csHiZ = vktools::createShaderModule(devices.device, vktools::readFile("shaders/hiz_build_comp.spv"));
+		computePipelineCreateInfo.stage = vktools::initializers::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_COMPUTE_BIT, csHiZ);
+		VK_CHECK_RESULT(vkCreateComputePipelines(devices.device, VK_NULL_HANDLE, 1, &computePipelineCreateInfo, nullptr, &hizPipeline));
+		VkShaderModule csHiZDepth = csHiZ;
+		if (sampleCount != VK_SAMPLE_COUNT_1_BIT) {
+			csHiZDepth = vktools::createShaderModule(devices.device, vktools::readFile("shaders/hiz_build_ms_comp.spv"));
+		}
+		computePipelineCreateInfo.stage = vktools::initializers::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_COMPUTE_BIT, csHiZDepth);
+		VK_CHECK_RESULT(vkCreateComputePipelines(devices.device, VK_NULL_HANDLE, 1, &computePipelineCreateInfo, nullptr, &hizDepthPipeline));
+
+		vkDestroyShaderModule(devices.device, csCull, nullptr);
+		if (csHiZDepth != csHiZ) {
+			vkDestroyShaderModule(devices.device, csHiZDepth, nullptr);
+		}
+		vkDestroyShaderModule(devices.device, csHiZ, nullptr);
+
+		LOG("created:\tculling pipelines");
 	}
 
 	/*
 	* create framebuffer - use swapchain images
 	*/
 	virtual void createFramebuffers() override {
-		for (auto& framebuffer : framebuffers) {
-			vkDestroyFramebuffer(devices.device, framebuffer, nullptr);
-		}
+		//old framebuffers may still be used by frames in flight
+		destroyLater([device = devices.device, oldFramebuffers = framebuffers]() {
+			for (VkFramebuffer framebuffer : oldFramebuffers) {
+				vkDestroyFramebuffer(device, framebuffer, nullptr);
+			}
+		});
 		framebuffers.resize(swapchain.imageCount);
 
 		for (size_t i = 0; i < swapchain.imageCount; ++i) {
@@ -784,136 +1125,321 @@ private:
 		gbufferRenderPassBeginInfo.clearValueCount = static_cast<uint32_t>(gbufferClearValues.size());
 		gbufferRenderPassBeginInfo.pClearValues = gbufferClearValues.data();
 
-		for (size_t i = 0; i < framebuffers.size() * MAX_FRAMES_IN_FLIGHT; ++i) {
-			VK_CHECK_RESULT(vkBeginCommandBuffer(commandBuffers[i], &cmdBufBeginInfo));
-			size_t resourceIndex = i / framebuffers.size();
-			/*
-			* gbuffer
-			*/
-			gbufferRenderPassBeginInfo.framebuffer = offscreenFramebuffers[resourceIndex].framebuffer;
-			vkCmdBeginRenderPass(commandBuffers[i], &gbufferRenderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-			vktools::setViewportScissorDynamicStates(commandBuffers[i], swapchain.extent);
-
-			vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, offscreenPipeline);
-			vkCmdBindDescriptorSets(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, offscreenPipelineLayout,
-				0, 1, &offscreenDescriptorSets[resourceIndex], 0, nullptr);
-
-			//floor
-			VkDeviceSize offsets[] = { 0 };
-			vkCmdBindVertexBuffers(commandBuffers[i], 0, 1, &floorBuffer, offsets);
-			vkCmdBindVertexBuffers(commandBuffers[i], 1, 1, &instancedTransformationBuffer, offsets);
-			VkDeviceSize indexBufferOffset = floor.vertices.bufferSize; // sizeof vertex buffer
-			vkCmdBindIndexBuffer(commandBuffers[i], floorBuffer, indexBufferOffset, VK_INDEX_TYPE_UINT32);
-			vkCmdDrawIndexed(commandBuffers[i], static_cast<uint32_t>(floor.indices.size()), 1, 0, 0, 0);
-
-			//model
-			vkCmdBindVertexBuffers(commandBuffers[i], 0, 1, &modelBuffer, offsets);
-			offsets[0] = sizeof(Transformation);
-			vkCmdBindVertexBuffers(commandBuffers[i], 1, 1, &instancedTransformationBuffer, offsets);
-			indexBufferOffset = model.vertices.bufferSize; // sizeof vertex buffer
-			vkCmdBindIndexBuffer(commandBuffers[i], modelBuffer, indexBufferOffset, VK_INDEX_TYPE_UINT32);
-			vkCmdDrawIndexed(commandBuffers[i], static_cast<uint32_t>(model.indices.size()), INSTANCE_NUM_SQRT * INSTANCE_NUM_SQRT, 0, 0, 0);
-
-			vkCmdEndRenderPass(commandBuffers[i]);
+		//render pass contents are recorded into secondaries concurrently, primaries only order the passes
+		for (size_t resourceIndex = 0; resourceIndex < static_cast<size_t>(MAX_FRAMES_IN_FLIGHT); ++resourceIndex) {
+			commandRecorder.beginFrame(resourceIndex);
+
+			//gbuffer floor, gbuffer model, ssao, ssao blur - only use per frame resources, shared by every swapchain image
+			const size_t sharedTaskCount = 4;
+			std::vector<CommandRecorder::Task> tasks;
+			VkFramebuffer gbufferFramebuffer = offscreenFramebuffers[resourceIndex].framebuffer;
+			tasks.push_back(CommandRecorder::makeTask(offscreenRenderPass, gbufferFramebuffer,
+				[this, resourceIndex](VkCommandBuffer cmdBuf) { recordGBufferFloor(cmdBuf, resourceIndex); }));
+			tasks.push_back(CommandRecorder::makeTask(offscreenRenderPass, gbufferFramebuffer,
+				[this, resourceIndex](VkCommandBuffer cmdBuf) { recordGBufferModel(cmdBuf, resourceIndex); }));
 
 			/*
 			* ssao occlusion render - full screem quad
 			*/
-			renderPassBeginInfo.renderPass = ssaoRenderPass;
-			renderPassBeginInfo.framebuffer = ssaoFramebuffers[resourceIndex].framebuffer;
-			renderPassBeginInfo.clearValueCount = 1;
-			renderPassBeginInfo.pClearValues = ssaoClearValues.data();
-			vkCmdBeginRenderPass(commandBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-			//dynamic states
-			vktools::setViewportScissorDynamicStates(commandBuffers[i], swapchain.extent);
-
-			vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, ssaoPipeline);
-			vkCmdBindDescriptorSets(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, ssaoPipelineLayout, 0, 1,
-				&ssaoDescriptorSets[resourceIndex], 0, nullptr);
-			vkCmdDraw(commandBuffers[i], 3, 1, 0, 0);
-			vkCmdEndRenderPass(commandBuffers[i]);
+			tasks.push_back(CommandRecorder::makeTask(ssaoRenderPass, ssaoFramebuffers[resourceIndex].framebuffer,
+				[this, resourceIndex](VkCommandBuffer cmdBuf) {
+					vktools::setViewportScissorDynamicStates(cmdBuf, swapchain.extent);
+					vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, ssaoPipeline);
+					vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, ssaoPipelineLayout, 0, 1,
+						&ssaoDescriptorSets[resourceIndex], 1, &cameraUBOOffsets[resourceIndex]);
+					vkCmdDraw(cmdBuf, 3, 1, 0, 0);
+				}));
 
 			/*
 			* ssao blur - full screen quad
 			*/
-			renderPassBeginInfo.renderPass = ssaoBlurRenderPass;
-			renderPassBeginInfo.framebuffer = ssaoBlurFramebuffers[resourceIndex].framebuffer;
-			vkCmdBeginRenderPass(commandBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-			//dynamic states
-			vktools::setViewportScissorDynamicStates(commandBuffers[i], swapchain.extent);
-
-			vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, ssaoBlurPipeline);
-			vkCmdBindDescriptorSets(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, ssaoBlurPipelineLayout, 0, 1,
-				&ssaoBlurDescriptorSets[resourceIndex], 0, nullptr);
-			vkCmdDraw(commandBuffers[i], 3, 1, 0, 0);
-			vkCmdEndRenderPass(commandBuffers[i]);
-
-			/*
-			* lighting calculation for normal pixels
-			*/
-			renderPassBeginInfo.renderPass = renderPass;
-			size_t framebufferIndex = i % framebuffers.size();
-			renderPassBeginInfo.framebuffer = framebuffers[framebufferIndex];
-			renderPassBeginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-			renderPassBeginInfo.pClearValues = clearValues.data();
-			vkCmdBeginRenderPass(commandBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-			//dynamic states
-			vktools::setViewportScissorDynamicStates(commandBuffers[i], swapchain.extent);
+			tasks.push_back(CommandRecorder::makeTask(ssaoBlurRenderPass, ssaoBlurFramebuffers[resourceIndex].framebuffer,
+				[this, resourceIndex](VkCommandBuffer cmdBuf) {
+					vktools::setViewportScissorDynamicStates(cmdBuf, swapchain.extent);
+					vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, ssaoBlurPipeline);
+					vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, ssaoBlurPipelineLayout, 0, 1,
+						&ssaoBlurDescriptorSets[resourceIndex], 0, nullptr);
+					vkCmdDraw(cmdBuf, 3, 1, 0, 0);
+				}));
+			for (CommandRecorder::Task& task : tasks) {
+				task.usage = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT; //executed by the primary of every swapchain image
+			}
 
-			vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
-			vkCmdBindDescriptorSets(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1,
-				&descriptorSets[resourceIndex], 0, nullptr);
+			//lighting, imgui - per swapchain image
+			const size_t framebufferTaskCount = 2;
+			for (size_t framebufferIndex = 0; framebufferIndex < framebuffers.size(); ++framebufferIndex) {
+				/*
+				* lighting calculation for normal pixels, then for complex pixels
+				*/
+				tasks.push_back(CommandRecorder::makeTask(renderPass, framebuffers[framebufferIndex],
+					[this, resourceIndex](VkCommandBuffer cmdBuf) { recordLighting(cmdBuf, resourceIndex); }));
+
+				/*
+				* imgui
+				*/
+				tasks.push_back(CommandRecorder::makeTask(renderPass, framebuffers[framebufferIndex],
+					[this, resourceIndex](VkCommandBuffer cmdBuf) { imguiBase->drawFrame(cmdBuf, resourceIndex); }));
+			}
+			std::vector<VkCommandBuffer> secondaries = commandRecorder.record(resourceIndex, tasks);
+			const VkCommandBuffer* sharedPasses = &secondaries[0];
+
+			for (size_t framebufferIndex = 0; framebufferIndex < framebuffers.size(); ++framebufferIndex) {
+				size_t i = resourceIndex * framebuffers.size() + framebufferIndex;
+				const VkCommandBuffer* framebufferPasses = &secondaries[sharedTaskCount + framebufferIndex * framebufferTaskCount];
+				VK_CHECK_RESULT(vkBeginCommandBuffer(commandBuffers[i], &cmdBufBeginInfo));
+
+				/*
+				* gpu culling - visible model instances & indirect draws of every level of detail
+				*/
+				if (gpuCulling) {
+					recordCulling(commandBuffers[i], resourceIndex);
+				}
+
+				/*
+				* gbuffer
+				*/
+				gbufferRenderPassBeginInfo.framebuffer = offscreenFramebuffers[resourceIndex].framebuffer;
+				vkCmdBeginRenderPass(commandBuffers[i], &gbufferRenderPassBeginInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+				vkCmdExecuteCommands(commandBuffers[i], 2, &sharedPasses[0]);
+				vkCmdEndRenderPass(commandBuffers[i]);
+
+				/*
+				* depth pyramid - occlusion culling input of the next frame
+				*/
+				if (gpuCulling) {
+					recordHiZBuild(commandBuffers[i], resourceIndex);
+				}
+
+				/*
+				* ssao & ssao blur
+				*/
+				renderPassBeginInfo.renderPass = ssaoRenderPass;
+				renderPassBeginInfo.framebuffer = ssaoFramebuffers[resourceIndex].framebuffer;
+				renderPassBeginInfo.clearValueCount = 1;
+				renderPassBeginInfo.pClearValues = ssaoClearValues.data();
+				vkCmdBeginRenderPass(commandBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+				vkCmdExecuteCommands(commandBuffers[i], 1, &sharedPasses[2]);
+				vkCmdEndRenderPass(commandBuffers[i]);
+
+				renderPassBeginInfo.renderPass = ssaoBlurRenderPass;
+				renderPassBeginInfo.framebuffer = ssaoBlurFramebuffers[resourceIndex].framebuffer;
+				vkCmdBeginRenderPass(commandBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+				vkCmdExecuteCommands(commandBuffers[i], 1, &sharedPasses[3]);
+				vkCmdEndRenderPass(commandBuffers[i]);
+
+				/*
+				* lighting & imgui
+				*/
+				renderPassBeginInfo.renderPass = renderPass;
+				renderPassBeginInfo.framebuffer = framebuffers[framebufferIndex];
+				renderPassBeginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+				renderPassBeginInfo.pClearValues = clearValues.data();
+				vkCmdBeginRenderPass(commandBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+				vkCmdExecuteCommands(commandBuffers[i], 2, &framebufferPasses[0]);
+				vkCmdEndRenderPass(commandBuffers[i]);
+
+				VK_CHECK_RESULT(vkEndCommandBuffer(commandBuffers[i]));
+			}
+		}
+		LOG("built:\t\tcommand buffers");
+	}
 
-			vkCmdDraw(commandBuffers[i], 3, 1, 0, 0);
+	/*
+	* record gbuffer floor draw - secondary of the gbuffer pass
+	*
+	* @param cmdBuf - command buffer to record to
+	* @param resourceIndex - frame index of the per frame resources
+	*/
+	void recordGBufferFloor(VkCommandBuffer cmdBuf, size_t resourceIndex) {
+		vktools::setViewportScissorDynamicStates(cmdBuf, swapchain.extent);
+		vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, offscreenPipeline);
+		vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, offscreenPipelineLayout,
+			0, 1, &offscreenDescriptorSets[resourceIndex], 1, &cameraUBOOffsets[resourceIndex]);
+
+		Mesh::Dequantization dequantization = floor.getDequantization();
+		vkCmdPushConstants(cmdBuf, offscreenPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0,
+			sizeof(Mesh::Dequantization), &dequantization);
+		VkDeviceSize offsets[] = { 0 };
+		vkCmdBindVertexBuffers(cmdBuf, 0, 1, &floorBuffer, offsets);
+		vkCmdBindVertexBuffers(cmdBuf, 1, 1, &instancedTransformationBuffer, offsets);
+		VkDeviceSize indexBufferOffset = floor.vertices.bufferSize; // sizeof vertex buffer
+		vkCmdBindIndexBuffer(cmdBuf, floorBuffer, indexBufferOffset, floor.indexType);
+		vkCmdDrawIndexed(cmdBuf, floor.indexCount, 1, 0, 0, 0);
+	}
 
-			/*
-			* final - lighting calculation for complex pixels
-			*/
-			vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, msaaPipeline);
-			vkCmdBindDescriptorSets(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1,
-				&descriptorSets[resourceIndex], 0, nullptr);
+	/*
+	* record gbuffer model draws - one indirect draw per level of detail, instances & counts are written by the culling
+	* without gpu culling they are written to frameRingBuffer by updateLodDraws
+	*
+	* @param cmdBuf - command buffer to record to
+	* @param resourceIndex - frame index of the per frame resources
+	*/
+	void recordGBufferModel(VkCommandBuffer cmdBuf, size_t resourceIndex) {
+		vktools::setViewportScissorDynamicStates(cmdBuf, swapchain.extent);
+		vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, offscreenPipeline);
+		vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, offscreenPipelineLayout,
+			0, 1, &offscreenDescriptorSets[resourceIndex], 1, &cameraUBOOffsets[resourceIndex]);
+
+		Mesh::Dequantization dequantization = model.getDequantization();
+		vkCmdPushConstants(cmdBuf, offscreenPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0,
+			sizeof(Mesh::Dequantization), &dequantization);
+		VkDeviceSize offsets[] = { 0 };
+		vkCmdBindVertexBuffers(cmdBuf, 0, 1, &modelBuffer, offsets);
+		VkDeviceSize indexBufferOffset = model.vertices.bufferSize; // sizeof vertex buffer
+		vkCmdBindIndexBuffer(cmdBuf, modelBuffer, indexBufferOffset, model.indexType);
+		if (!gpuCulling) {
+			for (size_t lod = 0; lod < model.lods.size(); ++lod) {
+				vkCmdBindVertexBuffers(cmdBuf, 1, 1, &frameRingBuffer.buffer, &lodInstanceOffsets[resourceIndex][lod]);
+				vkCmdDrawIndexedIndirect(cmdBuf, frameRingBuffer.buffer,
+					lodDrawOffsets[resourceIndex] + lod * sizeof(VkDrawIndexedIndirectCommand), 1, sizeof(VkDrawIndexedIndirectCommand));
+			}
+			return;
+		}
+		for (size_t lod = 0; lod < model.lods.size(); ++lod) {
+			VkDeviceSize instanceOffset = sizeof(Transformation) * modelInstanceCount * lod;
+			vkCmdBindVertexBuffers(cmdBuf, 1, 1, &culledInstanceBuffers[resourceIndex], &instanceOffset);
+			vkCmdDrawIndexedIndirect(cmdBuf, cullDrawBuffers[resourceIndex],
+				lod * sizeof(VkDrawIndexedIndirectCommand), 1, sizeof(VkDrawIndexedIndirectCommand));
+		}
+	}
 
-			vkCmdDraw(commandBuffers[i], 3, 1, 0, 0);
+	/*
+	* record lighting - full screen quad for normal pixels, then for complex (msaa edge) pixels
+	*
+	* @param cmdBuf - command buffer to record to
+	* @param resourceIndex - frame index of the per frame resources
+	*/
+	void recordLighting(VkCommandBuffer cmdBuf, size_t resourceIndex) {
+		vktools::setViewportScissorDynamicStates(cmdBuf, swapchain.extent);
+
+		vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+		vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1,
+			&descriptorSets[resourceIndex], 1, &deferredUBOOffsets[resourceIndex]);
+		vkCmdDraw(cmdBuf, 3, 1, 0, 0);
+
+		vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, msaaPipeline);
+		vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1,
+			&descriptorSets[resourceIndex], 1, &deferredUBOOffsets[resourceIndex]);
+		vkCmdDraw(cmdBuf, 3, 1, 0, 0);
+	}
 
-			/*
-			* imgui
-			*/
-			imguiBase->drawFrame(commandBuffers[i], resourceIndex);
+	/*
+	* record instance culling - reset draw commands, cull & copy the draw commands back for the statistics
+	*
+	* @param cmdBuf - command buffer to record to
+	* @param resourceIndex - frame index of the per frame resources
+	*/
+	void recordCulling(VkCommandBuffer cmdBuf, size_t resourceIndex) {
+		//instance counts of every level start from 0
+		std::array<VkDrawIndexedIndirectCommand, Mesh::MAX_LOD_COUNT> commands{};
+		for (size_t lod = 0; lod < model.lods.size(); ++lod) {
+			commands[lod].indexCount = model.lods[lod].indexCount;
+			commands[lod].firstIndex = model.lods[lod].firstIndex;
+		}
+		vkCmdUpdateBuffer(cmdBuf, cullDrawBuffers[resourceIndex], 0, sizeof(commands), commands.data());
+
+		//reset & pyramid built by the previous frame -> culling
+		VkMemoryBarrier barrier{ VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(cmdBuf, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline);
+		vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipelineLayout, 0, 1,
+			&cullDescriptorSets[resourceIndex], 1, &cullUBOOffsets[resourceIndex]);
+		vkCmdDispatch(cmdBuf, (modelInstanceCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+		//culling -> indirect draws, instance attributes & statistics copy
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT |
+			VK_ACCESS_TRANSFER_READ_BIT;
+		vkCmdPipelineBarrier(cmdBuf, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+			0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		VkBufferCopy statisticsRegion{ 0, sizeof(commands) * resourceIndex, sizeof(commands) };
+		vkCmdCopyBuffer(cmdBuf, cullDrawBuffers[resourceIndex], cullStatisticsBuffer, 1, &statisticsRegion);
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		vkCmdPipelineBarrier(cmdBuf, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+			0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
 
-			vkCmdEndRenderPass(commandBuffers[i]);
-			VK_CHECK_RESULT(vkEndCommandBuffer(commandBuffers[i]));
+	/*
+	* record depth pyramid build - each level holds the max depth of the texels it covers in the level below
+	*
+	* @param cmdBuf - command buffer to record to
+	* @param resourceIndex - frame index of the gbuffer depth
+	*/
+	void recordHiZBuild(VkCommandBuffer cmdBuf, size_t resourceIndex) {
+		//gbuffer depth -> compute read, this frame's culling read the pyramid before it's rewritten
+		const Framebuffer::Attachment& depth = offscreenFramebuffers[resourceIndex].attachments[2];
+		vktools::insertImageMemoryBarrier(cmdBuf, depth.image,
+			VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+			VK_ACCESS_SHADER_READ_BIT,
+			VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+			VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+			VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT |
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			{ depth.aspect, 0, 1, 0, 1 });
+
+		VkMemoryBarrier barrier{ VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+		VkExtent2D sourceExtent = swapchain.extent;
+		for (uint32_t level = 0; level < hizLevelCount; ++level) {
+			VkExtent2D levelExtent = { std::max(hizExtent.width >> level, 1u), std::max(hizExtent.height >> level, 1u) };
+			if (level < 2) {
+				vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_COMPUTE, level == 0 ? hizDepthPipeline : hizPipeline);
+			}
+			VkDescriptorSet descriptorSet = level == 0 ?
+				hizDepthDescriptorSets[resourceIndex] : hizLevelDescriptorSets[level - 1];
+			vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_COMPUTE, hizPipelineLayout, 0, 1,
+				&descriptorSet, 0, nullptr);
+			HiZLevel hizLevel{
+				glm::ivec2(sourceExtent.width, sourceExtent.height),
+				glm::ivec2(levelExtent.width, levelExtent.height) };
+			vkCmdPushConstants(cmdBuf, hizPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(HiZLevel), &hizLevel);
+			vkCmdDispatch(cmdBuf, (levelExtent.width + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE,
+				(levelExtent.height + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, 1);
+
+			//level -> next level
+			if (level + 1 < hizLevelCount) {
+				vkCmdPipelineBarrier(cmdBuf, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+					0, 1, &barrier, 0, nullptr, 0, nullptr);
+			}
+			sourceExtent = levelExtent;
 		}
-		LOG("built:\t\tcommand buffers");
 	}
 
 
 	/*
-	* create MAX_FRAMES_IN_FLIGHT of ubos
+	* reserve per-frame ubo offsets in frameRingBuffer & init lights
 	*/
 	void createUniformBuffers() {
-		VkDeviceSize cameraUBOSize = sizeof(CameraMatrices);
-		cameraUBO.resize(MAX_FRAMES_IN_FLIGHT);
-		cameraUBOMemories.resize(MAX_FRAMES_IN_FLIGHT);
-		VkDeviceSize deferredUBOSize = sizeof(UBODeferredRending);
-		deferredUBO.resize(MAX_FRAMES_IN_FLIGHT);
-		deferredUBOMemories.resize(MAX_FRAMES_IN_FLIGHT);
-
-		VkBufferCreateInfo cameraUBOCreateInfo = vktools::initializers::bufferCreateInfo(
-			cameraUBOSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
-		VkBufferCreateInfo deferredUBOCreateInfo = vktools::initializers::bufferCreateInfo(
-			deferredUBOSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
-
+		//ubos are pushed to frameRingBuffer every frame in the same order,
+		//so each frame region hands out the same offsets recorded in command buffers
+		cameraUBOOffsets.resize(MAX_FRAMES_IN_FLIGHT);
+		deferredUBOOffsets.resize(MAX_FRAMES_IN_FLIGHT);
+		cullUBOOffsets.resize(MAX_FRAMES_IN_FLIGHT);
+		lodInstanceOffsets.resize(MAX_FRAMES_IN_FLIGHT);
+		lodDrawOffsets.resize(MAX_FRAMES_IN_FLIGHT);
 		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
-			VK_CHECK_RESULT(vkCreateBuffer(devices.device, &cameraUBOCreateInfo, nullptr, &cameraUBO[i]));
-			cameraUBOMemories[i] = devices.memoryAllocator.allocateBufferMemory(
-				cameraUBO[i], VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-			VK_CHECK_RESULT(vkCreateBuffer(devices.device, &deferredUBOCreateInfo, nullptr, &deferredUBO[i]));
-			deferredUBOMemories[i] = devices.memoryAllocator.allocateBufferMemory(
-				deferredUBO[i], VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+			frameRingBuffer.beginFrame(i);
+			cameraUBOOffsets[i] = static_cast<uint32_t>(frameRingBuffer.allocate(sizeof(CameraMatrices)).offset);
+			deferredUBOOffsets[i] = static_cast<uint32_t>(frameRingBuffer.allocate(sizeof(UBODeferredRending)).offset);
+			if (gpuCulling) {
+				cullUBOOffsets[i] = static_cast<uint32_t>(frameRingBuffer.allocate(sizeof(CullData)).offset);
+				continue;
+			}
+			//every level of detail can hold all model instances
+			for (VkDeviceSize& offset : lodInstanceOffsets[i]) {
+				offset = frameRingBuffer.allocate(sizeof(Transformation) * modelInstanceCount).offset;
+			}
+			lodDrawOffsets[i] = frameRingBuffer.allocate(sizeof(VkDrawIndexedIndirectCommand) * Mesh::MAX_LOD_COUNT).offset;
 		}
 
 		//assign color & radius
@@ -932,7 +1458,7 @@ private:
 	/*
 	* update matrices in ubo - rotates 90 degrees per second
 	*
-	* @param currentFrame - index of uniform buffer vector
+	* @param currentFrame - index of frameRingBuffer region (already begun in VulkanAppBase::update)
 	*/
 	void updateUniformBuffer(size_t currentFrame) {
 		/*
@@ -942,7 +1468,7 @@ private:
 		ubo.normalMatrix = glm::transpose(glm::inverse(ubo.view /** ubo.model*/));
 		ubo.proj = cameraMatrices.proj;
 
-		cameraUBOMemories[currentFrame].mapData(devices.device, &ubo);
+		pushUniformData(&ubo, sizeof(CameraMatrices), cameraUBOOffsets[currentFrame]);
 
 		/*
 		* update lights & renderMode
@@ -959,7 +1485,154 @@ private:
 				glm::vec4(12 * std::cos(oldTime / 3 + i * angleInc), 3.f, 12 * std::sin(oldTime / 3 + i * angleInc), 1.f);
 			uboDeferredRendering.lights[i].pos = ubo.view * uboDeferredRendering.lights[i].pos; // light position in view space
 		}
-		deferredUBOMemories[currentFrame].mapData(devices.device, &uboDeferredRendering);
+		pushUniformData(&uboDeferredRendering, sizeof(UBODeferredRending), deferredUBOOffsets[currentFrame]);
+
+		if (gpuCulling) {
+			updateCulling(currentFrame);
+		}
+		else {
+			updateLodDraws(currentFrame);
+		}
+	}
+
+	/*
+	* push ubo data to the current frameRingBuffer region
+	* the offset must match the dynamic offset recorded in command buffers - push order changes would corrupt ubos silently
+	*
+	* @param data - ubo data
+	* @param size - ubo size
+	* @param recordedOffset - dynamic offset reserved in createUniformBuffers
+	*/
+	void pushUniformData(const void* data, VkDeviceSize size, uint32_t recordedOffset) {
+		if (frameRingBuffer.push(data, size).offset != recordedOffset) {
+			throw std::runtime_error("VulkanApp::pushUniformData(): ubo offset differs from the recorded dynamic offset");
+		}
+	}
+
+	/*
+	* fill this frame's culling ubo & read back the statistics of the previous use of this frame's resources
+	* occlusion is tested against the pyramid of the previous frame, so its view & projection are kept
+	*
+	* @param currentFrame - index of frameRingBuffer region (already begun in VulkanAppBase::update)
+	*/
+	void updateCulling(size_t currentFrame) {
+		Imgui* imgui = static_cast<Imgui*>(imguiBase);
+
+		//statistics - the frame's fence has been waited, so its copy is complete
+		const VkDrawIndexedIndirectCommand* commands = static_cast<const VkDrawIndexedIndirectCommand*>(
+			cullStatisticsMemory.mappedData) + Mesh::MAX_LOD_COUNT * currentFrame;
+		imgui->instanceCount = modelInstanceCount;
+		imgui->visibleInstanceCount = 0;
+		imgui->triangleCount = 0;
+		for (size_t lod = 0; lod < Mesh::MAX_LOD_COUNT; ++lod) {
+			imgui->lodInstanceCounts[lod] = commands[lod].instanceCount;
+			imgui->visibleInstanceCount += commands[lod].instanceCount;
+			imgui->triangleCount += commands[lod].indexCount / 3 * commands[lod].instanceCount;
+		}
+
+		//frustum planes from the rows of the view projection - depth range [0, 1]
+		glm::mat4 rows = glm::transpose(cameraMatrices.proj * cameraMatrices.view);
+		uboCull.frustumPlanes[0] = rows[3] + rows[0]; //left
+		uboCull.frustumPlanes[1] = rows[3] - rows[0]; //right
+		uboCull.frustumPlanes[2] = rows[3] + rows[1]; //bottom
+		uboCull.frustumPlanes[3] = rows[3] - rows[1]; //top
+		uboCull.frustumPlanes[4] = rows[2]; //near
+		uboCull.frustumPlanes[5] = rows[3] - rows[2]; //far
+		for (glm::vec4& plane : uboCull.frustumPlanes) {
+			plane /= glm::length(glm::vec3(plane));
+		}
+
+		uboCull.previousView = previousView;
+		uboCull.modelSphere = glm::vec4((model.boundsMin + model.boundsMax) * 0.5f,
+			glm::length(model.boundsMax - model.boundsMin) * 0.5f);
+		for (size_t lod = 0; lod < Mesh::MAX_LOD_COUNT; ++lod) {
+			uboCull.lodErrors[static_cast<int>(lod)] = lod < model.lods.size() ? model.lods[lod].error : 0.f;
+		}
+		uboCull.cameraPos = glm::vec4(camera.camPos, 1.f);
+		uboCull.previousProjection = glm::vec4(previousProjection[0][0], previousProjection[1][1],
+			previousProjection[2][2], previousProjection[3][2]);
+		uboCull.pyramidSize = glm::vec2(hizExtent.width, hizExtent.height);
+		uboCull.zNear = previousProjection[3][2] / previousProjection[2][2];
+		//pixels covered by one world unit at distance 1
+		uboCull.projectionScale = std::abs(cameraMatrices.proj[1][1]) * 0.5f * swapchain.extent.height;
+		uboCull.firstInstance = 1; //[0] is the floor
+		uboCull.instanceCount = modelInstanceCount;
+		uboCull.lodCount = static_cast<uint32_t>(model.lods.size());
+		uboCull.flags = 0;
+		if (imgui->userInput.enableFrustumCulling) {
+			uboCull.flags |= CULL_FRUSTUM;
+		}
+		if (imgui->userInput.enableOcclusionCulling && hizValid) {
+			uboCull.flags |= CULL_OCCLUSION;
+		}
+		if (imgui->userInput.enableLod) {
+			uboCull.flags |= SELECT_LOD;
+		}
+		uboCull.lodPixelError = imgui->userInput.lodPixelError;
+		pushUniformData(&uboCull, sizeof(CullData), cullUBOOffsets[currentFrame]);
+
+		//this frame builds the pyramid tested by the next one
+		previousView = cameraMatrices.view;
+		previousProjection = cameraMatrices.proj;
+		hizValid = true;
+	}
+
+	/*
+	* cpu fallback of the gpu culling - pick a level of detail per model instance & write the instances bucketed by level
+	* the coarsest level whose error, projected with the instance's bounding sphere, stays below lodPixelError is used
+	* allocates from frameRingBuffer right after the ubos - same offsets as recorded in command buffers
+	*
+	* @param currentFrame - index of frameRingBuffer region (already begun in VulkanAppBase::update)
+	*/
+	void updateLodDraws(size_t currentFrame) {
+		Imgui* imgui = static_cast<Imgui*>(imguiBase);
+		glm::vec3 center = (model.boundsMin + model.boundsMax) * 0.5f;
+		float radius = glm::length(model.boundsMax - model.boundsMin) * 0.5f;
+		//pixels covered by one world unit at distance 1
+		float projectionScale = std::abs(cameraMatrices.proj[1][1]) * 0.5f * swapchain.extent.height;
+
+		std::array<Transformation*, Mesh::MAX_LOD_COUNT> lodInstances;
+		for (size_t lod = 0; lod < Mesh::MAX_LOD_COUNT; ++lod) {
+			FrameRingBuffer::Allocation allocation = frameRingBuffer.allocate(sizeof(Transformation) * modelInstanceCount);
+			if (allocation.offset != lodInstanceOffsets[currentFrame][lod]) {
+				throw std::runtime_error("VulkanApp::updateLodDraws(): instance offset differs from the recorded offset");
+			}
+			lodInstances[lod] = static_cast<Transformation*>(allocation.data);
+		}
+		std::array<uint32_t, Mesh::MAX_LOD_COUNT> instanceCounts{};
+		for (size_t i = 1; i < instancedTransformation.size(); ++i) { //[0] is the floor
+			const Transformation& transformation = instancedTransformation[i];
+			float scale = std::max(std::max(transformation.scale.x, transformation.scale.y), transformation.scale.z);
+			float worldRadius = radius * scale;
+			float distance = glm::length(camera.camPos - (transformation.pos + center * transformation.scale));
+			float projectedRadius = worldRadius / std::max(distance - worldRadius, 1e-3f) * projectionScale;
+
+			size_t lod = 0;
+			while (imgui->userInput.enableLod && lod + 1 < model.lods.size() &&
+				model.lods[lod + 1].error * projectedRadius <= imgui->userInput.lodPixelError) {
+				lod++;
+			}
+			lodInstances[lod][instanceCounts[lod]++] = transformation;
+		}
+
+		FrameRingBuffer::Allocation allocation = frameRingBuffer.allocate(sizeof(VkDrawIndexedIndirectCommand) * Mesh::MAX_LOD_COUNT);
+		if (allocation.offset != lodDrawOffsets[currentFrame]) {
+			throw std::runtime_error("VulkanApp::updateLodDraws(): draw offset differs from the recorded offset");
+		}
+		auto* commands = static_cast<VkDrawIndexedIndirectCommand*>(allocation.data);
+		imgui->instanceCount = modelInstanceCount;
+		imgui->visibleInstanceCount = modelInstanceCount;
+		imgui->triangleCount = 0;
+		for (size_t lod = 0; lod < Mesh::MAX_LOD_COUNT; ++lod) {
+			commands[lod] = {};
+			if (lod < model.lods.size()) {
+				commands[lod].indexCount = model.lods[lod].indexCount;
+				commands[lod].firstIndex = model.lods[lod].firstIndex;
+			}
+			commands[lod].instanceCount = instanceCounts[lod];
+			imgui->triangleCount += commands[lod].indexCount / 3 * instanceCounts[lod];
+		}
+		imgui->lodInstanceCounts = instanceCounts;
 	}
 
 	/*
@@ -970,7 +1643,7 @@ private:
 		* offscreen descriptor
 		*/
 		//descriptor - camera matrices
-		offscreenBindings.addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT);
+		offscreenBindings.addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_VERTEX_BIT);
 		offscreenDescriptorPool = offscreenBindings.createDescriptorPool(devices.device, MAX_FRAMES_IN_FLIGHT);
 		offscreenDescriptorSetLayout = offscreenBindings.createDescriptorSetLayout(devices.device);
 		offscreenDescriptorSets = vktools::allocateDescriptorSets(devices.device, offscreenDescriptorSetLayout, offscreenDescriptorPool, MAX_FRAMES_IN_FLIGHT);
@@ -982,7 +1655,7 @@ private:
 		ssaoBindings.addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT); //gbuffer normal
 		ssaoBindings.addBinding(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT); //ssao noise
 		ssaoBindings.addBinding(3, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT); //sample kernal
-		ssaoBindings.addBinding(4, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT); //camera matrices
+		ssaoBindings.addBinding(4, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_FRAGMENT_BIT); //camera matrices
 		ssaoDescriptorPool = ssaoBindings.createDescriptorPool(devices.device, MAX_FRAMES_IN_FLIGHT);
 		ssaoDescriptorSetLayout = ssaoBindings.createDescriptorSetLayout(devices.device);
 		ssaoDescriptorSets = vktools::allocateDescriptorSets(devices.device, ssaoDescriptorSetLayout, ssaoDescriptorPool, MAX_FRAMES_IN_FLIGHT);
@@ -1003,10 +1676,33 @@ private:
 		bindings.addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT);
 		bindings.addBinding(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT);
 		//descriptor - 1 uniform buffer
-		bindings.addBinding(3, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT);
+		bindings.addBinding(3, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_FRAGMENT_BIT);
 		descriptorPool = bindings.createDescriptorPool(devices.device, MAX_FRAMES_IN_FLIGHT);
 		descriptorSetLayout = bindings.createDescriptorSetLayout(devices.device);
 		descriptorSets = vktools::allocateDescriptorSets(devices.device, descriptorSetLayout, descriptorPool, MAX_FRAMES_IN_FLIGHT);
+
+		/*
+		* culling descriptor
+		*/
+		cullBindings.addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_COMPUTE_BIT); //cull data
+		cullBindings.addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT); //instances
+		cullBindings.addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT); //draw commands
+		cullBindings.addBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT); //visible instances
+		cullBindings.addBinding(4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT); //depth pyramid
+		cullDescriptorPool = cullBindings.createDescriptorPool(devices.device, MAX_FRAMES_IN_FLIGHT);
+		cullDescriptorSetLayout = cullBindings.createDescriptorSetLayout(devices.device);
+		cullDescriptorSets = vktools::allocateDescriptorSets(devices.device, cullDescriptorSetLayout, cullDescriptorPool, MAX_FRAMES_IN_FLIGHT);
+
+		/*
+		* depth pyramid descriptor - source level (or gbuffer depth) & destination level
+		*/
+		hizBindings.addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+		hizBindings.addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+		uint32_t hizSetCount = MAX_FRAMES_IN_FLIGHT + MAX_HIZ_LEVEL_COUNT - 1;
+		hizDescriptorPool = hizBindings.createDescriptorPool(devices.device, hizSetCount);
+		hizDescriptorSetLayout = hizBindings.createDescriptorSetLayout(devices.device);
+		hizDepthDescriptorSets = vktools::allocateDescriptorSets(devices.device, hizDescriptorSetLayout, hizDescriptorPool, MAX_FRAMES_IN_FLIGHT);
+		hizLevelDescriptorSets = vktools::allocateDescriptorSets(devices.device, hizDescriptorSetLayout, hizDescriptorPool, MAX_HIZ_LEVEL_COUNT - 1);
 	}
 
 	/*
@@ -1025,9 +1721,9 @@ private:
 				ssaoBlurFramebuffers[i].attachments[0].imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
 
 			//offscreen rendering
-			VkDescriptorBufferInfo cameraUBObufferInfo{ cameraUBO[i], 0, sizeof(CameraMatrices) };
+			VkDescriptorBufferInfo cameraUBObufferInfo{ frameRingBuffer.buffer, 0, sizeof(CameraMatrices) };
 			//full quad rendering
-			VkDescriptorBufferInfo deferredUBObufferInfo{ deferredUBO[i], 0, sizeof(UBODeferredRending) };
+			VkDescriptorBufferInfo deferredUBObufferInfo{ frameRingBuffer.buffer, 0, sizeof(UBODeferredRending) };
 			
 			//ssao
 			VkDescriptorBufferInfo sampleKernelUBObufferInfo{ ssaoKernelUBO, 0, ssaoKernelUBOMemory.size };
@@ -1047,8 +1743,39 @@ private:
 			writes.push_back(bindings.makeWrite(descriptorSets[i], 1, &normalAttachmentInfo));
 			writes.push_back(bindings.makeWrite(descriptorSets[i], 2, &ssaoBlurAttachmentInfo));
 			writes.push_back(bindings.makeWrite(descriptorSets[i], 3, &deferredUBObufferInfo));
+
+			//gpu culling
+			VkDescriptorBufferInfo cullUBObufferInfo{ frameRingBuffer.buffer, 0, sizeof(CullData) };
+			VkDescriptorBufferInfo instanceBufferInfo{ instancedTransformationBuffer, 0, VK_WHOLE_SIZE };
+			VkDescriptorBufferInfo drawBufferInfo{ cullDrawBuffers[i], 0, VK_WHOLE_SIZE };
+			VkDescriptorBufferInfo visibleInstanceBufferInfo{ culledInstanceBuffers[i], 0, VK_WHOLE_SIZE };
+			VkDescriptorImageInfo pyramidInfo{ offscreenSampler, hizView, VK_IMAGE_LAYOUT_GENERAL };
+			writes.push_back(cullBindings.makeWrite(cullDescriptorSets[i], 0, &cullUBObufferInfo));
+			writes.push_back(cullBindings.makeWrite(cullDescriptorSets[i], 1, &instanceBufferInfo));
+			writes.push_back(cullBindings.makeWrite(cullDescriptorSets[i], 2, &drawBufferInfo));
+			writes.push_back(cullBindings.makeWrite(cullDescriptorSets[i], 3, &visibleInstanceBufferInfo));
+			writes.push_back(cullBindings.makeWrite(cullDescriptorSets[i], 4, &pyramidInfo));
+
+			//depth pyramid level 0
+			VkDescriptorImageInfo depthInfo{ offscreenSampler, depthSampleViews[i],
+				VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+			VkDescriptorImageInfo levelInfo{ VK_NULL_HANDLE, hizLevelViews[0], VK_IMAGE_LAYOUT_GENERAL };
+			writes.push_back(hizBindings.makeWrite(hizDepthDescriptorSets[i], 0, &depthInfo));
+			writes.push_back(hizBindings.makeWrite(hizDepthDescriptorSets[i], 1, &levelInfo));
 			vkUpdateDescriptorSets(devices.device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
 		}
+
+		//depth pyramid level i -> level i + 1
+		std::vector<VkDescriptorImageInfo> levelInfos;
+		std::vector<VkWriteDescriptorSet> writes;
+		levelInfos.reserve(hizLevelCount * 2);
+		for (uint32_t level = 1; level < hizLevelCount; ++level) {
+			levelInfos.push_back({ offscreenSampler, hizLevelViews[level - 1], VK_IMAGE_LAYOUT_GENERAL });
+			writes.push_back(hizBindings.makeWrite(hizLevelDescriptorSets[level - 1], 0, &levelInfos.back()));
+			levelInfos.push_back({ VK_NULL_HANDLE, hizLevelViews[level], VK_IMAGE_LAYOUT_GENERAL });
+			writes.push_back(hizBindings.makeWrite(hizLevelDescriptorSets[level - 1], 1, &levelInfos.back()));
+		}
+		vkUpdateDescriptorSets(devices.device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
 	}
 };
 
@@ -89,28 +89,25 @@ public:
 
 		//uniform buffers
 		for (size_t i = 0; i < cameraUBO.size(); ++i) {
-			devices.memoryAllocator.freeBufferMemory(cameraUBO[i],
-				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+			devices.memoryAllocator.freeBufferMemory(cameraUBO[i]);
 			vkDestroyBuffer(devices.device, cameraUBO[i], nullptr);
-			devices.memoryAllocator.freeBufferMemory(deferredUBO[i],
-				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+			devices.memoryAllocator.freeBufferMemory(deferredUBO[i]);
 			vkDestroyBuffer(devices.device, deferredUBO[i], nullptr);
 		}
 
 		//ssao resources
-		devices.memoryAllocator.freeBufferMemory(ssaoKernelUBO,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		devices.memoryAllocator.freeBufferMemory(ssaoKernelUBO);
 		vkDestroyBuffer(devices.device, ssaoKernelUBO, nullptr);
 		ssaoNoiseTex.cleanup();
 
 		//model & floor buffers
-		devices.memoryAllocator.freeBufferMemory(modelBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		devices.memoryAllocator.freeBufferMemory(modelBuffer);
 		vkDestroyBuffer(devices.device, modelBuffer, nullptr);
-		devices.memoryAllocator.freeBufferMemory(floorBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		devices.memoryAllocator.freeBufferMemory(floorBuffer);
 		vkDestroyBuffer(devices.device, floorBuffer, nullptr);
 
 		//instanced position buffer
-		devices.memoryAllocator.freeBufferMemory(instancedTransformationBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		devices.memoryAllocator.freeBufferMemory(instancedTransformationBuffer);
 		vkDestroyBuffer(devices.device, instancedTransformationBuffer, nullptr);
 
 		//framebuffers
@@ -134,11 +131,6 @@ public:
 		vkDestroyRenderPass(devices.device, ssaoRenderPass, nullptr);
 		ssaoFramebuffer.cleanup();
 		ssaoBlurFramebuffer.cleanup();
-
-		//offscreen semaphores
-		for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
-			vkDestroySemaphore(devices.device, offscreenSemaphores[i], nullptr);
-		}
 	}
 
 	/*
@@ -169,8 +161,6 @@ public:
 
 		//offscreen resources
 		createOffscreenRenderPassFramebuffer();
-		//offscreen semaphore
-		createOffscreenSemaphores();
 
 		//render pass
 		renderPass = vktools::createRenderPass(devices.device,
@@ -278,8 +268,6 @@ private:
 	VkRenderPass offscreenRenderPass = VK_NULL_HANDLE;
 	/** offscreen sampler */
 	VkSampler offscreenSampler = VK_NULL_HANDLE;
-	/** offscreen render semaphores */
-	std::vector<VkSemaphore> offscreenSemaphores;
 	/** offscreen command buffer */
 	std::vector<VkCommandBuffer> offscreenCmdBuf{};
 	/** offscreen pipeline */
@@ -333,26 +321,14 @@ private:
 		/*
 		* offscreen rendering
 		*/
-		VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-		VkSubmitInfo submitInfo{};
-		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		submitInfo.waitSemaphoreCount = 1;
-		submitInfo.pWaitSemaphores = &presentCompleteSemaphores[currentFrame];
-		submitInfo.pWaitDstStageMask = waitStages;
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &offscreenCmdBuf[currentFrame];
-		submitInfo.signalSemaphoreCount = 1;
-		submitInfo.pSignalSemaphores = &offscreenSemaphores[currentFrame];
-		VK_CHECK_RESULT(vkQueueSubmit(devices.graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE));
+		uint64_t offscreenValue = devices.timelineSync.submit(TimelineSync::GRAPHICS, { offscreenCmdBuf[currentFrame] });
 
 		/*
 		* post rendering
 		*/
-		submitInfo.pWaitSemaphores = &offscreenSemaphores[currentFrame];
 		size_t commandBufferIndex = currentFrame * framebuffers.size() + imageIndex;
-		submitInfo.pCommandBuffers = &commandBuffers[commandBufferIndex];
-		submitInfo.pSignalSemaphores = &renderCompleteSemaphores[currentFrame];
-		VK_CHECK_RESULT(vkQueueSubmit(devices.graphicsQueue, 1, &submitInfo, frameLimitFences[currentFrame]));
+		submitGraphics(imageIndex, { commandBuffers[commandBufferIndex] },
+			{ devices.timelineSync.makeWait(TimelineSync::GRAPHICS, offscreenValue, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT) });
 
 		submitFrame(imageIndex);
 	}
@@ -369,6 +345,8 @@ private:
 	* override resize function - update offscreen resources
 	*/
 	void resizeWindow(bool /*recordCommandBuffer*/) override {
+		//offscreen attachments & per-frame descriptor sets are rewritten in place
+		waitFramesInFlight();
 		sampleCount = VK_SAMPLE_COUNT_1_BIT;
 		VulkanAppBase::resizeWindow(false);
 		sampleCount = static_cast<VkSampleCountFlagBits>(devices.maxSampleCount);
@@ -489,7 +467,7 @@ private:
 		//host visible -> device local
 		devices.copyBuffer(devices.commandPool, stagingBuffer, instancedTransformationBuffer, bufferSize);
 
-		devices.memoryAllocator.freeBufferMemory(stagingBuffer, properties);
+		devices.memoryAllocator.freeBufferMemory(stagingBuffer);
 		vkDestroyBuffer(devices.device, stagingBuffer, nullptr);
 	}
 
@@ -534,17 +512,6 @@ private:
 		offscreenFramebuffer.createFramebuffer(swapchain.extent, offscreenRenderPass);
 	}
 
-	/*
-	* create offscreen semaphores
-	*/
-	void createOffscreenSemaphores() {
-		offscreenSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-		VkSemaphoreCreateInfo info{ VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
-		for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
-			VK_CHECK_RESULT(vkCreateSemaphore(devices.device, &info, nullptr, &offscreenSemaphores[i]));
-		}
-	}
-
 	/*
 	* create & record offscreen command buffer
 	*/
@@ -596,15 +563,15 @@ private:
 			vkCmdBindVertexBuffers(offscreenCmdBuf[i], 0, 1, &floorBuffer, offsets);
 			vkCmdBindVertexBuffers(offscreenCmdBuf[i], 1, 1, &instancedTransformationBuffer, offsets);
 			VkDeviceSize indexBufferOffset = floor.vertices.bufferSize; // sizeof vertex buffer
-			vkCmdBindIndexBuffer(offscreenCmdBuf[i], floorBuffer, indexBufferOffset, VK_INDEX_TYPE_UINT32);
-			vkCmdDrawIndexed(offscreenCmdBuf[i], static_cast<uint32_t>(floor.indices.size()), 1, 0, 0, 0);
+			vkCmdBindIndexBuffer(offscreenCmdBuf[i], floorBuffer, indexBufferOffset, floor.indexType);
+			vkCmdDrawIndexed(offscreenCmdBuf[i], floor.indexCount, 1, 0, 0, 0);
 
 			vkCmdBindVertexBuffers(offscreenCmdBuf[i], 0, 1, &modelBuffer, offsets);
 			offsets[0] = sizeof(Transformation);
 			vkCmdBindVertexBuffers(offscreenCmdBuf[i], 1, 1, &instancedTransformationBuffer, offsets);
 			indexBufferOffset = model.vertices.bufferSize; // sizeof vertex buffer
-			vkCmdBindIndexBuffer(offscreenCmdBuf[i], modelBuffer, indexBufferOffset, VK_INDEX_TYPE_UINT32);
-			vkCmdDrawIndexed(offscreenCmdBuf[i], static_cast<uint32_t>(model.indices.size()), INSTANCE_NUM_SQRT * INSTANCE_NUM_SQRT, 0, 0, 0);
+			vkCmdBindIndexBuffer(offscreenCmdBuf[i], modelBuffer, indexBufferOffset, model.indexType);
+			vkCmdDrawIndexed(offscreenCmdBuf[i], model.indexCount, INSTANCE_NUM_SQRT * INSTANCE_NUM_SQRT, 0, 0, 0);
 
 			vkCmdEndRenderPass(offscreenCmdBuf[i]);
 			VK_CHECK_RESULT(vkEndCommandBuffer(offscreenCmdBuf[i]));
@@ -710,9 +677,12 @@ private:
 	* create framebuffer - use swapchain images
 	*/
 	virtual void createFramebuffers() override {
-		for (auto& framebuffer : framebuffers) {
-			vkDestroyFramebuffer(devices.device, framebuffer, nullptr);
-		}
+		//old framebuffers may still be used by frames in flight
+		destroyLater([device = devices.device, oldFramebuffers = framebuffers]() {
+			for (VkFramebuffer framebuffer : oldFramebuffers) {
+				vkDestroyFramebuffer(device, framebuffer, nullptr);
+			}
+		});
 		framebuffers.resize(swapchain.imageCount);
 
 		for (size_t i = 0; i < swapchain.imageCount; ++i) {
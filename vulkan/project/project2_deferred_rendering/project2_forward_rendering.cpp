@@ -62,22 +62,20 @@ public:
 
 		//uniform buffers
 		for (size_t i = 0; i < cameraUBO.size(); ++i) {
-			devices.memoryAllocator.freeBufferMemory(cameraUBO[i],
-				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+			devices.memoryAllocator.freeBufferMemory(cameraUBO[i]);
 			vkDestroyBuffer(devices.device, cameraUBO[i], nullptr);
-			devices.memoryAllocator.freeBufferMemory(lightUBO[i],
-				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+			devices.memoryAllocator.freeBufferMemory(lightUBO[i]);
 			vkDestroyBuffer(devices.device, lightUBO[i], nullptr);
 		}
 
 		//model & floor buffers
-		devices.memoryAllocator.freeBufferMemory(modelBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		devices.memoryAllocator.freeBufferMemory(modelBuffer);
 		vkDestroyBuffer(devices.device, modelBuffer, nullptr);
-		devices.memoryAllocator.freeBufferMemory(floorBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		devices.memoryAllocator.freeBufferMemory(floorBuffer);
 		vkDestroyBuffer(devices.device, floorBuffer, nullptr);
 
 		//instanced position buffer
-		devices.memoryAllocator.freeBufferMemory(instancedTransformationBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		devices.memoryAllocator.freeBufferMemory(instancedTransformationBuffer);
 		vkDestroyBuffer(devices.device, instancedTransformationBuffer, nullptr);
 
 		//framebuffers
@@ -204,18 +202,8 @@ private:
 	virtual void draw() override {
 		uint32_t imageIndex = prepareFrame();
 
-		VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-		VkSubmitInfo submitInfo{};
-		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		submitInfo.waitSemaphoreCount = 1;
-		submitInfo.pWaitSemaphores = &presentCompleteSemaphores[currentFrame];
-		submitInfo.pWaitDstStageMask = waitStages;
-		submitInfo.commandBufferCount = 1;
 		size_t commandBufferIndex = currentFrame * framebuffers.size() + imageIndex;
-		submitInfo.pCommandBuffers = &commandBuffers[commandBufferIndex];
-		submitInfo.signalSemaphoreCount = 1;
-		submitInfo.pSignalSemaphores = &renderCompleteSemaphores[currentFrame];
-		VK_CHECK_RESULT(vkQueueSubmit(devices.graphicsQueue, 1, &submitInfo, frameLimitFences[currentFrame]));
+		submitGraphics(imageIndex, { commandBuffers[commandBufferIndex] });
 
 		submitFrame(imageIndex);
 	}
@@ -232,6 +220,8 @@ private:
 	* override resize function - update offscreen resources
 	*/
 	void resizeWindow(bool /*recordCommandBuffer*/) override {
+		//per-frame descriptor sets are rewritten in place
+		waitFramesInFlight();
 		VulkanAppBase::resizeWindow(false);
 		updateDescriptorSets();
 		recordCommandBuffer();
@@ -290,7 +280,7 @@ private:
 		//host visible -> device local
 		devices.copyBuffer(devices.commandPool, stagingBuffer, instancedTransformationBuffer, bufferSize);
 
-		devices.memoryAllocator.freeBufferMemory(stagingBuffer, properties);
+		devices.memoryAllocator.freeMemory(hostVisibleMemory);
 		vkDestroyBuffer(devices.device, stagingBuffer, nullptr);
 	}
 
@@ -429,9 +419,12 @@ private:
 	* create framebuffer - use swapchain images
 	*/
 	virtual void createFramebuffers() override {
-		for (auto& framebuffer : framebuffers) {
-			vkDestroyFramebuffer(devices.device, framebuffer, nullptr);
-		}
+		//old framebuffers may still be used by frames in flight
+		destroyLater([device = devices.device, oldFramebuffers = framebuffers]() {
+			for (VkFramebuffer framebuffer : oldFramebuffers) {
+				vkDestroyFramebuffer(device, framebuffer, nullptr);
+			}
+		});
 		framebuffers.resize(swapchain.imageCount);
 
 		for (size_t i = 0; i < swapchain.imageCount; ++i) {
@@ -504,15 +497,15 @@ private:
 			vkCmdBindVertexBuffers(commandBuffers[i], 0, 1, &floorBuffer, offsets);
 			vkCmdBindVertexBuffers(commandBuffers[i], 1, 1, &instancedTransformationBuffer, offsets);
 			VkDeviceSize indexBufferOffset = floor.vertices.bufferSize; // sizeof vertex buffer
-			vkCmdBindIndexBuffer(commandBuffers[i], floorBuffer, indexBufferOffset, VK_INDEX_TYPE_UINT32);
-			vkCmdDrawIndexed(commandBuffers[i], static_cast<uint32_t>(floor.indices.size()), 1, 0, 0, 0);
+			vkCmdBindIndexBuffer(commandBuffers[i], floorBuffer, indexBufferOffset, floor.indexType);
+			vkCmdDrawIndexed(commandBuffers[i], floor.indexCount, 1, 0, 0, 0);
 
 			vkCmdBindVertexBuffers(commandBuffers[i], 0, 1, &modelBuffer, offsets);
 			offsets[0] = sizeof(Transformation);
 			vkCmdBindVertexBuffers(commandBuffers[i], 1, 1, &instancedTransformationBuffer, offsets);
 			indexBufferOffset = model.vertices.bufferSize; // sizeof vertex buffer
-			vkCmdBindIndexBuffer(commandBuffers[i], modelBuffer, indexBufferOffset, VK_INDEX_TYPE_UINT32);
-			vkCmdDrawIndexed(commandBuffers[i], static_cast<uint32_t>(model.indices.size()), INSTANCE_NUM_SQRT * INSTANCE_NUM_SQRT, 0, 0, 0);
+			vkCmdBindIndexBuffer(commandBuffers[i], modelBuffer, indexBufferOffset, model.indexType);
+			vkCmdDrawIndexed(commandBuffers[i], model.indexCount, INSTANCE_NUM_SQRT * INSTANCE_NUM_SQRT, 0, 0, 0);
 			
 
 			/*
@@ -1,4 +1,5 @@
 ..\..\glslc.exe gbuffer.vert -o gbuffer_vert.spv -g
+..\..\glslc.exe gbuffer_quantized.vert -o gbuffer_quantized_vert.spv -g
 ..\..\glslc.exe gbuffer.frag -o gbuffer_frag.spv -g
 ..\..\glslc.exe full_quad.vert -o full_quad_vert.spv -g
 ..\..\glslc.exe full_quad_normal.frag -o full_quad_normal_frag.spv -g
@@ -10,4 +11,7 @@
 ..\..\glslc.exe forward.frag -o forward_frag.spv -g
 ..\..\glslc.exe skybox.vert -o skybox_vert.spv -g
 ..\..\glslc.exe skybox.frag -o skybox_frag.spv -g
+..\..\glslc.exe cull.comp -o cull_comp.spv -g
+..\..\glslc.exe hiz_build.comp -o hiz_build_comp.spv -g
+..\..\glslc.exe hiz_build.comp -DMULTISAMPLED -o hiz_build_ms_comp.spv -g
 pause
\ No newline at end of file
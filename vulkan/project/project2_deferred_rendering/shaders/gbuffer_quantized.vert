@@ -0,0 +1,50 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(binding = 0) uniform UBO {
+	mat4 view;
+	mat4 normalMatrix;
+	mat4 proj;
+} ubo;
+
+//Mesh::getDequantization()
+layout(push_constant) uniform Dequantization {
+	vec4 offset;
+	vec4 scale;
+} dequantization;
+
+layout(location = 0) in vec4 inPos; //R16G16B16A16_UNORM, relative to the bounding box
+layout(location = 1) in vec2 inNormal; //R16G16_SNORM, octahedral
+layout(location = 2) in vec3 inWorldTranslation;
+layout(location = 3) in vec3 inScale;
+
+layout(location = 0) out vec3 outViewPos;
+layout(location = 1) out vec3 outViewNormal;
+
+vec3 decodeOctahedral(vec2 e){
+	vec3 n = vec3(e.xy, 1.f - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.f);
+	n.xy += mix(vec2(t), vec2(-t), greaterThanEqual(n.xy, vec2(0.f)));
+	return normalize(n);
+}
+
+void main(){
+	//construct model matrix based on the instances position input (inWorldTranslation)
+	mat4 translation = mat4(1.f);
+	//transformation
+	translation[3][0] = inWorldTranslation.x;
+	translation[3][1] = inWorldTranslation.y;
+	translation[3][2] = inWorldTranslation.z;
+	//scale
+	mat4 scale = mat4(1.f);
+	scale[0][0] = inScale.x;
+	scale[1][1] = inScale.y;
+	scale[2][2] = inScale.z;
+
+	mat4 model = translation * scale;
+
+	vec3 pos = dequantization.offset.xyz + dequantization.scale.xyz * inPos.xyz;
+	outViewPos = (ubo.view * model * vec4(pos, 1.f)).xyz;
+	gl_Position = ubo.proj * vec4(outViewPos, 1.f);
+	outViewNormal = mat3(transpose(inverse(ubo.view * model))) * decodeOctahedral(inNormal);
+}
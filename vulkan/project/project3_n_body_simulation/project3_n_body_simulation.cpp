@@ -94,22 +94,19 @@ public:
 
 		//uniform buffers
 		for (size_t i = 0; i < cameraUBO.size(); ++i) {
-			devices.memoryAllocator.freeBufferMemory(cameraUBO[i],
-				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+			devices.memoryAllocator.freeBufferMemory(cameraUBO[i]);
 			vkDestroyBuffer(devices.device, cameraUBO[i], nullptr);
 		}
-		devices.memoryAllocator.freeBufferMemory(computeUBO,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		devices.memoryAllocator.freeBufferMemory(computeUBO);
 		vkDestroyBuffer(devices.device, computeUBO, nullptr);
 
 		for (auto& hdrUBOBuffer : hdrUBO) {
-			devices.memoryAllocator.freeBufferMemory(hdrUBOBuffer,
-				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+			devices.memoryAllocator.freeBufferMemory(hdrUBOBuffer);
 			vkDestroyBuffer(devices.device, hdrUBOBuffer, nullptr);
 		}
 
 		//model & floor buffer & skybox buffers
-		devices.memoryAllocator.freeBufferMemory(particleBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		devices.memoryAllocator.freeBufferMemory(particleBuffer);
 		vkDestroyBuffer(devices.device, particleBuffer, nullptr);
 		particleTex.cleanup();
 
@@ -144,14 +141,6 @@ public:
 			bloomFramebufferVerts[i].cleanup();
 			bloomFramebufferHorzs[i].cleanup();
 		}
-		
-		//semaphore
-		for (auto& semaphore : particleComputeCompleteSemaphores) {
-			vkDestroySemaphore(devices.device, semaphore, nullptr);
-		}
-		for (auto& semaphore : renderCompleteComputeSemaphores) {
-			vkDestroySemaphore(devices.device, semaphore, nullptr);
-		}
 
 		//compute command pool
 		if (separateComputeQueue) {
@@ -189,7 +178,6 @@ public:
 		imguiBase->init(&devices, swapchain.extent.width, swapchain.extent.height,
 			renderPass, MAX_FRAMES_IN_FLIGHT, VK_SAMPLE_COUNT_1_BIT);
 		recordCommandBuffer();
-		createComputeSemaphore();
 		createComputeCommandBuffers();
 		recordComputeCommandBuffers();
 	}
@@ -228,8 +216,6 @@ private:
 	std::vector<VkBuffer> cameraUBO;
 	/**  uniform buffer memory handle */
 	std::vector<MemoryAllocator::HostVisibleMemory> cameraUBOMemories;
-	/** semaphore for synchronizing compute & graphics pipeline */
-	std::vector<VkSemaphore> renderCompleteComputeSemaphores;
 
 	/** particle info */
 	struct Particle {
@@ -264,8 +250,10 @@ private:
 	VkPipeline computePipelineCompute = VK_NULL_HANDLE, computePipelineUpdate = VK_NULL_HANDLE;
 	/** pipeline layout */
 	VkPipelineLayout computePipelineLayout = VK_NULL_HANDLE;
-	/** semaphore for synchronizing compute & graphics pipeline */
-	std::vector<VkSemaphore> particleComputeCompleteSemaphores;
+	/** compute timeline value of each frame's compute submission - command buffer reuse */
+	std::vector<uint64_t> computeTimelineValues;
+	/** compute timeline value of the last compute submission - waited by the next graphics submission */
+	uint64_t lastComputeValue = 0;
 	/** compute command pool */
 	VkCommandPool computeCommandPool = VK_NULL_HANDLE;
 	/** compute command buffers */
@@ -326,48 +314,21 @@ private:
 		uint32_t imageIndex = prepareFrame();
 
 		/*
-		* graphics command
+		* graphics command - waits for the last simulation step (0 before the first one)
 		*/
-		VkPipelineStageFlags waitStages[] = { 
-			VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 
-			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT 
-		};
-		VkSemaphore graphicsWaitSemaphores[] = { 
-			particleComputeCompleteSemaphores[currentFrame],
-			presentCompleteSemaphores[currentFrame]
-		};
-		VkSemaphore graphicsSignalSemaphores[] = { 
-			renderCompleteComputeSemaphores[currentFrame],
-			renderCompleteSemaphores[currentFrame] 
-		};
-
-		VkSubmitInfo submitInfo{ VK_STRUCTURE_TYPE_SUBMIT_INFO };
-		submitInfo.waitSemaphoreCount = 2;
-		submitInfo.pWaitSemaphores = graphicsWaitSemaphores;
-		submitInfo.pWaitDstStageMask = waitStages;
-		submitInfo.commandBufferCount = 1;
 		size_t commandBufferIndex = currentFrame * framebuffers.size() + imageIndex;
-		submitInfo.pCommandBuffers = &commandBuffers[commandBufferIndex];
-		submitInfo.signalSemaphoreCount = 2;
-		submitInfo.pSignalSemaphores = graphicsSignalSemaphores;
-		VK_CHECK_RESULT(vkQueueSubmit(devices.graphicsQueue, 1, &submitInfo, frameLimitFences[currentFrame]));
+		uint64_t graphicsValue = submitGraphics(imageIndex, { commandBuffers[commandBufferIndex] },
+			{ devices.timelineSync.makeWait(TimelineSync::COMPUTE, lastComputeValue, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT) });
 
 		submitFrame(imageIndex);
 
 		/*
-		* compute command
+		* compute command - waits for this frame's rendering, graphics & compute alternate
 		*/
-		VkPipelineStageFlags waitStageCompute = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
-
-		VkSubmitInfo computeSubmitInfo{ VK_STRUCTURE_TYPE_SUBMIT_INFO };
-		computeSubmitInfo.waitSemaphoreCount = 1;
-		computeSubmitInfo.pWaitSemaphores = &renderCompleteComputeSemaphores[currentFrame];
-		computeSubmitInfo.pWaitDstStageMask = &waitStageCompute;
-		computeSubmitInfo.commandBufferCount = 1;
-		computeSubmitInfo.pCommandBuffers = &computeCommandBuffers[currentFrame];
-		computeSubmitInfo.signalSemaphoreCount = 1;
-		computeSubmitInfo.pSignalSemaphores = &particleComputeCompleteSemaphores[currentFrame];
-		VK_CHECK_RESULT(vkQueueSubmit(devices.computeQueue, 1, &computeSubmitInfo, VK_NULL_HANDLE));
+		devices.timelineSync.wait(TimelineSync::COMPUTE, computeTimelineValues[currentFrame]);
+		lastComputeValue = devices.timelineSync.submit(TimelineSync::COMPUTE, { computeCommandBuffers[currentFrame] },
+			{ devices.timelineSync.makeWait(TimelineSync::GRAPHICS, graphicsValue, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT) });
+		computeTimelineValues[currentFrame] = lastComputeValue;
 	}
 
 	/*
@@ -382,6 +343,8 @@ private:
 	* override resize function - update offscreen resources
 	*/
 	void resizeWindow(bool /*recordCommandBuffer*/) override {
+		//offscreen attachments & per-frame descriptor sets are rewritten in place
+		waitFramesInFlight();
 		VulkanAppBase::resizeWindow(false);
 
 		createHDRBloomResources(true);
@@ -642,24 +605,18 @@ private:
 		/* create vertex buffer */
 		particleBufferSize = particles.size() * sizeof(Particle);
 
-		VkBuffer stagingBuffer;
-		MemoryAllocator::HostVisibleMemory hostVisibleMemory = 
-			devices.createBuffer(stagingBuffer, particleBufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-		hostVisibleMemory.mapData(devices.device, particles.data());
-	
 		devices.createBuffer(particleBuffer, particleBufferSize,
 			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
 			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | 
 			VK_BUFFER_USAGE_TRANSFER_DST_BIT);
 
-		VkCommandBuffer oneTimeCmdBuf = devices.beginCommandBuffer();
-		VkBufferCopy copy{};
-		copy.size = particleBufferSize;
-		vkCmdCopyBuffer(oneTimeCmdBuf, stagingBuffer, particleBuffer, 1, &copy);
+		//staged through the persistent staging ring - the batch is ordered before the ownership release below
+		devices.uploadManager.uploadBuffer(particleBuffer, particles.data(), particleBufferSize);
+		devices.uploadManager.submit();
 
-		//release buffer ownership to compute queue - cmopute command runs before graphics commands
-		if (separateComputeQueue) {
+		if(separateComputeQueue) {
+			//release buffer ownership to compute queue - cmopute command runs before graphics commands
+			VkCommandBuffer oneTimeCmdBuf = devices.beginCommandBuffer();
 			cmdTransferBufferOwnership(oneTimeCmdBuf,
 				particleBuffer, particleBufferSize,
 				VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
@@ -669,11 +626,8 @@ private:
 				VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
 				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
 			);
-		}
+			devices.endCommandBuffer(oneTimeCmdBuf);
 
-		devices.endCommandBuffer(oneTimeCmdBuf);
-
-		if(separateComputeQueue) {
 			//create one time submit compute command buffer
 			VkCommandBuffer oneTimeComputeCmdBuf = VK_NULL_HANDLE;
 			VkCommandBufferAllocateInfo allocInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
@@ -714,32 +668,6 @@ private:
 			VK_CHECK_RESULT(vkQueueWaitIdle(devices.computeQueue));
 			vkFreeCommandBuffers(devices.device, computeCommandPool, 1, &oneTimeComputeCmdBuf);
 		}
-
-		devices.memoryAllocator.freeBufferMemory(stagingBuffer,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-		vkDestroyBuffer(devices.device, stagingBuffer, nullptr);
-	}
-
-	/*
-	* create semaphore to sync compute & graphics pipeline
-	*/
-	void createComputeSemaphore() {
-		//create semaphore
-		particleComputeCompleteSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-		renderCompleteComputeSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-		VkSemaphoreCreateInfo semaphoreCreateInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
-		for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
-			VK_CHECK_RESULT(vkCreateSemaphore(devices.device, &semaphoreCreateInfo, nullptr, &particleComputeCompleteSemaphores[i]));
-			VK_CHECK_RESULT(vkCreateSemaphore(devices.device, &semaphoreCreateInfo, nullptr, &renderCompleteComputeSemaphores[i]));
-		}
-
-		//signal semaphore since graphics pipeline is used before compute pipeline
-		VkSubmitInfo submitInfo{};
-		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		submitInfo.pSignalSemaphores = particleComputeCompleteSemaphores.data();
-		submitInfo.signalSemaphoreCount = static_cast<uint32_t>(particleComputeCompleteSemaphores.size());
-		VK_CHECK_RESULT(vkQueueSubmit(devices.graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE));
-		VK_CHECK_RESULT(vkQueueWaitIdle(devices.graphicsQueue));
 	}
 
 	/*
@@ -902,9 +830,12 @@ private:
 	* create framebuffer - use swapchain images
 	*/
 	virtual void createFramebuffers() override {
-		for (auto& framebuffer : framebuffers) {
-			vkDestroyFramebuffer(devices.device, framebuffer, nullptr);
-		}
+		//old framebuffers may still be used by frames in flight
+		destroyLater([device = devices.device, oldFramebuffers = framebuffers]() {
+			for (VkFramebuffer framebuffer : oldFramebuffers) {
+				vkDestroyFramebuffer(device, framebuffer, nullptr);
+			}
+		});
 		framebuffers.resize(swapchain.imageCount);
 
 		for (size_t i = 0; i < swapchain.imageCount; ++i) {
@@ -1143,6 +1074,7 @@ private:
 	void createComputeCommandBuffers() {
 		//create command buffers
 		computeCommandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+		computeTimelineValues.resize(MAX_FRAMES_IN_FLIGHT, 0);
 		VkCommandBufferAllocateInfo compCmdBufInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
 		compCmdBufInfo.commandPool = computeCommandPool;
 		compCmdBufInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
@@ -1152,12 +1084,16 @@ private:
 	}
 
 	/*
-	* destroy compute command buffer
+	* destroy compute command buffer once the compute queue finished them
 	*/
 	void destroyComputeCommandBuffers() {
 		if (!computeCommandBuffers.empty()) {
-			vkFreeCommandBuffers(devices.device, devices.commandPool,
-				static_cast<uint32_t>(computeCommandBuffers.size()), computeCommandBuffers.data());
+			devices.timelineSync.destroyLater(TimelineSync::COMPUTE,
+				[device = devices.device, commandPool = computeCommandPool, oldCommandBuffers = computeCommandBuffers]() {
+					vkFreeCommandBuffers(device, commandPool,
+						static_cast<uint32_t>(oldCommandBuffers.size()), oldCommandBuffers.data());
+				});
+			computeCommandBuffers.clear();
 		}
 	}
 
@@ -75,8 +75,7 @@ public:
 
 		//uniform buffers
 		for (size_t i = 0; i < cameraUBO.size(); ++i) {
-			devices.memoryAllocator.freeBufferMemory(cameraUBO[i],
-				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+			devices.memoryAllocator.freeBufferMemory(cameraUBO[i]);
 			vkDestroyBuffer(devices.device, cameraUBO[i], nullptr);
 		}
 
@@ -85,7 +84,7 @@ public:
 		
 		//model & skybox buffers
 		gltfModel.cleanup();
-		devices.memoryAllocator.freeBufferMemory(skydomeBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		devices.memoryAllocator.freeBufferMemory(skydomeBuffer);
 		vkDestroyBuffer(devices.device, skydomeBuffer, nullptr);
 
 		//framebuffers
@@ -190,18 +189,8 @@ private:
 		uint32_t imageIndex = prepareFrame();
 
 		//render
-		VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-		VkSubmitInfo submitInfo{};
-		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		submitInfo.waitSemaphoreCount = 1;
-		submitInfo.pWaitSemaphores = &presentCompleteSemaphores[currentFrame];
-		submitInfo.pWaitDstStageMask = waitStages;
-		submitInfo.commandBufferCount = 1;
 		size_t commandBufferIndex = currentFrame * framebuffers.size() + imageIndex;
-		submitInfo.pCommandBuffers = &commandBuffers[commandBufferIndex];
-		submitInfo.signalSemaphoreCount = 1;
-		submitInfo.pSignalSemaphores = &renderCompleteSemaphores[currentFrame];
-		VK_CHECK_RESULT(vkQueueSubmit(devices.graphicsQueue, 1, &submitInfo, frameLimitFences[currentFrame]));
+		submitGraphics(imageIndex, { commandBuffers[commandBufferIndex] });
 
 		submitFrame(imageIndex);
 	}
@@ -446,9 +435,12 @@ private:
 	* create framebuffer - use swapchain images
 	*/
 	virtual void createFramebuffers() override {
-		for (auto& framebuffer : framebuffers) {
-			vkDestroyFramebuffer(devices.device, framebuffer, nullptr);
-		}
+		//old framebuffers may still be used by frames in flight
+		destroyLater([device = devices.device, oldFramebuffers = framebuffers]() {
+			for (VkFramebuffer framebuffer : oldFramebuffers) {
+				vkDestroyFramebuffer(device, framebuffer, nullptr);
+			}
+		});
 		framebuffers.resize(swapchain.imageCount);
 
 		for (size_t i = 0; i < swapchain.imageCount; ++i) {
@@ -475,6 +467,40 @@ private:
 		LOG("created:\tframebuffers");
 	}
 
+	/*
+	* record one row of spheres - metallic changes per row, roughness per column
+	*
+	* @param cmdBuf - secondary command buffer to record to
+	* @param descriptorSetIndex - frame index of the descriptor set
+	* @param y - row
+	* @param nbSphereSquared - spheres per row & column
+	*/
+	void recordSphereRow(VkCommandBuffer cmdBuf, size_t descriptorSetIndex, int y, int nbSphereSquared) {
+		vktools::setViewportScissorDynamicStates(cmdBuf, swapchain.extent);
+		vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, spherePipeline);
+		vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, spherePipelineLayout, 0, 1,
+			&descriptorSets[descriptorSetIndex], 0, nullptr);
+		VkDeviceSize offsets[] = { 0 };
+		vkCmdBindVertexBuffers(cmdBuf, 0, 1, &skydomeBuffer, offsets);
+		VkDeviceSize indexBufferOffset = skydome.vertices.bufferSize; // sizeof vertex buffer
+		vkCmdBindIndexBuffer(cmdBuf, skydomeBuffer, indexBufferOffset, skydome.indexType);
+
+		//local copy - rows are recorded concurrently
+		Imgui* imgui = static_cast<Imgui*>(imguiBase);
+		PushConstant spherePushConstant = pushConstant;
+		for (int x = 0; x < nbSphereSquared; ++x) {
+			glm::mat4 model = glm::translate(glm::mat4(1.f), glm::vec3((x - (nbSphereSquared / 2)) * 3, y * 3, 0));
+			spherePushConstant.modelMatrix = model;
+			spherePushConstant.normalMatrix = glm::inverse(glm::transpose(cameraMatrices.view * model));
+			spherePushConstant.metallic = y / (float)nbSphereSquared;
+			spherePushConstant.roughness = x / (float)nbSphereSquared;
+			spherePushConstant.lightPos = imgui->userInput.lightPos;
+			vkCmdPushConstants(cmdBuf, spherePipelineLayout,
+				VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PushConstant), &spherePushConstant);
+			vkCmdDrawIndexed(cmdBuf, skydome.indexCount, 1, 0, 0, 0);
+		}
+	}
+
 	/*
 	* record drawing commands to command buffers
 	*/
@@ -505,65 +531,60 @@ private:
 		renderPassBeginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
 		renderPassBeginInfo.pClearValues = clearValues.data();
 		
-		Imgui* imgui = static_cast<Imgui*>(imguiBase);
-
-		for (size_t i = 0; i < framebuffers.size() * MAX_FRAMES_IN_FLIGHT; ++i) {
-			size_t framebufferIndex = i % framebuffers.size();
-			renderPassBeginInfo.framebuffer = framebuffers[framebufferIndex];
-
-			VK_CHECK_RESULT(vkBeginCommandBuffer(commandBuffers[i], &cmdBufBeginInfo));
-			vkCmdBeginRenderPass(commandBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-			//dynamic states
-			vktools::setViewportScissorDynamicStates(commandBuffers[i], swapchain.extent);
-			size_t descriptorSetIndex = i / framebuffers.size();
-
-			VkDeviceSize offsets[] = { 0, 0, 0 };
-			
-			/*
-			* draw spheres
-			*/
-			vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, spherePipeline);
-			vkCmdBindDescriptorSets(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, spherePipelineLayout, 0, 1,
-				&descriptorSets[descriptorSetIndex], 0, nullptr);
-			vkCmdBindVertexBuffers(commandBuffers[i], 0, 1, &skydomeBuffer, offsets);
-			size_t indexBufferOffset = skydome.vertices.bufferSize; // sizeof vertex buffer
-			vkCmdBindIndexBuffer(commandBuffers[i], skydomeBuffer, indexBufferOffset, VK_INDEX_TYPE_UINT32);
-
-			const int nbSphereSquared = 8;
-			for (int y = 0; y < nbSphereSquared; ++y) {
-				for (int x = 0; x < nbSphereSquared; ++x) {
-					glm::mat4 model = glm::translate(glm::mat4(1.f), glm::vec3((x - (nbSphereSquared / 2)) * 3, y * 3, 0));
-					pushConstant.modelMatrix = model;
-					pushConstant.normalMatrix = glm::inverse(glm::transpose(cameraMatrices.view * model));
-					pushConstant.metallic = y / (float)nbSphereSquared;
-					pushConstant.roughness = x / (float)nbSphereSquared;
-					pushConstant.lightPos = imgui->userInput.lightPos;
-					vkCmdPushConstants(commandBuffers[i], spherePipelineLayout,
-						VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PushConstant), &pushConstant);
-					vkCmdDrawIndexed(commandBuffers[i], static_cast<uint32_t>(skydome.indices.size()), 1, 0, 0, 0);
+		//spheres (a batch per row), skybox & imgui are recorded into secondaries concurrently
+		const int nbSphereSquared = 8;
+		const size_t taskCount = nbSphereSquared + 2;
+		for (size_t descriptorSetIndex = 0; descriptorSetIndex < static_cast<size_t>(MAX_FRAMES_IN_FLIGHT); ++descriptorSetIndex) {
+			commandRecorder.beginFrame(descriptorSetIndex);
+
+			std::vector<CommandRecorder::Task> tasks;
+			for (size_t framebufferIndex = 0; framebufferIndex < framebuffers.size(); ++framebufferIndex) {
+				VkFramebuffer framebuffer = framebuffers[framebufferIndex];
+				/*
+				* draw spheres
+				*/
+				for (int y = 0; y < nbSphereSquared; ++y) {
+					tasks.push_back(CommandRecorder::makeTask(renderPass, framebuffer,
+						[this, descriptorSetIndex, y, nbSphereSquared](VkCommandBuffer cmdBuf) {
+							recordSphereRow(cmdBuf, descriptorSetIndex, y, nbSphereSquared);
+						}));
 				}
+
+				/*
+				* draw skybox
+				*/
+				tasks.push_back(CommandRecorder::makeTask(renderPass, framebuffer,
+					[this, descriptorSetIndex](VkCommandBuffer cmdBuf) {
+						vktools::setViewportScissorDynamicStates(cmdBuf, swapchain.extent);
+						vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, skyboxPipeline);
+						vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1,
+							&descriptorSets[descriptorSetIndex], 0, nullptr);
+
+						VkDeviceSize offsets[] = { 0 };
+						vkCmdBindVertexBuffers(cmdBuf, 0, 1, &skydomeBuffer, offsets);
+						VkDeviceSize indexBufferOffset = skydome.vertices.bufferSize; // sizeof vertex buffer
+						vkCmdBindIndexBuffer(cmdBuf, skydomeBuffer, indexBufferOffset, skydome.indexType);
+						vkCmdDrawIndexed(cmdBuf, skydome.indexCount, 1, 0, 0, 0);
+					}));
+
+				/*
+				* imgui
+				*/
+				tasks.push_back(CommandRecorder::makeTask(renderPass, framebuffer,
+					[this, descriptorSetIndex](VkCommandBuffer cmdBuf) { imguiBase->drawFrame(cmdBuf, descriptorSetIndex); }));
 			}
+			std::vector<VkCommandBuffer> secondaries = commandRecorder.record(descriptorSetIndex, tasks);
+
+			for (size_t framebufferIndex = 0; framebufferIndex < framebuffers.size(); ++framebufferIndex) {
+				size_t i = descriptorSetIndex * framebuffers.size() + framebufferIndex;
+				renderPassBeginInfo.framebuffer = framebuffers[framebufferIndex];
 
-			/*
-			* draw skybox
-			*/
-			vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, skyboxPipeline);
-			vkCmdBindDescriptorSets(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1,
-				&descriptorSets[descriptorSetIndex], 0, nullptr);
-
-			vkCmdBindVertexBuffers(commandBuffers[i], 0, 1, &skydomeBuffer, offsets);
-			
-			vkCmdBindIndexBuffer(commandBuffers[i], skydomeBuffer, indexBufferOffset, VK_INDEX_TYPE_UINT32);
-			vkCmdDrawIndexed(commandBuffers[i], static_cast<uint32_t>(skydome.indices.size()), 1, 0, 0, 0);
-			
-			/*
-			* imgui
-			*/
-			imguiBase->drawFrame(commandBuffers[i], descriptorSetIndex);
-
-			vkCmdEndRenderPass(commandBuffers[i]);
-			VK_CHECK_RESULT(vkEndCommandBuffer(commandBuffers[i]));
+				VK_CHECK_RESULT(vkBeginCommandBuffer(commandBuffers[i], &cmdBufBeginInfo));
+				vkCmdBeginRenderPass(commandBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+				vkCmdExecuteCommands(commandBuffers[i], static_cast<uint32_t>(taskCount), &secondaries[framebufferIndex * taskCount]);
+				vkCmdEndRenderPass(commandBuffers[i]);
+				VK_CHECK_RESULT(vkEndCommandBuffer(commandBuffers[i]));
+			}
 		}
 		LOG("built:\t\tcommand buffers");
 	}
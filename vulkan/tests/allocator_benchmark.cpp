@@ -0,0 +1,232 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "mock_vulkan.h"
+#include "core/vulkan_memory_allocator.h"
+
+/*
+* cpu microbenchmark of MemoryAllocator on the mock device memory backend
+* TLSF suballocation vs the chunk scanner it replaced, at 1k / 10k / 100k buffers
+* phases: allocate all, free a random half, allocate the half again, free all
+*/
+namespace {
+	/** default chunk size of MemoryAllocator */
+	constexpr VkDeviceSize CHUNK_SIZE = 268435000;
+
+	/*
+	* chunk scanner used by MemoryAllocator before the TLSF allocator - buffers only, no bufferImageGranularity
+	* every allocation walks the blocks of every chunk & sorts the chunk's block vector, free searches linearly
+	*/
+	class ChunkScanner {
+	public:
+		void allocate(VkBuffer buffer) {
+			VkMemoryRequirements memRequirements;
+			vkGetBufferMemoryRequirements(mock::getDevice(), buffer, &memRequirements);
+
+			for (Chunk& chunk : chunks) {
+				if (chunk.currentSize > memRequirements.size && chunk.allocate(buffer, memRequirements)) {
+					return;
+				}
+			}
+
+			chunks.emplace_back();
+			Chunk& chunk = chunks.back();
+			VkMemoryAllocateInfo allocInfo{ VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
+			allocInfo.allocationSize = CHUNK_SIZE;
+			VK_CHECK_RESULT(vkAllocateMemory(mock::getDevice(), &allocInfo, nullptr, &chunk.memory));
+			chunk.currentSize = CHUNK_SIZE;
+			chunk.allocate(buffer, memRequirements);
+		}
+
+		void free(VkBuffer buffer) {
+			for (Chunk& chunk : chunks) {
+				auto it = std::find_if(chunk.blocks.begin(), chunk.blocks.end(),
+					[buffer](const Block& block) { return block.buffer == buffer; });
+				if (it != chunk.blocks.end()) {
+					chunk.currentSize += it->blockEndLocation - it->offset;
+					chunk.blocks.erase(it);
+					return;
+				}
+			}
+			throw std::runtime_error("ChunkScanner::free(): there is no matching buffer");
+		}
+
+		void cleanup() {
+			for (Chunk& chunk : chunks) {
+				vkFreeMemory(mock::getDevice(), chunk.memory, nullptr);
+			}
+			chunks.clear();
+		}
+
+	private:
+		struct Block {
+			VkBuffer buffer;
+			VkDeviceSize offset;
+			VkDeviceSize blockEndLocation;
+		};
+
+		struct Chunk {
+			VkDeviceMemory memory = VK_NULL_HANDLE;
+			VkDeviceSize currentSize = 0;
+			std::vector<Block> blocks;
+
+			bool allocate(VkBuffer buffer, const VkMemoryRequirements& memRequirements) {
+				Block block{ buffer, 0, memRequirements.size };
+				bool found = blocks.empty();
+				for (size_t i = 0; !found && i < blocks.size(); ++i) {
+					VkDeviceSize location = (blocks[i].blockEndLocation + memRequirements.alignment - 1) /
+						memRequirements.alignment * memRequirements.alignment;
+					VkDeviceSize next = (i + 1 == blocks.size()) ? CHUNK_SIZE : blocks[i + 1].offset;
+					if (next > location + memRequirements.size) {
+						block = { buffer, location, location + memRequirements.size };
+						found = true;
+					}
+				}
+				if (!found) {
+					return false;
+				}
+
+				blocks.push_back(block);
+				std::sort(blocks.begin(), blocks.end(), [](const Block& l, const Block& r) { return l.offset < r.offset; });
+				currentSize -= block.blockEndLocation - block.offset;
+				vkBindBufferMemory(mock::getDevice(), buffer, memory, block.offset);
+				return true;
+			}
+		};
+		std::vector<Chunk> chunks;
+	};
+
+	/** milliseconds of each phase */
+	struct Timings {
+		double allocate = 0.0;
+		double freeHalf = 0.0;
+		double reallocate = 0.0;
+		double freeAll = 0.0;
+	};
+
+	/*
+	* milliseconds spent in function
+	*/
+	template<typename Function>
+	double measure(Function function) {
+		auto start = std::chrono::steady_clock::now();
+		function();
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	/*
+	* run the phases with allocate / free callbacks on fresh buffers
+	*
+	* @param sizes - buffer sizes
+	* @param freeOrder - indices of the half freed & reallocated in phase 2 & 3
+	*/
+	template<typename Allocate, typename Free>
+	Timings run(const std::vector<VkDeviceSize>& sizes, const std::vector<size_t>& freeOrder,
+		Allocate allocate, Free free) {
+		std::vector<VkBuffer> buffers;
+		for (VkDeviceSize size : sizes) {
+			buffers.push_back(mock::createBuffer(size));
+		}
+		size_t half = freeOrder.size() / 2;
+
+		Timings timings;
+		timings.allocate = measure([&]() {
+			for (VkBuffer buffer : buffers) {
+				allocate(buffer);
+			}
+		});
+		timings.freeHalf = measure([&]() {
+			for (size_t i = 0; i < half; ++i) {
+				free(buffers[freeOrder[i]]);
+			}
+		});
+		for (size_t i = 0; i < half; ++i) {
+			vkDestroyBuffer(mock::getDevice(), buffers[freeOrder[i]], nullptr);
+			buffers[freeOrder[i]] = mock::createBuffer(sizes[freeOrder[i]]);
+		}
+		timings.reallocate = measure([&]() {
+			for (size_t i = 0; i < half; ++i) {
+				allocate(buffers[freeOrder[i]]);
+			}
+		});
+		timings.freeAll = measure([&]() {
+			for (VkBuffer buffer : buffers) {
+				free(buffer);
+			}
+		});
+
+		std::string error;
+		if (!mock::validateBindings(error)) {
+			throw std::runtime_error(error);
+		}
+		for (VkBuffer buffer : buffers) {
+			vkDestroyBuffer(mock::getDevice(), buffer, nullptr);
+		}
+		return timings;
+	}
+
+	void print(const char* name, size_t count, const Timings& timings) {
+		std::cout << std::left << std::setw(14) << name << std::right << std::setw(8) << count << std::fixed << std::setprecision(2)
+			<< std::setw(14) << timings.allocate << std::setw(14) << timings.freeHalf
+			<< std::setw(14) << timings.reallocate << std::setw(14) << timings.freeAll << std::endl;
+	}
+}
+
+/*
+* usage: allocator_benchmark [count...] - default 1000 10000 100000
+*/
+int main(int argc, char** argv) {
+	std::vector<size_t> counts = { 1000, 10000, 100000 };
+	if (argc > 1) {
+		counts.clear();
+		for (int i = 1; i < argc; ++i) {
+			counts.push_back(std::strtoull(argv[i], nullptr, 10));
+		}
+	}
+
+	std::cout << "milliseconds - buffers of 8 KiB to 64 KiB, device local" << std::endl;
+	std::cout << std::left << std::setw(14) << "allocator" << std::right << std::setw(8) << "count"
+		<< std::setw(14) << "allocate" << std::setw(14) << "free half"
+		<< std::setw(14) << "reallocate" << std::setw(14) << "free all" << std::endl;
+
+	try {
+		for (size_t count : counts) {
+			//same sizes & free order for both allocators
+			std::mt19937 random(static_cast<uint32_t>(count));
+			std::uniform_int_distribution<VkDeviceSize> sizeDistribution(8 * 1024, 64 * 1024);
+			std::vector<VkDeviceSize> sizes(count);
+			for (VkDeviceSize& size : sizes) {
+				size = sizeDistribution(random);
+			}
+			std::vector<size_t> freeOrder(count);
+			for (size_t i = 0; i < count; ++i) {
+				freeOrder[i] = i;
+			}
+			std::shuffle(freeOrder.begin(), freeOrder.end(), random);
+
+			MemoryAllocator allocator;
+			allocator.init(mock::getDevice(), 1024, 64, mock::getMemoryProperties());
+			Timings tlsf = run(sizes, freeOrder,
+				[&allocator](VkBuffer buffer) { allocator.allocateBufferMemory(buffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT); },
+				[&allocator](VkBuffer buffer) { allocator.freeBufferMemory(buffer); });
+			allocator.cleanup();
+			print("tlsf", count, tlsf);
+
+			ChunkScanner scanner;
+			Timings scan = run(sizes, freeOrder,
+				[&scanner](VkBuffer buffer) { scanner.allocate(buffer); },
+				[&scanner](VkBuffer buffer) { scanner.free(buffer); });
+			scanner.cleanup();
+			print("chunk scanner", count, scan);
+		}
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
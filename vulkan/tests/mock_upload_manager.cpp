@@ -0,0 +1,56 @@
+#include <algorithm>
+#include <mutex>
+#include "mock_upload_manager.h"
+#include "core/vulkan_upload_manager.h"
+
+namespace {
+	std::mutex mutex;
+	VkDeviceSize stagedSize = 0;
+	std::vector<unsigned char> stagedData;
+	size_t submitCount = 0;
+}
+
+/*
+* keep the requested size & return fresh host memory followed by guard bytes
+*/
+void* UploadManager::stageBuffer(VkBuffer, VkDeviceSize, VkDeviceSize size) {
+	std::lock_guard<std::mutex> lock(mutex);
+	stagedSize = size;
+	stagedData.assign(static_cast<size_t>(size) + mock::STAGING_GUARD_SIZE, mock::STAGING_GUARD_VALUE);
+	return stagedData.data();
+}
+
+/*
+* nothing to record - count the call, the ticket is the call number
+*/
+UploadManager::Ticket UploadManager::submit() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return ++submitCount;
+}
+
+namespace mock {
+	VkDeviceSize getStagedSize() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return stagedSize;
+	}
+
+	const std::vector<unsigned char>& getStagedData() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return stagedData;
+	}
+
+	/*
+	* check the guard bytes behind the last staged region
+	*/
+	bool isStagingGuardIntact() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return stagedData.size() >= STAGING_GUARD_SIZE &&
+			std::all_of(stagedData.end() - STAGING_GUARD_SIZE, stagedData.end(),
+				[](unsigned char value) { return value == STAGING_GUARD_VALUE; });
+	}
+
+	size_t getSubmitCount() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return submitCount;
+	}
+}
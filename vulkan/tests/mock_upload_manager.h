@@ -0,0 +1,24 @@
+#pragma once
+#include <vector>
+#include <vulkan/vulkan.h>
+
+/*
+* mock upload manager - defines UploadManager::stageBuffer & submit() on host memory, no queue or staging ring needed
+* the last staged region is kept so tests can check what a caller wrote into it
+* staged memory is followed by guard bytes to detect writes past the reserved size
+*/
+namespace mock {
+	/** bytes after every staged region */
+	constexpr size_t STAGING_GUARD_SIZE = 256;
+	/** value of every guard byte */
+	constexpr unsigned char STAGING_GUARD_VALUE = 0xcd;
+
+	/** @brief size requested by the last stageBuffer call */
+	VkDeviceSize getStagedSize();
+	/** @brief staged bytes of the last stageBuffer call followed by its guard bytes */
+	const std::vector<unsigned char>& getStagedData();
+	/** @brief true if the guard bytes of the last staged region are untouched */
+	bool isStagingGuardIntact();
+	/** @brief number of submit calls */
+	size_t getSubmitCount();
+}
@@ -0,0 +1,301 @@
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "mock_vulkan.h"
+#include "core/vulkan_utils.h"
+
+namespace {
+	/** created buffer / image */
+	struct Resource {
+		VkDeviceSize size = 0;
+		VkDeviceSize alignment = 0;
+		/** VK_NULL_HANDLE until bound */
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkDeviceSize offset = 0;
+	};
+
+	/** allocated device memory */
+	struct Memory {
+		VkDeviceSize size = 0;
+		/** host backing - allocated on first map */
+		std::unique_ptr<uint8_t[]> hostData;
+	};
+
+	std::mutex mutex;
+	std::atomic<uint64_t> nextHandle{ 1 };
+	std::unordered_map<uint64_t, Resource> resources;
+	std::unordered_map<uint64_t, Memory> memories;
+	/** first invalid bind - reported by validateBindings */
+	std::string bindError;
+
+	/*
+	* unique non-zero value used as handle
+	*/
+	template<typename T>
+	T createHandle() {
+		return reinterpret_cast<T>(nextHandle.fetch_add(1));
+	}
+
+	/*
+	* record binding of a buffer / image
+	*/
+	VkResult bind(uint64_t handle, VkDeviceMemory memory, VkDeviceSize offset) {
+		std::lock_guard<std::mutex> lock(mutex);
+		auto resource = resources.find(handle);
+		auto deviceMemory = memories.find(reinterpret_cast<uint64_t>(memory));
+		if (resource == resources.end() || deviceMemory == memories.end() ||
+			resource->second.memory != VK_NULL_HANDLE || offset % resource->second.alignment != 0 ||
+			offset + resource->second.size > deviceMemory->second.size) {
+			if (bindError.empty()) {
+				bindError = "invalid bind of handle " + std::to_string(handle) + " at offset " + std::to_string(offset);
+			}
+			return VK_ERROR_VALIDATION_FAILED_EXT;
+		}
+		resource->second.memory = memory;
+		resource->second.offset = offset;
+		return VK_SUCCESS;
+	}
+
+	/*
+	* requirements of a created buffer / image
+	*/
+	void getRequirements(uint64_t handle, VkMemoryRequirements& memRequirements) {
+		std::lock_guard<std::mutex> lock(mutex);
+		const Resource& resource = resources.at(handle);
+		memRequirements.size = resource.size;
+		memRequirements.alignment = resource.alignment;
+		memRequirements.memoryTypeBits = ~0u;
+	}
+}
+
+namespace mock {
+	/*
+	* fake logical device handle - never dereferenced
+	*/
+	VkDevice getDevice() {
+		return reinterpret_cast<VkDevice>(uintptr_t(1));
+	}
+
+	/*
+	* memory types of a discrete gpu - device local, host visible & device local + host visible (bar)
+	*
+	* @return VkPhysicalDeviceMemoryProperties
+	*/
+	VkPhysicalDeviceMemoryProperties getMemoryProperties() {
+		VkPhysicalDeviceMemoryProperties memProperties{};
+		memProperties.memoryTypeCount = 3;
+		memProperties.memoryTypes[0] = { VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0 };
+		memProperties.memoryTypes[1] = { VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 1 };
+		memProperties.memoryTypes[2] = { VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+			VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 2 };
+		memProperties.memoryHeapCount = 3;
+		memProperties.memoryHeaps[0] = { VkDeviceSize(8) << 30, VK_MEMORY_HEAP_DEVICE_LOCAL_BIT };
+		memProperties.memoryHeaps[1] = { VkDeviceSize(16) << 30, 0 };
+		memProperties.memoryHeaps[2] = { VkDeviceSize(256) << 20, VK_MEMORY_HEAP_DEVICE_LOCAL_BIT };
+		return memProperties;
+	}
+
+	/*
+	* create buffer usable by defragmentation
+	*
+	* @param size - buffer size
+	*
+	* @return VkBuffer
+	*/
+	VkBuffer createBuffer(VkDeviceSize size) {
+		VkBufferCreateInfo createInfo{ VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+		createInfo.size = size;
+		createInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VK_CHECK_RESULT(vkCreateBuffer(getDevice(), &createInfo, nullptr, &buffer));
+		return buffer;
+	}
+
+	/*
+	* create 2d rgba8 image
+	*
+	* @param width
+	* @param height
+	*
+	* @return VkImage
+	*/
+	VkImage createImage(uint32_t width, uint32_t height) {
+		VkImageCreateInfo createInfo{ VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
+		createInfo.imageType = VK_IMAGE_TYPE_2D;
+		createInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+		createInfo.extent = { width, height, 1 };
+		createInfo.mipLevels = 1;
+		createInfo.arrayLayers = 1;
+		createInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		createInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		createInfo.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+		VkImage image = VK_NULL_HANDLE;
+		VK_CHECK_RESULT(vkCreateImage(getDevice(), &createInfo, nullptr, &image));
+		return image;
+	}
+
+	/*
+	* number of device memory objects which are not freed
+	*
+	* @return size_t
+	*/
+	size_t getLiveMemoryCount() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return memories.size();
+	}
+
+	/*
+	* check bound ranges of live resources - sorted per device memory, neighbours must not overlap
+	* binds which broke alignment, memory size or bound a resource twice are reported as well
+	*
+	* @param error - out, first problem if the return value is false
+	*
+	* @return bool - true if every bind was valid & no two live resources share a byte
+	*/
+	bool validateBindings(std::string& error) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!bindError.empty()) {
+			error = bindError;
+			return false;
+		}
+		std::map<std::pair<uint64_t, VkDeviceSize>, VkDeviceSize> ranges;
+		for (const auto& resource : resources) {
+			if (resource.second.memory != VK_NULL_HANDLE) {
+				ranges[{ reinterpret_cast<uint64_t>(resource.second.memory), resource.second.offset }] = resource.second.size;
+			}
+		}
+
+		auto prev = ranges.end();
+		for (auto it = ranges.begin(); it != ranges.end(); prev = it++) {
+			if (prev != ranges.end() && prev->first.first == it->first.first &&
+				prev->first.second + prev->second > it->first.second) {
+				error = "memory " + std::to_string(it->first.first) + ": [" + std::to_string(prev->first.second) + ", " +
+					std::to_string(prev->first.second + prev->second) + ") overlaps [" + std::to_string(it->first.second) + ", " +
+					std::to_string(it->first.second + it->second) + ")";
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+/*
+* vulkan entry points used by MemoryAllocator
+*/
+VKAPI_ATTR VkResult VKAPI_CALL vkAllocateMemory(VkDevice, const VkMemoryAllocateInfo* pAllocateInfo,
+	const VkAllocationCallbacks*, VkDeviceMemory* pMemory) {
+	*pMemory = createHandle<VkDeviceMemory>();
+	std::lock_guard<std::mutex> lock(mutex);
+	memories[reinterpret_cast<uint64_t>(*pMemory)].size = pAllocateInfo->allocationSize;
+	return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkFreeMemory(VkDevice, VkDeviceMemory memory, const VkAllocationCallbacks*) {
+	std::lock_guard<std::mutex> lock(mutex);
+	memories.erase(reinterpret_cast<uint64_t>(memory));
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkMapMemory(VkDevice, VkDeviceMemory memory, VkDeviceSize offset, VkDeviceSize,
+	VkMemoryMapFlags, void** ppData) {
+	std::lock_guard<std::mutex> lock(mutex);
+	Memory& deviceMemory = memories.at(reinterpret_cast<uint64_t>(memory));
+	if (!deviceMemory.hostData) {
+		deviceMemory.hostData.reset(new uint8_t[deviceMemory.size]);
+	}
+	*ppData = deviceMemory.hostData.get() + offset;
+	return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkUnmapMemory(VkDevice, VkDeviceMemory) {}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkFlushMappedMemoryRanges(VkDevice, uint32_t, const VkMappedMemoryRange*) {
+	return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkInvalidateMappedMemoryRanges(VkDevice, uint32_t, const VkMappedMemoryRange*) {
+	return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkCreateBuffer(VkDevice, const VkBufferCreateInfo* pCreateInfo,
+	const VkAllocationCallbacks*, VkBuffer* pBuffer) {
+	*pBuffer = createHandle<VkBuffer>();
+	std::lock_guard<std::mutex> lock(mutex);
+	Resource& resource = resources[reinterpret_cast<uint64_t>(*pBuffer)];
+	resource.size = (pCreateInfo->size + mock::BUFFER_ALIGNMENT - 1) / mock::BUFFER_ALIGNMENT * mock::BUFFER_ALIGNMENT;
+	resource.alignment = mock::BUFFER_ALIGNMENT;
+	return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkDestroyBuffer(VkDevice, VkBuffer buffer, const VkAllocationCallbacks*) {
+	std::lock_guard<std::mutex> lock(mutex);
+	resources.erase(reinterpret_cast<uint64_t>(buffer));
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkCreateImage(VkDevice, const VkImageCreateInfo* pCreateInfo,
+	const VkAllocationCallbacks*, VkImage* pImage) {
+	*pImage = createHandle<VkImage>();
+	VkDeviceSize size = VkDeviceSize(pCreateInfo->extent.width) * pCreateInfo->extent.height * pCreateInfo->extent.depth * 4;
+	std::lock_guard<std::mutex> lock(mutex);
+	Resource& resource = resources[reinterpret_cast<uint64_t>(*pImage)];
+	resource.size = (size + mock::IMAGE_ALIGNMENT - 1) / mock::IMAGE_ALIGNMENT * mock::IMAGE_ALIGNMENT;
+	resource.alignment = mock::IMAGE_ALIGNMENT;
+	return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkDestroyImage(VkDevice, VkImage image, const VkAllocationCallbacks*) {
+	std::lock_guard<std::mutex> lock(mutex);
+	resources.erase(reinterpret_cast<uint64_t>(image));
+}
+
+VKAPI_ATTR void VKAPI_CALL vkGetBufferMemoryRequirements(VkDevice, VkBuffer buffer,
+	VkMemoryRequirements* pMemoryRequirements) {
+	getRequirements(reinterpret_cast<uint64_t>(buffer), *pMemoryRequirements);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkGetImageMemoryRequirements(VkDevice, VkImage image,
+	VkMemoryRequirements* pMemoryRequirements) {
+	getRequirements(reinterpret_cast<uint64_t>(image), *pMemoryRequirements);
+}
+
+//pNext (VkMemoryDedicatedRequirements) is left as is - the mock never prefers dedicated allocations
+VKAPI_ATTR void VKAPI_CALL vkGetBufferMemoryRequirements2(VkDevice, const VkBufferMemoryRequirementsInfo2* pInfo,
+	VkMemoryRequirements2* pMemoryRequirements) {
+	getRequirements(reinterpret_cast<uint64_t>(pInfo->buffer), pMemoryRequirements->memoryRequirements);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkGetImageMemoryRequirements2(VkDevice, const VkImageMemoryRequirementsInfo2* pInfo,
+	VkMemoryRequirements2* pMemoryRequirements) {
+	getRequirements(reinterpret_cast<uint64_t>(pInfo->image), pMemoryRequirements->memoryRequirements);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkBindBufferMemory(VkDevice, VkBuffer buffer, VkDeviceMemory memory,
+	VkDeviceSize memoryOffset) {
+	return bind(reinterpret_cast<uint64_t>(buffer), memory, memoryOffset);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkBindImageMemory(VkDevice, VkImage image, VkDeviceMemory memory,
+	VkDeviceSize memoryOffset) {
+	return bind(reinterpret_cast<uint64_t>(image), memory, memoryOffset);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkGetPhysicalDeviceMemoryProperties2(VkPhysicalDevice,
+	VkPhysicalDeviceMemoryProperties2* pMemoryProperties) {
+	pMemoryProperties->memoryProperties = mock::getMemoryProperties();
+}
+
+//copies are recorded into the caller's command buffer - nothing to execute without a gpu
+VKAPI_ATTR void VKAPI_CALL vkCmdPipelineBarrier(VkCommandBuffer, VkPipelineStageFlags, VkPipelineStageFlags,
+	VkDependencyFlags, uint32_t, const VkMemoryBarrier*, uint32_t, const VkBufferMemoryBarrier*,
+	uint32_t, const VkImageMemoryBarrier*) {}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdCopyBuffer(VkCommandBuffer, VkBuffer, VkBuffer, uint32_t, const VkBufferCopy*) {}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdCopyImage(VkCommandBuffer, VkImage, VkImageLayout, VkImage, VkImageLayout,
+	uint32_t, const VkImageCopy*) {}
+
+namespace vktools {
+	void insertImageMemoryBarrier(VkCommandBuffer, VkImage, VkAccessFlags, VkAccessFlags, VkImageLayout, VkImageLayout,
+		VkPipelineStageFlags, VkPipelineStageFlags, VkImageSubresourceRange) {}
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <string>
+#include <vulkan/vulkan.h>
+
+/*
+* mock device memory backend - defines the vulkan entry points MemoryAllocator calls, no gpu or loader needed
+* device memory is only a handle (host visible memory is backed by host memory once mapped)
+* every bind is recorded so tests can check that live resources never share bytes
+* all functions are thread safe
+*/
+namespace mock {
+	/** alignment reported by vkGetBufferMemoryRequirements */
+	constexpr VkDeviceSize BUFFER_ALIGNMENT = 256;
+	/** alignment reported by vkGetImageMemoryRequirements */
+	constexpr VkDeviceSize IMAGE_ALIGNMENT = 4096;
+
+	/** @brief fake logical device handle */
+	VkDevice getDevice();
+	/** @brief device local, host visible & device local + host visible memory types on separate heaps */
+	VkPhysicalDeviceMemoryProperties getMemoryProperties();
+	/** @brief vkCreateBuffer with transfer src & dst usage */
+	VkBuffer createBuffer(VkDeviceSize size);
+	/** @brief vkCreateImage of a 2d rgba8 image */
+	VkImage createImage(uint32_t width, uint32_t height);
+	/** @brief number of vkAllocateMemory calls without matching vkFreeMemory */
+	size_t getLiveMemoryCount();
+	/** @brief check binds & bound ranges of live resources - false & a description on invalid bind or overlap */
+	bool validateBindings(std::string& error);
+}
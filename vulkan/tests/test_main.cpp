@@ -0,0 +1,43 @@
+#include <iostream>
+#include <vector>
+#include "tests.h"
+
+/*
+* run every test - exit code is the number of failed tests
+*/
+int main() {
+	struct Test {
+		const char* name;
+		void(*function)();
+	};
+	std::vector<Test> tests = {
+		{ "memory allocator exact fit", testMemoryAllocatorExactFit },
+		{ "memory allocator defragment moves once", testMemoryAllocatorDefragmentMovesOnce },
+		{ "memory allocator thread stress", testMemoryAllocatorThreadStress },
+		{ "meshlet limits & coverage", testMeshletLimitsAndCoverage },
+		{ "meshlet bounds", testMeshletBounds },
+		{ "build clusters keeps source order", testBuildClustersKeepsSourceOrder },
+		{ "model buffer stages every 16 bit index", testModelBufferStagesEveryIndex16 },
+		{ "model buffer stages every 32 bit index", testModelBufferStagesEveryIndex32 },
+		{ "mesh cache round trip", testMeshCacheRoundTrip },
+		{ "mesh cache load matches parse", testMeshCacheLoadMatchesParse },
+		{ "mesh cache rebuilds stale & truncated", testMeshCacheRebuildsStaleAndTruncated },
+		{ "obj parser polygons", testObjParserPolygons },
+		{ "obj parser line endings", testObjParserLineEndings },
+		{ "obj parser relative indices", testObjParserRelativeIndices },
+	};
+
+	int failed = 0;
+	for (const Test& test : tests) {
+		try {
+			test.function();
+			std::cout << "passed:\t" << test.name << std::endl;
+		}
+		catch (const std::exception& e) {
+			std::cerr << "FAILED:\t" << test.name << " - " << e.what() << std::endl;
+			++failed;
+		}
+	}
+	std::cout << tests.size() - failed << " / " << tests.size() << " tests passed" << std::endl;
+	return failed;
+}
@@ -0,0 +1,219 @@
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+#include "tests.h"
+#include "mock_vulkan.h"
+#include "core/vulkan_memory_allocator.h"
+
+namespace {
+	/** small chunks so tests fill them quickly - resources above a quarter of it get dedicated memory */
+	constexpr uint32_t TEST_CHUNK_SIZE = 1 << 20;
+
+	/*
+	* allocator on the mock backend
+	*/
+	void initAllocator(MemoryAllocator& allocator) {
+		allocator.init(mock::getDevice(), 1024, 64, mock::getMemoryProperties(), 0, TEST_CHUNK_SIZE);
+	}
+
+	/*
+	* throw if a bind was invalid or two live resources overlap
+	*/
+	void checkBindings() {
+		std::string error;
+		if (!mock::validateBindings(error)) {
+			throw std::runtime_error(error);
+		}
+	}
+}
+
+/*
+* a freed block of exactly the requested size is reused instead of allocating a new chunk
+*/
+void testMemoryAllocatorExactFit() {
+	MemoryAllocator allocator;
+	initAllocator(allocator);
+	size_t liveMemoryCount = mock::getLiveMemoryCount();
+
+	//fill one chunk completely
+	const VkDeviceSize bufferSize = TEST_CHUNK_SIZE / 16;
+	std::vector<VkBuffer> buffers;
+	std::vector<MemoryAllocator::HostVisibleMemory> memories;
+	for (int i = 0; i < 16; ++i) {
+		buffers.push_back(mock::createBuffer(bufferSize));
+		memories.push_back(allocator.allocateBufferMemory(buffers.back(), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
+	}
+	CHECK(mock::getLiveMemoryCount() == liveMemoryCount + 1);
+
+	//free a block in the middle & allocate the same size again
+	allocator.freeBufferMemory(buffers[7]);
+	vkDestroyBuffer(mock::getDevice(), buffers[7], nullptr);
+	buffers[7] = mock::createBuffer(bufferSize);
+	MemoryAllocator::HostVisibleMemory memory = allocator.allocateBufferMemory(buffers[7], VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	CHECK(mock::getLiveMemoryCount() == liveMemoryCount + 1);
+	CHECK(memory.memory == memories[7].memory && memory.offset == memories[7].offset);
+	checkBindings();
+
+	for (VkBuffer buffer : buffers) {
+		allocator.freeBufferMemory(buffer);
+		vkDestroyBuffer(mock::getDevice(), buffer, nullptr);
+	}
+	allocator.cleanup();
+	CHECK(mock::getLiveMemoryCount() == liveMemoryCount);
+}
+
+/*
+* a relocated resource is moved once - the source waits for the caller to free it & is no candidate anymore
+*/
+void testMemoryAllocatorDefragmentMovesOnce() {
+	MemoryAllocator allocator;
+	initAllocator(allocator);
+	size_t liveMemoryCount = mock::getLiveMemoryCount();
+
+	//fill the first chunk, the movable buffer goes to a second one
+	const VkDeviceSize bufferSize = TEST_CHUNK_SIZE / 16;
+	std::vector<VkBuffer> buffers;
+	for (int i = 0; i < 16; ++i) {
+		buffers.push_back(mock::createBuffer(bufferSize));
+		allocator.allocateBufferMemory(buffers.back(), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	}
+	VkBufferCreateInfo bufferInfo{ VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+	bufferInfo.size = bufferSize;
+	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	VkBuffer movable = mock::createBuffer(bufferSize);
+	allocator.allocateBufferMemory(movable, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	allocator.setMovable(movable, bufferInfo);
+	CHECK(mock::getLiveMemoryCount() == liveMemoryCount + 2);
+
+	//first pass moves the buffer into the hole of the first chunk
+	allocator.freeBufferMemory(buffers[7]);
+	vkDestroyBuffer(mock::getDevice(), buffers[7], nullptr);
+	std::vector<MemoryAllocator::DefragmentationMove> moves;
+	CHECK(allocator.defragment(VK_NULL_HANDLE, TEST_CHUNK_SIZE, moves) == bufferSize);
+	CHECK(moves.size() == 1 && moves[0].srcBuffer == movable && moves[0].dstBuffer != VK_NULL_HANDLE);
+	buffers[7] = moves[0].dstBuffer;
+
+	//second pass before the source is freed - only the replacement may move
+	allocator.freeBufferMemory(buffers[3]);
+	vkDestroyBuffer(mock::getDevice(), buffers[3], nullptr);
+	buffers.erase(buffers.begin() + 3);
+	std::vector<MemoryAllocator::DefragmentationMove> secondMoves;
+	allocator.defragment(VK_NULL_HANDLE, TEST_CHUNK_SIZE, secondMoves);
+	for (const auto& move : secondMoves) {
+		CHECK(move.srcBuffer != movable);
+		CHECK(move.srcBuffer == buffers[6]);
+		allocator.freeBufferMemory(move.srcBuffer);
+		vkDestroyBuffer(mock::getDevice(), move.srcBuffer, nullptr);
+		buffers[6] = move.dstBuffer;
+	}
+	checkBindings();
+
+	allocator.freeBufferMemory(movable);
+	vkDestroyBuffer(mock::getDevice(), movable, nullptr);
+	for (VkBuffer buffer : buffers) {
+		allocator.freeBufferMemory(buffer);
+		vkDestroyBuffer(mock::getDevice(), buffer, nullptr);
+	}
+	allocator.cleanup();
+	CHECK(mock::getLiveMemoryCount() == liveMemoryCount);
+}
+
+/*
+* threads allocate & free buffers and images of every path (slab, tlsf, dedicated) on two memory types
+* host visible blocks are filled with a per-allocation byte & checked before free - overlapping blocks corrupt it
+* run under a thread sanitizer to validate the per-memory-type locking
+*/
+void testMemoryAllocatorThreadStress() {
+	MemoryAllocator allocator;
+	initAllocator(allocator);
+	size_t liveMemoryCount = mock::getLiveMemoryCount();
+
+	constexpr int THREAD_COUNT = 8;
+	constexpr int ITERATION_COUNT = 2000;
+	std::vector<std::string> errors(THREAD_COUNT);
+	std::vector<std::thread> threads;
+	for (int threadIndex = 0; threadIndex < THREAD_COUNT; ++threadIndex) {
+		threads.emplace_back([&allocator, &errors, threadIndex]() {
+			struct Resource {
+				VkBuffer buffer;
+				VkImage image;
+				MemoryAllocator::HostVisibleMemory memory;
+				unsigned char pattern;
+			};
+			std::vector<Resource> resources;
+			std::mt19937 random(threadIndex);
+			//slab, tlsf & dedicated (above a quarter of TEST_CHUNK_SIZE) buffer sizes
+			const VkDeviceSize bufferSizes[] = { 256, 4096, 24 * 1024, 200 * 1024, 400 * 1024 };
+			const uint32_t imageSizes[] = { 16, 128, 320 };
+
+			auto release = [&allocator, &errors, threadIndex](const Resource& resource) {
+				if (resource.memory.mappedData != nullptr) {
+					const unsigned char* data = static_cast<const unsigned char*>(resource.memory.mappedData);
+					for (VkDeviceSize i = 0; i < resource.memory.size; i += 64) {
+						if (data[i] != resource.pattern && errors[threadIndex].empty()) {
+							errors[threadIndex] = "host visible block overwritten by another allocation";
+						}
+					}
+				}
+				if (resource.buffer != VK_NULL_HANDLE) {
+					allocator.freeBufferMemory(resource.buffer);
+					vkDestroyBuffer(mock::getDevice(), resource.buffer, nullptr);
+				}
+				else {
+					allocator.freeImageMemory(resource.image);
+					vkDestroyImage(mock::getDevice(), resource.image, nullptr);
+				}
+			};
+
+			for (int iteration = 0; iteration < ITERATION_COUNT; ++iteration) {
+				if (!resources.empty() && random() % 5 < 2) {
+					size_t index = random() % resources.size();
+					release(resources[index]);
+					resources[index] = resources.back();
+					resources.pop_back();
+					continue;
+				}
+
+				Resource resource{};
+				resource.pattern = static_cast<unsigned char>(random());
+				if (random() % 4 == 0) {
+					uint32_t size = imageSizes[random() % 3];
+					resource.image = mock::createImage(size, size);
+					resource.memory = allocator.allocateImageMemory(resource.image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+				}
+				else {
+					VkMemoryPropertyFlags properties = (random() % 2 == 0) ? VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT :
+						VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+					resource.buffer = mock::createBuffer(bufferSizes[random() % 5]);
+					resource.memory = allocator.allocateBufferMemory(resource.buffer, properties);
+				}
+				if (resource.memory.mappedData != nullptr) {
+					std::memset(resource.memory.mappedData, resource.pattern, static_cast<size_t>(resource.memory.size));
+				}
+				resources.push_back(resource);
+			}
+			for (const Resource& resource : resources) {
+				release(resource);
+			}
+		});
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	for (const auto& error : errors) {
+		CHECK(error.empty());
+	}
+	checkBindings();
+
+	//every block is back - only chunks stay reserved
+	std::vector<MemoryAllocator::Statistics> memoryTypeStats;
+	std::vector<MemoryAllocator::HeapStatistics> memoryHeapStats;
+	allocator.getStatistics(memoryTypeStats, memoryHeapStats);
+	for (const auto& stats : memoryTypeStats) {
+		CHECK(stats.usedBytes == 0 && stats.blockCount == 0);
+	}
+
+	allocator.cleanup();
+	CHECK(mock::getLiveMemoryCount() == liveMemoryCount);
+}
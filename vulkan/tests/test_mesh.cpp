@@ -0,0 +1,99 @@
+#include <cstring>
+#include <vector>
+#include "tests.h"
+#include "mock_vulkan.h"
+#include "mock_upload_manager.h"
+#include "core/vulkan_device.h"
+#include "core/vulkan_mesh.h"
+
+namespace {
+	/*
+	* flat grid in the z = 0 plane facing +z, loaded through Mesh::load(vector)
+	*
+	* @param quadCount - quads per side
+	* @param mesh - out
+	*/
+	void loadGrid(uint32_t quadCount, Mesh& mesh) {
+		uint32_t side = quadCount + 1;
+		std::vector<glm::vec3> positions, normals;
+		std::vector<glm::vec2> uvs;
+		std::vector<uint32_t> indices;
+		for (uint32_t y = 0; y < side; ++y) {
+			for (uint32_t x = 0; x < side; ++x) {
+				positions.push_back(glm::vec3(static_cast<float>(x), static_cast<float>(y), 0.f));
+				normals.push_back(glm::vec3(0.f, 0.f, 1.f));
+				uvs.push_back(glm::vec2(x, y) / static_cast<float>(quadCount));
+			}
+		}
+		for (uint32_t y = 0; y < quadCount; ++y) {
+			for (uint32_t x = 0; x < quadCount; ++x) {
+				uint32_t v = y * side + x;
+				indices.insert(indices.end(), { v, v + 1, v + side + 1, v, v + side + 1, v + side });
+			}
+		}
+		mesh.load(positions, normals, uvs, indices, static_cast<uint32_t>(positions.size()), true, true);
+	}
+
+	/*
+	* create the model buffer on the mock backend & check the staged vertex & index bytes
+	*
+	* @param mesh - loaded mesh
+	*/
+	void checkModelBuffer(Mesh& mesh) {
+		VulkanDevice devices;
+		devices.device = mock::getDevice();
+		devices.memoryAllocator.init(mock::getDevice(), 1024, 64, mock::getMemoryProperties());
+		size_t submitCount = mock::getSubmitCount();
+
+		VkBuffer buffer = mesh.createModelBuffer(&devices);
+		CHECK(mock::getSubmitCount() == submitCount + 1);
+
+		//every index is staged - all levels & the cluster copy, nothing more
+		size_t indexSize = mesh.indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+		CHECK(mock::getStagedSize() == mesh.vertices.bufferSize + indexSize * mesh.indices.size());
+		CHECK(mock::isStagingGuardIntact());
+
+		const std::vector<unsigned char>& staged = mock::getStagedData();
+		CHECK(memcmp(staged.data(), mesh.vertices.data(), mesh.vertices.bufferSize) == 0);
+		const unsigned char* stagedIndices = staged.data() + mesh.vertices.bufferSize;
+		for (size_t i = 0; i < mesh.indices.size(); ++i) {
+			uint32_t index = 0;
+			if (mesh.indexType == VK_INDEX_TYPE_UINT16) {
+				uint16_t index16;
+				memcpy(&index16, stagedIndices + i * sizeof(uint16_t), sizeof(index16));
+				index = index16;
+			}
+			else {
+				memcpy(&index, stagedIndices + i * sizeof(uint32_t), sizeof(index));
+			}
+			CHECK(index == mesh.indices[i]);
+		}
+
+		devices.memoryAllocator.freeBufferMemory(buffer);
+		vkDestroyBuffer(mock::getDevice(), buffer, nullptr);
+		devices.memoryAllocator.cleanup();
+	}
+}
+
+/*
+* 16 bit index buffer holds every level & the meshlet ordered copy behind the full detail mesh
+*/
+void testModelBufferStagesEveryIndex16() {
+	Mesh mesh;
+	loadGrid(16, mesh);
+	CHECK(mesh.indexType == VK_INDEX_TYPE_UINT16);
+	CHECK(!mesh.clusters.empty());
+	CHECK(mesh.indices.size() > mesh.lods.back().firstIndex + mesh.lods.back().indexCount);
+	checkModelBuffer(mesh);
+}
+
+/*
+* 32 bit index buffer is staged untruncated - the grid has more vertices than 16 bit indices address
+*/
+void testModelBufferStagesEveryIndex32() {
+	Mesh mesh;
+	loadGrid(256, mesh);
+	CHECK(mesh.indexType == VK_INDEX_TYPE_UINT32);
+	CHECK(mesh.indices.size() > mesh.lods.back().firstIndex + mesh.lods.back().indexCount);
+	checkModelBuffer(mesh);
+}
@@ -0,0 +1,219 @@
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "tests.h"
+#include "mock_vulkan.h"
+#include "mock_upload_manager.h"
+#include "core/vulkan_device.h"
+#include "core/vulkan_mesh.h"
+#include "core/vulkan_mesh_cache.h"
+
+namespace {
+	/*
+	* path of a scratch file in the temp directory
+	*/
+	std::string getTempPath(const char* name) {
+		return (std::filesystem::temp_directory_path() / name).string();
+	}
+
+	/*
+	* write a flat grid obj with normals & texcoords - quads are triangulated by the parser
+	*
+	* @param path - output file
+	* @param quadCount - quads per side
+	*/
+	void writeGridObj(const std::string& path, uint32_t quadCount) {
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		uint32_t side = quadCount + 1;
+		for (uint32_t y = 0; y < side; ++y) {
+			for (uint32_t x = 0; x < side; ++x) {
+				file << "v " << x << " " << y << " " << (x * y) % 3 << "\n";
+				file << "vt " << static_cast<float>(x) / quadCount << " " << static_cast<float>(y) / quadCount << "\n";
+			}
+		}
+		file << "vn 0 0 1\n";
+		for (uint32_t y = 0; y < quadCount; ++y) {
+			for (uint32_t x = 0; x < quadCount; ++x) {
+				uint32_t v = y * side + x + 1;
+				file << "f " << v << "/" << v << "/1 " << v + 1 << "/" << v + 1 << "/1 "
+					<< v + side + 1 << "/" << v + side + 1 << "/1 " << v + side << "/" << v + side << "/1\n";
+			}
+		}
+	}
+
+	/*
+	* create the model buffer on the mock backend
+	*
+	* @return std::vector<unsigned char> - staged vertex & index bytes
+	*/
+	std::vector<unsigned char> stageModelBuffer(Mesh& mesh) {
+		VulkanDevice devices;
+		devices.device = mock::getDevice();
+		devices.memoryAllocator.init(mock::getDevice(), 1024, 64, mock::getMemoryProperties());
+		VkBuffer buffer = mesh.createModelBuffer(&devices);
+		CHECK(mock::isStagingGuardIntact());
+		const std::vector<unsigned char>& staged = mock::getStagedData();
+		std::vector<unsigned char> stagedCopy(staged.begin(), staged.begin() + static_cast<size_t>(mock::getStagedSize()));
+		devices.memoryAllocator.freeBufferMemory(buffer);
+		vkDestroyBuffer(mock::getDevice(), buffer, nullptr);
+		devices.memoryAllocator.cleanup();
+		return stagedCopy;
+	}
+
+	/*
+	* read the header of a cache file
+	*/
+	MeshCacheHeader readHeader(const MappedFile& file) {
+		MeshCacheHeader header{};
+		CHECK(file.size() >= sizeof(header));
+		memcpy(&header, file.data(), sizeof(header));
+		return header;
+	}
+}
+
+/*
+* meshcache::write() output maps back to the same header & blobs
+*/
+void testMeshCacheRoundTrip() {
+	std::string cachePath = getTempPath("test_mesh_cache_round_trip.meshcache");
+	std::vector<float> vertexData(3 * 5);
+	for (size_t i = 0; i < vertexData.size(); ++i) {
+		vertexData[i] = static_cast<float>(i) * 0.5f;
+	}
+	std::vector<uint16_t> indexData = { 0, 1, 2, 2, 3, 4, 0, 2, 4 };
+	std::vector<uint32_t> clusterData(sizeof(meshopt::Cluster) / sizeof(uint32_t), 7);
+
+	MeshCacheHeader header{};
+	header.sourceSize = 1234;
+	header.sourceTime = -56789;
+	header.vertexSize = 3 * sizeof(float);
+	header.vertexCount = 5;
+	header.indexType = 0; //VK_INDEX_TYPE_UINT16
+	header.indexCount = static_cast<uint32_t>(indexData.size());
+	header.lodCount = 2;
+	header.lodFirstIndex[1] = 6;
+	header.lodIndexCount[0] = 6;
+	header.lodIndexCount[1] = 3;
+	header.lodError[1] = 0.25f;
+	header.boundsMin[1] = -1.f;
+	header.boundsMax[2] = 2.f;
+	header.vertexDataSize = sizeof(float) * vertexData.size();
+	header.indexDataSize = sizeof(uint16_t) * indexData.size();
+	header.clusterCount = 1;
+	header.clusterDataSize = sizeof(meshopt::Cluster);
+	CHECK(meshcache::write(cachePath, header, vertexData.data(), indexData.data(), clusterData.data()));
+
+	{
+		MappedFile file;
+		CHECK(file.open(cachePath));
+		MeshCacheHeader mapped = readHeader(file);
+		CHECK(mapped.isValid(file.size(), header.sourceSize, header.sourceTime));
+		CHECK(!mapped.isValid(file.size(), header.sourceSize + 1, header.sourceTime));
+		CHECK(!mapped.isValid(file.size(), header.sourceSize, header.sourceTime + 1));
+
+		CHECK(mapped.vertexCount == header.vertexCount && mapped.indexCount == header.indexCount);
+		CHECK(mapped.lodCount == 2 && mapped.lodFirstIndex[1] == 6 && mapped.lodIndexCount[1] == 3);
+		CHECK(mapped.lodError[1] == 0.25f);
+		CHECK(mapped.boundsMin[1] == -1.f && mapped.boundsMax[2] == 2.f);
+		CHECK(mapped.vertexOffset % MeshCacheHeader::BLOB_ALIGNMENT == 0);
+		CHECK(mapped.indexOffset % MeshCacheHeader::BLOB_ALIGNMENT == 0);
+		CHECK(mapped.clusterOffset % MeshCacheHeader::BLOB_ALIGNMENT == 0);
+		CHECK(memcmp(file.data() + mapped.vertexOffset, vertexData.data(), header.vertexDataSize) == 0);
+		CHECK(memcmp(file.data() + mapped.indexOffset, indexData.data(), header.indexDataSize) == 0);
+		CHECK(memcmp(file.data() + mapped.clusterOffset, clusterData.data(), header.clusterDataSize) == 0);
+
+		//a truncated blob is out of the file
+		CHECK(!mapped.isValid(static_cast<size_t>(mapped.clusterOffset + mapped.clusterDataSize - 1),
+			header.sourceSize, header.sourceTime));
+	}
+	std::filesystem::remove(cachePath);
+}
+
+/*
+* a mesh loaded from the cache is the mesh that was written - same layout, levels, clusters & gpu buffer bytes
+*/
+void testMeshCacheLoadMatchesParse() {
+	std::string objPath = getTempPath("test_mesh_cache_load.obj");
+	std::string cachePath = meshcache::getCachePath(objPath);
+	std::filesystem::remove(cachePath);
+	writeGridObj(objPath, 24);
+
+	{
+		Mesh parsed(objPath);
+		CHECK(!parsed.loadStatistics.cacheHit);
+		CHECK(std::filesystem::exists(cachePath));
+		std::vector<unsigned char> parsedBuffer = stageModelBuffer(parsed);
+
+		Mesh cached(objPath);
+		CHECK(cached.loadStatistics.cacheHit);
+		CHECK(cached.indices.empty());
+		CHECK(cached.vertexSize == parsed.vertexSize && cached.vertexCount == parsed.vertexCount);
+		CHECK(cached.indexType == parsed.indexType && cached.indexCount == parsed.indexCount);
+		CHECK(cached.boundsMin == parsed.boundsMin && cached.boundsMax == parsed.boundsMax);
+		CHECK(cached.lods.size() == parsed.lods.size());
+		for (size_t i = 0; i < cached.lods.size(); ++i) {
+			CHECK(cached.lods[i].firstIndex == parsed.lods[i].firstIndex);
+			CHECK(cached.lods[i].indexCount == parsed.lods[i].indexCount);
+			CHECK(cached.lods[i].error == parsed.lods[i].error);
+		}
+		CHECK(cached.clusters.size() == parsed.clusters.size());
+		CHECK(memcmp(cached.clusters.data(), parsed.clusters.data(), sizeof(meshopt::Cluster) * cached.clusters.size()) == 0);
+		CHECK(stageModelBuffer(cached) == parsedBuffer);
+	}
+	std::filesystem::remove(cachePath);
+	std::filesystem::remove(objPath);
+}
+
+/*
+* a cache of an older source or a truncated cache isn't used - it is rebuilt from the source & used next time
+*/
+void testMeshCacheRebuildsStaleAndTruncated() {
+	std::string objPath = getTempPath("test_mesh_cache_rebuild.obj");
+	std::string cachePath = meshcache::getCachePath(objPath);
+	std::filesystem::remove(cachePath);
+	writeGridObj(objPath, 8);
+	{
+		Mesh mesh(objPath);
+		CHECK(!mesh.loadStatistics.cacheHit);
+	}
+
+	//stale - the source changed after the cache was written
+	writeGridObj(objPath, 12);
+	{
+		MappedFile file;
+		CHECK(file.open(cachePath));
+		uint64_t sourceSize = 0;
+		int64_t sourceTime = 0;
+		CHECK(meshcache::getSourceStamp(objPath, sourceSize, sourceTime));
+		CHECK(!readHeader(file).isValid(file.size(), sourceSize, sourceTime));
+	}
+	{
+		Mesh mesh(objPath);
+		CHECK(!mesh.loadStatistics.cacheHit);
+		CHECK(mesh.loadStatistics.vertexCount == 13 * 13);
+	}
+	{
+		Mesh mesh(objPath);
+		CHECK(mesh.loadStatistics.cacheHit);
+		CHECK(mesh.vertexCount == 13 * 13);
+	}
+
+	//truncated - blobs run past the end of the file, or not even the header is left
+	uint64_t truncatedSizes[] = { std::filesystem::file_size(cachePath) - 1, sizeof(MeshCacheHeader) / 2 };
+	for (uint64_t truncatedSize : truncatedSizes) {
+		std::filesystem::resize_file(cachePath, truncatedSize);
+		{
+			Mesh mesh(objPath);
+			CHECK(!mesh.loadStatistics.cacheHit);
+			CHECK(mesh.vertexCount == 13 * 13);
+		}
+		{
+			Mesh mesh(objPath);
+			CHECK(mesh.loadStatistics.cacheHit);
+		}
+	}
+	std::filesystem::remove(cachePath);
+	std::filesystem::remove(objPath);
+}
@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+#include "tests.h"
+#include "core/vulkan_mesh_optimizer.h"
+
+namespace {
+	/*
+	* flat grid in the z = 0 plane, counter clockwise triangles facing +z
+	*
+	* @param quadCount - quads per side
+	* @param positions - out, xyz per vertex
+	* @param indices - out, triangle list
+	*/
+	void buildGrid(uint32_t quadCount, std::vector<float>& positions, std::vector<uint32_t>& indices) {
+		uint32_t side = quadCount + 1;
+		positions.clear();
+		indices.clear();
+		for (uint32_t y = 0; y < side; ++y) {
+			for (uint32_t x = 0; x < side; ++x) {
+				positions.insert(positions.end(), { static_cast<float>(x), static_cast<float>(y), 0.f });
+			}
+		}
+		for (uint32_t y = 0; y < quadCount; ++y) {
+			for (uint32_t x = 0; x < quadCount; ++x) {
+				uint32_t v = y * side + x;
+				indices.insert(indices.end(), { v, v + 1, v + side + 1, v, v + side + 1, v + side });
+			}
+		}
+	}
+
+	/*
+	* every triangle of the list once, as a sorted multiset
+	*/
+	std::vector<std::array<uint32_t, 3>> sortedTriangles(const uint32_t* indices, size_t indexCount) {
+		std::vector<std::array<uint32_t, 3>> triangles;
+		for (size_t i = 0; i < indexCount; i += 3) {
+			triangles.push_back({ indices[i], indices[i + 1], indices[i + 2] });
+		}
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+}
+
+/*
+* meshlets respect the vertex / triangle limits and cover every input triangle exactly once
+*/
+void testMeshletLimitsAndCoverage() {
+	std::vector<float> positions;
+	std::vector<uint32_t> indices;
+	buildGrid(40, positions, indices);
+	size_t vertexCount = positions.size() / 3;
+
+	std::vector<meshopt::Meshlet> meshlets;
+	std::vector<uint32_t> meshletVertices;
+	std::vector<uint8_t> meshletTriangles;
+	meshopt::buildMeshlets(meshlets, meshletVertices, meshletTriangles, indices.data(), indices.size(), vertexCount);
+	CHECK(!meshlets.empty());
+
+	std::vector<uint32_t> emitted;
+	for (const meshopt::Meshlet& meshlet : meshlets) {
+		CHECK(meshlet.vertexCount > 0 && meshlet.vertexCount <= meshopt::MESHLET_MAX_VERTICES);
+		CHECK(meshlet.triangleCount > 0 && meshlet.triangleCount <= meshopt::MESHLET_MAX_TRIANGLES);
+		for (uint32_t i = 0; i < meshlet.triangleCount * 3; ++i) {
+			uint8_t local = meshletTriangles[(meshlet.triangleOffset * 3) + i];
+			CHECK(local < meshlet.vertexCount);
+			emitted.push_back(meshletVertices[meshlet.vertexOffset + local]);
+		}
+	}
+	CHECK(sortedTriangles(emitted.data(), emitted.size()) == sortedTriangles(indices.data(), indices.size()));
+}
+
+/*
+* bounding sphere contains every vertex, the normal cone of a flat patch points along its normal
+* and a closed cube disables cone culling
+*/
+void testMeshletBounds() {
+	std::vector<float> positions;
+	std::vector<uint32_t> indices;
+	buildGrid(4, positions, indices);
+
+	std::vector<meshopt::Meshlet> meshlets;
+	std::vector<uint32_t> meshletVertices;
+	std::vector<uint8_t> meshletTriangles;
+	meshopt::buildMeshlets(meshlets, meshletVertices, meshletTriangles, indices.data(), indices.size(), positions.size() / 3);
+	CHECK(meshlets.size() == 1);
+	meshopt::MeshletBounds bounds = meshopt::computeMeshletBounds(meshletVertices.data(), meshletTriangles.data(),
+		meshlets[0].triangleCount, positions.data(), sizeof(float) * 3);
+	for (size_t v = 0; v < positions.size(); v += 3) {
+		float dx = positions[v] - bounds.center[0], dy = positions[v + 1] - bounds.center[1], dz = positions[v + 2] - bounds.center[2];
+		CHECK(std::sqrt(dx * dx + dy * dy + dz * dz) <= bounds.radius * 1.0001f);
+	}
+	CHECK(std::fabs(bounds.coneAxis[2] - 1.f) < 1e-5f);
+	CHECK(bounds.coneCutoff < 1e-3f);
+
+	//unit cube, outward facing
+	const float cube[] = { 0, 0, 0,  1, 0, 0,  1, 1, 0,  0, 1, 0,  0, 0, 1,  1, 0, 1,  1, 1, 1,  0, 1, 1 };
+	const uint32_t cubeIndices[] = {
+		0, 2, 1, 0, 3, 2,  4, 5, 6, 4, 6, 7,  0, 1, 5, 0, 5, 4,
+		1, 2, 6, 1, 6, 5,  2, 3, 7, 2, 7, 6,  3, 0, 4, 3, 4, 7 };
+	meshopt::buildMeshlets(meshlets, meshletVertices, meshletTriangles, cubeIndices, 36, 8);
+	CHECK(meshlets.size() == 1);
+	bounds = meshopt::computeMeshletBounds(meshletVertices.data(), meshletTriangles.data(),
+		meshlets[0].triangleCount, cube, sizeof(float) * 3);
+	CHECK(bounds.coneCutoff == 1.f);
+	CHECK(std::fabs(bounds.radius - std::sqrt(0.75f)) < 1e-5f);
+}
+
+/*
+* clusters index a meshlet ordered copy appended after the source range, which is left untouched
+*/
+void testBuildClustersKeepsSourceOrder() {
+	std::vector<float> positions;
+	std::vector<uint32_t> indices;
+	buildGrid(24, positions, indices);
+	const std::vector<uint32_t> source = indices;
+
+	std::vector<meshopt::Cluster> clusters = meshopt::buildClusters(indices, 0, source.size(),
+		positions.data(), sizeof(float) * 3, positions.size() / 3);
+	CHECK(indices.size() == source.size() * 2);
+	CHECK(std::equal(source.begin(), source.end(), indices.begin()));
+
+	uint32_t firstIndex = static_cast<uint32_t>(source.size());
+	for (const meshopt::Cluster& cluster : clusters) {
+		CHECK(cluster.firstIndex == firstIndex);
+		CHECK(cluster.indexCount > 0 && cluster.indexCount <= meshopt::MESHLET_MAX_TRIANGLES * 3);
+		firstIndex += cluster.indexCount;
+	}
+	CHECK(firstIndex == indices.size());
+	CHECK(sortedTriangles(indices.data() + source.size(), source.size()) == sortedTriangles(source.data(), source.size()));
+}
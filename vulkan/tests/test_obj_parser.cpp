@@ -0,0 +1,145 @@
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "tests.h"
+#include "core/vulkan_obj_parser.h"
+
+namespace {
+	/** snippets are repeated past this size - objparser gives every MiB its own chunk, so up to 4 chunks are parsed */
+	constexpr size_t REPEATED_SIZE = (7 << 20) / 2;
+	/** worker counts compared against tinyobj - 1 is the sequential path */
+	const uint32_t THREAD_COUNTS[] = { 1, 2, 3, 8 };
+
+	/** triangles & polygons with every face corner format, comments, blank lines & tabs */
+	const char* POLYGON_OBJ =
+		"# polygons\n"
+		"v 0 0 0\n"
+		"v 1.0 0 0\n"
+		"v 1 1e0 0\n"
+		"v 0 1 -0.5E-1\n"
+		"v -0.5 0.5 .25\n"
+		"vt 0 0\n"
+		"vt 1 0\n"
+		"vt 1 1\n"
+		"vt 0 1\n"
+		"vn 0 0 1\n"
+		"vn 0 0 -1\n"
+		"\n"
+		"f 1 2 3\n"
+		"f 1/1 2/2 3/3 4/4\n"
+		"f 1//1 2//1 3//2 4//2 5//1\n"
+		"o second\n"
+		"s off\n"
+		"f 1/1/1 2/2/1 3/3/2\n"
+		"\tf\t2/2/2  3/3/2\t4/4/1 \n";
+
+	/** relative (negative) indices, alone & mixed with absolute ones */
+	const char* RELATIVE_OBJ =
+		"v 0 0 0\n"
+		"v 1 0 0\n"
+		"v 1 1 0\n"
+		"v 0 1 0\n"
+		"vt 0 0\n"
+		"vt 1 1\n"
+		"vn 0 1 0\n"
+		"f -4 -3 -2\n"
+		"f -4/-2/-1 -2/-1/-1 -1/-2/-1\n"
+		"f -4//-1 -3//-1 -2//-1 -1//-1\n"
+		"f 1 -3/1 -2\n";
+
+	/*
+	* repeat the snippet until the text is larger than REPEATED_SIZE
+	*/
+	std::string repeat(const std::string& snippet) {
+		std::string text;
+		text.reserve(REPEATED_SIZE + snippet.size());
+		while (text.size() < REPEATED_SIZE) {
+			text += snippet;
+		}
+		return text;
+	}
+
+	/*
+	* replace every \n with lineEnd
+	*/
+	std::string replaceLineEnds(const std::string& text, const std::string& lineEnd) {
+		std::string replaced;
+		replaced.reserve(text.size() * lineEnd.size());
+		for (char c : text) {
+			if (c == '\n') {
+				replaced += lineEnd;
+			}
+			else {
+				replaced += c;
+			}
+		}
+		return replaced;
+	}
+
+	/*
+	* parse the obj text with tinyobj::LoadObj() & with objparser::load() at every thread count, compare the output
+	*
+	* @param text - obj file content
+	*/
+	void checkMatchesTinyobj(const std::string& text) {
+		std::string path = (std::filesystem::temp_directory_path() / "test_obj_parser.obj").string();
+		{
+			std::ofstream file(path, std::ios::binary | std::ios::trunc);
+			file.write(text.data(), static_cast<std::streamsize>(text.size()));
+			CHECK(file.good());
+		}
+
+		tinyobj::attrib_t expectedAttrib;
+		std::vector<tinyobj::shape_t> shapes;
+		std::vector<tinyobj::material_t> materials;
+		std::string error;
+		CHECK(tinyobj::LoadObj(&expectedAttrib, &shapes, &materials, &error, path.c_str()));
+		//objparser keeps the face corners of all shapes in file order
+		std::vector<tinyobj::index_t> expectedIndices;
+		for (const tinyobj::shape_t& shape : shapes) {
+			expectedIndices.insert(expectedIndices.end(), shape.mesh.indices.begin(), shape.mesh.indices.end());
+		}
+		CHECK(!expectedIndices.empty());
+
+		for (uint32_t threadCount : THREAD_COUNTS) {
+			tinyobj::attrib_t attrib;
+			std::vector<tinyobj::index_t> indices;
+			CHECK(objparser::load(path, attrib, indices, threadCount));
+			CHECK(attrib.vertices == expectedAttrib.vertices);
+			CHECK(attrib.normals == expectedAttrib.normals);
+			CHECK(attrib.texcoords == expectedAttrib.texcoords);
+			CHECK(indices.size() == expectedIndices.size());
+			for (size_t i = 0; i < indices.size(); ++i) {
+				CHECK(indices[i].vertex_index == expectedIndices[i].vertex_index);
+				CHECK(indices[i].normal_index == expectedIndices[i].normal_index);
+				CHECK(indices[i].texcoord_index == expectedIndices[i].texcoord_index);
+			}
+		}
+		std::remove(path.c_str());
+	}
+}
+
+/*
+* triangles & fan triangulated polygons match tinyobj at every thread count
+*/
+void testObjParserPolygons() {
+	checkMatchesTinyobj(repeat(POLYGON_OBJ));
+}
+
+/*
+* \r\n & lone \r end lines like \n - chunk borders may fall between \r & \n
+*/
+void testObjParserLineEndings() {
+	checkMatchesTinyobj(repeat(replaceLineEnds(POLYGON_OBJ, "\r\n")));
+	checkMatchesTinyobj(repeat(replaceLineEnds(POLYGON_OBJ, "\r")));
+	checkMatchesTinyobj(repeat(replaceLineEnds(RELATIVE_OBJ, "\r\n")));
+}
+
+/*
+* relative indices resolve against the elements of all previous chunks
+*/
+void testObjParserRelativeIndices() {
+	checkMatchesTinyobj(repeat(RELATIVE_OBJ));
+}
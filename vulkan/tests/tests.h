@@ -0,0 +1,42 @@
+#pragma once
+#include <stdexcept>
+#include <string>
+
+/*
+* throws runtime error with the failed condition & its location - caught by the test runner
+*
+* @param condition - expression expected to be true
+*/
+#define CHECK(condition){															\
+	if (!(condition)) {																\
+		throw std::runtime_error(std::string(__FILE__) + ", line " +				\
+			std::to_string(__LINE__) + ": " + #condition + " has been failed");	\
+	}																				\
+}
+
+/*
+* cpu only tests - run by tests.exe, every test throws on failure
+*/
+//memory allocator on the mock device memory backend
+void testMemoryAllocatorExactFit();
+void testMemoryAllocatorDefragmentMovesOnce();
+void testMemoryAllocatorThreadStress();
+
+//meshlet partitioning & bounds
+void testMeshletLimitsAndCoverage();
+void testMeshletBounds();
+void testBuildClustersKeepsSourceOrder();
+
+//mesh model buffer on the mock backend & upload manager
+void testModelBufferStagesEveryIndex16();
+void testModelBufferStagesEveryIndex32();
+
+//binary mesh cache
+void testMeshCacheRoundTrip();
+void testMeshCacheLoadMatchesParse();
+void testMeshCacheRebuildsStaleAndTruncated();
+
+//parallel obj parser against tinyobj::LoadObj
+void testObjParserPolygons();
+void testObjParserLineEndings();
+void testObjParserRelativeIndices();